@@ -207,6 +207,7 @@ Client::Client(Messenger *m, MonClient *mc)
 				  cct->_conf->client_oc_target_dirty,
 				  cct->_conf->client_oc_max_dirty_age,
 				  true);
+  objectcacher->set_replacement_policy(cct->_conf->client_oc_replacement_policy);
   objecter_finisher.start();
   filer = new Filer(objecter);
 }
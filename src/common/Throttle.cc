@@ -33,6 +33,7 @@ Throttle::Throttle(CephContext *cct, std::string n, int64_t m, bool _use_perf)
   : cct(cct), name(n), logger(NULL),
 		max(m),
     lock("Throttle::lock"),
+    waiters(0),
     use_perf(_use_perf)
 {
   assert(m >= 0);
@@ -91,6 +92,9 @@ bool Throttle::_wait(int64_t c)
 {
   utime_t start;
   bool waited = false;
+  // register before looking at count: put() only takes the lock to
+  // wake us if it sees a waiter after it has released its share.
+  waiters.inc();
   if (_should_wait(c) || !cond.empty()) { // always wait behind other waiters.
     Cond *cv = new Cond;
     cond.push_back(cv);
@@ -119,6 +123,7 @@ bool Throttle::_wait(int64_t c)
     if (!cond.empty())
       cond.front()->SignalOne();
   }
+  waiters.dec();
   return waited;
 }
 
@@ -144,10 +149,7 @@ int64_t Throttle::take(int64_t c)
   }
   assert(c >= 0);
   ldout(cct, 10) << "take " << c << dendl;
-  {
-    Mutex::Locker l(lock);
-    count.add(c);
-  }
+  count.add(c);
   if (logger) {
     logger->inc(l_throttle_take);
     logger->inc(l_throttle_take_sum, c);
@@ -220,10 +222,7 @@ int64_t Throttle::put(int64_t c)
 
   assert(c >= 0);
   ldout(cct, 10) << "put " << c << " (" << count.read() << " -> " << (count.read()-c) << ")" << dendl;
-  Mutex::Locker l(lock);
   if (c) {
-    if (!cond.empty())
-      cond.front()->SignalOne();
     assert(((int64_t)count.read()) >= c); //if count goes negative, we failed somewhere!
     count.sub(c);
     if (logger) {
@@ -231,6 +230,12 @@ int64_t Throttle::put(int64_t c)
       logger->inc(l_throttle_put_sum, c);
       logger->set(l_throttle_val, count.read());
     }
+    // the uncontended case (no one in _wait) never touches the lock
+    if (waiters.read()) {
+      Mutex::Locker l(lock);
+      if (!cond.empty())
+	cond.front()->SignalOne();
+    }
   }
   return count.read();
 }
@@ -19,6 +19,7 @@ class Throttle {
 	ceph::atomic_t count, max;
   Mutex lock;
   list<Cond*> cond;
+  ceph::atomic_t waiters;  ///< threads in _wait; lets put() skip the lock
   bool use_perf;
   
 public:
@@ -0,0 +1,69 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_TOKENBUCKET_H
+#define CEPH_COMMON_TOKENBUCKET_H
+
+#include "include/utime.h"
+
+/**
+ * rate limiter for work whose cost is only known afterwards
+ *
+ * Tokens accumulate at rate per second, up to one second worth.  take()
+ * may overdraw the bucket; get_delay() says how long until it is out of
+ * debt again.  A rate of 0 means unlimited.
+ *
+ * Not thread safe; callers provide their own locking.
+ */
+class TokenBucket {
+  double rate;
+  double avail;
+  utime_t last;
+
+public:
+  TokenBucket() : rate(0), avail(0) {}
+
+  /// change the rate; starts over with a full bucket
+  void set_rate(double r) {
+    rate = r;
+    avail = r;
+  }
+  double get_rate() const { return rate; }
+  double get_avail() const { return avail; }
+
+  void refill(utime_t now) {
+    if (last == utime_t() || now < last) {
+      last = now;
+      return;
+    }
+    avail += rate * (double)(now - last);
+    if (avail > rate)
+      avail = rate;
+    last = now;
+  }
+
+  void take(utime_t now, double n) {
+    refill(now);
+    if (rate > 0)
+      avail -= n;
+  }
+
+  /// seconds until the bucket is out of debt
+  double get_delay(utime_t now) {
+    refill(now);
+    if (rate <= 0 || avail >= 0)
+      return 0;
+    return -avail / rate;
+  }
+};
+
+#endif
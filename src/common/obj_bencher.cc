@@ -26,6 +26,7 @@
 #include <time.h>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 
 
 const std::string BENCH_LASTRUN_METADATA = "benchmark_last_metadata";
@@ -264,6 +265,15 @@ static double vec_stddev(vector<double>& v)
   return sqrt(stddev);
 }
 
+static double vec_percentile(vector<double> v, double pct)
+{
+  if (v.empty())
+    return 0;
+  size_t n = (size_t)((v.size() - 1) * pct / 100.0);
+  nth_element(v.begin(), v.begin() + n, v.end());
+  return v[n];
+}
+
 int ObjBencher::fetch_bench_metadata(const std::string& metadata_file, int* object_size, int* num_objects, int* prevPid) {
   int r = 0;
   bufferlist object_data;
@@ -459,7 +469,8 @@ int ObjBencher::write_bench(int secondsToRun, int maxObjectsToCreate,
        << "Average Latency:        " << data.avg_latency << std::endl
        << "Stddev Latency:         " << vec_stddev(data.history.latency) << std::endl
        << "Max latency:            " << data.max_latency << std::endl
-       << "Min latency:            " << data.min_latency << std::endl;
+       << "Min latency:            " << data.min_latency << std::endl
+       << "99th pct latency:       " << vec_percentile(data.history.latency, 99) << std::endl;
 
   //write object size/number data for read benchmarks
   ::encode(data.object_size, b_write);
@@ -573,6 +584,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(cct) - start_times[slot];
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if( data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -616,6 +628,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(cct) - start_times[slot];
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -650,8 +663,10 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
        << "Read size:            " << data.object_size << std::endl
        << "Bandwidth (MB/sec):    " << bw << std::endl
        << "Average Latency:       " << data.avg_latency << std::endl
+       << "Stddev Latency:        " << vec_stddev(data.history.latency) << std::endl
        << "Max latency:           " << data.max_latency << std::endl
-       << "Min latency:           " << data.min_latency << std::endl;
+       << "Min latency:           " << data.min_latency << std::endl
+       << "99th pct latency:      " << vec_percentile(data.history.latency, 99) << std::endl;
 
   completions_done();
 
@@ -760,6 +775,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(g_ceph_context) - start_times[slot];
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if( data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -803,6 +819,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
       goto ERR;
     }
     data.cur_latency = ceph_clock_now(g_ceph_context) - start_times[slot];
+    data.history.latency.push_back(data.cur_latency);
     total_latency += data.cur_latency;
     if (data.cur_latency > data.max_latency) data.max_latency = data.cur_latency;
     if (data.cur_latency < data.min_latency) data.min_latency = data.cur_latency;
@@ -837,8 +854,10 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
        << "Read size:            " << data.object_size << std::endl
        << "Bandwidth (MB/sec):    " << bw << std::endl
        << "Average Latency:       " << data.avg_latency << std::endl
+       << "Stddev Latency:        " << vec_stddev(data.history.latency) << std::endl
        << "Max latency:           " << data.max_latency << std::endl
-       << "Min latency:           " << data.min_latency << std::endl;
+       << "Min latency:           " << data.min_latency << std::endl
+       << "99th pct latency:      " << vec_percentile(data.history.latency, 99) << std::endl;
 
   completions_done();
 
@@ -0,0 +1,131 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <assert.h>
+#include <string.h>
+
+#include "include/xor_region.h"
+
+#include "arch/probe.h"
+#include "arch/intel.h"
+
+#define XOR_SSE2_BLOCK 64
+#define XOR_SSE2_MAX_SRC 256
+
+static inline bool is_aligned(const void *p, uintptr_t align)
+{
+  return ((uintptr_t)p & (align - 1)) == 0;
+}
+
+static bool all_aligned(unsigned char **src, unsigned char *parity,
+			int src_size, uintptr_t align)
+{
+  if (!is_aligned(parity, align))
+    return false;
+  for (int i = 0; i < src_size; i++)
+    if (!is_aligned(src[i], align))
+      return false;
+  return true;
+}
+
+void ceph_xor_region_generic(unsigned char **src, unsigned char *parity,
+			     int src_size, unsigned size)
+{
+  if (!src_size || !size)
+    return;
+  if (parity != src[0])
+    memcpy(parity, src[0], size);
+  unsigned words = 0;
+  if (all_aligned(src, parity, src_size, sizeof(uint64_t)))
+    words = size / sizeof(uint64_t);
+  for (int i = 1; i < src_size; i++) {
+    const uint64_t *s = (const uint64_t *)src[i];
+    uint64_t *p = (uint64_t *)parity;
+    for (unsigned w = 0; w < words; w++)
+      p[w] ^= s[w];
+    for (unsigned b = words * sizeof(uint64_t); b < size; b++)
+      parity[b] ^= src[i][b];
+  }
+}
+
+#ifdef __x86_64__
+int ceph_xor_region_sse2_exists(void)
+{
+  return 1;
+}
+
+void ceph_xor_region_sse2(unsigned char **src, unsigned char *parity,
+			  int src_size, unsigned size)
+{
+  if (!src_size || !size)
+    return;
+  if (src_size > XOR_SSE2_MAX_SRC ||
+      !all_aligned(src, parity, src_size, 16)) {
+    ceph_xor_region_generic(src, parity, src_size, size);
+    return;
+  }
+
+  unsigned region = size - size % XOR_SSE2_BLOCK;
+  unsigned char *p = parity;
+  for (unsigned i = 0; i < region; i += XOR_SSE2_BLOCK) {
+    asm volatile("movdqa %0,%%xmm0" : : "m" (src[0][i]));
+    asm volatile("movdqa %0,%%xmm1" : : "m" (src[0][i + 16]));
+    asm volatile("movdqa %0,%%xmm2" : : "m" (src[0][i + 32]));
+    asm volatile("movdqa %0,%%xmm3" : : "m" (src[0][i + 48]));
+    for (int d = 1; d < src_size; d++) {
+      asm volatile("movdqa %0,%%xmm4" : : "m" (src[d][i]));
+      asm volatile("movdqa %0,%%xmm5" : : "m" (src[d][i + 16]));
+      asm volatile("movdqa %0,%%xmm6" : : "m" (src[d][i + 32]));
+      asm volatile("movdqa %0,%%xmm7" : : "m" (src[d][i + 48]));
+      asm volatile("pxor %xmm4,%xmm0");
+      asm volatile("pxor %xmm5,%xmm1");
+      asm volatile("pxor %xmm6,%xmm2");
+      asm volatile("pxor %xmm7,%xmm3");
+    }
+    asm volatile("movntdq %%xmm0,%0" : "=m" (p[i]));
+    asm volatile("movntdq %%xmm1,%0" : "=m" (p[i + 16]));
+    asm volatile("movntdq %%xmm2,%0" : "=m" (p[i + 32]));
+    asm volatile("movntdq %%xmm3,%0" : "=m" (p[i + 48]));
+  }
+  asm volatile("sfence" : : : "memory");
+
+  if (region < size) {
+    unsigned char *tail[XOR_SSE2_MAX_SRC];
+    for (int d = 0; d < src_size; d++)
+      tail[d] = src[d] + region;
+    ceph_xor_region_generic(tail, parity + region, src_size, size - region);
+  }
+}
+#else
+int ceph_xor_region_sse2_exists(void)
+{
+  return 0;
+}
+
+void ceph_xor_region_sse2(unsigned char **src, unsigned char *parity,
+			  int src_size, unsigned size)
+{
+  assert(0);
+}
+#endif
+
+/*
+ * choose best implementation based on the CPU architecture.
+ */
+ceph_xor_region_func_t ceph_choose_xor_region(void)
+{
+  // make sure we've probed cpu features; this might depend on the
+  // link order of this file relative to arch/probe.cc.
+  ceph_arch_probe();
+
+  if (ceph_arch_intel_sse2 && ceph_xor_region_sse2_exists())
+    return ceph_xor_region_sse2;
+
+  // default
+  return ceph_xor_region_generic;
+}
+
+/*
+ * static global, see ceph_crc32c_func.
+ */
+ceph_xor_region_func_t ceph_xor_region_func = ceph_choose_xor_region();
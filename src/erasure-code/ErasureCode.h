@@ -51,6 +51,10 @@ namespace ceph {
     virtual int encode_chunks(const set<int> &want_to_encode,
                               map<int, bufferlist> *encoded);
 
+    virtual bool supports_encode_chunks() const {
+      return false;
+    }
+
     virtual int decode(const set<int> &want_to_read,
                        const map<int, bufferlist> &chunks,
                        map<int, bufferlist> *decoded);
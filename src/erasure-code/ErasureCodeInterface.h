@@ -307,6 +307,28 @@ namespace ceph {
     virtual int encode_chunks(const set<int> &want_to_encode,
                               map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Return true if **encode_chunks** and **decode_chunks** can be
+     * called directly with buffers prepared by the caller.
+     *
+     * For **encode_chunks**, **encoded** must then hold all
+     * **get_chunk_count()** chunks, in the order before
+     * **get_chunk_mapping()** is applied. Each chunk is a single
+     * contiguous buffer of **get_chunk_size(stripe_width)** bytes.
+     * The parity chunks are overwritten.
+     *
+     * For **decode_chunks**, **decoded** must hold a buffer like
+     * this for every chunk. Those missing from **chunks** are
+     * overwritten.
+     *
+     * All buffers must be aligned on at least 64 bytes. This lets
+     * the caller place chunks in buffers it already has instead of
+     * the copies made by **encode** and **decode**.
+     *
+     * @return **true** if the chunk level methods may be used directly
+     */
+    virtual bool supports_encode_chunks() const = 0;
+
     /**
      * Decode the **chunks** and store at least **want_to_read**
      * chunks in **decoded**.
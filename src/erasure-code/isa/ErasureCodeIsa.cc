@@ -19,14 +19,17 @@
 // -----------------------------------------------------------------------------
 #include "common/debug.h"
 #include "ErasureCodeIsa.h"
-#include "xor_op.h"
 #include "crush/CrushWrapper.h"
 #include "osd/osd_types.h"
+#include "include/xor_region.h"
 // -----------------------------------------------------------------------------
 extern "C" {
 #include "isa-l/include/erasure_code.h"
 }
 // -----------------------------------------------------------------------------
+// chunks are aligned for the 16 byte loads of the xor and gf kernels
+#define EC_ISA_VECTOR_OP_WORDSIZE 16
+// -----------------------------------------------------------------------------
 #define dout_subsys ceph_subsys_osd
 #undef dout_prefix
 #define dout_prefix _prefix(_dout)
@@ -131,7 +134,7 @@ ErasureCodeIsaDefault::isa_encode(char **data,
   
   if (m==1)
     // single parity stripe
-    region_xor( (unsigned char**) data, (unsigned char*) coding[0], k, blocksize );
+    ceph_xor_region((unsigned char**) data, (unsigned char*) coding[0], k, blocksize);
   else
     ec_encode_data(blocksize, k, m, g_encode_tbls,
 		   (unsigned char**) data, (unsigned char**) coding);
@@ -271,7 +274,7 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
     // single parity decoding
     assert (1 == nerrs);
     dout(20) << "isa_decode: reconstruct using region xor [" << erasures[0] << "]" << dendl;
-    region_xor(recover_source, recover_target[0], k, blocksize);
+    ceph_xor_region(recover_source, recover_target[0], k, blocksize);
     return 0;
   }
 
@@ -283,7 +286,7 @@ ErasureCodeIsaDefault::isa_decode(int *erasures,
     dout(20) << "isa_decode: reconstruct using region xor [" << erasures[0] << "]" << dendl;
     assert(1 == s);
     assert(k == r);
-    region_xor(recover_source, recover_target[0], k, blocksize);
+    ceph_xor_region(recover_source, recover_target[0], k, blocksize);
     return 0;
   }
 
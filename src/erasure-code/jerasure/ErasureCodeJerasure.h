@@ -64,6 +64,10 @@ public:
   virtual int encode_chunks(const set<int> &want_to_encode,
 			    map<int, bufferlist> *encoded);
 
+  virtual bool supports_encode_chunks() const {
+    return true;
+  }
+
   virtual int decode_chunks(const set<int> &want_to_read,
 			    const map<int, bufferlist> &chunks,
 			    map<int, bufferlist> *decoded);
@@ -0,0 +1,390 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <errno.h>
+#include <algorithm>
+
+#include "common/debug.h"
+#include "crush/CrushWrapper.h"
+#include "osd/osd_types.h"
+#include "include/xor_region.h"
+#include "erasure-code/ErasureCodePlugin.h"
+#include "ErasureCodeLrc.h"
+
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix _prefix(_dout)
+
+static ostream& _prefix(std::ostream* _dout)
+{
+  return *_dout << "ErasureCodeLrc: ";
+}
+
+static void get_string(const string &name,
+		       const map<std::string,std::string> &parameters,
+		       string *value)
+{
+  map<string,string>::const_iterator parameter = parameters.find(name);
+  if (parameter != parameters.end())
+    *value = parameter->second;
+}
+
+int ErasureCodeLrc::create_ruleset(const string &name,
+				   CrushWrapper &crush,
+				   ostream *ss) const
+{
+  if (ruleset_locality.empty()) {
+    int ruleid = crush.add_simple_ruleset(name, ruleset_root,
+					  ruleset_failure_domain,
+					  "indep", pg_pool_t::TYPE_ERASURE, ss);
+    if (ruleid < 0)
+      return ruleid;
+    return crush.get_rule_mask_ruleset(ruleid);
+  }
+
+  // place each group (and its local parity) within a single
+  // ruleset-locality bucket so that local repair does not cross it
+  if (crush.rule_exists(name)) {
+    *ss << "rule " << name << " exists";
+    return -EEXIST;
+  }
+  if (!crush.name_exists(ruleset_root)) {
+    *ss << "root item " << ruleset_root << " does not exist";
+    return -ENOENT;
+  }
+  int root = crush.get_item_id(ruleset_root);
+  int locality = crush.get_type_id(ruleset_locality);
+  if (locality < 0) {
+    *ss << "unknown type " << ruleset_locality;
+    return -EINVAL;
+  }
+  int failure_domain = 0;
+  if (ruleset_failure_domain.length()) {
+    failure_domain = crush.get_type_id(ruleset_failure_domain);
+    if (failure_domain < 0) {
+      *ss << "unknown type " << ruleset_failure_domain;
+      return -EINVAL;
+    }
+  }
+
+  int rno;
+  for (rno = 0; rno < crush.get_max_rules(); rno++) {
+    if (!crush.rule_exists(rno) && !crush.ruleset_exists(rno))
+      break;
+  }
+  int ruleid = crush.add_rule(5, rno, pg_pool_t::TYPE_ERASURE,
+			      3, get_chunk_count(), rno);
+  if (ruleid < 0) {
+    *ss << "failed to add rule " << rno;
+    return ruleid;
+  }
+  crush.set_rule_step_set_chooseleaf_tries(ruleid, 0, 5);
+  crush.set_rule_step_take(ruleid, 1, root);
+  crush.set_rule_step_choose_indep(ruleid, 2, get_group_count(), locality);
+  crush.set_rule_step_choose_leaf_indep(ruleid, 3, l + 1, failure_domain);
+  crush.set_rule_step_emit(ruleid, 4);
+  crush.set_rule_name(ruleid, name);
+  return crush.get_rule_mask_ruleset(ruleid);
+}
+
+int ErasureCodeLrc::parse(const map<std::string,std::string> &parameters,
+			  ostream *ss)
+{
+  int err = 0;
+  err |= to_int("k", parameters, &k, DEFAULT_K, ss);
+  err |= to_int("m", parameters, &m, DEFAULT_M, ss);
+  err |= to_int("l", parameters, &l, DEFAULT_L, ss);
+  if (k <= 0 || m <= 0) {
+    *ss << "k=" << k << " and m=" << m << " must be positive" << std::endl;
+    return -EINVAL;
+  }
+  if (l <= 0 || (k + m) % l) {
+    *ss << "l=" << l << " must divide k + m = " << k + m << std::endl;
+    return -EINVAL;
+  }
+  get_string("layer-plugin", parameters, &layer_plugin);
+  get_string("layer-technique", parameters, &layer_technique);
+  get_string("ruleset-root", parameters, &ruleset_root);
+  get_string("ruleset-locality", parameters, &ruleset_locality);
+  get_string("ruleset-failure-domain", parameters, &ruleset_failure_domain);
+
+  // data chunks first, then the global coding chunks and the local
+  // parities, in position order
+  chunk_mapping.clear();
+  for (int i = 0; i < k; i++)
+    chunk_mapping.push_back(global_to_position(i));
+  for (int p = 0; p < (int)get_chunk_count(); p++) {
+    int i = position_to_global(p);
+    if (i < 0 || i >= k)
+      chunk_mapping.push_back(p);
+  }
+  return err;
+}
+
+int ErasureCodeLrc::init(const map<std::string,std::string> &parameters,
+			 ostream *ss)
+{
+  int r = parse(parameters, ss);
+  if (r)
+    return r;
+
+  map<std::string,std::string> layer_parameters;
+  ostringstream k_str, m_str;
+  k_str << k;
+  m_str << m;
+  layer_parameters["k"] = k_str.str();
+  layer_parameters["m"] = m_str.str();
+  layer_parameters["technique"] = layer_technique;
+  if (parameters.count("directory"))
+    layer_parameters["directory"] = parameters.find("directory")->second;
+  dout(10) << "layer " << layer_plugin << " " << layer_parameters << dendl;
+
+  ErasureCodePluginRegistry &registry = ErasureCodePluginRegistry::instance();
+  r = registry.factory(layer_plugin, layer_parameters, &layer, *ss);
+  if (r)
+    return r;
+  if (layer->get_data_chunk_count() != (unsigned)k ||
+      layer->get_chunk_count() != (unsigned)(k + m)) {
+    *ss << "layer " << layer_plugin << " has "
+	<< layer->get_data_chunk_count() << "+"
+	<< layer->get_chunk_count() - layer->get_data_chunk_count()
+	<< " chunks instead of " << k << "+" << m << std::endl;
+    layer.reset();
+    return -EINVAL;
+  }
+  return 0;
+}
+
+unsigned int ErasureCodeLrc::get_chunk_size(unsigned int object_size) const
+{
+  return layer->get_chunk_size(object_size);
+}
+
+void ErasureCodeLrc::get_group_peers(int position, set<int> *peers) const
+{
+  int first = get_group(position) * (l + 1);
+  for (int i = first; i < first + l + 1; i++)
+    if (i != position)
+      peers->insert(i);
+}
+
+void ErasureCodeLrc::local_repair(int position, unsigned blocksize,
+				  const map<int, bufferlist> &chunks,
+				  bufferlist *out) const
+{
+  bufferptr ptr(buffer::create_page_aligned(blocksize));
+  set<int> peers;
+  get_group_peers(position, &peers);
+  vector<bufferlist> peer_chunks;
+  vector<unsigned char*> src;
+  peer_chunks.reserve(peers.size());
+  for (set<int>::iterator p = peers.begin(); p != peers.end(); ++p) {
+    map<int, bufferlist>::const_iterator c = chunks.find(*p);
+    assert(c != chunks.end());
+    assert(c->second.length() == blocksize);
+    peer_chunks.push_back(c->second);
+    src.push_back((unsigned char*)peer_chunks.back().c_str());
+  }
+  if (src.empty())
+    ptr.zero();
+  else
+    ceph_xor_region(&src[0], (unsigned char*)ptr.c_str(), src.size(),
+		    blocksize);
+  out->clear();
+  out->push_back(ptr);
+}
+
+int ErasureCodeLrc::minimum_to_decode(const set<int> &want_to_read,
+				      const set<int> &available,
+				      set<int> *minimum)
+{
+  if (includes(available.begin(), available.end(),
+	       want_to_read.begin(), want_to_read.end())) {
+    *minimum = want_to_read;
+    return 0;
+  }
+
+  // every missing chunk can be repaired from its own group
+  set<int> local;
+  bool all_local = true;
+  for (set<int>::const_iterator i = want_to_read.begin();
+       i != want_to_read.end();
+       ++i) {
+    if (available.count(*i)) {
+      local.insert(*i);
+      continue;
+    }
+    set<int> peers;
+    get_group_peers(*i, &peers);
+    if (!includes(available.begin(), available.end(),
+		  peers.begin(), peers.end())) {
+      all_local = false;
+      break;
+    }
+    local.insert(peers.begin(), peers.end());
+  }
+  if (all_local) {
+    dout(20) << __func__ << " local " << want_to_read << " from " << local
+	     << dendl;
+    *minimum = local;
+    return 0;
+  }
+
+  // k global chunks, some of them possibly repaired from their group
+  set<int> global;
+  for (set<int>::const_iterator i = want_to_read.begin();
+       i != want_to_read.end();
+       ++i)
+    if (available.count(*i))
+      global.insert(*i);
+  unsigned found = 0;
+  for (set<int>::iterator i = global.begin(); i != global.end(); ++i)
+    if (position_to_global(*i) >= 0)
+      found++;
+  for (int i = 0; i < k + m && found < (unsigned)k; i++) {
+    int position = global_to_position(i);
+    if (available.count(position) && !global.count(position)) {
+      global.insert(position);
+      found++;
+    }
+  }
+  for (unsigned g = 0; g < get_group_count() && found < (unsigned)k; g++) {
+    int missing = -1;
+    unsigned missing_count = 0;
+    for (int p = g * (l + 1); p < (int)(g + 1) * (l + 1); p++) {
+      if (!available.count(p)) {
+	missing = p;
+	missing_count++;
+      }
+    }
+    if (missing_count != 1 || position_to_global(missing) < 0)
+      continue;
+    set<int> peers;
+    get_group_peers(missing, &peers);
+    global.insert(peers.begin(), peers.end());
+    found++;
+  }
+  if (found < (unsigned)k)
+    return -EIO;
+  dout(20) << __func__ << " global " << want_to_read << " from " << global
+	   << dendl;
+  *minimum = global;
+  return 0;
+}
+
+int ErasureCodeLrc::encode(const set<int> &want_to_encode,
+			   const bufferlist &in,
+			   map<int, bufferlist> *encoded)
+{
+  set<int> want_global;
+  for (int i = 0; i < k + m; i++)
+    want_global.insert(i);
+  map<int, bufferlist> global;
+  int r = layer->encode(want_global, in, &global);
+  if (r)
+    return r;
+  unsigned blocksize = global.begin()->second.length();
+
+  map<int, bufferlist> chunks;
+  for (int i = 0; i < k + m; i++)
+    chunks[global_to_position(i)].claim(global[i]);
+  for (unsigned g = 0; g < get_group_count(); g++) {
+    int parity = get_local_parity(g);
+    if (want_to_encode.count(parity))
+      local_repair(parity, blocksize, chunks, &(*encoded)[parity]);
+  }
+  for (map<int, bufferlist>::iterator i = chunks.begin();
+       i != chunks.end();
+       ++i)
+    if (want_to_encode.count(i->first))
+      (*encoded)[i->first].claim(i->second);
+  return 0;
+}
+
+int ErasureCodeLrc::decode(const set<int> &want_to_read,
+			   const map<int, bufferlist> &chunks,
+			   map<int, bufferlist> *decoded)
+{
+  map<int, bufferlist> have = chunks;
+  unsigned blocksize = chunks.begin()->second.length();
+
+  // first repair wanted chunks from their group, then any group
+  // missing a single chunk, which may bring enough global chunks
+  for (int pass = 0; pass < 2; pass++) {
+    set<int> have_positions;
+    for (map<int, bufferlist>::iterator i = have.begin(); i != have.end(); ++i)
+      have_positions.insert(i->first);
+    if (includes(have_positions.begin(), have_positions.end(),
+		 want_to_read.begin(), want_to_read.end()))
+      break;
+    for (unsigned g = 0; g < get_group_count(); g++) {
+      int missing = -1;
+      unsigned missing_count = 0;
+      for (int p = g * (l + 1); p < (int)(g + 1) * (l + 1); p++) {
+	if (!have.count(p)) {
+	  missing = p;
+	  missing_count++;
+	}
+      }
+      if (missing_count != 1 || (pass == 0 && !want_to_read.count(missing)))
+	continue;
+      bufferlist repaired;
+      local_repair(missing, blocksize, have, &repaired);
+      have[missing].claim(repaired);
+    }
+  }
+
+  set<int> missing;
+  for (set<int>::const_iterator i = want_to_read.begin();
+       i != want_to_read.end();
+       ++i)
+    if (!have.count(*i))
+      missing.insert(*i);
+
+  if (!missing.empty()) {
+    map<int, bufferlist> global;
+    set<int> want_global;
+    for (int i = 0; i < k + m; i++) {
+      int position = global_to_position(i);
+      if (have.count(position))
+	global[i] = have[position];
+      else
+	want_global.insert(i);
+    }
+    if (global.size() < (unsigned)k) {
+      dout(10) << __func__ << " cannot decode " << missing << " from "
+	       << chunks.size() << " chunks" << dendl;
+      return -EIO;
+    }
+    map<int, bufferlist> global_decoded;
+    int r = layer->decode(want_global, global, &global_decoded);
+    if (r)
+      return r;
+    for (set<int>::iterator i = want_global.begin();
+	 i != want_global.end();
+	 ++i)
+      have[global_to_position(*i)].claim(global_decoded[*i]);
+    for (set<int>::iterator i = missing.begin(); i != missing.end(); ++i) {
+      if (have.count(*i))
+	continue;
+      bufferlist repaired;
+      local_repair(*i, blocksize, have, &repaired);
+      have[*i].claim(repaired);
+    }
+  }
+
+  for (set<int>::const_iterator i = want_to_read.begin();
+       i != want_to_read.end();
+       ++i)
+    (*decoded)[*i] = have[*i];
+  return 0;
+}
@@ -0,0 +1,123 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_LRC_H
+#define CEPH_ERASURE_CODE_LRC_H
+
+#include "erasure-code/ErasureCode.h"
+
+/**
+ * Locally repairable code
+ *
+ * The k data chunks and m coding chunks computed by another plugin
+ * (the global layer) are split into groups of l chunks.  Each group is
+ * followed by a local parity chunk which is the XOR of the l chunks of
+ * the group.  The chunk at position p belongs to group p / (l + 1); it
+ * is the local parity of that group when p % (l + 1) == l and the
+ * global chunk (p / (l + 1)) * l + p % (l + 1) otherwise.
+ *
+ * Losing a single chunk of a group only requires reading the l other
+ * chunks of the group instead of k chunks.  When more chunks of a
+ * group are lost, the global layer is used.
+ */
+class ErasureCodeLrc : public ErasureCode {
+public:
+  int k;
+  int DEFAULT_K;
+  int m;
+  int DEFAULT_M;
+  int l;
+  int DEFAULT_L;
+  string layer_plugin;
+  string layer_technique;
+  string ruleset_root;
+  string ruleset_locality;
+  string ruleset_failure_domain;
+  ErasureCodeInterfaceRef layer;
+
+  ErasureCodeLrc() :
+    k(0),
+    DEFAULT_K(4),
+    m(0),
+    DEFAULT_M(2),
+    l(0),
+    DEFAULT_L(3),
+    layer_plugin("jerasure"),
+    layer_technique("reed_sol_van"),
+    ruleset_root("default"),
+    ruleset_failure_domain("host")
+  {}
+
+  virtual ~ErasureCodeLrc() {}
+
+  int init(const map<std::string,std::string> &parameters, ostream *ss);
+
+  virtual int parse(const map<std::string,std::string> &parameters,
+		    ostream *ss);
+
+  virtual int create_ruleset(const string &name,
+			     CrushWrapper &crush,
+			     ostream *ss) const;
+
+  virtual unsigned int get_chunk_count() const {
+    return k + m + get_group_count();
+  }
+
+  virtual unsigned int get_data_chunk_count() const {
+    return k;
+  }
+
+  virtual unsigned int get_chunk_size(unsigned int object_size) const;
+
+  virtual int minimum_to_decode(const set<int> &want_to_read,
+				const set<int> &available,
+				set<int> *minimum);
+
+  virtual int encode(const set<int> &want_to_encode,
+		     const bufferlist &in,
+		     map<int, bufferlist> *encoded);
+
+  virtual int decode(const set<int> &want_to_read,
+		     const map<int, bufferlist> &chunks,
+		     map<int, bufferlist> *decoded);
+
+  unsigned get_group_count() const {
+    return (k + m) / l;
+  }
+  int get_group(int position) const {
+    return position / (l + 1);
+  }
+  int get_local_parity(int group) const {
+    return group * (l + 1) + l;
+  }
+  /// position of the global chunk i
+  int global_to_position(int i) const {
+    return (i / l) * (l + 1) + i % l;
+  }
+  /// global chunk at position, or -1 for a local parity
+  int position_to_global(int position) const {
+    int i = position % (l + 1);
+    if (i == l)
+      return -1;
+    return get_group(position) * l + i;
+  }
+
+private:
+  /// the positions of group other than position
+  void get_group_peers(int position, set<int> *peers) const;
+  /// XOR of the group members (except position) found in chunks
+  void local_repair(int position, unsigned blocksize,
+		    const map<int, bufferlist> &chunks,
+		    bufferlist *out) const;
+};
+
+#endif
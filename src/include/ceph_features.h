@@ -52,6 +52,10 @@
 #define CEPH_FEATURE_OSD_PRIMARY_AFFINITY (1ULL<<41)  /* overlap w/ tunables3 */
 #define CEPH_FEATURE_MSGR_KEEPALIVE2   (1ULL<<42)
 #define CEPH_FEATURE_OSD_POOLRESEND    (1ULL<<43)
+#define CEPH_FEATURE_OSD_PARTIAL_RECOVERY (1ULL<<44)
+#define CEPH_FEATURE_OSD_EC_OVERWRITES (1ULL<<45)
+#define CEPH_FEATURE_OSD_PROXY_CACHE (1ULL<<46)
+#define CEPH_FEATURE_OSD_HITSET_COMPACT (1ULL<<47)
 
 /*
  * The introduction of CEPH_FEATURE_OSD_SNAPMAPPER caused the feature
@@ -124,6 +128,10 @@ static inline unsigned long long ceph_sanitize_features(unsigned long long f) {
 	 CEPH_FEATURE_OSD_PRIMARY_AFFINITY |	\
 	 CEPH_FEATURE_MSGR_KEEPALIVE2 |	\
 	 CEPH_FEATURE_OSD_POOLRESEND |	\
+	 CEPH_FEATURE_OSD_PARTIAL_RECOVERY |	\
+	 CEPH_FEATURE_OSD_EC_OVERWRITES |	\
+	 CEPH_FEATURE_OSD_PROXY_CACHE |	\
+	 CEPH_FEATURE_OSD_HITSET_COMPACT |	\
 	 0ULL)
 
 #define CEPH_FEATURES_SUPPORTED_DEFAULT  CEPH_FEATURES_ALL
@@ -815,6 +815,29 @@ void rados_ioctx_set_namespace(rados_ioctx_t io, const char *nspace);
  */
 int rados_objects_list_open(rados_ioctx_t io, rados_list_ctx_t *ctx);
 
+/**
+ * Start listing one split of the objects in a pool
+ *
+ * The objects of the pool are divided into split_num parts of about
+ * equal size by their hash, and only the objects of part split_index
+ * are listed, reading only the placement groups that can hold them.
+ * Listing every split from 0 to split_num - 1, possibly from different
+ * threads or processes, lists every object exactly once.  Which split
+ * an object belongs to does not depend on the pool's pg_num.  If
+ * pg_num changes while a split is listed, rados_objects_list_next()
+ * fails with -ESTALE; discard what that split returned and list it
+ * again.  Splits that already completed remain valid.
+ *
+ * @param io the pool to list from
+ * @param split_num number of splits the pool is divided into
+ * @param split_index which split to list, 0 <= split_index < split_num
+ * @param ctx the handle to store list context in
+ * @returns 0 on success, negative error code on failure
+ * @returns -EINVAL if split_index is out of range
+ */
+int rados_objects_list_open_split(rados_ioctx_t io, uint32_t split_num,
+				  uint32_t split_index, rados_list_ctx_t *ctx);
+
 /**
  * Return hash position of iterator, rounded to the current PG
  *
@@ -1699,6 +1722,45 @@ int rados_aio_flush(rados_ioctx_t io);
  */
 int rados_aio_flush_async(rados_ioctx_t io, rados_completion_t completion);
 
+/**
+ * Coalesce small aio writes and appends to the same object
+ *
+ * While enabled, a rados_aio_write() that starts where a pending
+ * rados_aio_write() to the same object ends, or a rados_aio_append()
+ * following a pending rados_aio_append(), is merged with it and sent
+ * as one operation once window_us has passed since the first of them
+ * or max_bytes have accumulated.  Each completion still completes on
+ * its own, with the result of the merged operation.  Any other
+ * operation on the object, and rados_aio_flush(), send pending writes
+ * first, so ordering with this io context's other operations on the
+ * object is preserved.
+ *
+ * A completion whose write was coalesced shares one operation with
+ * the others merged into it, so rados_aio_cancel() refuses it with
+ * -EBUSY, both while it is held and after the merged write was sent.
+ *
+ * @param io the io context
+ * @param window_us how long a write may wait for others to merge
+ * with, in microseconds; 0 disables coalescing and sends anything
+ * pending
+ * @param max_bytes size at which a merged write is sent right away
+ */
+void rados_ioctx_set_aio_coalesce(rados_ioctx_t io, uint32_t window_us,
+				  uint64_t max_bytes);
+
+/**
+ * Get aio write coalescing counters
+ *
+ * writes / ops is the merge ratio.
+ *
+ * @param io the io context
+ * @param writes where to store the number of aio writes and appends
+ * seen while coalescing was enabled
+ * @param ops where to store the number of operations they were sent as
+ */
+void rados_ioctx_get_aio_coalesce_stats(rados_ioctx_t io, uint64_t *writes,
+					uint64_t *ops);
+
 
 /**
  * Asynchronously get object stats (size/mtime)
@@ -1718,7 +1780,8 @@ int rados_aio_stat(rados_ioctx_t io, const char *o,
  *
  * @param io ioctx
  * @param completion completion handle
- * @returns 0 on success, negative error code on failure
+ * @returns 0 on success, -EBUSY if the write was coalesced (see
+ * rados_ioctx_set_aio_coalesce()), negative error code on failure
  */
 int rados_aio_cancel(rados_ioctx_t io, rados_completion_t completion);
 
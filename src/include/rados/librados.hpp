@@ -58,6 +58,13 @@ namespace librados
     std::string address;
   } locker_t;
 
+  /// one object's result of IoCtx::aio_operate_many()
+  struct bulk_op_result_t {
+    int rval;                        ///< result of the operation on this object
+    std::vector<int> op_rvals;       ///< result of each step of the operation
+    std::vector<bufferlist> op_outs; ///< output data of each step
+  };
+
   typedef std::map<std::string, pool_stat_t> stats_map;
 
   typedef void *completion_t;
@@ -665,6 +672,16 @@ namespace librados
     ObjectIterator objects_begin();
     /// Start enumerating objects for a pool starting from a hash position
     ObjectIterator objects_begin(uint32_t start_hash_position);
+    /**
+     * Start enumerating one of split_num disjoint parts of a pool
+     *
+     * See rados_objects_list_open_split().  Throws std::invalid_argument
+     * if split_index is not below split_num.  Advancing the iterator
+     * throws std::runtime_error if pg_num changed during the listing;
+     * the split must then be listed again.
+     */
+    ObjectIterator objects_begin_split(uint32_t split_num,
+				       uint32_t split_index);
     /// Iterator indicating the end of a pool
     const ObjectIterator& objects_end() const;
 
@@ -780,13 +797,23 @@ namespace librados
      */
     int aio_flush_async(AioCompletion *c);
 
+    /**
+     * Coalesce small aio writes and appends to the same object
+     *
+     * See rados_ioctx_set_aio_coalesce().  A window_us of 0 disables it.
+     */
+    void set_aio_coalesce(uint32_t window_us, uint64_t max_bytes);
+    /// counters for set_aio_coalesce(); writes / ops is the merge ratio
+    void get_aio_coalesce_stats(uint64_t *writes, uint64_t *ops);
+
     int aio_stat(const std::string& oid, AioCompletion *c, uint64_t *psize, time_t *pmtime);
 
     /**
      * Cancel aio operation
      *
      * @param c completion handle
-     * @returns 0 on success, negative error code on failure
+     * @returns 0 on success, -EBUSY if the write was coalesced (see
+     * set_aio_coalesce()), negative error code on failure
      */
     int aio_cancel(AioCompletion *c);
 
@@ -827,6 +854,36 @@ namespace librados
 		    ObjectReadOperation *op, int flags,
 		    bufferlist *pbl);
 
+    /**
+     * Apply the same read operation to many objects
+     *
+     * A copy of op is sent to each object. The copies are mapped and
+     * submitted together, ordered by target OSD, so a batch costs
+     * about one round trip per OSD rather than one per object. This
+     * suits metadata-heavy work such as stat()ing every object in a
+     * listing.
+     *
+     * Output arguments given when op was built (psize, prval, ...) are
+     * not filled in; each object's results go to its entry in results
+     * instead, with op_outs holding the raw output of each step (e.g.
+     * the encoded size and mtime of a stat, or the data of a read).
+     * Per-object errors such as -ENOENT are reported there and do not
+     * fail the completion.
+     *
+     * @param oids the objects to operate on
+     * @param c what to do when every object has been answered
+     * @param op the operation to apply to each object
+     * @param flags OPERATION_* flags
+     * @param results where to store the results, one per oid
+     * @returns 0 on success, negative error code on failure
+     */
+    int aio_operate_many(const std::vector<std::string>& oids, AioCompletion *c,
+			 ObjectReadOperation *op, int flags,
+			 std::vector<bulk_op_result_t> *results);
+    int operate_many(const std::vector<std::string>& oids,
+		     ObjectReadOperation *op, int flags,
+		     std::vector<bulk_op_result_t> *results);
+
     // watch/notify
     int watch(const std::string& o, uint64_t ver, uint64_t *handle,
 	      librados::WatchCtx *ctx);
@@ -0,0 +1,48 @@
+#ifndef CEPH_XOR_REGION_H
+#define CEPH_XOR_REGION_H
+
+#include <inttypes.h>
+
+typedef void (*ceph_xor_region_func_t)(unsigned char **src,
+				       unsigned char *parity,
+				       int src_size, unsigned size);
+
+/*
+ * this is a static global with the chosen region xor implementation
+ * for the given architecture.
+ */
+extern ceph_xor_region_func_t ceph_xor_region_func;
+
+extern ceph_xor_region_func_t ceph_choose_xor_region(void);
+
+/*
+ * the individual kernels, for tests and benchmarks.  the sse2 kernel
+ * falls back to the generic one for buffers that are not 16 byte
+ * aligned and for the tail that does not fill a 64 byte block.
+ */
+extern void ceph_xor_region_generic(unsigned char **src,
+				    unsigned char *parity,
+				    int src_size, unsigned size);
+extern int ceph_xor_region_sse2_exists(void);
+extern void ceph_xor_region_sse2(unsigned char **src,
+				 unsigned char *parity,
+				 int src_size, unsigned size);
+
+/**
+ * xor regions together
+ *
+ * Computes parity = src[0] ^ src[1] ^ ... ^ src[src_size - 1].  The
+ * parity buffer may be src[0] but must not overlap the other sources.
+ *
+ * @param src array of src_size pointers to the regions to xor
+ * @param parity output region
+ * @param src_size number of source regions
+ * @param size length of each region in bytes
+ */
+static inline void ceph_xor_region(unsigned char **src, unsigned char *parity,
+				   int src_size, unsigned size)
+{
+  ceph_xor_region_func(src, parity, src_size, size);
+}
+
+#endif
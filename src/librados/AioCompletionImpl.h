@@ -34,6 +34,7 @@ struct librados::AioCompletionImpl {
   bool ack, safe;
   version_t objver;
   ceph_tid_t tid;
+  bool coalesced;  ///< shares its op with other completions; can't cancel
 
   rados_callback_t callback_complete, callback_safe;
   void *callback_complete_arg, *callback_safe_arg;
@@ -50,7 +51,7 @@ struct librados::AioCompletionImpl {
   AioCompletionImpl() : lock("AioCompletionImpl lock", false, false),
 			ref(1), rval(0), released(false), ack(false), safe(false),
 			objver(0),
-                        tid(0),
+                        tid(0), coalesced(false),
 			callback_complete(0),
 			callback_safe(0),
 			callback_complete_arg(0),
@@ -28,7 +28,10 @@
 librados::IoCtxImpl::IoCtxImpl() :
   ref_cnt(0), client(NULL), poolid(0), assert_ver(0), last_objver(0),
   notify_timeout(30), aio_write_list_lock("librados::IoCtxImpl::aio_write_list_lock"),
-  aio_write_seq(0), lock(NULL), objecter(NULL)
+  aio_write_seq(0),
+  coalesce_lock("librados::IoCtxImpl::coalesce_lock"),
+  coalesce_window_us(0), coalesce_max_bytes(0), coalesce_seq(0),
+  lock(NULL), objecter(NULL)
 {
 }
 
@@ -39,7 +42,10 @@ librados::IoCtxImpl::IoCtxImpl(RadosClient *c, Objecter *objecter,
     assert_ver(0), notify_timeout(c->cct->_conf->client_notify_timeout),
     oloc(poolid),
     aio_write_list_lock("librados::IoCtxImpl::aio_write_list_lock"),
-    aio_write_seq(0), lock(client_lock), objecter(objecter)
+    aio_write_seq(0),
+    coalesce_lock("librados::IoCtxImpl::coalesce_lock"),
+    coalesce_window_us(0), coalesce_max_bytes(0), coalesce_seq(0),
+    lock(client_lock), objecter(objecter)
 {
 }
 
@@ -120,6 +126,7 @@ void librados::IoCtxImpl::flush_aio_writes_async(AioCompletionImpl *c)
 {
   ldout(client->cct, 20) << "flush_aio_writes_async " << this
 			 << " completion " << c << dendl;
+  flush_coalesced_all();
   Mutex::Locker l(aio_write_list_lock);
   ceph_tid_t seq = aio_write_seq;
   if (aio_write_list.empty()) {
@@ -137,6 +144,7 @@ void librados::IoCtxImpl::flush_aio_writes_async(AioCompletionImpl *c)
 void librados::IoCtxImpl::flush_aio_writes()
 {
   ldout(client->cct, 20) << "flush_aio_writes" << dendl;
+  flush_coalesced_all();
   aio_write_list_lock.Lock();
   ceph_tid_t seq = aio_write_seq;
   while (!aio_write_list.empty() &&
@@ -145,6 +153,211 @@ void librados::IoCtxImpl::flush_aio_writes()
   aio_write_list_lock.Unlock();
 }
 
+// AIO WRITE COALESCING
+
+struct librados::IoCtxImpl::CoalescedWrite {
+  object_t oid;
+  uint64_t seq;
+  bool append;
+  uint64_t off;                          ///< unused for appends
+  bufferlist bl;
+  ::SnapContext snapc;
+  utime_t mtime;
+  std::list<AioCompletionImpl*> comps;   ///< each holds a ref for us
+  version_t objver;
+
+  CoalescedWrite(const object_t& o, uint64_t s, bool a, uint64_t off,
+		 const ::SnapContext& sc, utime_t t)
+    : oid(o), seq(s), append(a), off(off), snapc(sc), mtime(t), objver(0) {}
+};
+
+namespace {
+  // fan the reply to the merged op out to every completion in it
+  struct C_CoalescedReply : public Context {
+    librados::IoCtxImpl::CoalescedWrite *w;
+    bool safe;
+    C_CoalescedReply(librados::IoCtxImpl::CoalescedWrite *w, bool safe)
+      : w(w), safe(safe) {}
+    void finish(int r) {
+      for (std::list<librados::AioCompletionImpl*>::iterator p =
+	     w->comps.begin(); p != w->comps.end(); ++p) {
+	(*p)->objver = w->objver;
+	Context *f;
+	if (safe)
+	  f = new librados::IoCtxImpl::C_aio_Safe(*p);
+	else
+	  f = new librados::IoCtxImpl::C_aio_Ack(*p);
+	f->complete(r);
+      }
+      if (safe) {
+	for (std::list<librados::AioCompletionImpl*>::iterator p =
+	       w->comps.begin(); p != w->comps.end(); ++p)
+	  (*p)->put();
+	delete w;
+      }
+    }
+  };
+
+  struct C_CoalesceTimeout : public Context {
+    librados::IoCtxImpl *io;
+    object_t oid;
+    uint64_t seq;
+    C_CoalesceTimeout(librados::IoCtxImpl *io, const object_t& oid,
+		      uint64_t seq)
+      : io(io), oid(oid), seq(seq) {
+      io->get();
+    }
+    void finish(int r) {
+      io->coalesce_timeout(oid, seq);
+      io->put();
+    }
+  };
+}
+
+void librados::IoCtxImpl::set_aio_coalesce(uint32_t window_us,
+					   uint64_t max_bytes)
+{
+  ldout(client->cct, 10) << "set_aio_coalesce window " << window_us
+			 << "us max_bytes " << max_bytes << dendl;
+  coalesce_lock.Lock();
+  coalesce_window_us = window_us;
+  coalesce_max_bytes = max_bytes;
+  coalesce_lock.Unlock();
+  if (!window_us)
+    flush_coalesced_all();
+}
+
+/**
+ * queue an aio write or append for coalescing
+ *
+ * @returns false if the caller should send the write itself
+ */
+bool librados::IoCtxImpl::coalesce_aio_write(const object_t& oid,
+					     AioCompletionImpl *c,
+					     const bufferlist& bl,
+					     uint64_t off, bool append)
+{
+  CoalescedWrite *to_send = NULL;
+  uint64_t new_seq = 0;
+  bool queued = true;
+
+  coalesce_lock.Lock();
+  if (!coalesce_window_us) {
+    coalesce_lock.Unlock();
+    return false;
+  }
+  coalesce_num_writes.inc();
+  map<object_t, CoalescedWrite*>::iterator p = coalesce_pending.find(oid);
+  CoalescedWrite *w = p != coalesce_pending.end() ? p->second : NULL;
+  if (w && !(w->append == append &&
+	     (append || w->off + w->bl.length() == off) &&
+	     w->snapc.seq == snapc.seq && w->snapc.snaps == snapc.snaps &&
+	     w->bl.length() + bl.length() <= coalesce_max_bytes)) {
+    // can't extend it; send it ahead of this write
+    to_send = w;
+    coalesce_pending.erase(p);
+    w = NULL;
+  }
+  if (w) {
+    ldout(client->cct, 20) << "coalesce_aio_write " << oid << " "
+			   << (append ? "append " : "write ") << off
+			   << "~" << bl.length() << " into " << w->off
+			   << "~" << w->bl.length() << dendl;
+    c->get();
+    c->coalesced = true;
+    w->comps.push_back(c);
+    w->bl.append(bl);
+    if (w->bl.length() >= coalesce_max_bytes) {
+      to_send = w;
+      coalesce_pending.erase(p);
+    }
+  } else if (bl.length() >= coalesce_max_bytes) {
+    queued = false;  // nothing to gain; the caller sends it as is
+  } else {
+    w = new CoalescedWrite(oid, ++coalesce_seq, append, off, snapc,
+			   ceph_clock_now(client->cct));
+    c->get();
+    c->coalesced = true;
+    w->comps.push_back(c);
+    w->bl = bl;
+    coalesce_pending[oid] = w;
+    new_seq = w->seq;
+  }
+  coalesce_lock.Unlock();
+
+  if (to_send)
+    send_coalesced(to_send);
+  if (!queued)
+    coalesce_num_ops.inc();
+  if (new_seq)
+    client->add_timer_event(coalesce_window_us / 1000000.0,
+			    new C_CoalesceTimeout(this, oid, new_seq));
+  return queued;
+}
+
+void librados::IoCtxImpl::send_coalesced(CoalescedWrite *w)
+{
+  ldout(client->cct, 20) << "send_coalesced " << w->oid << " "
+			 << (w->append ? "append " : "write ")
+			 << w->off << "~" << w->bl.length()
+			 << " from " << w->comps.size() << " aio ops" << dendl;
+  coalesce_num_ops.inc();
+  Context *onack = new C_CoalescedReply(w, false);
+  Context *onsafe = new C_CoalescedReply(w, true);
+  ceph_tid_t tid;
+  if (w->append)
+    tid = objecter->append(w->oid, oloc, w->bl.length(), w->snapc, w->bl,
+			   w->mtime, 0, onack, onsafe, &w->objver);
+  else
+    tid = objecter->write(w->oid, oloc, w->off, w->bl.length(), w->snapc,
+			  w->bl, w->mtime, 0, onack, onsafe, &w->objver);
+  for (std::list<AioCompletionImpl*>::iterator p = w->comps.begin();
+       p != w->comps.end(); ++p)
+    (*p)->tid = tid;
+}
+
+void librados::IoCtxImpl::flush_coalesced(const object_t& oid)
+{
+  if (!coalesce_window_us)
+    return;  // nothing can be pending; set_aio_coalesce(0) flushed it
+  CoalescedWrite *w;
+  {
+    Mutex::Locker l(coalesce_lock);
+    map<object_t, CoalescedWrite*>::iterator p = coalesce_pending.find(oid);
+    if (p == coalesce_pending.end())
+      return;
+    w = p->second;
+    coalesce_pending.erase(p);
+  }
+  send_coalesced(w);
+}
+
+void librados::IoCtxImpl::flush_coalesced_all()
+{
+  map<object_t, CoalescedWrite*> pending;
+  {
+    Mutex::Locker l(coalesce_lock);
+    pending.swap(coalesce_pending);
+  }
+  for (map<object_t, CoalescedWrite*>::iterator p = pending.begin();
+       p != pending.end(); ++p)
+    send_coalesced(p->second);
+}
+
+void librados::IoCtxImpl::coalesce_timeout(const object_t& oid, uint64_t seq)
+{
+  CoalescedWrite *w;
+  {
+    Mutex::Locker l(coalesce_lock);
+    map<object_t, CoalescedWrite*>::iterator p = coalesce_pending.find(oid);
+    if (p == coalesce_pending.end() || p->second->seq != seq)
+      return;  // already sent
+    w = p->second;
+    coalesce_pending.erase(p);
+  }
+  send_coalesced(w);
+}
+
 // SNAPS
 
 int librados::IoCtxImpl::snap_create(const char *snapName)
@@ -220,6 +433,7 @@ int librados::IoCtxImpl::selfmanaged_snap_rollback_object(const object_t& oid,
 							  uint64_t snapid)
 {
   utime_t ut = ceph_clock_now(client->cct);
+  flush_coalesced(oid);
   int reply;
 
   Mutex mylock("IoCtxImpl::snap_rollback::mylock");
@@ -361,6 +575,13 @@ uint32_t librados::IoCtxImpl::list_seek(Objecter::ListContext *context,
   return objecter->list_objects_seek(context, pos);
 }
 
+int librados::IoCtxImpl::list_split(Objecter::ListContext *context,
+				    uint32_t split_num, uint32_t split_index)
+{
+  context->list.clear();
+  return objecter->list_objects_split(context, split_num, split_index);
+}
+
 int librados::IoCtxImpl::create(const object_t& oid, bool exclusive)
 {
   ::ObjectOperation op;
@@ -449,6 +670,7 @@ int librados::IoCtxImpl::clone_range(const object_t& dst_oid,
 int librados::IoCtxImpl::operate(const object_t& oid, ::ObjectOperation *o,
 				 time_t *pmtime, int flags)
 {
+  flush_coalesced(oid);
   utime_t ut;
   if (pmtime) {
     ut = utime_t(*pmtime, 0);
@@ -495,6 +717,7 @@ int librados::IoCtxImpl::operate_read(const object_t& oid,
 				      bufferlist *pbl,
 				      int flags)
 {
+  flush_coalesced(oid);
   if (!o->size())
     return 0;
 
@@ -531,6 +754,7 @@ int librados::IoCtxImpl::aio_operate_read(const object_t &oid,
 					  int flags,
 					  bufferlist *pbl)
 {
+  flush_coalesced(oid);
   Context *onack = new C_aio_Ack(c);
 
   c->is_read = true;
@@ -543,10 +767,101 @@ int librados::IoCtxImpl::aio_operate_read(const object_t &oid,
   return 0;
 }
 
+// records one object's result and reports to the gather as a success,
+// so that per-object errors don't fail the batch
+struct C_bulk_object : public Context {
+  int *prval;
+  Context *sub;
+  C_bulk_object(int *prval, Context *sub) : prval(prval), sub(sub) {}
+  void finish(int r) {
+    *prval = r;
+    sub->complete(0);
+  }
+};
+
+void librados::IoCtxImpl::submit_read_many(const vector<object_t>& oids,
+					   ::ObjectOperation *o,
+					   int flags,
+					   vector<bulk_op_result_t> *results,
+					   Context *onfinish)
+{
+  results->resize(oids.size());
+  if (oids.empty()) {
+    onfinish->complete(0);
+    return;
+  }
+
+  C_GatherBuilder gather(client->cct, onfinish);
+  vector<Objecter::Op*> ops;
+  ops.reserve(oids.size());
+  unsigned nops = o->ops.size();
+  for (unsigned i = 0; i < oids.size(); ++i) {
+    flush_coalesced(oids[i]);
+    bulk_op_result_t &res = (*results)[i];
+    res.rval = 0;
+    res.op_rvals.assign(nops, 0);
+    res.op_outs.assign(nops, bufferlist());
+
+    // a copy of the template whose outputs point at this object's result
+    ::ObjectOperation op;
+    op.ops = o->ops;
+    op.flags = o->flags;
+    op.priority = o->priority;
+    op.out_handler.resize(nops, NULL);
+    for (unsigned j = 0; j < nops; ++j) {
+      op.out_bl.push_back(&res.op_outs[j]);
+      op.out_rval.push_back(&res.op_rvals[j]);
+    }
+    Context *onack = new C_bulk_object(&res.rval, gather.new_sub());
+    ops.push_back(objecter->prepare_read_op(oids[i], oloc, op, snap_seq,
+					    NULL, flags, onack));
+  }
+  gather.activate();
+
+  ldout(client->cct, 10) << __func__ << " " << oids.size() << " objects" << dendl;
+  objecter->op_submit_batch(ops);
+}
+
+int librados::IoCtxImpl::operate_read_many(const vector<object_t>& oids,
+					   ::ObjectOperation *o,
+					   int flags,
+					   vector<bulk_op_result_t> *results)
+{
+  Mutex mylock("IoCtxImpl::operate_read_many::mylock");
+  Cond cond;
+  bool done;
+  int r;
+
+  Context *onfinish = new C_SafeCond(&mylock, &cond, &done, &r);
+  submit_read_many(oids, o, flags, results, onfinish);
+
+  mylock.Lock();
+  while (!done)
+    cond.Wait(mylock);
+  mylock.Unlock();
+  return r;
+}
+
+int librados::IoCtxImpl::aio_operate_read_many(const vector<object_t>& oids,
+					       ::ObjectOperation *o,
+					       AioCompletionImpl *c,
+					       int flags,
+					       vector<bulk_op_result_t> *results)
+{
+  Context *onack = new C_aio_Ack(c);
+
+  c->is_read = true;
+  c->io = this;
+
+  submit_read_many(oids, o, flags, results, onack);
+  return 0;
+}
+
 int librados::IoCtxImpl::aio_operate(const object_t& oid,
 				     ::ObjectOperation *o, AioCompletionImpl *c,
 				     const SnapContext& snap_context, int flags)
 {
+  flush_coalesced(oid);
   utime_t ut = ceph_clock_now(client->cct);
   /* can't write to a snapshot */
   if (snap_seq != CEPH_NOSNAP)
@@ -568,6 +883,7 @@ int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
 				  bufferlist *pbl, size_t len, uint64_t off,
 				  uint64_t snapid)
 {
+  flush_coalesced(oid);
   if (len > (size_t) INT_MAX)
     return -EDOM;
 
@@ -587,6 +903,7 @@ int librados::IoCtxImpl::aio_read(const object_t oid, AioCompletionImpl *c,
 				  char *buf, size_t len, uint64_t off,
 				  uint64_t snapid)
 {
+  flush_coalesced(oid);
   if (len > (size_t) INT_MAX)
     return -EDOM;
 
@@ -622,6 +939,7 @@ int librados::IoCtxImpl::aio_sparse_read(const object_t oid,
 					 bufferlist *data_bl, size_t len,
 					 uint64_t off, uint64_t snapid)
 {
+  flush_coalesced(oid);
   if (len > (size_t) INT_MAX)
     return -EDOM;
 
@@ -652,6 +970,12 @@ int librados::IoCtxImpl::aio_write(const object_t &oid, AioCompletionImpl *c,
 
   c->io = this;
   queue_aio_write(c);
+  if (len == bl.length()) {
+    if (coalesce_aio_write(oid, c, bl, off, false))
+      return 0;
+  } else {
+    flush_coalesced(oid);
+  }
 
   Context *onack = new C_aio_Ack(c);
   Context *onsafe = new C_aio_Safe(c);
@@ -674,6 +998,12 @@ int librados::IoCtxImpl::aio_append(const object_t &oid, AioCompletionImpl *c,
 
   c->io = this;
   queue_aio_write(c);
+  if (len == bl.length()) {
+    if (coalesce_aio_write(oid, c, bl, 0, true))
+      return 0;
+  } else {
+    flush_coalesced(oid);
+  }
 
   Context *onack = new C_aio_Ack(c);
   Context *onsafe = new C_aio_Safe(c);
@@ -689,6 +1019,7 @@ int librados::IoCtxImpl::aio_write_full(const object_t &oid,
 					AioCompletionImpl *c,
 					const bufferlist& bl)
 {
+  flush_coalesced(oid);
   utime_t ut = ceph_clock_now(client->cct);
 
   /* can't write to a snapshot */
@@ -710,6 +1041,7 @@ int librados::IoCtxImpl::aio_write_full(const object_t &oid,
 
 int librados::IoCtxImpl::aio_remove(const object_t &oid, AioCompletionImpl *c)
 {
+  flush_coalesced(oid);
   utime_t ut = ceph_clock_now(client->cct);
 
   /* can't write to a snapshot */
@@ -733,6 +1065,7 @@ int librados::IoCtxImpl::aio_remove(const object_t &oid, AioCompletionImpl *c)
 int librados::IoCtxImpl::aio_stat(const object_t& oid, AioCompletionImpl *c,
 				  uint64_t *psize, time_t *pmtime)
 {
+  flush_coalesced(oid);
   c->io = this;
   C_aio_stat_Ack *onack = new C_aio_stat_Ack(c, pmtime);
 
@@ -745,6 +1078,9 @@ int librados::IoCtxImpl::aio_stat(const object_t& oid, AioCompletionImpl *c,
 
 int librados::IoCtxImpl::aio_cancel(AioCompletionImpl *c)
 {
+  // cancelling the merged op would cancel the other writes in it too
+  if (c->coalesced)
+    return -EBUSY;
   return objecter->op_cancel(c->tid, -ECANCELED);
 }
 
@@ -840,6 +1176,7 @@ int librados::IoCtxImpl::aio_exec(const object_t& oid, AioCompletionImpl *c,
 				  const char *cls, const char *method,
 				  bufferlist& inbl, bufferlist *outbl)
 {
+  flush_coalesced(oid);
   Context *onack = new C_aio_Ack(c);
 
   c->is_read = true;
@@ -878,6 +1215,7 @@ int librados::IoCtxImpl::mapext(const object_t& oid,
 				uint64_t off, size_t len,
 				std::map<uint64_t,uint64_t>& m)
 {
+  flush_coalesced(oid);
   bufferlist bl;
 
   Mutex mylock("IoCtxImpl::read::mylock");
@@ -1003,6 +1341,7 @@ void librados::IoCtxImpl::set_sync_op_version(version_t ver)
 int librados::IoCtxImpl::watch(const object_t& oid, uint64_t ver,
 			       uint64_t *cookie, librados::WatchCtx *ctx)
 {
+  flush_coalesced(oid);
   ::ObjectOperation wr;
   Mutex mylock("IoCtxImpl::watch::mylock");
   Cond cond;
@@ -1048,6 +1387,7 @@ int librados::IoCtxImpl::_notify_ack(
   uint64_t notify_id, uint64_t ver,
   uint64_t cookie)
 {
+  flush_coalesced(oid);
   ::ObjectOperation rd;
   prepare_assert_ops(&rd);
   rd.notify_ack(notify_id, ver, cookie);
@@ -1057,6 +1397,7 @@ int librados::IoCtxImpl::_notify_ack(
 
 int librados::IoCtxImpl::unwatch(const object_t& oid, uint64_t cookie)
 {
+  flush_coalesced(oid);
   bufferlist inbl, outbl;
 
   Mutex mylock("IoCtxImpl::unwatch::mylock");
@@ -1087,6 +1428,7 @@ int librados::IoCtxImpl::unwatch(const object_t& oid, uint64_t cookie)
 
 int librados::IoCtxImpl::notify(const object_t& oid, uint64_t ver, bufferlist& bl)
 {
+  flush_coalesced(oid);
   bufferlist inbl, outbl;
 
   // Construct WatchNotifyInfo
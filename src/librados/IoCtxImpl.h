@@ -47,6 +47,24 @@ struct librados::IoCtxImpl {
   xlist<AioCompletionImpl*> aio_write_list;
   map<ceph_tid_t, std::list<AioCompletionImpl*> > aio_write_waiters;
 
+  /**
+   * aio write coalescing
+   *
+   * When enabled, an aio_write that starts where the previous pending
+   * aio_write to the same object ended, or an aio_append following a
+   * pending aio_append, is folded into a single op that is sent once
+   * the window expires or it reaches coalesce_max_bytes.  Any other
+   * op on the object, and aio_flush, send the pending op first.
+   */
+  struct CoalescedWrite;
+  Mutex coalesce_lock;
+  uint32_t coalesce_window_us;   ///< 0 disables coalescing
+  uint64_t coalesce_max_bytes;
+  uint64_t coalesce_seq;
+  map<object_t, CoalescedWrite*> coalesce_pending;
+  atomic64_t coalesce_num_writes;  ///< aio writes/appends coalescing saw
+  atomic64_t coalesce_num_ops;     ///< ops they were sent as
+
   Mutex *lock;
   Objecter *objecter;
 
@@ -66,6 +84,8 @@ struct librados::IoCtxImpl {
     last_objver = rhs.last_objver;
     notify_timeout = rhs.notify_timeout;
     oloc = rhs.oloc;
+    coalesce_window_us = rhs.coalesce_window_us;
+    coalesce_max_bytes = rhs.coalesce_max_bytes;
     lock = rhs.lock;
     objecter = rhs.objecter;
   }
@@ -87,6 +107,14 @@ struct librados::IoCtxImpl {
   void flush_aio_writes_async(AioCompletionImpl *c);
   void flush_aio_writes();
 
+  void set_aio_coalesce(uint32_t window_us, uint64_t max_bytes);
+  bool coalesce_aio_write(const object_t& oid, AioCompletionImpl *c,
+			  const bufferlist& bl, uint64_t off, bool append);
+  void flush_coalesced(const object_t& oid);
+  void flush_coalesced_all();
+  void coalesce_timeout(const object_t& oid, uint64_t seq);
+  void send_coalesced(CoalescedWrite *w);
+
   int64_t get_id() {
     return poolid;
   }
@@ -112,6 +140,8 @@ struct librados::IoCtxImpl {
   // io
   int list(Objecter::ListContext *context, int max_entries);
   uint32_t list_seek(Objecter::ListContext *context, uint32_t pos);
+  int list_split(Objecter::ListContext *context, uint32_t split_num,
+		 uint32_t split_index);
   int create(const object_t& oid, bool exclusive);
   int create(const object_t& oid, bool exclusive, const std::string& category);
   int write(const object_t& oid, bufferlist& bl, size_t len, uint64_t off);
@@ -147,6 +177,14 @@ struct librados::IoCtxImpl {
 		  int flags);
   int aio_operate_read(const object_t& oid, ::ObjectOperation *o,
 		       AioCompletionImpl *c, int flags, bufferlist *pbl);
+  int operate_read_many(const vector<object_t>& oids, ::ObjectOperation *o,
+			int flags, vector<bulk_op_result_t> *results);
+  int aio_operate_read_many(const vector<object_t>& oids, ::ObjectOperation *o,
+			    AioCompletionImpl *c, int flags,
+			    vector<bulk_op_result_t> *results);
+  void submit_read_many(const vector<object_t>& oids, ::ObjectOperation *o,
+			int flags, vector<bulk_op_result_t> *results,
+			Context *onfinish);
 
   struct C_aio_Ack : public Context {
     librados::AioCompletionImpl *c;
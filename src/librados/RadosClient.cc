@@ -313,6 +313,12 @@ uint64_t librados::RadosClient::get_instance_id()
   return instance_id;
 }
 
+void librados::RadosClient::add_timer_event(double seconds, Context *c)
+{
+  Mutex::Locker l(lock);
+  timer.add_event_after(seconds, c);
+}
+
 librados::RadosClient::~RadosClient()
 {
   if (messenger)
@@ -84,6 +84,9 @@ public:
 
   uint64_t get_instance_id();
 
+  /// run c from the client timer after seconds
+  void add_timer_event(double seconds, Context *c);
+
   int wait_for_latest_osdmap();
 
   int create_ioctx(const char *name, IoCtxImpl **io);
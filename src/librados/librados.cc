@@ -1111,6 +1111,28 @@ int librados::IoCtx::aio_operate(const std::string& oid, AioCompletion *c,
 				       translate_flags(flags), pbl);
 }
 
+int librados::IoCtx::aio_operate_many(const std::vector<std::string>& oids,
+				      AioCompletion *c,
+				      librados::ObjectReadOperation *o,
+				      int flags,
+				      std::vector<bulk_op_result_t> *results)
+{
+  vector<object_t> objs(oids.begin(), oids.end());
+  return io_ctx_impl->aio_operate_read_many(objs, (::ObjectOperation*)o->impl,
+					    c->pc, translate_flags(flags),
+					    results);
+}
+
+int librados::IoCtx::operate_many(const std::vector<std::string>& oids,
+				  librados::ObjectReadOperation *o,
+				  int flags,
+				  std::vector<bulk_op_result_t> *results)
+{
+  vector<object_t> objs(oids.begin(), oids.end());
+  return io_ctx_impl->operate_read_many(objs, (::ObjectOperation*)o->impl,
+					translate_flags(flags), results);
+}
+
 
 void librados::IoCtx::snap_set_read(snap_t seq)
 {
@@ -1279,6 +1301,22 @@ librados::ObjectIterator librados::IoCtx::objects_begin(uint32_t pos)
   return iter;
 }
 
+librados::ObjectIterator librados::IoCtx::objects_begin_split(
+  uint32_t split_num, uint32_t split_index)
+{
+  rados_list_ctx_t listh;
+  int r = rados_objects_list_open_split(io_ctx_impl, split_num, split_index,
+					&listh);
+  if (r < 0) {
+    ostringstream oss;
+    oss << "rados returned " << cpp_strerror(r);
+    throw std::invalid_argument(oss.str());
+  }
+  ObjectIterator iter((ObjListCtx*)listh);
+  iter.get_next();
+  return iter;
+}
+
 const librados::ObjectIterator& librados::IoCtx::objects_end() const
 {
   return ObjectIterator::__EndObjectIterator;
@@ -1379,6 +1417,17 @@ int librados::IoCtx::aio_flush()
   return 0;
 }
 
+void librados::IoCtx::set_aio_coalesce(uint32_t window_us, uint64_t max_bytes)
+{
+  io_ctx_impl->set_aio_coalesce(window_us, max_bytes);
+}
+
+void librados::IoCtx::get_aio_coalesce_stats(uint64_t *writes, uint64_t *ops)
+{
+  *writes = io_ctx_impl->coalesce_num_writes.read();
+  *ops = io_ctx_impl->coalesce_num_ops.read();
+}
+
 int librados::IoCtx::aio_stat(const std::string& oid, librados::AioCompletion *c,
 			      uint64_t *psize, time_t *pmtime)
 {
@@ -3050,6 +3099,29 @@ extern "C" int rados_objects_list_open(rados_ioctx_t io, rados_list_ctx_t *listh
   return retval;
 }
 
+extern "C" int rados_objects_list_open_split(rados_ioctx_t io,
+					     uint32_t split_num,
+					     uint32_t split_index,
+					     rados_list_ctx_t *listh)
+{
+  tracepoint(librados, rados_objects_list_open_split_enter, io, split_num,
+	     split_index);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+  Objecter::ListContext *h = new Objecter::ListContext;
+  h->pool_id = ctx->poolid;
+  h->pool_snap_seq = ctx->snap_seq;
+  h->nspace = ctx->oloc.nspace;
+  int retval = ctx->list_split(h, split_num, split_index);
+  if (retval < 0) {
+    delete h;
+    *listh = NULL;
+  } else {
+    *listh = (void *)new librados::ObjListCtx(ctx, h);
+  }
+  tracepoint(librados, rados_objects_list_open_split_exit, retval, *listh);
+  return retval;
+}
+
 extern "C" void rados_objects_list_close(rados_list_ctx_t h)
 {
   tracepoint(librados, rados_objects_list_close_enter, h);
@@ -3312,6 +3384,28 @@ extern "C" int rados_aio_flush(rados_ioctx_t io)
   return retval;
 }
 
+extern "C" void rados_ioctx_set_aio_coalesce(rados_ioctx_t io,
+					     uint32_t window_us,
+					     uint64_t max_bytes)
+{
+  tracepoint(librados, rados_ioctx_set_aio_coalesce_enter, io, window_us,
+	     max_bytes);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+  ctx->set_aio_coalesce(window_us, max_bytes);
+  tracepoint(librados, rados_ioctx_set_aio_coalesce_exit);
+}
+
+extern "C" void rados_ioctx_get_aio_coalesce_stats(rados_ioctx_t io,
+						   uint64_t *writes,
+						   uint64_t *ops)
+{
+  tracepoint(librados, rados_ioctx_get_aio_coalesce_stats_enter, io);
+  librados::IoCtxImpl *ctx = (librados::IoCtxImpl *)io;
+  *writes = ctx->coalesce_num_writes.read();
+  *ops = ctx->coalesce_num_ops.read();
+  tracepoint(librados, rados_ioctx_get_aio_coalesce_stats_exit, *writes, *ops);
+}
+
 extern "C" int rados_aio_stat(rados_ioctx_t io, const char *o, 
 			      rados_completion_t completion,
 			      uint64_t *psize, time_t *pmtime)
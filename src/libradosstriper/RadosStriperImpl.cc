@@ -20,6 +20,9 @@
 #include <iomanip>
 #include <algorithm>
 
+#include "common/perf_counters.h"
+#include "include/stringify.h"
+
 #include "include/types.h"
 #include "include/uuid.h"
 #include "include/ceph_fs.h"
@@ -136,9 +139,14 @@ libradosstriper::RadosStriperImpl::ReadCompletionData::ReadCompletionData
  librados::AioCompletionImpl *userCompletion,
  bufferlist* bl,
  std::vector<ObjectExtent>* extents,
- std::vector<bufferlist>* resultbl) :
+ std::vector<bufferlist>* resultbl,
+ libradosstriper::MultiAioCompletionImpl *multiAioCompl) :
   CompletionData(striper, soid, lockCookie, userCompletion),
-  m_bl(bl), m_extents(extents), m_resultbl(resultbl) {}
+  m_bl(bl), m_extents(extents), m_resultbl(resultbl),
+  m_multiAioCompl(multiAioCompl),
+  m_lock("RadosStriperImpl::ReadCompletionData::m_lock"),
+  m_nextExtent(0), m_allIssued(false),
+  m_start(ceph_clock_now(striper->cct())) {}
 
 libradosstriper::RadosStriperImpl::ReadCompletionData::~ReadCompletionData() {
   delete m_extents;
@@ -156,6 +164,12 @@ void libradosstriper::RadosStriperImpl::ReadCompletionData::complete(int r) {
   }
   m_bl->clear();
   readResult.assemble_result(m_striper->cct(), *m_bl, true);
+  PerfCounters *logger = m_striper->m_perfcounter;
+  logger->inc(l_striper_rd);
+  if (r >= 0)
+    logger->inc(l_striper_rd_bytes, m_bl->length());
+  logger->tinc(l_striper_rd_latency,
+	       ceph_clock_now(m_striper->cct()) - m_start);
   // call parent's completion method
   CompletionData::complete(r?r:m_bl->length());
 }
@@ -200,7 +214,28 @@ libradosstriper::RadosStriperImpl::RadosExclusiveLock::~RadosExclusiveLock() {
 
 libradosstriper::RadosStriperImpl::RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl) :
   m_refCnt(0), m_radosCluster(ioctx), m_ioCtx(ioctx), m_ioCtxImpl(ioctx_impl),
-  m_layout(g_default_file_layout) {}
+  m_layout(g_default_file_layout), m_perfcounter(NULL)
+{
+  // several stripers may share a pool, so number them
+  static atomic_t instance;
+  std::string name = "libradosstriper-" + m_ioCtx.get_pool_name() + "-" +
+    stringify(instance.inc());
+  PerfCountersBuilder plb(cct(), name, l_striper_first, l_striper_last);
+  plb.add_u64_counter(l_striper_rd, "rd");
+  plb.add_u64_counter(l_striper_rd_bytes, "rd_bytes");
+  plb.add_time_avg(l_striper_rd_latency, "rd_latency");
+  plb.add_u64_counter(l_striper_rd_object_ops, "rd_object_ops");
+  plb.add_u64_counter(l_striper_wr, "wr");
+  plb.add_u64_counter(l_striper_wr_bytes, "wr_bytes");
+  m_perfcounter = plb.create_perf_counters();
+  cct()->get_perfcounters_collection()->add(m_perfcounter);
+}
+
+libradosstriper::RadosStriperImpl::~RadosStriperImpl()
+{
+  cct()->get_perfcounters_collection()->remove(m_perfcounter);
+  delete m_perfcounter;
+}
 
 ///////////////////////// layout /////////////////////////////
 
@@ -428,6 +463,10 @@ static void rados_req_read_complete(rados_completion_t c, void *arg)
   }
   librados::AioCompletion *comp = reinterpret_cast<librados::AioCompletion*>(c);
   libradosstriper::MultiAioCompletionImpl * multiAioComp = data->m_multiAioCompl;
+  // keep the window full. This must happen before we complete our own
+  // request, which may complete (and free) the whole striped read
+  libradosstriper::RadosStriperImpl::ReadCompletionData *cdata = data->m_read;
+  cdata->m_striper->aio_read_next_extents(cdata, 1);
   if (0 == comp->pc->safe) delete data;
   multiAioComp->complete_request(rc);
 }
@@ -464,34 +503,79 @@ int libradosstriper::RadosStriperImpl::aio_read(const std::string& soid,
   vector<bufferlist> *resultbl = new vector<bufferlist>(extents->size());
   c->is_read = true;
   c->io = m_ioCtxImpl;
-  ReadCompletionData *cdata = new ReadCompletionData(this, soid, lockCookie, c,
-						     bl, extents, resultbl);
   libradosstriper::MultiAioCompletionImpl *nc = new libradosstriper::MultiAioCompletionImpl;
+  ReadCompletionData *cdata = new ReadCompletionData(this, soid, lockCookie, c,
+						     bl, extents, resultbl, nc);
   nc->set_complete_callback(cdata, striper_read_aio_req_complete);
-  // go through the extents
-  int r = 0, i = 0;
-  for (vector<ObjectExtent>::iterator p = extents->begin(); p != extents->end(); ++p) {
-    // create a buffer list describing where to place data read from current extend
-    bufferlist *oid_bl = &((*resultbl)[i++]);
-    for (vector<pair<uint64_t,uint64_t> >::iterator q = p->buffer_extents.begin();
-        q != p->buffer_extents.end();
+  // start the first window of reads; each completion then starts the next
+  aio_read_next_extents(cdata, cct()->_conf->rados_striper_read_window);
+  return 0;
+}
+
+void libradosstriper::RadosStriperImpl::aio_read_next_extents(ReadCompletionData *cdata,
+							      size_t max)
+{
+  // claim a range of extents. The requests are added to the multi
+  // completion right away so that it cannot complete while we are
+  // still issuing them
+  vector<ObjectExtent> *extents = cdata->m_extents;
+  libradosstriper::MultiAioCompletionImpl *nc = cdata->m_multiAioCompl;
+  size_t first, last;
+  bool finish = false;
+  {
+    Mutex::Locker l(cdata->m_lock);
+    first = cdata->m_nextExtent;
+    last = extents->size();
+    if (max)
+      last = MIN(last, first + max);
+    cdata->m_nextExtent = last;
+    if (last == extents->size() && !cdata->m_allIssued) {
+      cdata->m_allIssued = true;
+      finish = true;
+    }
+    for (size_t i = first; i < last; i++)
+      nc->add_request();
+  }
+  for (size_t i = first; i < last; i++) {
+    ObjectExtent &p = (*extents)[i];
+    // create a buffer list describing where to place data read from current
+    // extent. It points into the caller's buffer, so data lands in place
+    bufferlist *oid_bl = &((*cdata->m_resultbl)[i]);
+    for (vector<pair<uint64_t,uint64_t> >::iterator q = p.buffer_extents.begin();
+        q != p.buffer_extents.end();
         ++q) {
       bufferlist buffer_bl;
-      buffer_bl.substr_of(*bl, q->first, q->second);
+      buffer_bl.substr_of(*cdata->m_bl, q->first, q->second);
       oid_bl->append(buffer_bl);
     }
     // read all extends of a given object in one go
-    nc->add_request();
-    RadosReadCompletionData *data = new RadosReadCompletionData(nc, p->length, oid_bl);
+    RadosReadCompletionData *data = new RadosReadCompletionData(nc, p.length, oid_bl, cdata);
     librados::AioCompletion *rados_completion =
       m_radosCluster.aio_create_completion(data, rados_req_read_complete, rados_req_read_safe);
-    r = m_ioCtx.aio_read(p->oid.name, rados_completion, oid_bl, p->length, p->offset);
+    m_perfcounter->inc(l_striper_rd_object_ops);
+    int r = m_ioCtx.aio_read(p.oid.name, rados_completion, oid_bl, p.length, p.offset);
     rados_completion->release();
-    if (r < 0)
+    if (r < 0) {
+      // fail this request and the rest of our range, and start no more
+      delete data;
+      {
+	Mutex::Locker l(cdata->m_lock);
+	cdata->m_nextExtent = extents->size();
+	if (!cdata->m_allIssued) {
+	  cdata->m_allIssued = true;
+	  finish = true;
+	}
+      }
+      for (; i < last; i++) {
+	nc->complete_request(r);
+	nc->safe_request(r);
+      }
       break;
+    }
   }
-  nc->finish_adding_requests();
-  return r;
+  // nothing of cdata may be touched after this, it may be gone
+  if (finish)
+    nc->finish_adding_requests();
 }
 
 int libradosstriper::RadosStriperImpl::aio_read(const std::string& soid,
@@ -744,6 +828,8 @@ libradosstriper::RadosStriperImpl::internal_aio_write(const std::string& soid,
   vector<ObjectExtent> extents;
   std::string format = soid + RADOS_OBJECT_EXTENSION_FORMAT;
   Striper::file_to_extents(cct(), format.c_str(), &layout, off, len, 0, extents);
+  m_perfcounter->inc(l_striper_wr);
+  m_perfcounter->inc(l_striper_wr_bytes, len);
   // go through the extents
   int r = 0;
   for (vector<ObjectExtent>::iterator p = extents.begin(); p != extents.end(); ++p) {
@@ -18,6 +18,8 @@
 #include <string>
 
 #include "include/atomic.h"
+#include "include/utime.h"
+#include "common/Mutex.h"
 
 #include "include/rados/librados.h"
 #include "include/rados/librados.hpp"
@@ -26,6 +28,19 @@
 
 #include "librados/IoCtxImpl.h"
 
+class PerfCounters;
+
+enum {
+  l_striper_first = 27000,
+  l_striper_rd,               // striped read ops
+  l_striper_rd_bytes,         // bytes read
+  l_striper_rd_latency,       // average latency
+  l_striper_rd_object_ops,    // rados reads issued for striped reads
+  l_striper_wr,
+  l_striper_wr_bytes,
+  l_striper_last,
+};
+
 struct libradosstriper::RadosStriperImpl {
 
   /**
@@ -63,6 +78,16 @@ struct libradosstriper::RadosStriperImpl {
     std::vector<ObjectExtent>* m_extents;
     /// intermediate results
     std::vector<bufferlist>* m_resultbl;
+    /// completion gathering the reads of the rados objects
+    MultiAioCompletionImpl *m_multiAioCompl;
+    /// protects m_nextExtent and m_allIssued
+    Mutex m_lock;
+    /// index in m_extents of the next extent to be read
+    size_t m_nextExtent;
+    /// whether the last extent has been handed out
+    bool m_allIssued;
+    /// start time, for the latency counter
+    utime_t m_start;
     /// constructor
     ReadCompletionData(libradosstriper::RadosStriperImpl * striper,
 		       const std::string& soid,
@@ -70,7 +95,8 @@ struct libradosstriper::RadosStriperImpl {
 		       librados::AioCompletionImpl *userCompletion,
 		       bufferlist* bl,
 		       std::vector<ObjectExtent>* extents,
-		       std::vector<bufferlist>* resultbl);
+		       std::vector<bufferlist>* resultbl,
+		       MultiAioCompletionImpl *multiAioCompl);
     /// destructor
     virtual ~ReadCompletionData();
     /// complete method
@@ -103,14 +129,18 @@ struct libradosstriper::RadosStriperImpl {
     /// constructor
     RadosReadCompletionData(MultiAioCompletionImpl *multiAioCompl,
 			    uint64_t expectedBytes,
-			    bufferlist *bl) :
-      m_multiAioCompl(multiAioCompl), m_expectedBytes(expectedBytes), m_bl(bl) {};
+			    bufferlist *bl,
+			    ReadCompletionData *read) :
+      m_multiAioCompl(multiAioCompl), m_expectedBytes(expectedBytes), m_bl(bl),
+      m_read(read) {};
     /// the multi asynch io completion object to be used
     MultiAioCompletionImpl *m_multiAioCompl;
     /// the expected number of bytes
     uint64_t m_expectedBytes;
     /// the bufferlist object where data have been written
     bufferlist *m_bl;
+    /// the striped read this is part of
+    ReadCompletionData *m_read;
   };
 
   /**
@@ -146,7 +176,7 @@ struct libradosstriper::RadosStriperImpl {
    */
   RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl);
   /// Destructor
-  ~RadosStriperImpl() {};
+  ~RadosStriperImpl();
 
   // configuration
   int setObjectLayoutStripeUnit(unsigned int stripe_unit);
@@ -178,6 +208,14 @@ struct libradosstriper::RadosStriperImpl {
 	       char* buf, size_t len, uint64_t off);
   int aio_flush();
 
+  /**
+   * issue the reads of up to max (0 for all) further extents of a
+   * striped read. Called once when the read starts and again as each
+   * rados read completes, so that at most rados_striper_read_window
+   * reads are in flight per striped read.
+   */
+  void aio_read_next_extents(ReadCompletionData *cdata, size_t max);
+
   // stat, deletion and truncation
   int stat(const std::string& soid, uint64_t *psize, time_t *pmtime);
   int remove(const std::string& soid);
@@ -314,6 +352,9 @@ struct libradosstriper::RadosStriperImpl {
 
   // Default layout
   ceph_file_layout m_layout;
+
+  // throughput counters
+  PerfCounters *m_perfcounter;
 };
 
 #endif
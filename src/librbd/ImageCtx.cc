@@ -92,6 +92,10 @@ namespace librbd {
 				       cct->_conf->rbd_cache_target_dirty,
 				       cct->_conf->rbd_cache_max_dirty_age,
 				       cct->_conf->rbd_cache_block_writes_upfront);
+      object_cacher->set_replacement_policy(cct->_conf->rbd_cache_replacement_policy);
+      readahead.set_trigger_requests(cct->_conf->rbd_readahead_trigger_requests);
+      readahead.set_min_readahead_size(cct->_conf->rbd_readahead_min_bytes);
+      readahead.set_max_readahead_size(cct->_conf->rbd_readahead_max_bytes);
       object_set = new ObjectCacher::ObjectSet(NULL, data_ctx.get_id(), 0);
       object_set->return_enoent = true;
       object_cacher->start();
@@ -193,6 +197,12 @@ namespace librbd {
       ldout(cct, 10) << " cache bytes " << cct->_conf->rbd_cache_size << " order " << (int)order
 		     << " -> about " << obj << " objects" << dendl;
       object_cacher->set_max_objects(obj);
+
+      // end readahead on a period or stripe unit boundary where we can
+      vector<uint64_t> alignments;
+      alignments.push_back(stripe_count << order);
+      alignments.push_back(stripe_unit);
+      readahead.set_alignments(alignments);
     }
 
     ldout(cct, 10) << "init_layout stripe_unit " << stripe_unit
@@ -232,6 +242,10 @@ namespace librbd {
     plb.add_u64_counter(l_librbd_snap_rollback, "snap_rollback");
     plb.add_u64_counter(l_librbd_notify, "notify");
     plb.add_u64_counter(l_librbd_resize, "resize");
+    plb.add_u64_counter(l_librbd_readahead, "readahead");
+    plb.add_u64_counter(l_librbd_readahead_bytes, "readahead_bytes");
+    plb.add_u64_counter(l_librbd_readahead_hit_bytes, "readahead_hit_bytes");
+    plb.add_u64_counter(l_librbd_readahead_waste_bytes, "readahead_waste_bytes");
 
     perfcounter = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perfcounter);
@@ -565,6 +579,9 @@ namespace librbd {
   int ImageCtx::invalidate_cache() {
     if (!object_cacher)
       return 0;
+    // readahead still in flight would leave rx buffers behind
+    readahead.wait_for_pending();
+    readahead.reset();
     cache_lock.Lock();
     object_cacher->release_set(object_set);
     cache_lock.Unlock();
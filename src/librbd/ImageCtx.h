@@ -18,6 +18,7 @@
 #include "include/rbd_types.h"
 #include "include/types.h"
 #include "osdc/ObjectCacher.h"
+#include "osdc/Readahead.h"
 
 #include "cls/rbd/cls_rbd_client.h"
 #include "librbd/LibrbdWriteback.h"
@@ -89,6 +90,7 @@ namespace librbd {
     ObjectCacher *object_cacher;
     LibrbdWriteback *writeback_handler;
     ObjectCacher::ObjectSet *object_set;
+    Readahead readahead;  ///< readahead state for object_set
 
     /**
      * Either image_name or image_id must be set.
@@ -3107,6 +3107,69 @@ reprotect_and_return_err:
     req->complete(comp->get_return_value());
   }
 
+  class C_RBD_Readahead : public Context {
+  public:
+    C_RBD_Readahead(ImageCtx *ictx, object_t oid, uint64_t offset,
+		    uint64_t length)
+      : m_ictx(ictx), m_oid(oid), m_offset(offset), m_length(length) {}
+    virtual void finish(int r) {
+      ldout(m_ictx->cct, 20) << "C_RBD_Readahead on " << m_oid << ": "
+			     << m_offset << "~" << m_length << " r = " << r
+			     << dendl;
+      m_ictx->readahead.dec_pending();
+    }
+  private:
+    ImageCtx *m_ictx;
+    object_t m_oid;
+    uint64_t m_offset;
+    uint64_t m_length;
+  };
+
+  static void readahead(ImageCtx *ictx,
+			const vector<pair<uint64_t,uint64_t> >& image_extents,
+			uint64_t image_size)
+  {
+    Readahead::update_t ra;
+    for (vector<pair<uint64_t,uint64_t> >::const_iterator p = image_extents.begin();
+	 p != image_extents.end();
+	 ++p) {
+      ictx->readahead.update(p->first, p->second, image_size, &ra);
+    }
+    if (ra.hit_bytes)
+      ictx->perfcounter->inc(l_librbd_readahead_hit_bytes, ra.hit_bytes);
+    if (ra.waste_bytes)
+      ictx->perfcounter->inc(l_librbd_readahead_waste_bytes, ra.waste_bytes);
+    if (ra.extents.empty())
+      return;
+
+    for (vector<Readahead::extent_t>::iterator p = ra.extents.begin();
+	 p != ra.extents.end();
+	 ++p) {
+      ldout(ictx->cct, 20) << "readahead " << p->first << "~" << p->second
+			   << dendl;
+      map<object_t,vector<ObjectExtent> > object_extents;
+      Striper::file_to_extents(ictx->cct, ictx->format_string, &ictx->layout,
+			       p->first, p->second, 0, object_extents);
+      for (map<object_t,vector<ObjectExtent> >::iterator q = object_extents.begin();
+	   q != object_extents.end();
+	   ++q) {
+	for (vector<ObjectExtent>::iterator e = q->second.begin();
+	     e != q->second.end();
+	     ++e) {
+	  ldout(ictx->cct, 20) << "readahead oid " << e->oid << " "
+			       << e->offset << "~" << e->length << dendl;
+	  Context *comp = new C_RBD_Readahead(ictx, e->oid, e->offset,
+					      e->length);
+	  ictx->readahead.inc_pending();
+	  // no destination bufferlist: just populate the cache
+	  ictx->aio_read_from_cache(e->oid, NULL, e->length, e->offset, comp);
+	}
+      }
+    }
+    ictx->perfcounter->inc(l_librbd_readahead);
+    ictx->perfcounter->inc(l_librbd_readahead_bytes, ra.bytes);
+  }
+
   int aio_read(ImageCtx *ictx, uint64_t off, size_t len,
 	       char *buf, bufferlist *bl,
 	       AioCompletion *c)
@@ -3128,6 +3191,7 @@ reprotect_and_return_err:
 
     ictx->snap_lock.get_read();
     snap_t snap_id = ictx->snap_id;
+    uint64_t image_size = ictx->get_image_size(snap_id);
     ictx->snap_lock.put_read();
 
     // map
@@ -3187,6 +3251,10 @@ reprotect_and_return_err:
 	}
       }
     }
+
+    if (ictx->object_cacher)
+      readahead(ictx, image_extents, image_size);
+
     ret = buffer_ofs;
   done:
     c->finish_adding_requests(ictx->cct);
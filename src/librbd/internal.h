@@ -47,6 +47,11 @@ enum {
   l_librbd_notify,
   l_librbd_resize,
 
+  l_librbd_readahead,
+  l_librbd_readahead_bytes,
+  l_librbd_readahead_hit_bytes,
+  l_librbd_readahead_waste_bytes,
+
   l_librbd_last,
 };
 
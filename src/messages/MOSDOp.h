@@ -32,7 +32,7 @@ class OSD;
 
 class MOSDOp : public Message {
 
-  static const int HEAD_VERSION = 4;
+  static const int HEAD_VERSION = 5;
   static const int COMPAT_VERSION = 3;
 
 private:
@@ -42,6 +42,7 @@ private:
   utime_t mtime;
   eversion_t reassert_version;
   int32_t retry_attempt;   // 0 is first attempt.  -1 if we don't know.
+  uint64_t trace_id;       // client-chosen id, constant across resends; 0 if none
 
   object_t oid;
   object_locator_t oloc;
@@ -91,13 +92,15 @@ public:
   utime_t get_mtime() { return mtime; }
 
   MOSDOp()
-    : Message(CEPH_MSG_OSD_OP, HEAD_VERSION, COMPAT_VERSION) { }
+    : Message(CEPH_MSG_OSD_OP, HEAD_VERSION, COMPAT_VERSION),
+      trace_id(0) { }
   MOSDOp(int inc, long tid,
          object_t& _oid, object_locator_t& _oloc, pg_t& _pgid, epoch_t _osdmap_epoch,
 	 int _flags)
     : Message(CEPH_MSG_OSD_OP, HEAD_VERSION, COMPAT_VERSION),
       client_inc(inc),
       osdmap_epoch(_osdmap_epoch), flags(_flags), retry_attempt(-1),
+      trace_id(0),
       oid(_oid), oloc(_oloc), pgid(_pgid) {
     set_tid(tid);
   }
@@ -108,6 +111,9 @@ public:
   void set_version(eversion_t v) { reassert_version = v; }
   void set_mtime(utime_t mt) { mtime = mt; }
 
+  uint64_t get_trace_id() const { return trace_id; }
+  void set_trace_id(uint64_t t) { trace_id = t; }
+
   // ops
   void add_simple_op(int o, uint64_t off, uint64_t len) {
     OSDOp osd_op;
@@ -251,6 +257,7 @@ struct ceph_osd_request_head {
       ::encode(snaps, payload);
 
       ::encode(retry_attempt, payload);
+      ::encode(trace_id, payload);
     }
   }
 
@@ -332,6 +339,11 @@ struct ceph_osd_request_head {
 	::decode(retry_attempt, p);
       else
 	retry_attempt = -1;
+
+      if (header.version >= 5)
+	::decode(trace_id, p);
+      else
+	trace_id = 0;
     }
 
     OSDOp::split_osd_op_vector_in_data(ops, data);
@@ -366,6 +378,8 @@ struct ceph_osd_request_head {
     out << " " << pgid;
     if (is_retry_attempt())
       out << " RETRY=" << get_retry_attempt();
+    if (trace_id)
+      out << " trace=" << trace_id;
     if (reassert_version != eversion_t())
       out << " reassert_version=" << reassert_version;
     if (get_snap_seq())
@@ -240,6 +240,14 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     mon->store->apply_transaction(t);
   }
 
+  // this maps every pg and holds up paxos while it does; it is off by
+  // default until it can be built incrementally or off this path
+  if (g_conf->mon_osd_cache_pg_mapping) {
+    osdmap.build_pg_mapping();
+    dout(10) << __func__ << " built pg mapping for e" << osdmap.epoch
+	     << ", " << osdmap.get_pg_mapping_bytes() << " bytes" << dendl;
+  }
+
   for (int o = 0; o < osdmap.get_max_osd(); o++) {
     if (osdmap.is_down(o)) {
       // invalidate osd_epoch cache
@@ -1264,6 +1272,18 @@ bool OSDMonitor::preprocess_boot(MOSDBoot *m)
             << " doesn't announce support -- ignore" << dendl;
     goto ignore;
   }
+
+  {
+    // pool flags and cache modes older osds would misinterpret
+    uint64_t required = osdmap.get_features(CEPH_ENTITY_TYPE_OSD, NULL) &
+      (CEPH_FEATURE_OSD_EC_OVERWRITES | CEPH_FEATURE_OSD_PROXY_CACHE);
+    if ((m->get_connection()->get_features() & required) != required) {
+      dout(0) << __func__ << " osdmap requires features " << required
+	      << " but osd at " << m->get_orig_source_inst()
+	      << " doesn't announce support -- ignore" << dendl;
+      goto ignore;
+    }
+  }
   
   // already booted?
   if (osdmap.is_up(from) &&
@@ -2659,6 +2679,10 @@ bool OSDMonitor::preprocess_command(MMonCommand *m)
        f->dump_string("erasure_code_profile", p->erasure_code_profile);
       } else if (var == "min_read_recency_for_promote") {
 	f->dump_int("min_read_recency_for_promote", p->min_read_recency_for_promote);
+      } else if (var == "min_write_recency_for_promote") {
+	f->dump_int("min_write_recency_for_promote", p->min_write_recency_for_promote);
+      } else if (var == "hit_set_grade_decay_rate") {
+	f->dump_int("hit_set_grade_decay_rate", p->hit_set_grade_decay_rate);
       }
 
       f->close_section();
@@ -2710,6 +2734,10 @@ bool OSDMonitor::preprocess_command(MMonCommand *m)
        ss << "erasure_code_profile: " << p->erasure_code_profile;
       } else if (var == "min_read_recency_for_promote") {
 	ss << "min_read_recency_for_promote: " << p->min_read_recency_for_promote;
+      } else if (var == "min_write_recency_for_promote") {
+	ss << "min_write_recency_for_promote: " << p->min_write_recency_for_promote;
+      } else if (var == "hit_set_grade_decay_rate") {
+	ss << "hit_set_grade_decay_rate: " << p->hit_set_grade_decay_rate;
       }
 
       rdata.append(ss);
@@ -3766,6 +3794,39 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
       ss << "expecting value 'true', 'false', '0', or '1'";
       return -EINVAL;
     }
+  } else if (var == "allow_ec_overwrites") {
+    if (!p.is_erasure()) {
+      ss << "ec overwrites can only be enabled for an erasure coded pool";
+      return -EINVAL;
+    }
+    if (val == "true" || (interr.empty() && n == 1)) {
+      int err = check_cluster_features(CEPH_FEATURE_OSD_EC_OVERWRITES, ss);
+      if (err)
+	return err;
+      p.flags |= pg_pool_t::FLAG_EC_OVERWRITES;
+    } else if (val == "false" || (interr.empty() && n == 0)) {
+      if (p.has_flag(pg_pool_t::FLAG_EC_OVERWRITES)) {
+	// objects written since may no longer be append-only
+	ss << "ec overwrites cannot be disabled once enabled";
+	return -EINVAL;
+      }
+    } else {
+      ss << "expecting value 'true', 'false', '0', or '1'";
+      return -EINVAL;
+    }
+  } else if (var == "fast_read") {
+    if (!p.is_erasure()) {
+      ss << "fast read can only be enabled for an erasure coded pool";
+      return -EINVAL;
+    }
+    if (val == "true" || (interr.empty() && n == 1)) {
+      p.flags |= pg_pool_t::FLAG_FAST_READ;
+    } else if (val == "false" || (interr.empty() && n == 0)) {
+      p.flags &= ~pg_pool_t::FLAG_FAST_READ;
+    } else {
+      ss << "expecting value 'true', 'false', '0', or '1'";
+      return -EINVAL;
+    }
   } else if (var == "hit_set_type") {
     if (val == "none")
       p.hit_set_params = HitSet::Params();
@@ -3864,6 +3925,22 @@ int OSDMonitor::prepare_command_pool_set(map<string,cmd_vartype> &cmdmap,
       return -EINVAL;
     }
     p.min_read_recency_for_promote = n;
+  } else if (var == "min_write_recency_for_promote") {
+    if (interr.length()) {
+      ss << "error parsing integer value '" << val << "': " << interr;
+      return -EINVAL;
+    }
+    p.min_write_recency_for_promote = n;
+  } else if (var == "hit_set_grade_decay_rate") {
+    if (interr.length()) {
+      ss << "error parsing integer value '" << val << "': " << interr;
+      return -EINVAL;
+    }
+    if (n < 0 || n > 100) {
+      ss << "value must be in the range 0..100";
+      return -ERANGE;
+    }
+    p.hit_set_grade_decay_rate = n;
   } else {
     ss << "unrecognized variable '" << var << "'";
     return -EINVAL;
@@ -5606,6 +5683,14 @@ done:
       err = -EINVAL;
       goto reply;
     }
+    if (mode == pg_pool_t::CACHEMODE_PROXY) {
+      // older osds assert on a cache mode they do not know
+      err = check_cluster_features(CEPH_FEATURE_OSD_PROXY_CACHE, ss);
+      if (err == -EAGAIN)
+	goto wait;
+      if (err)
+	goto reply;
+    }
 
     // pool already has this cache-mode set and there are no pending changes
     if (p->cache_mode == mode &&
@@ -5624,13 +5709,15 @@ done:
      *  writeback:  Cache writes, promote reads from base pool
      *  readonly:   Forward writes to base pool
      *  readforward: Writes are in writeback mode, Reads and in forward mode
+     *  proxy:      Proxy reads and writes to base pool, never promote
      *
      * Hence, these are the allowed transitions:
      *
      *  none -> any
-     *  forward -> readforward || writeback || any IF num_objects_dirty == 0
-     *  readforward -> forward || writeback || any IF num_objects_dirty == 0
-     *  writeback -> readforward || forward
+     *  forward -> readforward || writeback || proxy || any IF num_objects_dirty == 0
+     *  readforward -> forward || writeback || proxy || any IF num_objects_dirty == 0
+     *  proxy -> forward || readforward || writeback || any IF num_objects_dirty == 0
+     *  writeback -> readforward || forward || proxy
      *  readonly -> any
      */
 
@@ -5640,23 +5727,33 @@ done:
 
     if (p->cache_mode == pg_pool_t::CACHEMODE_WRITEBACK &&
         (mode != pg_pool_t::CACHEMODE_FORWARD &&
-	  mode != pg_pool_t::CACHEMODE_READFORWARD)) {
+	  mode != pg_pool_t::CACHEMODE_READFORWARD &&
+	  mode != pg_pool_t::CACHEMODE_PROXY)) {
       ss << "unable to set cache-mode '" << pg_pool_t::get_cache_mode_name(mode)
          << "' on a '" << pg_pool_t::get_cache_mode_name(p->cache_mode)
          << "' pool; only '"
          << pg_pool_t::get_cache_mode_name(pg_pool_t::CACHEMODE_FORWARD)
 	 << "','"
          << pg_pool_t::get_cache_mode_name(pg_pool_t::CACHEMODE_READFORWARD)
+	 << "','"
+         << pg_pool_t::get_cache_mode_name(pg_pool_t::CACHEMODE_PROXY)
         << "' allowed.";
       err = -EINVAL;
       goto reply;
     }
     if ((p->cache_mode == pg_pool_t::CACHEMODE_READFORWARD &&
         (mode != pg_pool_t::CACHEMODE_WRITEBACK &&
-	  mode != pg_pool_t::CACHEMODE_FORWARD)) ||
+	  mode != pg_pool_t::CACHEMODE_FORWARD &&
+	  mode != pg_pool_t::CACHEMODE_PROXY)) ||
 
         (p->cache_mode == pg_pool_t::CACHEMODE_FORWARD &&
         (mode != pg_pool_t::CACHEMODE_WRITEBACK &&
+	  mode != pg_pool_t::CACHEMODE_READFORWARD &&
+	  mode != pg_pool_t::CACHEMODE_PROXY)) ||
+
+        (p->cache_mode == pg_pool_t::CACHEMODE_PROXY &&
+        (mode != pg_pool_t::CACHEMODE_WRITEBACK &&
+	  mode != pg_pool_t::CACHEMODE_FORWARD &&
 	  mode != pg_pool_t::CACHEMODE_READFORWARD))) {
 
       const pool_stat_t& tier_stats =
@@ -5741,6 +5838,13 @@ done:
       err = -EINVAL;
       goto reply;
     }
+    if (mode == pg_pool_t::CACHEMODE_PROXY) {
+      err = check_cluster_features(CEPH_FEATURE_OSD_PROXY_CACHE, ss);
+      if (err == -EAGAIN)
+	goto wait;
+      if (err)
+	goto reply;
+    }
     HitSet::Params hsp;
     if (g_conf->osd_tier_default_cache_hit_set_type == "bloom") {
       BloomHitSet::Params *bsp = new BloomHitSet::Params;
@@ -5771,6 +5875,8 @@ done:
     ntp->hit_set_count = g_conf->osd_tier_default_cache_hit_set_count;
     ntp->hit_set_period = g_conf->osd_tier_default_cache_hit_set_period;
     ntp->min_read_recency_for_promote = g_conf->osd_tier_default_cache_min_read_recency_for_promote;
+    ntp->min_write_recency_for_promote = g_conf->osd_tier_default_cache_min_write_recency_for_promote;
+    ntp->hit_set_grade_decay_rate = g_conf->osd_tier_default_cache_hit_set_grade_decay_rate;
     ntp->hit_set_params = hsp;
     ntp->target_max_bytes = size;
     ss << "pool '" << tierpoolstr << "' is now (or already was) a cache tier of '" << poolstr << "'";
@@ -2809,15 +2809,18 @@ int FileStore::read(
     return got;
   }
   bptr.set_length(got);   // properly size the buffer
-  bl.push_back(bptr);   // put it in the target bufferlist
+  bufferlist got_bl;
+  got_bl.push_back(bptr);
 
   if (m_filestore_sloppy_crc && (!replaying || backend->can_checkpoint())) {
     ostringstream ss;
-    int errors = backend->_crc_verify_read(**fd, offset, got, bl, &ss);
+    int errors = backend->_crc_verify_read(**fd, offset, got, got_bl, &ss);
     if (errors > 0) {
       dout(0) << "FileStore::read " << cid << "/" << oid << " " << offset << "~"
 	      << got << " ... BAD CRC:\n" << ss.str() << dendl;
-      assert(0 == "bad crc on read");
+      lfn_close(fd);
+      assert(allow_eio || !m_filestore_fail_eio);
+      return -EIO;
     }
   }
 
@@ -2829,6 +2832,7 @@ int FileStore::read(
       debug_data_eio(oid)) {
     return -EIO;
   } else {
+    bl.claim_append(got_bl);   // put it in the target bufferlist
     tracepoint(objectstore, read_exit, got);
     return got;
   }
@@ -19,6 +19,7 @@
 
 #include "ECUtil.h"
 #include "ECBackend.h"
+#include "common/errno.h"
 #include "messages/MOSDPGPush.h"
 #include "messages/MOSDPGPushReply.h"
 
@@ -100,7 +101,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::ReadOp &rhs)
 	     << ", priority=" << rhs.priority
 	     << ", obj_to_source=" << rhs.obj_to_source
 	     << ", source_to_obj=" << rhs.source_to_obj
-	     << ", in_progress=" << rhs.in_progress << ")";
+	     << ", in_progress=" << rhs.in_progress
+	     << (rhs.do_fast_read ? ", fast_read" : "") << ")";
 }
 
 void ECBackend::ReadOp::dump(Formatter *f) const
@@ -115,6 +117,7 @@ void ECBackend::ReadOp::dump(Formatter *f) const
   f->dump_stream("obj_to_source") << obj_to_source;
   f->dump_stream("source_to_obj") << source_to_obj;
   f->dump_stream("in_progress") << in_progress;
+  f->dump_bool("fast_read", do_fast_read);
 }
 
 ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
@@ -147,7 +150,8 @@ ostream &operator<<(ostream &lhs, const ECBackend::RecoveryOp &rhs)
 	     << " obc refcount=" << rhs.obc.use_count()
 	     << " state=" << ECBackend::RecoveryOp::tostr(rhs.state)
 	     << " waiting_on_pushes=" << rhs.waiting_on_pushes
-	     << " extent_requested=" << rhs.extent_requested;
+	     << " extent_requested=" << rhs.extent_requested
+	     << " read_size=" << rhs.read_size;
 }
 
 void ECBackend::RecoveryOp::dump(Formatter *f) const
@@ -162,6 +166,7 @@ void ECBackend::RecoveryOp::dump(Formatter *f) const
   f->dump_stream("state") << tostr(state);
   f->dump_stream("waiting_on_pushes") << waiting_on_pushes;
   f->dump_stream("extent_requested") << extent_requested;
+  f->dump_unsigned("read_size", read_size);
 }
 
 ECBackend::ECBackend(
@@ -451,6 +456,9 @@ void ECBackend::dispatch_recovery_messages(RecoveryMessages &m, int priority)
   m.t = NULL;
   if (m.reads.empty())
     return;
+  get_parent()->get_logger()->inc(l_osd_ec_recovery_read);
+  get_parent()->get_logger()->inc(l_osd_ec_recovery_read_objects,
+				  m.reads.size());
   start_read_op(
     priority,
     m.reads,
@@ -470,7 +478,8 @@ void ECBackend::continue_recovery_op(
       assert(!op.recovery_progress.data_complete);
       set<int> want(op.missing_on_shards.begin(), op.missing_on_shards.end());
       set<pg_shard_t> to_read;
-      uint64_t recovery_max_chunk = get_recovery_chunk_size();
+      uint64_t recovery_max_chunk =
+	op.read_size ? op.read_size : get_recovery_chunk_size();
       int r = get_min_avail_to_read_shards(
 	op.hoid, want, true, &to_read);
       if (r != 0) {
@@ -568,6 +577,9 @@ void ECBackend::continue_recovery_op(
 	    }
 	  }
 	  get_parent()->on_global_recover(op.hoid);
+	  get_parent()->get_logger()->inc(l_osd_ec_recovery_objects);
+	  get_parent()->get_logger()->inc(l_osd_ec_recovery_bytes,
+					  op.obc->obs.oi.size);
 	  dout(10) << __func__ << ": WRITING return " << op << dendl;
 	  recovery_ops.erase(op.hoid);
 	  return;
@@ -594,9 +606,14 @@ void ECBackend::run_recovery_op(
 {
   ECRecoveryHandle *h = static_cast<ECRecoveryHandle*>(_h);
   RecoveryMessages m;
+  uint64_t read_size = 0;
+  if (h->max_bytes && !h->ops.empty())
+    read_size = get_batch_read_size(
+      sinfo, get_recovery_chunk_size(), h->max_bytes, h->ops.size());
   for (list<RecoveryOp>::iterator i = h->ops.begin();
        i != h->ops.end();
        ++i) {
+    i->read_size = read_size;
     dout(10) << __func__ << ": starting " << *i << dendl;
     assert(!recovery_ops.count(i->hoid));
     RecoveryOp &op = recovery_ops.insert(make_pair(i->hoid, *i)).first->second;
@@ -606,6 +623,18 @@ void ECBackend::run_recovery_op(
   delete _h;
 }
 
+uint64_t ECBackend::get_batch_read_size(
+  const ECUtil::stripe_info_t &sinfo,
+  uint64_t chunk,
+  uint64_t max_bytes,
+  unsigned objects)
+{
+  assert(objects > 0);
+  uint64_t r = sinfo.logical_to_prev_stripe_offset(max_bytes / objects);
+  r = MAX(r, sinfo.get_stripe_width());
+  return MIN(r, chunk);
+}
+
 void ECBackend::recover_object(
   const hobject_t &hoid,
   eversion_t v,
@@ -936,10 +965,22 @@ void ECBackend::handle_sub_read_reply(
   dout(10) << __func__ << ": reply " << op << dendl;
   map<ceph_tid_t, ReadOp>::iterator iter = tid_to_read_map.find(op.tid);
   if (iter == tid_to_read_map.end()) {
+    map<ceph_tid_t, pair<utime_t, set<pg_shard_t> > >::iterator s =
+      fast_read_stragglers.find(op.tid);
+    if (s != fast_read_stragglers.end()) {
+      // still a useful latency sample
+      get_parent()->note_peer_read_latency(
+	from.osd, ceph_clock_now(cct) - s->second.first);
+      s->second.second.erase(from);
+      if (s->second.second.empty())
+	fast_read_stragglers.erase(s);
+    }
     //canceled
     return;
   }
   ReadOp &rop = iter->second;
+  get_parent()->note_peer_read_latency(
+    from.osd, ceph_clock_now(cct) - rop.start);
   for (map<hobject_t, list<pair<uint64_t, bufferlist> > >::iterator i =
 	 op.buffers_read.begin();
        i != op.buffers_read.end();
@@ -997,16 +1038,79 @@ shard_to_read_map.find(from);
 
   assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
-  if (!rop.in_progress.empty()) {
+  bool fast_read_done = rop.do_fast_read && fast_read_ready(rop);
+  if (!rop.in_progress.empty() && !fast_read_done) {
     dout(10) << __func__ << " readop not complete: " << rop << dendl;
   } else {
+    if (!rop.in_progress.empty()) {
+      dout(10) << __func__ << " fast read complete without "
+	       << rop.in_progress << dendl;
+      get_parent()->get_logger()->inc(l_osd_ec_fast_read_early);
+    }
     dout(10) << __func__ << " readop complete: " << rop << dendl;
     complete_read_op(rop, m);
   }
 }
 
+bool ECBackend::fast_read_ready(ReadOp &rop)
+{
+  for (map<hobject_t, read_result_t>::iterator i = rop.complete.begin();
+       i != rop.complete.end();
+       ++i) {
+    read_result_t &res = i->second;
+    if (res.returned.empty())
+      return false;
+    set<int> have;
+    for (map<pg_shard_t, bufferlist>::iterator j =
+	   res.returned.front().get<2>().begin();
+	 j != res.returned.front().get<2>().end();
+	 ++j) {
+      if (!res.errors.count(j->first))
+	have.insert(j->first.shard);
+    }
+    set<int> need;
+    if (ec_impl->minimum_to_decode(rop.want_to_read, have, &need) < 0)
+      return false;
+  }
+
+  for (map<hobject_t, read_result_t>::iterator i = rop.complete.begin();
+       i != rop.complete.end();
+       ++i) {
+    read_result_t &res = i->second;
+    if (res.errors.empty())
+      continue;
+    dout(10) << __func__ << " " << i->first << " ignoring errors from "
+	     << res.errors << dendl;
+    for (list<
+	   boost::tuple<
+	     uint64_t, uint64_t, map<pg_shard_t, bufferlist> > >::iterator j =
+	   res.returned.begin();
+	 j != res.returned.end();
+	 ++j) {
+      for (map<pg_shard_t, int>::iterator k = res.errors.begin();
+	   k != res.errors.end();
+	   ++k)
+	j->get<2>().erase(k->first);
+    }
+    res.errors.clear();
+    res.r = 0;
+  }
+  return true;
+}
+
 void ECBackend::complete_read_op(ReadOp &rop, RecoveryMessages *m)
 {
+  // a fast read may complete before every shard replied
+  for (set<pg_shard_t>::iterator i = rop.in_progress.begin();
+       i != rop.in_progress.end();
+       ++i) {
+    map<pg_shard_t, set<ceph_tid_t> >::iterator siter =
+      shard_to_read_map.find(*i);
+    if (siter != shard_to_read_map.end())
+      siter->second.erase(rop.tid);
+  }
+  if (!rop.in_progress.empty())
+    fast_read_stragglers[rop.tid] = make_pair(rop.start, rop.in_progress);
   map<hobject_t, read_request_t>::iterator reqiter =
     rop.to_read.begin();
   map<hobject_t, read_result_t>::iterator resiter =
@@ -1124,7 +1228,9 @@ void ECBackend::check_recovery_sources(const OSDMapRef osdmap)
 void ECBackend::on_change()
 {
   dout(10) << __func__ << dendl;
+  waiting_rmw.clear();
   writing.clear();
+  rmw_failed_objects.clear();
   tid_to_op_map.clear();
   for (map<ceph_tid_t, ReadOp>::iterator i = tid_to_read_map.begin();
        i != tid_to_read_map.end();
@@ -1147,6 +1253,7 @@ void ECBackend::on_change()
   }
   in_progress_client_reads.clear();
   shard_to_read_map.clear();
+  fast_read_stragglers.clear();
   clear_state();
 }
 
@@ -1204,6 +1311,14 @@ struct MustPrependHashInfo : public ObjectModDesc::Visitor {
       state = FOUND_CREATE_STASH;
     }
   }
+  void rollback_extents(
+    version_t gen,
+    const vector<pair<uint64_t, uint64_t> > &extents) {
+    // an overwrite drops the hashes, so the old HashInfo is needed as well
+    if (state == EMPTY) {
+      state = FOUND_APPEND;
+    }
+  }
   bool must_prepend_hash_info() const { return state == FOUND_APPEND; }
 };
 
@@ -1251,44 +1366,278 @@ void ECBackend::submit_transaction(
 	get_hash_info(*i)));
   }
 
-  for (vector<pg_log_entry_t>::iterator i = op->log_entries.begin();
-       i != op->log_entries.end();
+  dout(10) << __func__ << ": op " << *op << " starting" << dendl;
+  if (op->t->has_overwrites())
+    op->rmw_state = Op::RMW_NEED_READ;
+  if (op->rmw_state != Op::RMW_NONE || !waiting_rmw.empty() ||
+      rmw_touches_failed(op)) {
+    waiting_rmw.push_back(op);
+    check_rmw();
+  } else {
+    start_write(op);
+    writing.push_back(op);
+  }
+  dout(10) << "onreadable_sync: " << op->on_local_applied_sync << dendl;
+}
+
+struct RMWReadCB :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  ECBackend *ec;
+  ECBackend::Op *op;
+  hobject_t hoid;
+  RMWReadCB(ECBackend *ec, ECBackend::Op *op, const hobject_t &hoid)
+    : ec(ec), op(op), hoid(hoid) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) {
+    ECBackend::read_result_t &res = in.second;
+    if (op->rmw_state == ECBackend::Op::RMW_FAILED)
+      return;  // the read of another object failed
+    assert(op->rmw_state == ECBackend::Op::RMW_READING);
+    int inject = ec->cct->_conf->osd_debug_inject_ec_rmw_read_errors;
+    if (inject > 0 && res.r == 0 && !op->rmw_bad_shards.count(hoid) &&
+	!res.returned.empty()) {
+      map<pg_shard_t, bufferlist> &got = res.returned.front().get<2>();
+      for (map<pg_shard_t, bufferlist>::iterator i = got.begin();
+	   i != got.end() && inject > 0;
+	   ++i, --inject)
+	res.errors[i->first] = -EIO;
+      res.r = -EIO;
+    }
+    if (res.r != 0 || !res.errors.empty()) {
+      if (res.errors.empty()) {
+	// no shard to exclude
+	ec->fail_rmw(op, hoid, res.r);
+	ec->check_rmw();
+	return;
+      }
+      for (map<pg_shard_t, int>::iterator i = res.errors.begin();
+	   i != res.errors.end();
+	   ++i)
+	op->rmw_bad_shards[hoid].insert(i->first);
+      ec->retry_rmw_read(op, hoid);
+      return;
+    }
+    map<uint64_t, bufferlist> &stripes = op->rmw_stripes[hoid];
+    for (list<boost::tuple<uint64_t, uint64_t,
+			   map<pg_shard_t, bufferlist> > >::iterator i =
+	   res.returned.begin();
+	 i != res.returned.end();
+	 ++i) {
+      map<int, bufferlist> to_decode;
+      for (map<pg_shard_t, bufferlist>::iterator j = i->get<2>().begin();
+	   j != i->get<2>().end();
+	   ++j) {
+	to_decode[j->first.shard].claim(j->second);
+      }
+      bufferlist bl;
+      ECUtil::decode(
+	ec->sinfo,
+	ec->ec_impl,
+	to_decode,
+	&bl);
+      assert(bl.length() == i->get<1>());
+      stripes[i->get<0>()].claim(bl);
+    }
+    op->rmw_pending_reads.erase(hoid);
+    if (op->rmw_pending_reads.empty()) {
+      op->rmw_state = ECBackend::Op::RMW_NONE;
+      ec->check_rmw();
+    }
+  }
+};
+
+bool ECBackend::rmw_blocked(Op *op)
+{
+  // the stripes must be read after every earlier write to them applied
+  for (list<Op*>::iterator i = writing.begin(); i != writing.end(); ++i) {
+    if ((*i)->pending_apply.empty())
+      continue;
+    for (map<hobject_t, ECUtil::HashInfoRef>::iterator j =
+	   op->unstable_hash_infos.begin();
+	 j != op->unstable_hash_infos.end();
+	 ++j) {
+      if ((*i)->unstable_hash_infos.count(j->first))
+	return true;
+    }
+  }
+  return false;
+}
+
+void ECBackend::start_rmw(Op *op)
+{
+  assert(op->rmw_state == Op::RMW_NEED_READ);
+  map<hobject_t, set<uint64_t> > stripes;
+  op->t->get_rmw_stripes(sinfo, op->unstable_hash_infos, &stripes);
+  if (stripes.empty()) {
+    dout(10) << __func__ << ": " << *op << " covers whole stripes" << dendl;
+    op->rmw_state = Op::RMW_NONE;
+    return;
+  }
+
+  map<hobject_t, read_request_t> for_read_op;
+  for (map<hobject_t, set<uint64_t> >::iterator i = stripes.begin();
+       i != stripes.end();
        ++i) {
-    MustPrependHashInfo vis;
-    i->mod_desc.visit(&vis);
-    if (vis.must_prepend_hash_info()) {
-      dout(10) << __func__ << ": stashing HashInfo for "
-	       << i->soid << " for entry " << *i << dendl;
-      assert(op->unstable_hash_infos.count(i->soid));
-      ObjectModDesc desc;
-      map<string, boost::optional<bufferlist> > old_attrs;
-      bufferlist old_hinfo;
-      ::encode(*(op->unstable_hash_infos[i->soid]), old_hinfo);
-      old_attrs[ECUtil::get_hinfo_key()] = old_hinfo;
-      desc.setattrs(old_attrs);
-      i->mod_desc.swap(desc);
-      i->mod_desc.claim_append(desc);
-      assert(i->mod_desc.can_rollback());
+    list<pair<uint64_t, uint64_t> > &to_read = op->rmw_to_read[i->first];
+    for (set<uint64_t>::iterator j = i->second.begin();
+	 j != i->second.end();
+	 ++j) {
+      to_read.push_back(make_pair(*j, sinfo.get_stripe_width()));
+    }
+    op->rmw_pending_reads.insert(i->first);
+    if (!add_rmw_read(op, i->first, &for_read_op)) {
+      for (map<hobject_t, read_request_t>::iterator j = for_read_op.begin();
+	   j != for_read_op.end();
+	   ++j)
+	delete j->second.cb;
+      fail_rmw(op, i->first, -EIO);
+      return;
     }
   }
+  dout(10) << __func__ << ": " << *op << " reading " << stripes << dendl;
+  op->rmw_state = Op::RMW_READING;
+  start_read_op(
+      cct->_conf->osd_client_op_priority,
+      for_read_op,
+      op->client_op);
+}
 
-  dout(10) << __func__ << ": op " << *op << " starting" << dendl;
-  start_write(op);
-  writing.push_back(op);
-  dout(10) << "onreadable_sync: " << op->on_local_applied_sync << dendl;
+bool ECBackend::add_rmw_read(
+  Op *op,
+  const hobject_t &hoid,
+  map<hobject_t, read_request_t> *for_read_op)
+{
+  const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+  set<int> want_to_read;
+  for (int i = 0; i < (int)ec_impl->get_data_chunk_count(); ++i) {
+    int chunk = (int)chunk_mapping.size() > i ? chunk_mapping[i] : i;
+    want_to_read.insert(chunk);
+  }
+
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  get_all_avail_shards(hoid, false, &have, &shards);
+  set<pg_shard_t> bad;
+  if (op->rmw_bad_shards.count(hoid))
+    bad = op->rmw_bad_shards[hoid];
+  for (set<pg_shard_t>::iterator i = bad.begin(); i != bad.end(); ++i)
+    have.erase(i->shard);
+
+  set<int> need;
+  int r = ec_impl->minimum_to_decode(want_to_read, have, &need);
+  if (r < 0) {
+    dout(10) << __func__ << ": " << *op << " cannot decode " << hoid
+	     << " without " << bad << dendl;
+    return false;
+  }
+
+  set<pg_shard_t> to_read_shards;
+  for (set<int>::iterator i = need.begin(); i != need.end(); ++i) {
+    assert(shards.count(shard_id_t(*i)));
+    to_read_shards.insert(shards[shard_id_t(*i)]);
+  }
+  for_read_op->insert(
+    make_pair(
+      hoid,
+      read_request_t(
+	hoid,
+	op->rmw_to_read[hoid],
+	to_read_shards,
+	false,
+	new RMWReadCB(this, op, hoid))));
+  return true;
 }
 
-int ECBackend::get_min_avail_to_read_shards(
+void ECBackend::retry_rmw_read(Op *op, const hobject_t &hoid)
+{
+  dout(10) << __func__ << ": " << *op << " rereading " << hoid
+	   << " without " << op->rmw_bad_shards[hoid] << dendl;
+  map<hobject_t, read_request_t> for_read_op;
+  if (!add_rmw_read(op, hoid, &for_read_op)) {
+    fail_rmw(op, hoid, -EIO);
+    check_rmw();
+    return;
+  }
+  start_read_op(
+    cct->_conf->osd_client_op_priority,
+    for_read_op,
+    op->client_op);
+}
+
+void ECBackend::fail_rmw(Op *op, const hobject_t &hoid, int r)
+{
+  derr << __func__ << ": " << *op << " cannot read the old stripes of "
+       << hoid << ": " << cpp_strerror(r) << ", failed shards "
+       << op->rmw_bad_shards[hoid] << dendl;
+  get_parent()->clog_error() << "ec overwrite of " << hoid
+			     << " cannot read old stripes ("
+			     << cpp_strerror(r) << "), failed shards "
+			     << op->rmw_bad_shards[hoid]
+			     << "; writes to it wait for a new interval";
+  op->rmw_state = Op::RMW_FAILED;
+  op->rmw_stripes.clear();
+}
+
+bool ECBackend::rmw_touches_failed(Op *op)
+{
+  if (rmw_failed_objects.empty())
+    return false;
+  if (rmw_failed_objects.count(op->hoid))
+    return true;
+  for (map<hobject_t, ECUtil::HashInfoRef>::iterator i =
+	 op->unstable_hash_infos.begin();
+       i != op->unstable_hash_infos.end();
+       ++i) {
+    if (rmw_failed_objects.count(i->first))
+      return true;
+  }
+  return false;
+}
+
+void ECBackend::check_rmw()
+{
+  while (!waiting_rmw.empty()) {
+    Op *op = waiting_rmw.front();
+    if (op->rmw_state != Op::RMW_FAILED && rmw_touches_failed(op)) {
+      dout(10) << __func__ << ": " << *op << " writes an object whose"
+	       << " earlier overwrite failed" << dendl;
+      op->rmw_state = Op::RMW_FAILED;
+    }
+    if (op->rmw_state == Op::RMW_NEED_READ) {
+      if (rmw_blocked(op)) {
+	dout(20) << __func__ << ": " << *op << " blocked" << dendl;
+	return;
+      }
+      start_rmw(op);
+    }
+    if (op->rmw_state == Op::RMW_READING)
+      return;
+    waiting_rmw.pop_front();
+    if (op->rmw_state == Op::RMW_FAILED) {
+      // set aside in tid_to_op_map; on_change() drops it
+      rmw_failed_objects.insert(op->hoid);
+      for (map<hobject_t, ECUtil::HashInfoRef>::iterator i =
+	     op->unstable_hash_infos.begin();
+	   i != op->unstable_hash_infos.end();
+	   ++i)
+	rmw_failed_objects.insert(i->first);
+      continue;
+    }
+    start_write(op);
+    writing.push_back(op);
+  }
+}
+
+void ECBackend::get_all_avail_shards(
   const hobject_t &hoid,
-  const set<int> &want,
   bool for_recovery,
-  set<pg_shard_t> *to_read)
+  set<int> *_have,
+  map<shard_id_t, pg_shard_t> *_shards)
 {
   map<hobject_t, set<pg_shard_t> >::const_iterator miter =
     get_parent()->get_missing_loc_shards().find(hoid);
 
-  set<int> have;
-  map<shard_id_t, pg_shard_t> shards;
+  set<int> &have = *_have;
+  map<shard_id_t, pg_shard_t> &shards = *_shards;
 
   for (set<pg_shard_t>::const_iterator i =
 	 get_parent()->get_acting_shards().begin();
@@ -1338,6 +1687,17 @@ int ECBackend::get_min_avail_to_read_shards(
       }
     }
   }
+}
+
+int ECBackend::get_min_avail_to_read_shards(
+  const hobject_t &hoid,
+  const set<int> &want,
+  bool for_recovery,
+  set<pg_shard_t> *to_read)
+{
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  get_all_avail_shards(hoid, for_recovery, &have, &shards);
 
   set<int> need;
   int r = ec_impl->minimum_to_decode(want, have, &need);
@@ -1356,10 +1716,61 @@ int ECBackend::get_min_avail_to_read_shards(
   return 0;
 }
 
+int ECBackend::get_fast_read_shards(
+  const hobject_t &hoid,
+  const set<int> &want,
+  set<pg_shard_t> *to_read)
+{
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  get_all_avail_shards(hoid, false, &have, &shards);
+
+  // cheapest first.  Shards we would have to decode from pay a
+  // penalty, and with equal (or unknown) latencies the wanted shards
+  // come first, so that a read without latency data is the same as
+  // without fast_read.
+  vector<pair<pair<double, bool>, int> > by_cost;
+  for (set<int>::iterator i = have.begin(); i != have.end(); ++i) {
+    double lat = get_parent()->get_peer_read_latency(
+      shards[shard_id_t(*i)].osd);
+    bool decode = !want.count(*i);
+    if (decode)
+      lat *= 1 + cct->_conf->osd_ec_fast_read_decode_penalty;
+    by_cost.push_back(make_pair(make_pair(lat, decode), *i));
+  }
+  sort(by_cost.begin(), by_cost.end());
+
+  // the shortest prefix we can decode from
+  set<int> candidates, need;
+  int r = -EIO;
+  vector<pair<pair<double, bool>, int> >::iterator i = by_cost.begin();
+  while (i != by_cost.end()) {
+    candidates.insert((i++)->second);
+    need.clear();
+    r = ec_impl->minimum_to_decode(want, candidates, &need);
+    if (r == 0)
+      break;
+  }
+  if (r < 0)
+    return r;
+  for (int extra = cct->_conf->osd_ec_fast_read_extra_shards;
+       extra > 0 && i != by_cost.end();
+       --extra, ++i)
+    need.insert(i->second);
+
+  dout(20) << __func__ << " " << hoid << " by cost " << by_cost
+	   << " reading " << need << dendl;
+  for (set<int>::iterator j = need.begin(); j != need.end(); ++j)
+    to_read->insert(shards[shard_id_t(*j)]);
+  return 0;
+}
+
 void ECBackend::start_read_op(
   int priority,
   map<hobject_t, read_request_t> &to_read,
-  OpRequestRef _op)
+  OpRequestRef _op,
+  bool do_fast_read,
+  const set<int> &want_to_read)
 {
   ceph_tid_t tid = get_parent()->get_tid();
   assert(!tid_to_read_map.count(tid));
@@ -1368,6 +1779,9 @@ void ECBackend::start_read_op(
   op.tid = tid;
   op.to_read.swap(to_read);
   op.op = _op;
+  op.do_fast_read = do_fast_read;
+  op.want_to_read = want_to_read;
+  op.start = ceph_clock_now(cct);
   dout(10) << __func__ << ": starting " << op << dendl;
 
   map<pg_shard_t, ECSubRead> messages;
@@ -1485,6 +1899,8 @@ void ECBackend::check_op(Op *op)
     writing.pop_front();
     tid_to_op_map.erase(op->tid);
   }
+  if (!waiting_rmw.empty())
+    check_rmw();
   for (map<ceph_tid_t, Op>::iterator i = tid_to_op_map.begin();
        i != tid_to_op_map.end();
        ++i) {
@@ -1493,6 +1909,28 @@ void ECBackend::check_op(Op *op)
 }
 
 void ECBackend::start_write(Op *op) {
+  // only now, with every earlier op generated, is the HashInfo current
+  for (vector<pg_log_entry_t>::iterator i = op->log_entries.begin();
+       i != op->log_entries.end();
+       ++i) {
+    MustPrependHashInfo vis;
+    i->mod_desc.visit(&vis);
+    if (vis.must_prepend_hash_info()) {
+      dout(10) << __func__ << ": stashing HashInfo for "
+	       << i->soid << " for entry " << *i << dendl;
+      assert(op->unstable_hash_infos.count(i->soid));
+      ObjectModDesc desc;
+      map<string, boost::optional<bufferlist> > old_attrs;
+      bufferlist old_hinfo;
+      ::encode(*(op->unstable_hash_infos[i->soid]), old_hinfo);
+      old_attrs[ECUtil::get_hinfo_key()] = old_hinfo;
+      desc.setattrs(old_attrs);
+      i->mod_desc.swap(desc);
+      i->mod_desc.claim_append(desc);
+      assert(i->mod_desc.can_rollback());
+    }
+  }
+
   map<shard_id_t, ObjectStore::Transaction> trans;
   for (set<pg_shard_t>::const_iterator i =
 	 get_parent()->get_actingbackfill_shards().begin();
@@ -1502,6 +1940,7 @@ void ECBackend::start_write(Op *op) {
   }
   op->t->generate_transactions(
     op->unstable_hash_infos,
+    op->rmw_stripes,
     ec_impl,
     get_parent()->get_info().pgid.pgid,
     sinfo,
@@ -1562,7 +2001,8 @@ int ECBackend::objects_read_sync(
   const hobject_t &hoid,
   uint64_t off,
   uint64_t len,
-  bufferlist *bl)
+  bufferlist *bl,
+  bool allow_eio)
 {
   return -EOPNOTSUPP;
 }
@@ -1663,11 +2103,18 @@ void ECBackend::objects_read_async(
     want_to_read.insert(chunk);
   }
   set<pg_shard_t> shards;
-  int r = get_min_avail_to_read_shards(
-    hoid,
-    want_to_read,
-    false,
-    &shards);
+  bool fast_read = get_parent()->get_pool().fast_read();
+  int r;
+  if (fast_read) {
+    r = get_fast_read_shards(hoid, want_to_read, &shards);
+    get_parent()->get_logger()->inc(l_osd_ec_fast_read);
+  } else {
+    r = get_min_avail_to_read_shards(
+      hoid,
+      want_to_read,
+      false,
+      &shards);
+  }
   assert(r == 0);
 
   map<hobject_t, read_request_t> for_read_op;
@@ -1684,7 +2131,9 @@ void ECBackend::objects_read_async(
   start_read_op(
     cct->_conf->osd_client_op_priority,
     for_read_op,
-    OpRequestRef());
+    OpRequestRef(),
+    fast_read,
+    want_to_read);
   return;
 }
 
@@ -1724,6 +2173,21 @@ void ECBackend::rollback_append(
       old_size));
 }
 
+void ECBackend::rollback_extents(
+  const hobject_t &hoid,
+  version_t gen,
+  const vector<pair<uint64_t, uint64_t> > &extents,
+  ObjectStore::Transaction *t)
+{
+  vector<pair<uint64_t, uint64_t> > chunk_extents;
+  for (vector<pair<uint64_t, uint64_t> >::const_iterator i = extents.begin();
+       i != extents.end();
+       ++i) {
+    chunk_extents.push_back(sinfo.aligned_offset_len_to_chunk(*i));
+  }
+  PGBackend::rollback_extents(hoid, gen, chunk_extents, t);
+}
+
 void ECBackend::be_deep_scrub(
   const hobject_t &poid,
   ScrubMap::object &o,
@@ -1763,7 +2227,8 @@ void ECBackend::be_deep_scrub(
     o.read_error = true;
   }
 
-  if (hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != h.digest()) {
+  if (hinfo->has_chunk_hash() &&
+      hinfo->get_chunk_hash(get_parent()->whoami_shard().shard) != h.digest()) {
     dout(0) << "_scan_list  " << poid << " got incorrect hash on read" << dendl;
     o.read_error = true;
   }
@@ -1779,8 +2244,10 @@ void ECBackend::be_deep_scrub(
    * we match our chunk hash and our recollection of the hash for
    * chunk 0 matches that of our peers, there is likely no corruption.
    */
-  o.digest = hinfo->get_chunk_hash(0);
-  o.digest_present = true;
+  if (hinfo->has_chunk_hash()) {
+    o.digest = hinfo->get_chunk_hash(0);
+    o.digest_present = true;
+  }
 
   o.omap_digest = 0;
   o.omap_digest_present = true;
@@ -112,7 +112,8 @@ public:
     const hobject_t &hoid,
     uint64_t off,
     uint64_t len,
-    bufferlist *bl);
+    bufferlist *bl,
+    bool allow_eio = false);
 
   /**
    * Async read mechanism
@@ -146,6 +147,17 @@ public:
 		    pair<bufferlist*, Context*> > > &to_read,
     Context *on_complete);
 
+  /**
+   * bytes each of @objects recovery ops may read per round so that
+   * together they read at most @max_bytes: a whole number of stripes,
+   * at least one and at most @chunk
+   */
+  static uint64_t get_batch_read_size(
+    const ECUtil::stripe_info_t &sinfo,
+    uint64_t chunk,
+    uint64_t max_bytes,
+    unsigned objects);
+
 private:
   friend struct ECRecoveryHandle;
   uint64_t get_recovery_chunk_size() const {
@@ -225,9 +237,12 @@ private:
     // valid in state READING
     pair<uint64_t, uint64_t> extent_requested;
 
+    // bytes read per round, 0 for get_recovery_chunk_size()
+    uint64_t read_size;
+
     void dump(Formatter *f) const;
 
-    RecoveryOp() : pending_read(false), state(IDLE) {}
+    RecoveryOp() : pending_read(false), state(IDLE), read_size(0) {}
   };
   friend ostream &operator<<(ostream &lhs, const RecoveryOp &rhs);
   map<hobject_t, RecoveryOp> recovery_ops;
@@ -284,6 +299,11 @@ public:
     ceph_tid_t tid;
     OpRequestRef op; // may be null if not on behalf of a client
 
+    /// complete as soon as want_to_read can be decoded from the replies
+    bool do_fast_read;
+    set<int> want_to_read;
+    utime_t start;
+
     map<hobject_t, read_request_t> to_read;
     map<hobject_t, read_result_t> complete;
 
@@ -293,19 +313,31 @@ public:
     void dump(Formatter *f) const;
 
     set<pg_shard_t> in_progress;
+
+    ReadOp() : priority(0), tid(0), do_fast_read(false) {}
   };
   friend struct FinishReadOp;
   void filter_read_op(
     const OSDMapRef osdmap,
     ReadOp &op);
   void complete_read_op(ReadOp &rop, RecoveryMessages *m);
+  /**
+   * true if every object of a fast read can be decoded from the
+   * shards which replied without error; the errors are then dropped
+   * from the results
+   */
+  bool fast_read_ready(ReadOp &rop);
   friend ostream &operator<<(ostream &lhs, const ReadOp &rhs);
   map<ceph_tid_t, ReadOp> tid_to_read_map;
   map<pg_shard_t, set<ceph_tid_t> > shard_to_read_map;
+  /// fast reads completed before these shards replied, by tid
+  map<ceph_tid_t, pair<utime_t, set<pg_shard_t> > > fast_read_stragglers;
   void start_read_op(
     int priority,
     map<hobject_t, read_request_t> &to_read,
-    OpRequestRef op);
+    OpRequestRef op,
+    bool do_fast_read = false,
+    const set<int> &want_to_read = set<int>());
 
 
   /**
@@ -320,6 +352,19 @@ public:
    * As with client reads, there is a possibility of out-of-order
    * completions. Thus, callbacks and completion are called in order
    * on the writing list.
+   *
+   * Writes which only partly cover a stripe (pools with
+   * FLAG_EC_OVERWRITES) first need the old contents of that stripe.
+   * Such an op waits on waiting_rmw until no earlier write to the same
+   * objects is still being applied, reads the partial stripes
+   * (start_rmw), and only then generates and sends its transaction.
+   * Later ops queue behind it so that writes still go out in version
+   * order.  A shard which fails such a read is excluded and the read
+   * is retried from the remaining shards.  If the stripe can no longer
+   * be decoded the op is set aside (RMW_FAILED) together with any later
+   * op touching the same objects, and ops on other objects go on.  The
+   * set aside ops are dropped at the next interval change (on_change),
+   * after which the clients resend them.
    */
   struct Op {
     hobject_t hoid;
@@ -344,6 +389,16 @@ public:
     set<pg_shard_t> pending_apply;
 
     map<hobject_t, ECUtil::HashInfoRef> unstable_hash_infos;
+
+    enum rmw_state_t {
+      RMW_NONE, RMW_NEED_READ, RMW_READING, RMW_FAILED
+    } rmw_state;
+    set<hobject_t> rmw_pending_reads;
+    map<hobject_t, map<uint64_t, bufferlist> > rmw_stripes;
+    map<hobject_t, list<pair<uint64_t, uint64_t> > > rmw_to_read;
+    map<hobject_t, set<pg_shard_t> > rmw_bad_shards;
+
+    Op() : rmw_state(RMW_NONE) {}
     ~Op() {
       delete t;
       delete on_local_applied_sync;
@@ -373,7 +428,10 @@ public:
     RecoveryMessages *m);
 
   map<ceph_tid_t, Op> tid_to_op_map; /// lists below point into here
+  list<Op*> waiting_rmw;
   list<Op*> writing;
+  /// objects with a set aside write, see Op
+  set<hobject_t> rmw_failed_objects;
 
   CephContext *cct;
   ErasureCodeInterfaceRef ec_impl;
@@ -437,6 +495,18 @@ public:
   friend struct ReadCB;
   void check_op(Op *op);
   void start_write(Op *op);
+
+  friend struct RMWReadCB;
+  bool rmw_blocked(Op *op);
+  void start_rmw(Op *op);
+  bool add_rmw_read(
+    Op *op,
+    const hobject_t &hoid,
+    map<hobject_t, read_request_t> *for_read_op);
+  void retry_rmw_read(Op *op, const hobject_t &hoid);
+  void fail_rmw(Op *op, const hobject_t &hoid, int r);
+  bool rmw_touches_failed(Op *op);
+  void check_rmw();
 public:
   ECBackend(
     PGBackend::Listener *pg,
@@ -447,6 +517,14 @@ public:
     ErasureCodeInterfaceRef ec_impl,
     uint64_t stripe_width);
 
+  /// Returns the shards holding an up to date copy of hoid
+  void get_all_avail_shards(
+    const hobject_t &hoid,     ///< [in] object
+    bool for_recovery,         ///< [in] true if we may use non-acting replicas
+    set<int> *have,            ///< [out] shard ids
+    map<shard_id_t, pg_shard_t> *shards ///< [out] shard id -> replica
+    );
+
   /// Returns to_read replicas sufficient to reconstruct want
   int get_min_avail_to_read_shards(
     const hobject_t &hoid,     ///< [in] object
@@ -455,6 +533,16 @@ public:
     set<pg_shard_t> *to_read   ///< [out] shards to read
     ); ///< @return error code, 0 on success
 
+  /**
+   * Returns the cheapest replicas sufficient to reconstruct want, by
+   * recent read latency, plus osd_ec_fast_read_extra_shards more
+   */
+  int get_fast_read_shards(
+    const hobject_t &hoid,     ///< [in] object
+    const set<int> &want,      ///< [in] desired shards
+    set<pg_shard_t> *to_read   ///< [out] shards to read
+    ); ///< @return error code, 0 on success
+
   int objects_get_attrs(
     const hobject_t &hoid,
     map<string, bufferlist> *out);
@@ -464,6 +552,12 @@ public:
     uint64_t old_size,
     ObjectStore::Transaction *t);
 
+  void rollback_extents(
+    const hobject_t &hoid,
+    version_t gen,
+    const vector<pair<uint64_t, uint64_t> > &extents,
+    ObjectStore::Transaction *t);
+
   bool scrub_supported() { return true; }
 
   void be_deep_scrub(
@@ -29,6 +29,9 @@ struct AppendObjectsGenerator: public boost::static_visitor<void> {
   void operator()(const ECTransaction::AppendOp &op) {
     out->insert(op.oid);
   }
+  void operator()(const ECTransaction::OverwriteOp &op) {
+    out->insert(op.oid);
+  }
   void operator()(const ECTransaction::TouchOp &op) {}
   void operator()(const ECTransaction::CloneOp &op) {
     out->insert(op.source);
@@ -56,9 +59,63 @@ void ECTransaction::get_append_objects(
   reverse_visit(gen);
 }
 
+struct RMWStripesGenerator : public boost::static_visitor<void> {
+  typedef void result_type;
+  const ECUtil::stripe_info_t &sinfo;
+  map<hobject_t, ECUtil::HashInfoRef> &hash_infos;
+  map<hobject_t, set<uint64_t> > *out;
+  RMWStripesGenerator(
+    const ECUtil::stripe_info_t &sinfo,
+    map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+    map<hobject_t, set<uint64_t> > *out)
+    : sinfo(sinfo), hash_infos(hash_infos), out(out) {}
+  void operator()(const ECTransaction::OverwriteOp &op) {
+    assert(hash_infos.count(op.oid));
+    uint64_t size = sinfo.aligned_chunk_offset_to_logical_offset(
+      hash_infos[op.oid]->get_total_chunk_size());
+    set<uint64_t> partial = sinfo.partial_stripes(
+      make_pair(op.off, (uint64_t)op.bl.length()));
+    for (set<uint64_t>::iterator i = partial.begin();
+	 i != partial.end();
+	 ++i) {
+      // nothing to preserve past the end of the object
+      if (*i < size)
+	(*out)[op.oid].insert(*i);
+    }
+  }
+  template <typename T>
+  void operator()(const T &op) {}
+};
+void ECTransaction::get_rmw_stripes(
+  const ECUtil::stripe_info_t &sinfo,
+  map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+  map<hobject_t, set<uint64_t> > *out) const
+{
+  RMWStripesGenerator gen(sinfo, hash_infos, out);
+  visit(gen);
+}
+
+struct OverwriteFinder : public boost::static_visitor<void> {
+  typedef void result_type;
+  bool found;
+  OverwriteFinder() : found(false) {}
+  void operator()(const ECTransaction::OverwriteOp &op) {
+    found = true;
+  }
+  template <typename T>
+  void operator()(const T &op) {}
+};
+bool ECTransaction::has_overwrites() const
+{
+  OverwriteFinder finder;
+  visit(finder);
+  return finder.found;
+}
+
 struct TransGenerator : public boost::static_visitor<void> {
   typedef void result_type;
   map<hobject_t, ECUtil::HashInfoRef> &hash_infos;
+  const map<hobject_t, map<uint64_t, bufferlist> > &rmw_stripes;
 
   ErasureCodeInterfaceRef &ecimpl;
   const pg_t pgid;
@@ -70,6 +127,7 @@ struct TransGenerator : public boost::static_visitor<void> {
   stringstream *out;
   TransGenerator(
     map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+    const map<hobject_t, map<uint64_t, bufferlist> > &rmw_stripes,
     ErasureCodeInterfaceRef &ecimpl,
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
@@ -78,6 +136,7 @@ struct TransGenerator : public boost::static_visitor<void> {
     set<hobject_t> *temp_removed,
     stringstream *out)
     : hash_infos(hash_infos),
+      rmw_stripes(rmw_stripes),
       ecimpl(ecimpl), pgid(pgid),
       sinfo(sinfo),
       trans(trans),
@@ -165,6 +224,65 @@ struct TransGenerator : public boost::static_visitor<void> {
 	hbuf);
     }
   }
+  void operator()(const ECTransaction::OverwriteOp &op) {
+    assert(op.bl.length());
+    assert(hash_infos.count(op.oid));
+    ECUtil::HashInfoRef hinfo = hash_infos[op.oid];
+
+    map<uint64_t, bufferlist> no_stripes;
+    map<hobject_t, map<uint64_t, bufferlist> >::const_iterator old =
+      rmw_stripes.find(op.oid);
+    bufferlist bl;
+    ECUtil::merge_overwrite(
+      sinfo, op.off, op.bl,
+      old == rmw_stripes.end() ? no_stripes : old->second,
+      &bl);
+
+    map<int, bufferlist> buffers;
+    int r = ECUtil::encode(
+      sinfo, ecimpl, bl, want, &buffers);
+    assert(r == 0);
+
+    uint64_t chunk_off = sinfo.logical_to_prev_chunk_offset(op.off);
+    uint64_t chunk_end = chunk_off + buffers.begin()->second.length();
+    hinfo->set_total_chunk_size_clear_hash(
+      MAX(hinfo->get_total_chunk_size(), chunk_end));
+    bufferlist hbuf;
+    ::encode(
+      *hinfo,
+      hbuf);
+
+    for (map<shard_id_t, ObjectStore::Transaction>::iterator i = trans->begin();
+	 i != trans->end();
+	 ++i) {
+      coll_t cid(get_coll_ct(i->first, op.oid));
+      ghobject_t goid(op.oid, ghobject_t::NO_GEN, i->first);
+      for (vector<pair<uint64_t, uint64_t> >::const_iterator j =
+	     op.stash.begin();
+	   j != op.stash.end();
+	   ++j) {
+	pair<uint64_t, uint64_t> chunk = sinfo.aligned_offset_len_to_chunk(*j);
+	i->second.clone_range(
+	  cid,
+	  goid,
+	  ghobject_t(op.oid, op.gen, i->first),
+	  chunk.first, chunk.second, chunk.first);
+      }
+      assert(buffers.count(i->first));
+      bufferlist &enc_bl = buffers[i->first];
+      i->second.write(
+	cid,
+	goid,
+	chunk_off,
+	enc_bl.length(),
+	enc_bl);
+      i->second.setattr(
+	cid,
+	goid,
+	ECUtil::get_hinfo_key(),
+	hbuf);
+    }
+  }
   void operator()(const ECTransaction::CloneOp &op) {
     assert(hash_infos.count(op.source));
     assert(hash_infos.count(op.target));
@@ -262,6 +380,7 @@ struct TransGenerator : public boost::static_visitor<void> {
 
 void ECTransaction::generate_transactions(
   map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+  const map<hobject_t, map<uint64_t, bufferlist> > &rmw_stripes,
   ErasureCodeInterfaceRef &ecimpl,
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
@@ -272,6 +391,7 @@ void ECTransaction::generate_transactions(
 {
   TransGenerator gen(
     hash_infos,
+    rmw_stripes,
     ecimpl,
     pgid,
     sinfo,
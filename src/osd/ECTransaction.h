@@ -31,6 +31,24 @@ public:
     AppendOp(const hobject_t &oid, uint64_t off, bufferlist &bl)
       : oid(oid), off(off), bl(bl) {}
   };
+  /**
+   * sub-stripe write
+   *
+   * The partly covered stripes are read before the transaction is
+   * generated (@see ECBackend::start_rmw).  The stripe aligned extents
+   * in stash are first copied into object generation gen so that the
+   * write can be rolled back until the log entry is trimmed.
+   */
+  struct OverwriteOp {
+    hobject_t oid;
+    uint64_t off;
+    bufferlist bl;
+    version_t gen;
+    vector<pair<uint64_t, uint64_t> > stash;
+    OverwriteOp(const hobject_t &oid, uint64_t off, bufferlist &bl,
+		version_t gen, const vector<pair<uint64_t, uint64_t> > &stash)
+      : oid(oid), off(off), bl(bl), gen(gen), stash(stash) {}
+  };
   struct CloneOp {
     hobject_t source;
     hobject_t target;
@@ -87,6 +105,7 @@ public:
   struct NoOp {};
   typedef boost::variant<
     AppendOp,
+    OverwriteOp,
     CloneOp,
     RenameOp,
     StashOp,
@@ -119,6 +138,21 @@ public:
     assert(len == bl.length());
     ops.push_back(AppendOp(hoid, off, bl));
   }
+  void overwrite(
+    const hobject_t &hoid,
+    uint64_t off,
+    uint64_t len,
+    bufferlist &bl,
+    version_t gen,
+    const vector<pair<uint64_t, uint64_t> > &stash) {
+    assert(len == bl.length());
+    if (len == 0) {
+      touch(hoid);
+      return;
+    }
+    written += len;
+    ops.push_back(OverwriteOp(hoid, off, bl, gen, stash));
+  }
   void stash(
     const hobject_t &hoid,
     version_t former_version) {
@@ -193,8 +227,15 @@ public:
   }
   void get_append_objects(
     set<hobject_t> *out) const;
+  /// stripes which must be read before generating the transaction
+  void get_rmw_stripes(
+    const ECUtil::stripe_info_t &sinfo,
+    map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+    map<hobject_t, set<uint64_t> > *out) const;
+  bool has_overwrites() const;
   void generate_transactions(
     map<hobject_t, ECUtil::HashInfoRef> &hash_infos,
+    const map<hobject_t, map<uint64_t, bufferlist> > &rmw_stripes,
     ErasureCodeInterfaceRef &ecimpl,
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
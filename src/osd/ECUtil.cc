@@ -1,9 +1,114 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 
 #include <errno.h>
+#include "include/atomic.h"
 #include "include/encoding.h"
 #include "ECUtil.h"
 
+static atomic64_t copied_bytes;
+
+uint64_t ECUtil::get_copied_bytes()
+{
+  return copied_bytes.read();
+}
+
+/**
+ * Append the next len bytes of it to view as a single buffer the
+ * plugin can use in place.  If they are not contiguous or not aligned,
+ * they are copied to spare at spare_off first; spare is allocated on
+ * first use with spare_size bytes.
+ *
+ * @return the number of bytes copied
+ */
+static unsigned get_chunk_view(
+  bufferlist::iterator &it,
+  unsigned len,
+  bufferptr &spare,
+  unsigned spare_size,
+  unsigned spare_off,
+  bufferlist *view)
+{
+  bufferptr cur = it.get_current_ptr();
+  if (cur.length() >= len &&
+      ((uintptr_t)cur.c_str() & (ECUtil::CHUNK_ALIGNMENT - 1)) == 0) {
+    view->append(cur, 0, len);
+    it.advance(len);
+    return 0;
+  }
+  if (!spare.have_raw())
+    spare = buffer::create_page_aligned(spare_size);
+  it.copy(len, spare.c_str() + spare_off);
+  view->append(spare, spare_off, len);
+  return len;
+}
+
+/**
+ * Decode need from to_decode one stripe at a time, handing the plugin
+ * views of to_decode and writing the missing chunks directly into one
+ * preallocated buffer per shard.  The decoded chunks are appended to
+ * out or, if concat is set, the data chunks are appended to concat in
+ * logical order.
+ */
+static int decode_chunks(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  map<int, bufferlist> &to_decode,
+  const set<int> &need,
+  map<int, bufferlist> *out,
+  bufferlist *concat)
+{
+  const unsigned k = ec_impl->get_data_chunk_count();
+  const unsigned n = ec_impl->get_chunk_count();
+  const vector<int> &mapping = ec_impl->get_chunk_mapping();
+  const unsigned chunk_size = sinfo.get_chunk_size();
+  const unsigned shard_size = to_decode.begin()->second.length();
+  unsigned copied = 0;
+
+  map<int, bufferlist::iterator> its;
+  map<int, bufferptr> spares;
+  for (map<int, bufferlist>::iterator i = to_decode.begin();
+       i != to_decode.end();
+       ++i)
+    its[i->first] = i->second.begin();
+  vector<bufferptr> missing(n);
+  for (unsigned i = 0; i < n; i++)
+    if (!to_decode.count(i))
+      missing[i] = buffer::create_page_aligned(shard_size);
+
+  for (unsigned off = 0; off < shard_size; off += chunk_size) {
+    map<int, bufferlist> chunks;
+    for (map<int, bufferlist::iterator>::iterator i = its.begin();
+	 i != its.end();
+	 ++i)
+      copied += get_chunk_view(i->second, chunk_size, spares[i->first],
+			       shard_size, off, &chunks[i->first]);
+    map<int, bufferlist> decoded;
+    for (unsigned i = 0; i < n; i++) {
+      if (chunks.count(i))
+	decoded[i] = chunks[i];
+      else
+	decoded[i].append(missing[i], off, chunk_size);
+    }
+    int r = ec_impl->decode_chunks(need, chunks, &decoded);
+    if (r)
+      return r;
+    if (concat) {
+      for (unsigned i = 0; i < k; i++) {
+	int chunk = mapping.size() > i ? mapping[i] : i;
+	const bufferptr &p = decoded[chunk].buffers().front();
+	concat->append(p, 0, p.length());
+      }
+    } else {
+      for (set<int>::const_iterator i = need.begin(); i != need.end(); ++i) {
+	const bufferptr &p = decoded[*i].buffers().front();
+	(*out)[*i].append(p, 0, p.length());
+      }
+    }
+  }
+  copied_bytes.add(copied);
+  return 0;
+}
+
 int ECUtil::decode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
@@ -26,6 +131,22 @@ int ECUtil::decode(
   if (total_chunk_size == 0)
     return 0;
 
+  const vector<int> &mapping = ec_impl->get_chunk_mapping();
+  set<int> need;
+  for (unsigned i = 0; i < ec_impl->get_data_chunk_count(); i++)
+    need.insert(mapping.size() > i ? mapping[i] : i);
+  bool missing = false;
+  for (set<int>::iterator i = need.begin(); i != need.end(); ++i)
+    if (!to_decode.count(*i))
+      missing = true;
+  if (missing && ec_impl->supports_encode_chunks()) {
+    int r = decode_chunks(sinfo, ec_impl, to_decode, need, NULL, out);
+    assert(r == 0);
+    assert(out->length() ==
+	   sinfo.aligned_chunk_offset_to_logical_offset(total_chunk_size));
+    return 0;
+  }
+
   for (uint64_t i = 0; i < total_chunk_size; i += sinfo.get_chunk_size()) {
     map<int, bufferlist> chunks;
     for (map<int, bufferlist>::iterator j = to_decode.begin();
@@ -71,6 +192,23 @@ int ECUtil::decode(
     need.insert(i->first);
   }
 
+  bool missing = false;
+  for (set<int>::iterator i = need.begin(); i != need.end(); ++i)
+    if (!to_decode.count(*i))
+      missing = true;
+  if (missing && ec_impl->supports_encode_chunks()) {
+    map<int, bufferlist> decoded;
+    int r = decode_chunks(sinfo, ec_impl, to_decode, need, &decoded, NULL);
+    assert(r == 0);
+    for (map<int, bufferlist*>::iterator i = out.begin();
+	 i != out.end();
+	 ++i) {
+      assert(decoded[i->first].length() == total_chunk_size);
+      i->second->claim(decoded[i->first]);
+    }
+    return 0;
+  }
+
   for (uint64_t i = 0; i < total_chunk_size; i += sinfo.get_chunk_size()) {
     map<int, bufferlist> chunks;
     for (map<int, bufferlist>::iterator j = to_decode.begin();
@@ -113,6 +251,41 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
+  if (ec_impl->supports_encode_chunks()) {
+    // parity goes straight into one buffer per shard and data chunks are
+    // used in place whenever in already has them contiguous and aligned
+    const unsigned k = ec_impl->get_data_chunk_count();
+    const unsigned n = ec_impl->get_chunk_count();
+    const vector<int> &mapping = ec_impl->get_chunk_mapping();
+    const unsigned chunk_size = sinfo.get_chunk_size();
+    const unsigned shard_size =
+      sinfo.aligned_logical_offset_to_chunk_offset(logical_size);
+    unsigned copied = 0;
+    vector<bufferptr> shards(n);
+    for (unsigned i = k; i < n; i++)
+      shards[i] = buffer::create_page_aligned(shard_size);
+    bufferlist::iterator it = in.begin();
+    for (unsigned off = 0; off < shard_size; off += chunk_size) {
+      map<int, bufferlist> chunks;
+      for (unsigned i = 0; i < k; i++)
+	copied += get_chunk_view(it, chunk_size, shards[i], shard_size, off,
+				 &chunks[i]);
+      for (unsigned i = k; i < n; i++)
+	chunks[i].append(shards[i], off, chunk_size);
+      int r = ec_impl->encode_chunks(want, &chunks);
+      assert(r == 0);
+      for (unsigned i = 0; i < n; i++) {
+	int chunk = mapping.size() > 0 ? mapping[i] : i;
+	if (!want.count(chunk))
+	  continue;
+	const bufferptr &p = chunks[i].buffers().front();
+	(*out)[chunk].append(p, 0, p.length());
+      }
+    }
+    copied_bytes.add(copied);
+    return 0;
+  }
+
   for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
     map<int, bufferlist> encoded;
     bufferlist buf;
@@ -138,6 +311,48 @@ int ECUtil::encode(
   return 0;
 }
 
+void ECUtil::merge_overwrite(
+  const stripe_info_t &sinfo,
+  uint64_t off,
+  const bufferlist &bl,
+  const map<uint64_t, bufferlist> &old,
+  bufferlist *out)
+{
+  assert(out);
+  assert(out->length() == 0);
+  const uint64_t width = sinfo.get_stripe_width();
+  pair<uint64_t, uint64_t> bounds =
+    sinfo.offset_len_to_stripe_bounds(make_pair(off, (uint64_t)bl.length()));
+  uint64_t end = off + bl.length();
+
+  if (bounds.first < off) {
+    map<uint64_t, bufferlist>::const_iterator i = old.find(bounds.first);
+    if (i != old.end()) {
+      assert(i->second.length() == width);
+      bufferlist head;
+      head.substr_of(i->second, 0, off - bounds.first);
+      out->claim_append(head);
+    } else {
+      out->append_zero(off - bounds.first);
+    }
+  }
+  out->append(bl);
+  if (end % width) {
+    uint64_t tail_stripe = sinfo.logical_to_prev_stripe_offset(end);
+    uint64_t tail_off = end - tail_stripe;
+    map<uint64_t, bufferlist>::const_iterator i = old.find(tail_stripe);
+    if (i != old.end()) {
+      assert(i->second.length() == width);
+      bufferlist tail;
+      tail.substr_of(i->second, tail_off, width - tail_off);
+      out->claim_append(tail);
+    } else {
+      out->append_zero(width - tail_off);
+    }
+  }
+  assert(out->length() == bounds.second);
+}
+
 void ECUtil::HashInfo::encode(bufferlist &bl) const
 {
   ENCODE_START(1, 1, bl);
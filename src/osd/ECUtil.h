@@ -83,8 +83,35 @@ public:
       (in.first - off) + in.second);
     return make_pair(off, len);
   }
+  /// offsets of the stripes which in (off, len) only partly covers
+  set<uint64_t> partial_stripes(pair<uint64_t, uint64_t> in) const {
+    set<uint64_t> ret;
+    if (in.second == 0)
+      return ret;
+    if (in.first % stripe_width)
+      ret.insert(logical_to_prev_stripe_offset(in.first));
+    uint64_t end = in.first + in.second;
+    if (end % stripe_width)
+      ret.insert(logical_to_prev_stripe_offset(end));
+    return ret;
+  }
 };
 
+/**
+ * Build the stripe aligned buffer for an overwrite of bl at off
+ *
+ * Bytes of the partly covered first and last stripes which bl does not
+ * replace are taken from the old stripe contents in old (keyed by
+ * stripe offset); stripes missing from old, e.g. past the end of the
+ * object, are treated as zeros.  out begins at the stripe containing off.
+ */
+void merge_overwrite(
+  const stripe_info_t &sinfo,
+  uint64_t off,
+  const bufferlist &bl,
+  const map<uint64_t, bufferlist> &old,
+  bufferlist *out);
+
 int decode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
@@ -104,6 +131,13 @@ int encode(
   const set<int> &want,
   map<int, bufferlist> *out);
 
+/**
+ * bytes encode() and decode() copied so far to gather chunks which
+ * were not contiguous and CHUNK_ALIGNMENT aligned in their input, when
+ * the plugin supports_encode_chunks()
+ */
+uint64_t get_copied_bytes();
+
 class HashInfo {
   uint64_t total_chunk_size;
   vector<uint32_t> cumulative_shard_hashes;
@@ -113,9 +147,13 @@ public:
   : total_chunk_size(0),
     cumulative_shard_hashes(num_chunks, -1) {}
   void append(uint64_t old_size, map<int, bufferlist> &to_append) {
-    assert(to_append.size() == cumulative_shard_hashes.size());
     assert(old_size == total_chunk_size);
     uint64_t size_to_append = to_append.begin()->second.length();
+    if (!has_chunk_hash()) {
+      total_chunk_size += size_to_append;
+      return;
+    }
+    assert(to_append.size() == cumulative_shard_hashes.size());
     for (map<int, bufferlist>::iterator i = to_append.begin();
 	 i != to_append.end();
 	 ++i) {
@@ -136,6 +174,17 @@ public:
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
   static void generate_test_instances(list<HashInfo*>& o);
+  /**
+   * cumulative hashes can only be maintained for append-only objects;
+   * an overwrite drops them for the rest of the object's life
+   */
+  void set_total_chunk_size_clear_hash(uint64_t new_chunk_size) {
+    cumulative_shard_hashes.clear();
+    total_chunk_size = new_chunk_size;
+  }
+  bool has_chunk_hash() const {
+    return !cumulative_shard_hashes.empty();
+  }
   uint32_t get_chunk_hash(int shard) const {
     assert((unsigned)shard < cumulative_shard_hashes.size());
     return cumulative_shard_hashes[shard];
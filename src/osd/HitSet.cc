@@ -12,6 +12,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "HitSet.h"
 
 // -- HitSet --
@@ -44,13 +46,13 @@ HitSet::HitSet(const HitSet::Params& params)
   }
 }
 
-void HitSet::encode(bufferlist &bl) const
+void HitSet::encode(bufferlist &bl, uint64_t features) const
 {
   ENCODE_START(1, 1, bl);
   ::encode(sealed, bl);
   if (impl) {
     ::encode((__u8)impl->get_type(), bl);
-    impl->encode(bl);
+    impl->encode(bl, features);
   } else {
     ::encode((__u8)TYPE_NONE, bl);
   }
@@ -109,6 +111,78 @@ void HitSet::generate_test_instances(list<HitSet*>& o)
   o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
 }
 
+// -- ExplicitHashHitSet --
+
+/*
+ * v2 stores the hashes sorted, as deltas in groups of 7 bits.  It
+ * keeps an empty v1 set in front of them, but a v1 decoder would take
+ * that for the whole HitSet, so v2 is incompatible and is only used
+ * when every reader understands it.
+ */
+void ExplicitHashHitSet::encode(bufferlist &bl, uint64_t features) const
+{
+  if ((features & CEPH_FEATURE_OSD_HITSET_COMPACT) == 0) {
+    ENCODE_START(1, 1, bl);
+    ::encode(count, bl);
+    ::encode(hits, bl);
+    ENCODE_FINISH(bl);
+    return;
+  }
+
+  ENCODE_START(2, 2, bl);
+  ::encode(count, bl);
+  ::encode(ceph::unordered_set<uint32_t>(), bl);
+
+  vector<uint32_t> sorted(hits.begin(), hits.end());
+  std::sort(sorted.begin(), sorted.end());
+  bufferptr bp(sorted.size() * 5);
+  unsigned char *out = (unsigned char *)bp.c_str();
+  unsigned len = 0;
+  uint32_t last = 0;
+  for (vector<uint32_t>::iterator p = sorted.begin(); p != sorted.end(); ++p) {
+    uint32_t delta = *p - last;
+    last = *p;
+    while (delta >= 0x80) {
+      out[len++] = (delta & 0x7f) | 0x80;
+      delta >>= 7;
+    }
+    out[len++] = delta;
+  }
+  bp.set_length(len);
+  ::encode((uint32_t)sorted.size(), bl);
+  ::encode(bp, bl);
+  ENCODE_FINISH(bl);
+}
+
+void ExplicitHashHitSet::decode(bufferlist::iterator &bl)
+{
+  DECODE_START(2, bl);
+  ::decode(count, bl);
+  ::decode(hits, bl);
+  if (struct_v >= 2) {
+    uint32_t n;
+    ::decode(n, bl);
+    bufferlist t;
+    ::decode(t, bl);
+    const unsigned char *in = (const unsigned char *)t.c_str();
+    const unsigned char *end = in + t.length();
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      uint32_t delta = 0;
+      for (unsigned shift = 0; ; shift += 7) {
+	if (in == end || shift > 28)
+	  throw buffer::malformed_input("bad ExplicitHashHitSet hash encoding");
+	delta |= (uint32_t)(*in & 0x7f) << shift;
+	if (!(*in++ & 0x80))
+	  break;
+      }
+      last += delta;
+      hits.insert(last);
+    }
+  }
+  DECODE_FINISH(bl);
+}
+
 HitSet::Params::Params(const Params& o)
 {
   if (o.get_type() != TYPE_NONE) {
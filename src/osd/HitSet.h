@@ -18,6 +18,7 @@
 #include <boost/scoped_ptr.hpp>
 
 #include "include/encoding.h"
+#include "include/ceph_features.h"
 #include "include/unordered_set.h"
 #include "common/bloom_filter.hpp"
 #include "common/hobject.h"
@@ -64,7 +65,7 @@ public:
     virtual bool contains(const hobject_t& o) const = 0;
     virtual unsigned insert_count() const = 0;
     virtual unsigned approx_unique_insert_count() const = 0;
-    virtual void encode(bufferlist &bl) const = 0;
+    virtual void encode(bufferlist &bl, uint64_t features) const = 0;
     virtual void decode(bufferlist::iterator& p) = 0;
     virtual void dump(Formatter *f) const = 0;
     virtual Impl* clone() const = 0;
@@ -159,7 +160,7 @@ public:
     impl->seal();
   }
 
-  void encode(bufferlist &bl) const;
+  void encode(bufferlist &bl, uint64_t features) const;
   void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const;
   static void generate_test_instances(list<HitSet*>& o);
@@ -167,7 +168,7 @@ public:
 private:
   void reset_to_type(impl_type_t type);
 };
-WRITE_CLASS_ENCODER(HitSet)
+WRITE_CLASS_ENCODER_FEATURES(HitSet)
 WRITE_CLASS_ENCODER(HitSet::Params)
 
 typedef boost::shared_ptr<HitSet> HitSetRef;
@@ -222,18 +223,8 @@ public:
   unsigned approx_unique_insert_count() const {
     return hits.size();
   }
-  void encode(bufferlist &bl) const {
-    ENCODE_START(1, 1, bl);
-    ::encode(count, bl);
-    ::encode(hits, bl);
-    ENCODE_FINISH(bl);
-  }
-  void decode(bufferlist::iterator &bl) {
-    DECODE_START(1, bl);
-    ::decode(count, bl);
-    ::decode(hits, bl);
-    DECODE_FINISH(bl);
-  }
+  void encode(bufferlist &bl, uint64_t features) const;
+  void decode(bufferlist::iterator &bl);
   void dump(Formatter *f) const {
     f->dump_unsigned("insert_count", count);
     f->open_array_section("hash_set");
@@ -249,7 +240,7 @@ public:
     o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
   }
 };
-WRITE_CLASS_ENCODER(ExplicitHashHitSet)
+WRITE_CLASS_ENCODER_FEATURES(ExplicitHashHitSet)
 
 /**
  * explicitly enumerate objects in the set
@@ -299,7 +290,7 @@ public:
   unsigned approx_unique_insert_count() const {
     return hits.size();
   }
-  void encode(bufferlist &bl) const {
+  void encode(bufferlist &bl, uint64_t features) const {
     ENCODE_START(1, 1, bl);
     ::encode(count, bl);
     ::encode(hits, bl);
@@ -329,7 +320,7 @@ public:
     o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
   }
 };
-WRITE_CLASS_ENCODER(ExplicitObjectHitSet)
+WRITE_CLASS_ENCODER_FEATURES(ExplicitObjectHitSet)
 
 /**
  * use a bloom_filter to track hits to the set
@@ -417,7 +408,7 @@ public:
   BloomHitSet(const BloomHitSet &o) {
     // oh god
     bufferlist bl;
-    o.encode(bl);
+    o.encode(bl, CEPH_FEATURES_ALL);
     bufferlist::iterator bli = bl.begin();
     this->decode(bli);
   }
@@ -449,7 +440,7 @@ public:
       bloom.compress(pc);
   }
 
-  void encode(bufferlist &bl) const {
+  void encode(bufferlist &bl, uint64_t features) const {
     ENCODE_START(1, 1, bl);
     ::encode(bloom, bl);
     ENCODE_FINISH(bl);
@@ -472,6 +463,6 @@ public:
     o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
   }
 };
-WRITE_CLASS_ENCODER(BloomHitSet)
+WRITE_CLASS_ENCODER_FEATURES(BloomHitSet)
 
 #endif
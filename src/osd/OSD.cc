@@ -204,6 +204,9 @@ OSDService::OSDService(OSD *osd) :
   peer_map_epoch_lock("OSDService::peer_map_epoch_lock"),
   sched_scrub_lock("OSDService::sched_scrub_lock"), scrubs_pending(0),
   scrubs_active(0),
+  snap_trim_lock("OSDService::snap_trim_lock"),
+  snap_trimq_total(0),
+  peer_read_lat_lock("OSDService::peer_read_lat_lock"),
   agent_lock("OSD::agent_lock"),
   agent_valid_iterator(false),
   agent_ops(0),
@@ -947,6 +950,112 @@ void OSDService::dec_scrubs_active()
   sched_scrub_lock.Unlock();
 }
 
+bool OSDService::scrub_throttle_wait(ThreadPool::TPHandle &handle)
+{
+  bool latency_paused;
+  utime_t delay = scrub_throttle.get_delay(ceph_clock_now(cct),
+					   &latency_paused);
+  if (delay == utime_t())
+    return true;
+
+  utime_t max_sleep;
+  max_sleep.set_from_double(cct->_conf->osd_scrub_throttle_max_sleep);
+  if (delay > max_sleep)
+    delay = max_sleep;
+  dout(20) << __func__ << " sleeping " << delay
+	   << (latency_paused ? " (client latency)" : "") << dendl;
+  delay.sleep();
+  handle.reset_tp_timeout();
+  // this chunk was already counted as throttled above
+  return scrub_throttle.peek_delay(ceph_clock_now(cct)) == utime_t();
+}
+
+void OSDService::set_snap_trim_rate(double trims_per_sec)
+{
+  Mutex::Locker l(snap_trim_lock);
+  snap_trim_throttle.set_rate(trims_per_sec);
+}
+
+void OSDService::set_snap_trimq_len(spg_t pgid, uint64_t len)
+{
+  Mutex::Locker l(snap_trim_lock);
+  map<spg_t, uint64_t>::iterator p = snap_trimq_len.find(pgid);
+  if (p != snap_trimq_len.end()) {
+    snap_trimq_total -= p->second;
+    if (len)
+      p->second = len;
+    else
+      snap_trimq_len.erase(p);
+  } else if (len) {
+    snap_trimq_len[pgid] = len;
+  }
+  snap_trimq_total += len;
+  if (osd->logger) {
+    osd->logger->set(l_osd_snap_trim_pgs, snap_trimq_len.size());
+    osd->logger->set(l_osd_snap_trim_queue, snap_trimq_total);
+  }
+}
+
+utime_t OSDService::get_snap_trim_delay()
+{
+  Mutex::Locker l(snap_trim_lock);
+  utime_t t;
+  t.set_from_double(snap_trim_throttle.get_delay(ceph_clock_now(cct)));
+  return t;
+}
+
+void OSDService::take_snap_trim(unsigned trimmed)
+{
+  Mutex::Locker l(snap_trim_lock);
+  snap_trim_throttle.take(ceph_clock_now(cct), trimmed);
+}
+
+void OSDService::note_peer_read_latency(int peer, utime_t lat)
+{
+  Mutex::Locker l(peer_read_lat_lock);
+  map<int, double>::iterator p = peer_read_lat.find(peer);
+  if (p == peer_read_lat.end())
+    peer_read_lat[peer] = lat;
+  else
+    p->second = .75 * p->second + .25 * (double)lat;
+}
+
+double OSDService::get_peer_read_latency(int peer)
+{
+  Mutex::Locker l(peer_read_lat_lock);
+  map<int, double>::iterator p = peer_read_lat.find(peer);
+  if (p == peer_read_lat.end())
+    return 0;
+  return p->second;
+}
+
+void OSDService::dump_snap_trim(Formatter *f)
+{
+  Mutex::Locker l(snap_trim_lock);
+  f->dump_float("max_trims_per_sec", snap_trim_throttle.get_rate());
+  f->dump_unsigned("pgs", snap_trimq_len.size());
+  f->dump_unsigned("snaps", snap_trimq_total);
+  map<int64_t, pair<uint64_t, uint64_t> > by_pool;  // pool -> (pgs, snaps)
+  for (map<spg_t, uint64_t>::iterator p = snap_trimq_len.begin();
+       p != snap_trimq_len.end();
+       ++p) {
+    pair<uint64_t, uint64_t>& e = by_pool[p->first.pool()];
+    ++e.first;
+    e.second += p->second;
+  }
+  f->open_array_section("pools");
+  for (map<int64_t, pair<uint64_t, uint64_t> >::iterator p = by_pool.begin();
+       p != by_pool.end();
+       ++p) {
+    f->open_object_section("pool");
+    f->dump_int("pool", p->first);
+    f->dump_unsigned("pgs", p->second.first);
+    f->dump_unsigned("snaps", p->second.second);
+    f->close_section();
+  }
+  f->close_section();
+}
+
 void OSDService::retrieve_epochs(epoch_t *_boot_epoch, epoch_t *_up_epoch,
                                  epoch_t *_bind_epoch) const
 {
@@ -1646,6 +1755,7 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
     cct->_conf->osd_op_num_threads_per_shard * cct->_conf->osd_op_num_shards),
   recovery_tp(cct, "OSD::recovery_tp", cct->_conf->osd_recovery_threads, "osd_recovery_threads"),
   disk_tp(cct, "OSD::disk_tp", cct->_conf->osd_disk_threads, "osd_disk_threads"),
+  scrub_tp(cct, "OSD::scrub_tp", cct->_conf->osd_scrub_threads, "osd_scrub_threads"),
   command_tp(cct, "OSD::command_tp", 1),
   paused_recovery(false),
   session_waiting_lock("OSD::session_waiting_lock"),
@@ -1679,9 +1789,9 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   recovery_wq(this, cct->_conf->osd_recovery_thread_timeout, &recovery_tp),
   replay_queue_lock("OSD::replay_queue_lock"),
   snap_trim_wq(this, cct->_conf->osd_snap_trim_thread_timeout, &disk_tp),
-  scrub_wq(this, cct->_conf->osd_scrub_thread_timeout, &disk_tp),
+  scrub_wq(this, cct->_conf->osd_scrub_thread_timeout, &scrub_tp),
   scrub_finalize_wq(cct->_conf->osd_scrub_finalize_thread_timeout, &osd_tp),
-  rep_scrub_wq(this, cct->_conf->osd_scrub_thread_timeout, &disk_tp),
+  rep_scrub_wq(this, cct->_conf->osd_scrub_thread_timeout, &scrub_tp),
   remove_wq(store, cct->_conf->osd_remove_thread_timeout, &disk_tp),
   next_removal_seq(0),
   service(this)
@@ -1843,6 +1953,54 @@ bool OSD::asok_command(string command, cmdmap_t& cmdmap, string format,
     service.remote_reserver.dump(f);
     f->close_section();
     f->close_section();
+  } else if (command == "dump_snap_trim") {
+    f->open_object_section("snap_trim");
+    service.dump_snap_trim(f);
+    f->close_section();
+  } else if (command == "dump_scrubs") {
+    utime_t now = ceph_clock_now(cct);
+    f->open_object_section("scrubs");
+    f->open_object_section("throttle");
+    service.scrub_throttle.dump(f, now);
+    f->close_section();
+    f->open_array_section("pgs");
+    {
+      Mutex::Locker l(osd_lock);
+      RWLock::RLocker l2(pg_map_lock);
+      for (ceph::unordered_map<spg_t,PG*>::iterator it = pg_map.begin();
+	   it != pg_map.end();
+	   ++it) {
+	PG *pg = it->second;
+	pg->lock();
+	if (pg->is_primary() && pg->scrubber.active) {
+	  f->open_object_section("pg");
+	  pg->dump_scrub_progress(f, now);
+	  f->close_section();
+	}
+	pg->unlock();
+      }
+    }
+    f->close_section();
+    f->close_section();
+  } else if (command == "dump_tier_agent") {
+    f->open_object_section("tier_agent");
+    f->dump_int("agent_ops", service.agent_get_num_ops());
+    f->open_array_section("pgs");
+    {
+      Mutex::Locker l(osd_lock);
+      RWLock::RLocker l2(pg_map_lock);
+      for (ceph::unordered_map<spg_t,PG*>::iterator it = pg_map.begin();
+	   it != pg_map.end();
+	   ++it) {
+	PG *pg = it->second;
+	pg->lock();
+	if (pg->is_primary())
+	  pg->agent_dump(f);
+	pg->unlock();
+      }
+    }
+    f->close_section();
+    f->close_section();
   } else {
     assert(0 == "broken asok registration");
   }
@@ -2014,9 +2172,13 @@ int OSD::init()
   osd_op_tp.start();
   recovery_tp.start();
   disk_tp.start();
+  scrub_tp.start();
   command_tp.start();
 
   set_disk_tp_priority();
+  set_scrub_tp_priority();
+  set_scrub_throttle();
+  service.set_snap_trim_rate(cct->_conf->osd_snap_trim_max_ops_per_sec);
 
   // start the heartbeat
   heartbeat_thread.create();
@@ -2103,6 +2265,20 @@ void OSD::final_init()
 				     asok_hook,
 				     "show recovery reservations");
   assert(r == 0);
+  r = admin_socket->register_command("dump_snap_trim", "dump_snap_trim",
+				     asok_hook,
+				     "show snaps left to trim, by pool");
+  assert(r == 0);
+  r = admin_socket->register_command("dump_scrubs", "dump_scrubs",
+				     asok_hook,
+				     "show scrub throttle state and progress"
+				     " of active scrubs");
+  assert(r == 0);
+  r = admin_socket->register_command("dump_tier_agent", "dump_tier_agent",
+				     asok_hook,
+				     "show cache tier agent modes, object"
+				     " temperatures and recent decisions");
+  assert(r == 0);
 
   test_ops_hook = new TestOpsSocketHook(&(this->service), this->store);
   // Note: pools are CephString instead of CephPoolname because
@@ -2225,6 +2401,16 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_push_in,    "push_in");        // inbound push messages
   osd_plb.add_u64_counter(l_osd_push_inb,   "push_in_bytes");  // inbound pushed bytes
 
+  osd_plb.add_u64_counter(l_osd_push_partial, "push_partial");  // pushes of dirty extents only
+  osd_plb.add_u64_counter(l_osd_push_partial_saved_bytes, "push_partial_saved_bytes");  // bytes not pushed thanks to them
+  osd_plb.add_u64_counter(l_osd_read_eio_repair, "read_eio_repair");  // objects recovered after a read error
+  osd_plb.add_u64_counter(l_osd_ec_fast_read, "ec_fast_read");  // ec client reads of extra shards
+  osd_plb.add_u64_counter(l_osd_ec_fast_read_early, "ec_fast_read_early");  // ... which completed before every shard replied
+  osd_plb.add_u64_counter(l_osd_ec_recovery_read, "ec_recovery_read");  // ec recovery read rounds
+  osd_plb.add_u64_counter(l_osd_ec_recovery_read_objects, "ec_recovery_read_objects");  // objects read in those rounds
+  osd_plb.add_u64_counter(l_osd_ec_recovery_objects, "ec_recovery_objects");  // ec objects recovered
+  osd_plb.add_u64_counter(l_osd_ec_recovery_bytes, "ec_recovery_bytes");  // ec bytes recovered
+
   osd_plb.add_u64_counter(l_osd_rop, "recovery_ops");       // recovery ops (started)
 
   osd_plb.add_u64(l_osd_loadavg, "loadavg");
@@ -2258,12 +2444,19 @@ void OSD::create_logger()
   osd_plb.add_u64_counter(l_osd_tier_dirty, "tier_dirty");
   osd_plb.add_u64_counter(l_osd_tier_clean, "tier_clean");
   osd_plb.add_u64_counter(l_osd_tier_delay, "tier_delay");
+  osd_plb.add_u64_counter(l_osd_tier_proxy_read, "tier_proxy_read");   // reads proxied to the base tier
+  osd_plb.add_u64_counter(l_osd_tier_proxy_write, "tier_proxy_write"); // writes proxied to the base tier
 
   osd_plb.add_u64_counter(l_osd_agent_wake, "agent_wake");
   osd_plb.add_u64_counter(l_osd_agent_skip, "agent_skip");
   osd_plb.add_u64_counter(l_osd_agent_flush, "agent_flush");
   osd_plb.add_u64_counter(l_osd_agent_evict, "agent_evict");
 
+  osd_plb.add_u64_counter(l_osd_snap_trim, "snap_trim");  // clones trimmed
+  osd_plb.add_u64_counter(l_osd_snap_trim_throttled, "snap_trim_throttled");  // trim passes delayed by osd_snap_trim_max_ops_per_sec
+  osd_plb.add_u64(l_osd_snap_trim_pgs, "snap_trim_pgs");  // primary pgs with snaps to trim
+  osd_plb.add_u64(l_osd_snap_trim_queue, "snap_trim_queue");  // snaps left to trim, summed over pgs
+
   logger = osd_plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
@@ -2322,6 +2515,7 @@ void OSD::suicide(int exitcode)
   osd_tp.pause();
   osd_op_tp.pause();
   disk_tp.pause();
+  scrub_tp.pause();
   recovery_tp.pause();
   command_tp.pause();
 
@@ -2389,6 +2583,9 @@ int OSD::shutdown()
   cct->get_admin_socket()->unregister_command("dump_blacklist");
   cct->get_admin_socket()->unregister_command("dump_watchers");
   cct->get_admin_socket()->unregister_command("dump_reservations");
+  cct->get_admin_socket()->unregister_command("dump_scrubs");
+  cct->get_admin_socket()->unregister_command("dump_snap_trim");
+  cct->get_admin_socket()->unregister_command("dump_tier_agent");
   delete asok_hook;
   asok_hook = NULL;
 
@@ -2432,6 +2629,10 @@ int OSD::shutdown()
   disk_tp.stop();
   dout(10) << "disk tp paused (new)" << dendl;
 
+  scrub_tp.drain();
+  scrub_tp.stop();
+  dout(10) << "scrub tp stopped" << dendl;
+
   dout(10) << "stopping agent" << dendl;
   service.agent_stop();
 
@@ -7826,6 +8027,7 @@ void OSD::do_recovery(PG *pg, ThreadPool::TPHandle &handle)
 	     << " rops)" << dendl;
   }
   recovery_wq.unlock();
+  int max_objects = max;
 
   if (max <= 0) {
     dout(10) << "do_recovery raced and failed to start anything; requeuing " << *pg << dendl;
@@ -7843,11 +8045,25 @@ void OSD::do_recovery(PG *pg, ThreadPool::TPHandle &handle)
     dout(20) << "  active was " << recovery_oids[pg->info.pgid] << dendl;
 #endif
     
+    int batch = pg->get_recovery_batch();
+    if (batch > 1) {
+      // each slot may cover several objects, but all of them count
+      // against osd_recovery_max_active
+      recovery_wq.lock();
+      int extra = MIN(max * (batch - 1),
+		      cct->_conf->osd_recovery_max_active - recovery_ops_active);
+      if (extra > 0) {
+	recovery_ops_active += extra;
+	max_objects += extra;
+      }
+      recovery_wq.unlock();
+    }
+
     PG::RecoveryCtx rctx = create_context();
 
     int started;
-    bool more = pg->start_recovery_ops(max, &rctx, handle, &started);
-    dout(10) << "do_recovery started " << started << "/" << max << " on " << *pg << dendl;
+    bool more = pg->start_recovery_ops(max, max_objects, &rctx, handle, &started);
+    dout(10) << "do_recovery started " << started << "/" << max_objects << " on " << *pg << dendl;
 
     /*
      * if we couldn't start any recovery ops and things are still
@@ -7874,8 +8090,8 @@ void OSD::do_recovery(PG *pg, ThreadPool::TPHandle &handle)
  out:
   recovery_wq.lock();
   if (max > 0) {
-    assert(recovery_ops_active >= max);
-    recovery_ops_active -= max;
+    assert(recovery_ops_active >= max_objects);
+    recovery_ops_active -= max_objects;
   }
   recovery_wq._wake();
   recovery_wq.unlock();
@@ -8477,6 +8693,14 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_pg_epoch_persisted_max_stale",
     "osd_disk_thread_ioprio_class",
     "osd_disk_thread_ioprio_priority",
+    "osd_scrub_thread_ioprio_class",
+    "osd_scrub_thread_ioprio_priority",
+    "osd_scrub_max_bytes_per_sec",
+    "osd_scrub_max_ops_per_sec",
+    "osd_scrub_client_latency_threshold",
+    "osd_scrub_client_latency_percentile",
+    "osd_scrub_client_latency_window",
+    "osd_snap_trim_max_ops_per_sec",
     NULL
   };
   return KEYS;
@@ -8507,6 +8731,22 @@ void OSD::handle_conf_change(const struct md_config_t *conf,
       changed.count("osd_disk_thread_ioprio_priority")) {
     set_disk_tp_priority();
   }
+  if (changed.count("osd_disk_thread_ioprio_class") ||
+      changed.count("osd_disk_thread_ioprio_priority") ||
+      changed.count("osd_scrub_thread_ioprio_class") ||
+      changed.count("osd_scrub_thread_ioprio_priority")) {
+    set_scrub_tp_priority();
+  }
+  if (changed.count("osd_scrub_max_bytes_per_sec") ||
+      changed.count("osd_scrub_max_ops_per_sec") ||
+      changed.count("osd_scrub_client_latency_threshold") ||
+      changed.count("osd_scrub_client_latency_percentile") ||
+      changed.count("osd_scrub_client_latency_window")) {
+    set_scrub_throttle();
+  }
+  if (changed.count("osd_snap_trim_max_ops_per_sec")) {
+    service.set_snap_trim_rate(cct->_conf->osd_snap_trim_max_ops_per_sec);
+  }
   if (changed.count("osd_map_cache_size")) {
     service.map_cache.set_size(cct->_conf->osd_map_cache_size);
     service.map_bl_cache.set_size(cct->_conf->osd_map_cache_size);
@@ -8542,6 +8782,31 @@ void OSD::set_disk_tp_priority()
   disk_tp.set_ioprio(cls, cct->_conf->osd_disk_thread_ioprio_priority);
 }
 
+void OSD::set_scrub_tp_priority()
+{
+  // scrub used to share the disk threads; follow their settings unless
+  // told otherwise
+  string cls_str = cct->_conf->osd_scrub_thread_ioprio_class;
+  if (cls_str.empty())
+    cls_str = cct->_conf->osd_disk_thread_ioprio_class;
+  int prio = cct->_conf->osd_scrub_thread_ioprio_priority;
+  if (prio < 0)
+    prio = cct->_conf->osd_disk_thread_ioprio_priority;
+  dout(10) << __func__ << " class " << cls_str << " priority " << prio << dendl;
+  int cls = ceph_ioprio_string_to_class(cls_str);
+  scrub_tp.set_ioprio(cls, prio);
+}
+
+void OSD::set_scrub_throttle()
+{
+  service.scrub_throttle.set_limits(cct->_conf->osd_scrub_max_bytes_per_sec,
+				    cct->_conf->osd_scrub_max_ops_per_sec);
+  service.scrub_throttle.set_latency_limit(
+    cct->_conf->osd_scrub_client_latency_threshold,
+    cct->_conf->osd_scrub_client_latency_percentile,
+    cct->_conf->osd_scrub_client_latency_window);
+}
+
 // --------------------------------
 
 int OSD::init_op_flags(OpRequestRef& op)
@@ -31,6 +31,7 @@
 
 #include "os/ObjectStore.h"
 #include "OSDCap.h"
+#include "ScrubThrottle.h"
 
 #include "osd/ClassHandler.h"
 
@@ -102,6 +103,16 @@ enum {
   l_osd_push_in,
   l_osd_push_inb,
 
+  l_osd_push_partial,
+  l_osd_push_partial_saved_bytes,
+  l_osd_read_eio_repair,
+  l_osd_ec_fast_read,
+  l_osd_ec_fast_read_early,
+  l_osd_ec_recovery_read,
+  l_osd_ec_recovery_read_objects,
+  l_osd_ec_recovery_objects,
+  l_osd_ec_recovery_bytes,
+
   l_osd_rop,
 
   l_osd_loadavg,
@@ -135,12 +146,19 @@ enum {
   l_osd_tier_dirty,
   l_osd_tier_clean,
   l_osd_tier_delay,
+  l_osd_tier_proxy_read,
+  l_osd_tier_proxy_write,
 
   l_osd_agent_wake,
   l_osd_agent_skip,
   l_osd_agent_flush,
   l_osd_agent_evict,
 
+  l_osd_snap_trim,
+  l_osd_snap_trim_throttled,
+  l_osd_snap_trim_pgs,
+  l_osd_snap_trim_queue,
+
   l_osd_last,
 };
 
@@ -544,6 +562,40 @@ public:
   void dec_scrubs_pending();
   void dec_scrubs_active();
 
+  // -- scrub throttling --
+  ScrubThrottle scrub_throttle;
+
+  /**
+   * wait (briefly) for the scrub budget before starting a new chunk
+   *
+   * Sleeps for at most osd_scrub_throttle_max_sleep.
+   *
+   * @return true if the chunk may start, false if the caller should
+   * requeue and try again later
+   */
+  bool scrub_throttle_wait(ThreadPool::TPHandle &handle);
+
+  // -- snap trimming --
+  Mutex snap_trim_lock;
+  TokenBucket snap_trim_throttle;        ///< clone trims per second
+  map<spg_t, uint64_t> snap_trimq_len;   ///< snaps left to trim, by pg
+  uint64_t snap_trimq_total;
+
+  void set_snap_trim_rate(double trims_per_sec);
+  void set_snap_trimq_len(spg_t pgid, uint64_t len);
+  /// how long to wait before trimming more clones
+  utime_t get_snap_trim_delay();
+  void take_snap_trim(unsigned trimmed);
+  void dump_snap_trim(Formatter *f);
+
+  // -- ec sub read latency, by peer --
+  Mutex peer_read_lat_lock;
+  map<int, double> peer_read_lat;  ///< osd -> moving average, in seconds
+
+  void note_peer_read_latency(int peer, utime_t lat);
+  /// recent sub read latency of peer, 0 if unknown
+  double get_peer_read_latency(int peer);
+
   void reply_op_error(OpRequestRef op, int err);
   void reply_op_error(OpRequestRef op, int err, eversion_t v, version_t uv);
   void handle_misdirected_op(PG *pg, OpRequestRef op);
@@ -1087,11 +1139,14 @@ private:
   ShardedThreadPool osd_op_tp;
   ThreadPool recovery_tp;
   ThreadPool disk_tp;
+  ThreadPool scrub_tp;
   ThreadPool command_tp;
 
   bool paused_recovery;
 
   void set_disk_tp_priority();
+  void set_scrub_tp_priority();
+  void set_scrub_throttle();
 
   // -- sessions --
 public:
@@ -806,6 +806,7 @@ void OSDMap::Incremental::generate_test_instances(list<Incremental*>& o)
 void OSDMap::set_epoch(epoch_t e)
 {
   epoch = e;
+  pg_mapping.reset();
   for (map<int64_t,pg_pool_t>::iterator p = pools.begin();
        p != pools.end();
        ++p)
@@ -844,6 +845,7 @@ void OSDMap::get_blacklist(list<pair<entity_addr_t,utime_t> > *bl) const
 
 void OSDMap::set_max_osd(int m)
 {
+  pg_mapping.reset();
   int o = max_osd;
   max_osd = m;
   osd_state.resize(m);
@@ -979,6 +981,14 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
 	entity_type != CEPH_ENTITY_TYPE_CLIENT) { // not for clients
       features |= CEPH_FEATURE_OSD_ERASURE_CODES;
     }
+    if (p->second.allows_ec_overwrites() &&
+	entity_type != CEPH_ENTITY_TYPE_CLIENT) {
+      features |= CEPH_FEATURE_OSD_EC_OVERWRITES;
+    }
+    if (p->second.cache_mode == pg_pool_t::CACHEMODE_PROXY &&
+	entity_type != CEPH_ENTITY_TYPE_CLIENT) {
+      features |= CEPH_FEATURE_OSD_PROXY_CACHE;
+    }
     if (!p->second.tiers.empty() ||
 	p->second.is_tier()) {
       features |= CEPH_FEATURE_OSD_CACHEPOOL;
@@ -995,7 +1005,8 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
   }
   mask |= CEPH_FEATURE_OSDHASHPSPOOL | CEPH_FEATURE_OSD_CACHEPOOL;
   if (entity_type != CEPH_ENTITY_TYPE_CLIENT)
-    mask |= CEPH_FEATURE_OSD_ERASURE_CODES;
+    mask |= CEPH_FEATURE_OSD_ERASURE_CODES | CEPH_FEATURE_OSD_EC_OVERWRITES |
+      CEPH_FEATURE_OSD_PROXY_CACHE;
 
   if (osd_primary_affinity) {
     for (int i = 0; i < max_osd; ++i) {
@@ -1165,6 +1176,7 @@ void OSDMap::remove_down_temps(CephContext *cct,
 int OSDMap::apply_incremental(const Incremental &inc)
 {
   new_blacklist_entries = false;
+  pg_mapping.reset();
   if (inc.epoch == 1)
     fsid = inc.fsid;
   else if (inc.fsid != fsid)
@@ -1587,6 +1599,10 @@ void OSDMap::pg_to_raw_up(pg_t pg, vector<int> *up, int *primary) const
 void OSDMap::_pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_primary,
                                    vector<int> *acting, int *acting_primary) const
 {
+  if (pg_mapping && pg_mapping->get_epoch() == epoch &&
+      pg_mapping->get(pg, up, up_primary, acting, acting_primary))
+    return;
+
   const pg_pool_t *pool = get_pg_pool(pg.pool());
   if (!pool) {
     if (up)
@@ -1625,6 +1641,15 @@ void OSDMap::_pg_to_up_acting_osds(const pg_t& pg, vector<int> *up, int *up_prim
     *acting_primary = _acting_primary;
 }
 
+void OSDMap::build_pg_mapping()
+{
+  // compute every mapping the slow way, then publish the table
+  pg_mapping.reset();
+  OSDMapMapping *m = new OSDMapMapping;
+  m->update(*this);
+  pg_mapping.reset(m);
+}
+
 int OSDMap::calc_pg_rank(int osd, const vector<int>& acting, int nrep)
 {
   if (!nrep)
@@ -2039,6 +2064,8 @@ void OSDMap::decode(bufferlist::iterator& bl)
 
 void OSDMap::post_decode()
 {
+  pg_mapping.reset();
+
   // index pool names
   name_pool.clear();
   for (map<int64_t,string>::iterator i = pool_name.begin();
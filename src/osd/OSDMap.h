@@ -27,6 +27,7 @@
 #include "common/config.h"
 #include "include/types.h"
 #include "osd_types.h"
+#include "OSDMapMapping.h"
 #include "msg/Message.h"
 #include "common/Mutex.h"
 #include "common/Clock.h"
@@ -240,6 +241,9 @@ private:
   string cluster_snapshot;
   bool new_blacklist_entries;
 
+  /// precomputed pg mappings for this epoch, if built; see build_pg_mapping()
+  ceph::shared_ptr<const OSDMapMapping> pg_mapping;
+
  public:
   ceph::shared_ptr<CrushWrapper> crush;       // hierarchical map
 
@@ -281,6 +285,9 @@ public:
 
     // NOTE: we do not copy crush.  note that apply_incremental will
     // allocate a new CrushWrapper, though.
+
+    // the copy is about to be modified; don't let it use our mappings.
+    pg_mapping.reset();
   }
 
   // map info
@@ -340,6 +347,7 @@ public:
   void set_state(int o, unsigned s) {
     assert(o < max_osd);
     osd_state[o] = s;
+    pg_mapping.reset();
   }
   void set_weightf(int o, float w) {
     set_weight(o, (int)((float)CEPH_OSD_IN * w));
@@ -349,6 +357,7 @@ public:
     osd_weight[o] = w;
     if (w)
       osd_state[o] |= CEPH_OSD_EXISTS;
+    pg_mapping.reset();
   }
   unsigned get_weight(int o) const {
     assert(o < max_osd);
@@ -365,6 +374,7 @@ public:
       osd_primary_affinity.reset(new vector<__u32>(max_osd,
 						   CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
     (*osd_primary_affinity)[o] = w;
+    pg_mapping.reset();
   }
   unsigned get_primary_affinity(int o) const {
     assert(o < max_osd);
@@ -662,6 +672,28 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+
+  /**
+   * precompute up/acting for every pg of every pool in this epoch
+   *
+   * Subsequent pg_to_up_acting_osds()/pg_to_acting_osds() lookups are
+   * served from the table instead of running CRUSH.  The table is
+   * dropped by anything that modifies the map (apply_incremental(),
+   * decode(), set_state(), ...), so owners that keep a single current
+   * map should call this again after each update.  Building is not
+   * thread-safe with respect to concurrent lookups on the same map.
+   */
+  void build_pg_mapping();
+  void clear_pg_mapping() {
+    pg_mapping.reset();
+  }
+  bool have_pg_mapping() const {
+    return pg_mapping && pg_mapping->get_epoch() == epoch;
+  }
+  /// bytes used by the precomputed pg mappings, or 0 if none are built
+  uint64_t get_pg_mapping_bytes() const {
+    return pg_mapping ? pg_mapping->get_num_bytes() : 0;
+  }
   bool pg_is_ec(pg_t pg) const {
     map<int64_t, pg_pool_t>::const_iterator i = pools.find(pg.pool());
     assert(i != pools.end());
@@ -804,6 +836,7 @@ public:
   void clear_temp() {
     pg_temp->clear();
     primary_temp->clear();
+    pg_mapping.reset();
   }
 
 private:
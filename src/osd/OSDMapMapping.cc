@@ -0,0 +1,118 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "OSDMapMapping.h"
+#include "OSDMap.h"
+#include "common/Formatter.h"
+
+void OSDMapMapping::update(const OSDMap& osdmap)
+{
+  epoch = osdmap.get_epoch();
+  pools.clear();
+  num_pgs = 0;
+  num_uncached = 0;
+  const map<int64_t,pg_pool_t>& osdmap_pools = osdmap.get_pools();
+  for (map<int64_t,pg_pool_t>::const_iterator p = osdmap_pools.begin();
+       p != osdmap_pools.end();
+       ++p) {
+    _build_pool(osdmap, p->first, p->second);
+  }
+}
+
+void OSDMapMapping::_build_pool(const OSDMap& osdmap, int64_t poolid,
+				const pg_pool_t& pool)
+{
+  PoolMapping& pm = pools.insert(
+    make_pair(poolid,
+	      PoolMapping(pool.get_size(), pool.get_pg_num(),
+			  pool.get_pg_num_mask()))).first->second;
+  vector<int> up, acting;
+  int up_primary, acting_primary;
+  for (unsigned ps = 0; ps < pm.pg_num; ++ps) {
+    osdmap.pg_to_up_acting_osds(pg_t(ps, poolid), &up, &up_primary,
+				&acting, &acting_primary);
+    int32_t *row = pm.row(ps);
+    ++num_pgs;
+    if (up.size() > pm.size || acting.size() > pm.size) {
+      row[2] = -1;
+      ++num_uncached;
+      continue;
+    }
+    row[0] = up_primary;
+    row[1] = acting_primary;
+    row[2] = up.size();
+    row[3] = acting.size();
+    int32_t *o = row + 4;
+    for (unsigned i = 0; i < up.size(); ++i)
+      o[i] = up[i];
+    o += pm.size;
+    for (unsigned i = 0; i < acting.size(); ++i)
+      o[i] = acting[i];
+  }
+}
+
+bool OSDMapMapping::get(pg_t pgid,
+			vector<int> *up, int *up_primary,
+			vector<int> *acting, int *acting_primary) const
+{
+  map<int64_t, PoolMapping>::const_iterator p = pools.find(pgid.pool());
+  if (p == pools.end())
+    return false;
+  const PoolMapping& pm = p->second;
+  if (pm.pg_num == 0)
+    return false;
+  ps_t ps = ceph_stable_mod(pgid.ps(), pm.pg_num, pm.pg_num_mask);
+  const int32_t *row = pm.row(ps);
+  if (row[2] < 0)
+    return false;
+  const int32_t *o = row + 4;
+  if (up)
+    up->assign(o, o + row[2]);
+  if (up_primary)
+    *up_primary = row[0];
+  o += pm.size;
+  if (acting)
+    acting->assign(o, o + row[3]);
+  if (acting_primary)
+    *acting_primary = row[1];
+  return true;
+}
+
+uint64_t OSDMapMapping::get_num_bytes() const
+{
+  uint64_t bytes = sizeof(*this);
+  for (map<int64_t, PoolMapping>::const_iterator p = pools.begin();
+       p != pools.end();
+       ++p) {
+    bytes += sizeof(*p) + p->second.table.capacity() * sizeof(int32_t);
+  }
+  return bytes;
+}
+
+void OSDMapMapping::dump(Formatter *f) const
+{
+  f->dump_unsigned("epoch", epoch);
+  f->dump_unsigned("num_pgs", num_pgs);
+  f->dump_unsigned("num_uncached", num_uncached);
+  f->dump_unsigned("bytes", get_num_bytes());
+  f->open_array_section("pools");
+  for (map<int64_t, PoolMapping>::const_iterator p = pools.begin();
+       p != pools.end();
+       ++p) {
+    f->open_object_section("pool");
+    f->dump_int("pool", p->first);
+    f->dump_unsigned("pg_num", p->second.pg_num);
+    f->dump_unsigned("row_size", p->second.row_size());
+    f->close_section();
+  }
+  f->close_section();
+}
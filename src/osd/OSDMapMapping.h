@@ -0,0 +1,99 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_OSDMAPMAPPING_H
+#define CEPH_OSD_OSDMAPMAPPING_H
+
+#include <map>
+#include <vector>
+
+#include "include/types.h"
+#include "osd_types.h"
+
+class OSDMap;
+
+/**
+ * precomputed pg -> (up, up_primary, acting, acting_primary) table
+ *
+ * Running CRUSH for every lookup is by far the most expensive part of
+ * mapping a pg.  An OSDMapMapping captures the result for every pg of
+ * every pool for a single epoch so that subsequent lookups are a couple
+ * of array reads.  Each pool is stored as a flat vector of int32_t rows:
+ *
+ *   [up_primary, acting_primary, up_len, acting_len,
+ *    up[0..size), acting[0..size)]
+ *
+ * Rows whose up or acting set does not fit in the pool size (e.g. an
+ * oversized pg_temp) are flagged with up_len == -1 and are computed on
+ * demand by the caller instead.
+ *
+ * The table is immutable once built; the owning OSDMap discards it
+ * whenever it is modified.
+ */
+class OSDMapMapping {
+  struct PoolMapping {
+    unsigned size;      ///< max osds per row (pool size)
+    unsigned pg_num;
+    unsigned pg_num_mask;
+    std::vector<int32_t> table;
+
+    PoolMapping(unsigned s, unsigned n, unsigned m)
+      : size(s), pg_num(n), pg_num_mask(m),
+	table(row_size() * n) {}
+
+    size_t row_size() const {
+      return 4 + size + size;
+    }
+    int32_t *row(ps_t ps) {
+      return &table[row_size() * ps];
+    }
+    const int32_t *row(ps_t ps) const {
+      return &table[row_size() * ps];
+    }
+  };
+
+  epoch_t epoch;
+  std::map<int64_t, PoolMapping> pools;
+  uint64_t num_pgs;
+  uint64_t num_uncached;  ///< rows that did not fit and fall back to CRUSH
+
+  void _build_pool(const OSDMap& osdmap, int64_t poolid, const pg_pool_t& pool);
+
+public:
+  OSDMapMapping() : epoch(0), num_pgs(0), num_uncached(0) {}
+
+  /// (re)build the table from scratch for every pool in @p osdmap
+  void update(const OSDMap& osdmap);
+
+  /**
+   * look up a (possibly raw) pg
+   *
+   * Any of the output pointers may be NULL.
+   *
+   * @return false if the pg is not covered by the table, in which case
+   * the outputs are untouched and the caller must compute the mapping
+   */
+  bool get(pg_t pgid,
+	   std::vector<int> *up, int *up_primary,
+	   std::vector<int> *acting, int *acting_primary) const;
+
+  epoch_t get_epoch() const { return epoch; }
+  uint64_t get_num_pgs() const { return num_pgs; }
+  uint64_t get_num_uncached() const { return num_uncached; }
+
+  /// approximate heap footprint of the table, in bytes
+  uint64_t get_num_bytes() const;
+
+  void dump(Formatter *f) const;
+};
+
+#endif
@@ -820,6 +820,11 @@ void PG::build_prior(std::auto_ptr<PriorSet> &prior_set)
   set_probe_targets(prior_set->probe);
 }
 
+void PG::publish_snap_trimq_len()
+{
+  osd->set_snap_trimq_len(info.pgid, snap_trimq.size());
+}
+
 void PG::clear_primary_state()
 {
   dout(10) << "clear_primary_state" << dendl;
@@ -841,6 +846,7 @@ void PG::clear_primary_state()
   last_update_ondisk = eversion_t();
 
   snap_trimq.clear();
+  publish_snap_trimq_len();
 
   finish_sync_event = 0;  // so that _finish_recvoery doesn't go off in another thread
 
@@ -1450,6 +1456,7 @@ void PG::activate(ObjectStore::Transaction& t,
     min_last_complete_ondisk = eversion_t(0,0);  // we don't know (yet)!
   }
   last_update_applied = info.last_update;
+  projected_last_update = info.last_update;
   last_rollback_info_trimmed_to_applied = pg_log.get_rollback_trimmed_to();
 
   need_up_thru = false;
@@ -1468,6 +1475,7 @@ void PG::activate(ObjectStore::Transaction& t,
     snap_trimq = pool.cached_removed_snaps;
     snap_trimq.subtract(info.purged_snaps);
     dout(10) << "activate - snap_trimq " << snap_trimq << dendl;
+    publish_snap_trimq_len();
     if (!snap_trimq.empty() && is_clean())
       queue_snap_trim();
   }
@@ -3480,11 +3488,56 @@ int PG::build_scrub_map_chunk(
 
   // pg attrs
   osd->store->collection_getattrs(coll, map.attrs);
-  dout(10) << __func__ << " done." << dendl;
+
+  // charge the reads to the scrub budget.  replicas charge but never
+  // wait: the primary is blocking writes to this chunk until we reply.
+  uint64_t bytes = 0, ops = 0;
+  uint64_t stride = MAX(cct->_conf->osd_deep_scrub_stride, 1);
+  for (std::map<hobject_t, ScrubMap::object>::iterator p = map.objects.begin();
+       p != map.objects.end();
+       ++p) {
+    ++ops;  // stat + getattrs
+    if (deep) {
+      bytes += p->second.size;
+      ops += (p->second.size + stride - 1) / stride;
+    }
+  }
+  osd->scrub_throttle.take(ceph_clock_now(cct), bytes, ops);
+  dout(10) << __func__ << " done, " << map.objects.size() << " objects "
+	   << bytes << " bytes " << ops << " ops" << dendl;
 
   return 0;
 }
 
+/*
+ * called with pg lock held
+ */
+void PG::dump_scrub_progress(Formatter *f, utime_t now)
+{
+  f->dump_stream("pgid") << info.pgid;
+  f->dump_bool("deep", scrubber.deep);
+  f->dump_string("state", Scrubber::state_string(scrubber.state));
+  f->dump_stream("start") << scrubber.stamp_start;
+  f->dump_stream("position") << scrubber.start;
+  uint64_t objects_total = MAX(info.stats.stats.sum.num_objects, 0);
+  f->dump_unsigned("objects_scrubbed", scrubber.objects_scrubbed);
+  f->dump_unsigned("objects_total", objects_total);
+  f->dump_unsigned("bytes_scrubbed", scrubber.bytes_scrubbed);
+
+  double elapsed = 0;
+  if (scrubber.stamp_start != utime_t() && now > scrubber.stamp_start)
+    elapsed = now - scrubber.stamp_start;
+  double progress = 1.0;
+  if (objects_total)
+    progress = MIN(1.0, (double)scrubber.objects_scrubbed / objects_total);
+  f->dump_float("elapsed", elapsed);
+  f->dump_float("progress", progress);
+  if (progress > 0)
+    f->dump_float("eta", elapsed * (1.0 - progress) / progress);
+  else
+    f->dump_string("eta", "unknown");
+}
+
 /*
  * build a (sorted) summary of pg content for purposes of scrubbing
  * called while holding pg lock
@@ -3666,6 +3719,18 @@ void PG::scrub(ThreadPool::TPHandle &handle)
     lock();
     dout(20) << __func__ << " slept for " << t << dendl;
   }
+  if (scrubber.state == PG::Scrubber::NEW_CHUNK ||
+      scrubber.state == PG::Scrubber::INACTIVE) {
+    unlock();
+    bool go = osd->scrub_throttle_wait(handle);
+    lock();
+    if (!go && !deleting) {
+      dout(20) << __func__ << " throttled, requeueing" << dendl;
+      osd->scrub_wq.queue(this);
+      unlock();
+      return;
+    }
+  }
   if (deleting) {
     unlock();
     return;
@@ -3808,6 +3873,7 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         publish_stats_to_osd();
         scrubber.epoch_start = info.history.same_interval_since;
         scrubber.active = true;
+        scrubber.stamp_start = ceph_clock_now(cct);
 
 	osd->inc_scrubs_active(scrubber.reserved);
 	if (scrubber.reserved) {
@@ -3945,6 +4011,13 @@ void PG::chunky_scrub(ThreadPool::TPHandle &handle)
         --scrubber.waiting_on;
         scrubber.waiting_on_whom.erase(pg_whoami);
 
+        scrubber.objects_scrubbed += scrubber.primary_scrubmap.objects.size();
+        for (map<hobject_t, ScrubMap::object>::iterator p =
+	       scrubber.primary_scrubmap.objects.begin();
+	     p != scrubber.primary_scrubmap.objects.end();
+	     ++p)
+	  scrubber.bytes_scrubbed += p->second.size;
+
         scrubber.state = PG::Scrubber::WAIT_REPLICAS;
         break;
 
@@ -6232,6 +6305,8 @@ boost::statechart::result PG::RecoveryState::Active::react(const AdvMap& advmap)
   if (!pg->pool.newly_removed_snaps.empty()) {
     pg->snap_trimq.union_of(pg->pool.newly_removed_snaps);
     dout(10) << *pg << " snap_trimq now " << pg->snap_trimq << dendl;
+    if (pg->is_primary())
+      pg->publish_snap_trimq_len();
     pg->dirty_info = true;
     pg->dirty_big_info = true;
   }
@@ -421,6 +421,8 @@ public:
   map<epoch_t,pg_interval_t> past_intervals;
 
   interval_set<snapid_t> snap_trimq;
+  /// report snap_trimq's size to the OSD (for perf counters)
+  void publish_snap_trimq_len();
 
   /* You should not use these items without taking their respective queue locks
    * (if they have one) */
@@ -443,6 +445,9 @@ public:
   eversion_t  last_update_ondisk;    // last_update that has committed; ONLY DEFINED WHEN is_active()
   eversion_t  last_complete_ondisk;  // last_complete that has committed.
   eversion_t  last_update_applied;
+  // last version handed to the backend; ahead of the log while an ec
+  // read-modify-write holds later writes back
+  eversion_t  projected_last_update;
 
 
   struct C_UpdateLastRollbackInfoTrimmedToApplied : Context {
@@ -837,6 +842,11 @@ public:
 	old_version,
 	t);
     }
+    void rollback_extents(
+      version_t gen,
+      const vector<pair<uint64_t, uint64_t> > &extents) {
+      pg->get_pgbackend()->trim_stashed_object(soid, gen, t);
+    }
   };
 
   struct SnapRollBacker : public ObjectModDesc::Visitor {
@@ -976,12 +986,17 @@ public:
 
   virtual void check_local() = 0;
 
+  /// objects a single recovery slot may cover for this pg
+  virtual int get_recovery_batch() const = 0;
+
   /**
+   * @param max recovery slots granted to the pg
+   * @param max_objects objects the slots may cover, see get_recovery_batch()
    * @param ops_begun returns how many recovery ops the function started
    * @returns true if any useful work was accomplished; false otherwise
    */
   virtual bool start_recovery_ops(
-    int max, RecoveryCtx *prctx,
+    int max, int max_objects, RecoveryCtx *prctx,
     ThreadPool::TPHandle &handle,
     int *ops_begun) = 0;
 
@@ -1020,7 +1035,8 @@ public:
       active_rep_scrub(0),
       must_scrub(false), must_deep_scrub(false), must_repair(false),
       state(INACTIVE),
-      deep(false)
+      deep(false),
+      objects_scrubbed(0), bytes_scrubbed(0)
     {
     }
 
@@ -1073,6 +1089,10 @@ public:
     // deep scrub
     bool deep;
 
+    // progress, for dump_scrubs
+    utime_t stamp_start;
+    uint64_t objects_scrubbed, bytes_scrubbed;
+
     list<Context*> callbacks;
     void add_callback(Context *context) {
       callbacks.push_back(context);
@@ -1142,6 +1162,9 @@ public:
       deep_errors = 0;
       fixed = 0;
       deep = false;
+      stamp_start = utime_t();
+      objects_scrubbed = 0;
+      bytes_scrubbed = 0;
       run_callbacks();
       inconsistent.clear();
       missing.clear();
@@ -1180,6 +1203,7 @@ public:
     hobject_t start, hobject_t end, bool deep,
     ThreadPool::TPHandle &handle);
   void build_scrub_map(ScrubMap &map, ThreadPool::TPHandle &handle);
+  void dump_scrub_progress(Formatter *f, utime_t now);
   void build_inc_scrub_map(
     ScrubMap &map, eversion_t v, ThreadPool::TPHandle &handle);
   /**
@@ -2089,7 +2113,8 @@ public:
 
   eversion_t get_next_version() const {
     eversion_t at_version(get_osdmap()->get_epoch(),
-			  pg_log.get_head().version+1);
+			  MAX(pg_log.get_head().version,
+			      projected_last_update.version)+1);
     assert(at_version > info.last_update);
     assert(at_version > pg_log.get_head());
     return at_version;
@@ -2243,6 +2268,7 @@ public:
   virtual void agent_delay() = 0;
   virtual void agent_clear() = 0;
   virtual void agent_choose_mode_restart() = 0;
+  virtual void agent_dump(Formatter *f) = 0;
 };
 
 ostream& operator<<(ostream& out, const PG& pg);
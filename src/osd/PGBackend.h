@@ -215,6 +215,10 @@
 
      virtual PerfCounters *get_logger() = 0;
 
+     /// feed/query the osd wide estimate of sub read latency from peer
+     virtual void note_peer_read_latency(int peer, utime_t lat) = 0;
+     virtual double get_peer_read_latency(int peer) = 0;
+
      virtual ceph_tid_t get_tid() = 0;
 
      virtual LogClientTemp clog_error() = 0;
@@ -245,6 +249,9 @@
     * the pending recovery operations.
     */
    struct RecoveryHandle {
+     /// bound on the data read at once for the objects in the op, 0 for none
+     uint64_t max_bytes;
+     RecoveryHandle() : max_bytes(0) {}
      virtual ~RecoveryHandle() {}
    };
 
@@ -468,6 +475,17 @@
        uint64_t len
        ) { assert(0); }
 
+     /// Optional, only on ec pools which allow overwrites
+     virtual void overwrite(
+       const hobject_t &hoid, ///< [in] object to write
+       uint64_t off,          ///< [in] off at which to write
+       uint64_t len,          ///< [in] len to write from bl
+       bufferlist &bl,        ///< [in] bl to write
+       version_t gen,         ///< [in] generation to stash old extents in
+       /// [in] stripe aligned extents to stash, @see ObjectModDesc
+       const vector<pair<uint64_t, uint64_t> > &stash
+       ) { assert(0); }
+
      /// Supported on all backends
 
      /// off must be the current object size
@@ -532,6 +550,13 @@
      version_t old_version,
      ObjectStore::Transaction *t);
 
+   /// Copy back extents stashed in generation gen to rollback overwrite
+   virtual void rollback_extents(
+     const hobject_t &hoid,
+     version_t gen,
+     const vector<pair<uint64_t, uint64_t> > &extents,
+     ObjectStore::Transaction *t);
+
    /// Delete object to rollback create
    void rollback_create(
      const hobject_t &hoid,
@@ -572,7 +597,8 @@
      const hobject_t &hoid,
      uint64_t off,
      uint64_t len,
-     bufferlist *bl) = 0;
+     bufferlist *bl,
+     bool allow_eio = false) = 0;
 
    virtual void objects_read_async(
      const hobject_t &hoid,
@@ -223,9 +223,10 @@ int ReplicatedBackend::objects_read_sync(
   const hobject_t &hoid,
   uint64_t off,
   uint64_t len,
-  bufferlist *bl)
+  bufferlist *bl,
+  bool allow_eio)
 {
-  return store->read(coll, hoid, off, len, *bl);
+  return store->read(coll, hoid, off, len, *bl, allow_eio);
 }
 
 struct AsyncReadCallback : public GenContext<ThreadPool::TPHandle&> {
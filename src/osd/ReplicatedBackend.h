@@ -153,7 +153,8 @@ public:
     const hobject_t &hoid,
     uint64_t off,
     uint64_t len,
-    bufferlist *bl);
+    bufferlist *bl,
+    bool allow_eio = false);
 
   void objects_read_async(
     const hobject_t &hoid,
@@ -263,6 +264,7 @@ private:
 		    ObjectRecoveryProgress *out_progress,
 		    PushOp *out_op,
 		    object_stat_sum_t *stat = 0);
+  bool can_apply_partial_push(const ObjectRecoveryInfo &recovery_info);
   void submit_push_data(ObjectRecoveryInfo &recovery_info,
 			bool first,
 			bool complete,
@@ -300,12 +302,17 @@ private:
 		 eversion_t version,
 		 interval_set<uint64_t> &data_subset,
 		 map<hobject_t, interval_set<uint64_t> >& clone_subsets,
-		 PushOp *op);
+		 PushOp *op,
+		 eversion_t base_version = eversion_t());
   void calc_head_subsets(ObjectContextRef obc, SnapSet& snapset, const hobject_t& head,
 			 const pg_missing_t& missing,
 			 const hobject_t &last_backfill,
 			 interval_set<uint64_t>& data_subset,
 			 map<hobject_t, interval_set<uint64_t> >& clone_subsets);
+  bool calc_partial_subsets(ObjectContextRef obc, const hobject_t& head,
+			    pg_shard_t peer,
+			    interval_set<uint64_t>& data_subset,
+			    eversion_t *base_version);
   ObjectRecoveryInfo recalc_subsets(
     const ObjectRecoveryInfo& recovery_info,
     SnapSetContext *ssc
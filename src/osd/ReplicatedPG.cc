@@ -405,6 +405,96 @@ void ReplicatedPG::wait_for_unreadable_object(
   op->mark_delayed("waiting for missing object");
 }
 
+void ReplicatedPG::get_repair_sources(const hobject_t& soid,
+				      set<pg_shard_t> *good)
+{
+  for (set<pg_shard_t>::iterator i = actingbackfill.begin();
+       i != actingbackfill.end();
+       ++i) {
+    if (*i == pg_whoami)
+      continue;
+    if (is_backfill_targets(*i))
+      continue;
+    if (peer_missing.count(*i) && peer_missing[*i].is_missing(soid))
+      continue;
+    good->insert(*i);
+  }
+}
+
+/*
+ * Whether repair_primary_object could handle an EIO reading version v
+ * of soid.  Only then may the read tolerate EIO; otherwise the store
+ * keeps failing the osd under filestore_fail_eio.
+ */
+bool ReplicatedPG::can_repair_primary_object(const hobject_t& soid,
+					     eversion_t v)
+{
+  if (!cct->_conf->osd_read_eio_repair || !pool.info.is_replicated())
+    return false;
+  if (v > last_update_applied)
+    return false;
+  map<hobject_t, eversion_t>::iterator p = read_repaired.find(soid);
+  if (p != read_repaired.end() && p->second == v)
+    return false;
+  set<pg_shard_t> good;
+  get_repair_sources(soid, &good);
+  return !good.empty();
+}
+
+/*
+ * A read of our copy of soid failed with EIO (e.g., the store found a
+ * bad crc).  Treat the object as missing on the primary, recover it
+ * from a replica that has it, and retry op once it is readable.
+ *
+ * @return false if we cannot repair, in which case the caller should
+ * return the error
+ */
+bool ReplicatedPG::repair_primary_object(const hobject_t& soid, OpRequestRef op)
+{
+  if (!cct->_conf->osd_read_eio_repair || !pool.info.is_replicated())
+    return false;
+
+  ObjectContextRef obc = get_object_context(soid, false);
+  if (!obc || !obc->obs.exists)
+    return false;
+  eversion_t v = obc->obs.oi.version;
+  if (v > last_update_applied) {
+    dout(10) << __func__ << " " << soid << " v " << v
+	     << " not yet applied, not repairing" << dendl;
+    return false;
+  }
+
+  map<hobject_t, eversion_t>::iterator p = read_repaired.find(soid);
+  if (p != read_repaired.end() && p->second == v) {
+    // we already replaced this very version and it still fails
+    dout(0) << __func__ << " " << soid << " v " << v
+	    << " still unreadable after repair" << dendl;
+    read_repaired.erase(p);
+    return false;
+  }
+
+  set<pg_shard_t> good;
+  get_repair_sources(soid, &good);
+  if (good.empty()) {
+    osd->clog.error() << info.pgid << " " << soid
+		      << " read error and no other copy to repair from\n";
+    return false;
+  }
+
+  osd->clog.error() << info.pgid << " " << soid << " v " << v
+		    << " read error, recovering from " << good << "\n";
+  osd->logger->inc(l_osd_read_eio_repair);
+  pg_log.missing_add(soid, v, eversion_t());
+  missing_loc.add_missing(soid, v, eversion_t());
+  for (set<pg_shard_t>::iterator i = good.begin(); i != good.end(); ++i)
+    missing_loc.add_location(soid, *i);
+  pg_log.set_last_requested(0);
+  read_repaired[soid] = v;
+
+  wait_for_unreadable_object(soid, op);
+  return true;
+}
+
 void ReplicatedPG::wait_for_all_missing(OpRequestRef op)
 {
   waiting_for_all_missing.push_back(op);
@@ -970,7 +1060,8 @@ void ReplicatedPG::do_pg_op(OpRequestRef op)
 	    result= -ENOENT;
 	    break;
 	  }
-	  ::encode(*hit_set, osd_op.outdata);
+	  ::encode(*hit_set, osd_op.outdata,
+		   m->get_connection()->get_features());
 	  result = osd_op.outdata.length();
 	} else {
 	  // read an archived HitSet.
@@ -1354,7 +1445,7 @@ void ReplicatedPG::do_op(OpRequestRef& op)
 
   bool in_hit_set = false;
   if (hit_set) {
-    if (missing_oid != hobject_t() && hit_set->contains(missing_oid))
+    if (hit_set->contains(missing_oid != hobject_t() ? missing_oid : oid))
       in_hit_set = true;
     hit_set->insert(oid);
     if (hit_set->is_full() ||
@@ -1371,6 +1462,15 @@ void ReplicatedPG::do_op(OpRequestRef& op)
       maybe_handle_cache(op, write_ordered, obc, r, missing_oid, false, in_hit_set))
     return;
 
+  // replies must not overtake those of the writes proxied before us
+  if (write_ordered && proxy_writes.count(head)) {
+    dout(20) << __func__ << ": waiting for proxied writes on " << head
+	     << dendl;
+    waiting_for_proxy_writes[head].push_back(op);
+    op->mark_delayed("waiting for proxied writes");
+    return;
+  }
+
   if (r) {
     osd->reply_op_error(op, r);
     return;
@@ -1598,8 +1698,13 @@ bool ReplicatedPG::maybe_handle_cache(OpRequestRef op,
     if (agent_state &&
 	agent_state->evict_mode == TierAgentState::EVICT_MODE_FULL) {
       if (!op->may_write() && !op->may_cache() && !write_ordered) {
-	dout(20) << __func__ << " cache pool full, redirecting read" << dendl;
-	do_cache_redirect(op, obc);
+	dout(20) << __func__ << " cache pool full, proxying read" << dendl;
+	do_proxy_op(op, false);
+	return true;
+      }
+      if (op->may_write() && can_proxy_write(op)) {
+	dout(20) << __func__ << " cache pool full, proxying write" << dendl;
+	do_proxy_op(op, true);
 	return true;
       }
       dout(20) << __func__ << " cache pool full, waiting" << dendl;
@@ -1609,41 +1714,29 @@ bool ReplicatedPG::maybe_handle_cache(OpRequestRef op,
     if (!must_promote && can_skip_promote(op, obc)) {
       return false;
     }
-    if (op->may_write() || write_ordered || must_promote || !hit_set) {
+    if (must_promote || !hit_set) {
       promote_object(op, obc, missing_oid);
-    } else {
-      switch (pool.info.min_read_recency_for_promote) {
-      case 0:
-        promote_object(op, obc, missing_oid);
-        break;
-      case 1:
-        // Check if in the current hit set
-        if (in_hit_set) {
-          promote_object(op, obc, missing_oid);
-        } else {
-          do_cache_redirect(op, obc);
-        }
-        break;
-      default:
-        if (in_hit_set) {
-          promote_object(op, obc, missing_oid);
-        } else {
-          // Check if in other hit sets
-          map<time_t,HitSetRef>::iterator itor;
-          bool in_other_hit_sets = false;
-          for (itor = agent_state->hit_set_map.begin(); itor != agent_state->hit_set_map.end(); itor++) {
-            if (itor->second->contains(missing_oid)) {
-              in_other_hit_sets = true;
-              break;
-            }
-          }
-          if (in_other_hit_sets) {
-            promote_object(op, obc, missing_oid);
-          } else {
-            do_cache_redirect(op, obc);
-          }
-        }
-        break;
+      return true;
+    }
+    {
+      // objects are only worth promoting once they were recently used;
+      // until then the base tier serves them through us
+      const hobject_t& hit_oid =
+	missing_oid != hobject_t() || !obc.get() ?
+	missing_oid : obc->obs.oi.soid;
+      if (op->may_write() || op->may_cache()) {
+	if (!is_hit_set_recent(hit_oid, in_hit_set,
+			       pool.info.min_write_recency_for_promote) &&
+	    can_proxy_write(op))
+	  do_proxy_op(op, true);
+	else
+	  promote_object(op, obc, missing_oid);
+      } else if (write_ordered ||
+		 is_hit_set_recent(hit_oid, in_hit_set,
+				   pool.info.min_read_recency_for_promote)) {
+	promote_object(op, obc, missing_oid);
+      } else {
+	do_proxy_op(op, false);
       }
     }
     return true;
@@ -1702,6 +1795,22 @@ bool ReplicatedPG::maybe_handle_cache(OpRequestRef op,
       do_cache_redirect(op, obc);
     return true;
 
+  case pg_pool_t::CACHEMODE_PROXY:
+    if (obc.get() && obc->obs.exists) {
+      return false;
+    }
+    if (must_promote) {
+      promote_object(op, obc, missing_oid);
+    } else if (op->may_write() || op->may_cache()) {
+      if (can_proxy_write(op))
+	do_proxy_op(op, true);
+      else
+	do_cache_redirect(op, obc);
+    } else {
+      do_proxy_op(op, false);
+    }
+    return true;
+
   default:
     assert(0 == "unrecognized cache_mode");
   }
@@ -1722,6 +1831,25 @@ bool ReplicatedPG::can_skip_promote(OpRequestRef op, ObjectContextRef obc)
   return false;
 }
 
+bool ReplicatedPG::is_hit_set_recent(const hobject_t& oid, bool in_hit_set,
+				     unsigned recency)
+{
+  if (recency == 0 || in_hit_set)
+    return true;
+  if (!agent_state || oid == hobject_t())
+    return false;
+  // the archived HitSets kept in memory, newest first
+  unsigned checked = 1;
+  for (map<time_t,HitSetRef>::reverse_iterator p =
+	 agent_state->hit_set_map.rbegin();
+       p != agent_state->hit_set_map.rend() && checked < recency;
+       ++p, ++checked) {
+    if (p->second->contains(oid))
+      return true;
+  }
+  return false;
+}
+
 void ReplicatedPG::do_cache_redirect(OpRequestRef op, ObjectContextRef obc)
 {
   MOSDOp *m = static_cast<MOSDOp*>(op->get_req());
@@ -1736,6 +1864,171 @@ void ReplicatedPG::do_cache_redirect(OpRequestRef op, ObjectContextRef obc)
   return;
 }
 
+bool ReplicatedPG::can_proxy_write(OpRequestRef op)
+{
+  MOSDOp *m = static_cast<MOSDOp*>(op->get_req());
+  if (m->ops.empty())
+    return false;
+  for (vector<OSDOp>::iterator p = m->ops.begin(); p != m->ops.end(); ++p) {
+    int o = p->op.op;
+    if (ceph_osd_op_type_exec(o) || ceph_osd_op_mode_cache(o))
+      return false;
+    if (!ceph_osd_op_mode_modify(o))
+      continue;
+    switch (o) {
+    case CEPH_OSD_OP_WRITE:
+    case CEPH_OSD_OP_WRITEFULL:
+    case CEPH_OSD_OP_ZERO:
+    case CEPH_OSD_OP_TRUNCATE:
+    case CEPH_OSD_OP_SETXATTR:
+    case CEPH_OSD_OP_RMXATTR:
+    case CEPH_OSD_OP_OMAPSETVALS:
+    case CEPH_OSD_OP_OMAPSETHEADER:
+    case CEPH_OSD_OP_OMAPRMKEYS:
+    case CEPH_OSD_OP_OMAPCLEAR:
+      break;
+    case CEPH_OSD_OP_CREATE:
+      if (p->op.flags & CEPH_OSD_OP_FLAG_EXCL)
+	return false;
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+struct C_ProxyOp : public Context {
+  ReplicatedPGRef pg;
+  hobject_t oid;
+  epoch_t last_peering_reset;
+  ceph_tid_t tid;
+  ReplicatedPG::ProxyOpRef pop;
+  C_ProxyOp(ReplicatedPG *p, hobject_t o, epoch_t lpr,
+	    const ReplicatedPG::ProxyOpRef& pop)
+    : pg(p), oid(o), last_peering_reset(lpr),
+      tid(0), pop(pop)
+  {}
+  void finish(int r) {
+    if (r == -ECANCELED)
+      return;
+    pg->lock();
+    if (last_peering_reset == pg->get_last_peering_reset()) {
+      pg->finish_proxy_op(oid, tid, r);
+    }
+    pg->unlock();
+  }
+};
+
+void ReplicatedPG::do_proxy_op(OpRequestRef op, bool write)
+{
+  MOSDOp *m = static_cast<MOSDOp*>(op->get_req());
+  object_locator_t oloc(m->get_object_locator());
+  oloc.pool = pool.info.tier_of;
+  hobject_t head(m->get_oid(), m->get_object_locator().key,
+		 CEPH_NOSNAP, m->get_pg().ps(),
+		 info.pgid.pool(), m->get_object_locator().nspace);
+
+  // we are already the primary, so leave out the balancing and
+  // redirection flags, and the read/write flags derived from the ops
+  unsigned flags = CEPH_OSD_FLAG_IGNORE_CACHE | CEPH_OSD_FLAG_IGNORE_OVERLAY;
+  flags |= m->get_flags() & (CEPH_OSD_FLAG_RWORDERED |
+			     CEPH_OSD_FLAG_ORDERSNAP |
+			     CEPH_OSD_FLAG_ENFORCE_SNAPC |
+			     CEPH_OSD_FLAG_MAP_SNAP_CLONE);
+
+  dout(10) << __func__ << " " << (write ? "write " : "read ") << *m << dendl;
+
+  ProxyOpRef pop(new ProxyOp(op, head, write, m->ops));
+  ObjectOperation obj_op;
+  obj_op.dup(pop->ops);
+
+  C_ProxyOp *fin = new C_ProxyOp(this, head, get_last_peering_reset(), pop);
+  Context *onfinish = new C_OnFinisher(fin, &osd->objecter_finisher);
+  ceph_tid_t tid;
+  if (write) {
+    SnapContext snapc(m->get_snap_seq(), m->get_snaps());
+    tid = osd->objecter->mutate(m->get_oid(), oloc, obj_op, snapc,
+				m->get_mtime(), flags, NULL, onfinish,
+				&pop->user_version);
+    ++proxy_writes[head];
+  } else {
+    tid = osd->objecter->read(m->get_oid(), oloc, obj_op, m->get_snapid(),
+			      NULL, flags, onfinish, &pop->user_version);
+  }
+  fin->tid = tid;
+  pop->objecter_tid = tid;
+  proxy_ops[tid] = pop;
+  op->mark_event(write ? "proxied write" : "proxied read");
+}
+
+void ReplicatedPG::finish_proxy_op(hobject_t oid, ceph_tid_t tid, int r)
+{
+  dout(10) << __func__ << " " << oid << " tid " << tid
+	   << " " << cpp_strerror(r) << dendl;
+  map<ceph_tid_t, ProxyOpRef>::iterator p = proxy_ops.find(tid);
+  if (p == proxy_ops.end()) {
+    dout(10) << __func__ << " no proxy op found" << dendl;
+    return;
+  }
+  ProxyOpRef pop = p->second;
+  proxy_ops.erase(p);
+  assert(pop->soid == oid);
+
+  if (pop->write) {
+    map<hobject_t, unsigned>::iterator q = proxy_writes.find(oid);
+    assert(q != proxy_writes.end());
+    if (--q->second == 0) {
+      proxy_writes.erase(q);
+      map<hobject_t, list<OpRequestRef> >::iterator w =
+	waiting_for_proxy_writes.find(oid);
+      if (w != waiting_for_proxy_writes.end()) {
+	requeue_ops(w->second);
+	waiting_for_proxy_writes.erase(w);
+      }
+    }
+    osd->logger->inc(l_osd_tier_proxy_write);
+  } else {
+    osd->logger->inc(l_osd_tier_proxy_read);
+  }
+
+  MOSDOp *m = static_cast<MOSDOp*>(pop->op->get_req());
+  for (unsigned i = 0; i < m->ops.size() && i < pop->ops.size(); ++i)
+    m->ops[i].rval = pop->ops[i].rval;
+  MOSDOpReply *reply = new MOSDOpReply(m, r, get_osdmap()->get_epoch(), 0,
+				       true);
+  if (!pop->write)
+    reply->claim_op_out_data(pop->ops);
+  if (r >= 0)
+    reply->set_reply_versions(eversion_t(), pop->user_version);
+  reply->add_flags(CEPH_OSD_FLAG_ACK | CEPH_OSD_FLAG_ONDISK);
+  osd->send_message_osd_client(reply, m->get_connection());
+}
+
+void ReplicatedPG::cancel_proxy_ops(bool requeue)
+{
+  dout(10) << __func__ << dendl;
+  list<OpRequestRef> ls;
+  for (map<ceph_tid_t, ProxyOpRef>::iterator p = proxy_ops.begin();
+       p != proxy_ops.end();
+       ++p) {
+    osd->objecter->op_cancel(p->first, -ECANCELED);
+    ls.push_back(p->second->op);
+  }
+  proxy_ops.clear();
+  proxy_writes.clear();
+  if (requeue) {
+    // the ops waiting for the proxied writes came in after them
+    for (map<hobject_t, list<OpRequestRef> >::iterator p =
+	   waiting_for_proxy_writes.begin();
+	 p != waiting_for_proxy_writes.end();
+	 ++p)
+      requeue_ops(p->second);
+    requeue_ops(ls);
+  }
+  waiting_for_proxy_writes.clear();
+}
+
 class PromoteCallback: public ReplicatedPG::CopyCallback {
   OpRequestRef op;
   ObjectContextRef obc;
@@ -1883,6 +2176,13 @@ void ReplicatedPG::execute_ctx(OpContext *ctx)
     return;
   }
 
+  if (result == -EIO && ctx->read_eio &&
+      repair_primary_object(ctx->obs->oi.soid, op)) {
+    // op was queued to retry once the object is recovered
+    close_op_ctx(ctx, -EAGAIN);
+    return;
+  }
+
   // check for full
   if (ctx->delta_stats.num_bytes > 0 &&
       pool.info.get_flags() & pg_pool_t::FLAG_FULL) {
@@ -2000,6 +2300,8 @@ void ReplicatedPG::log_op_stats(OpContext *ctx)
   osd->logger->inc(l_osd_op_inb, inb);
   osd->logger->tinc(l_osd_op_lat, latency);
   osd->logger->tinc(l_osd_op_process_lat, process_latency);
+  if (cct->_conf->osd_scrub_client_latency_threshold > 0)
+    osd->scrub_throttle.note_client_latency(now, latency);
 
   if (op->may_read() && op->may_write()) {
     osd->logger->inc(l_osd_op_rw);
@@ -2609,9 +2911,15 @@ ReplicatedPG::RepGather *ReplicatedPG::trim_object(const hobject_t &coid)
 
 void ReplicatedPG::snap_trimmer()
 {
-  if (g_conf->osd_snap_trim_sleep > 0) {
-    utime_t t;
+  utime_t t;
+  if (g_conf->osd_snap_trim_sleep > 0)
     t.set_from_double(g_conf->osd_snap_trim_sleep);
+  utime_t delay = osd->get_snap_trim_delay();
+  if (delay > t) {
+    osd->logger->inc(l_osd_snap_trim_throttled);
+    t = delay;
+  }
+  if (t > utime_t()) {
     t.sleep();
     lock();
     dout(20) << __func__ << " slept for " << t << dendl;
@@ -3166,12 +3474,15 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  dout(10) << " async_read noted for " << soid << dendl;
 	} else {
 	  int r = pgbackend->objects_read_sync(
-	    soid, op.extent.offset, op.extent.length, &osd_op.outdata);
+	    soid, op.extent.offset, op.extent.length, &osd_op.outdata,
+	    can_repair_primary_object(soid, oi.version));
 	  if (r >= 0)
 	    op.extent.length = r;
 	  else {
 	    result = r;
 	    op.extent.length = 0;
+	    if (r == -EIO)
+	      ctx->read_eio = true;
 	  }
 	  dout(10) << " read got " << r << " / " << op.extent.length
 		   << " bytes from obj " << soid << dendl;
@@ -3251,7 +3562,8 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
           bufferlist tmpbl;
 	  r = pgbackend->objects_read_sync(
-	    soid, miter->first, miter->second, &tmpbl);
+	    soid, miter->first, miter->second, &tmpbl,
+	    can_repair_primary_object(soid, oi.version));
           if (r < 0)
             break;
 
@@ -3280,6 +3592,8 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 
         if (r < 0) {
           result = r;
+	  if (r == -EIO)
+	    ctx->read_eio = true;
           break;
         }
 
@@ -3819,8 +4133,49 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  break;
 	}
 
+	// anything but a stripe aligned append is a read-modify-write
+	bool ec_overwrite = pool.info.allows_ec_overwrites() &&
+	  (op.extent.offset != oi.size ||
+	   op.extent.offset % pool.info.required_alignment() != 0);
+	vector<pair<uint64_t, uint64_t> > ec_stash;
+	if (ec_overwrite && t->get_bytes_written() > 0) {
+	  // the old stripes are read before any of this op is applied
+	  result = -EOPNOTSUPP;
+	  break;
+	}
+	if (ec_overwrite) {
+	  // shards that predate overwrites cannot apply ROLLBACK_EXTENTS
+	  for (set<pg_shard_t>::iterator p = actingbackfill.begin();
+	       p != actingbackfill.end();
+	       ++p) {
+	    if (!(get_osdmap()->get_xinfo(p->osd).features &
+		  CEPH_FEATURE_OSD_EC_OVERWRITES)) {
+	      dout(10) << " osd." << p->osd << " lacks ec overwrite support"
+		       << dendl;
+	      result = -EOPNOTSUPP;
+	      break;
+	    }
+	  }
+	  if (result < 0)
+	    break;
+	}
+
 	if (!obs.exists) {
 	  ctx->mod_desc.create();
+	} else if (ec_overwrite) {
+	  // stash the old contents of the stripes we touch
+	  uint64_t width = pool.info.required_alignment();
+	  uint64_t old_end = ROUND_UP_TO(oi.size, width);
+	  uint64_t start = op.extent.offset - (op.extent.offset % width);
+	  uint64_t end = MIN(
+	    ROUND_UP_TO(op.extent.offset + op.extent.length, width),
+	    old_end);
+	  if (op.extent.offset + op.extent.length > old_end)
+	    ctx->mod_desc.append(old_end);
+	  if (start < end) {
+	    ec_stash.push_back(make_pair(start, end - start));
+	    ctx->mod_desc.rollback_extents(ctx->at_version.version, ec_stash);
+	  }
 	} else if (op.extent.offset == oi.size) {
 	  ctx->mod_desc.append(oi.size);
 	} else {
@@ -3864,7 +4219,10 @@ int ReplicatedPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	result = check_offset_and_length(op.extent.offset, op.extent.length, cct->_conf->osd_max_object_size);
 	if (result < 0)
 	  break;
-	if (pool.info.require_rollback()) {
+	if (ec_overwrite) {
+	  t->overwrite(soid, op.extent.offset, op.extent.length, osd_op.indata,
+		       ctx->at_version.version, ec_stash);
+	} else if (pool.info.require_rollback()) {
 	  t->append(soid, op.extent.offset, op.extent.length, osd_op.indata);
 	} else {
 	  t->write(soid, op.extent.offset, op.extent.length, osd_op.indata);
@@ -5316,6 +5674,15 @@ int ReplicatedPG::prepare_transaction(OpContext *ctx)
     }
   }
 
+  // note what we wrote before make_writeable trims modified_ranges
+  if (pool.info.is_replicated() &&
+      soid.snap == CEPH_NOSNAP &&
+      ctx->new_obs.exists &&
+      OSDOp::have_known_extents(ctx->ops)) {
+    ctx->dirty_extents_valid = true;
+    ctx->dirty_extents = ctx->modified_ranges;
+  }
+
   // clone, if necessary
   if (soid.snap == CEPH_NOSNAP)
     make_writeable(ctx);
@@ -5489,6 +5856,10 @@ void ReplicatedPG::finish_ctx(OpContext *ctx, int log_op_type, bool maintain_ssc
   }
 
   ctx->log.back().mod_desc.claim(ctx->mod_desc);
+  if (ctx->dirty_extents_valid && log_op_type == pg_log_entry_t::MODIFY) {
+    ctx->log.back().dirty_extents_valid = true;
+    ctx->log.back().dirty_extents.swap(ctx->dirty_extents);
+  }
 
   // apply new object state.
   ctx->obc->obs = ctx->new_obs;
@@ -6949,6 +7320,8 @@ void ReplicatedPG::issue_repop(RepGather *repop, utime_t now)
           << dendl;
 
   repop->v = ctx->at_version;
+  if (ctx->at_version > projected_last_update)
+    projected_last_update = ctx->at_version;
   if (ctx->at_version > eversion_t()) {
     for (set<pg_shard_t>::iterator i = actingbackfill.begin();
 	 i != actingbackfill.end();
@@ -8017,6 +8390,70 @@ void ReplicatedBackend::calc_head_subsets(
 	   << "  clone_subsets " << clone_subsets << dendl;
 }
 
+/*
+ * If the peer already has an older version of a head object and every
+ * log entry since that version recorded the extents it wrote, we only
+ * need to push those extents (plus attrs) on top of the peer's copy.
+ * Only used when the result fits in a single push so the replica can
+ * apply it atomically.
+ */
+bool ReplicatedBackend::calc_partial_subsets(
+  ObjectContextRef obc, const hobject_t& head, pg_shard_t peer,
+  interval_set<uint64_t>& data_subset,
+  eversion_t *base_version)
+{
+  if (!cct->_conf->osd_recovery_partial_push)
+    return false;
+
+  const object_info_t& oi = obc->obs.oi;
+  if (oi.is_omap()) {
+    // omap is resent in full; leave that to a normal push
+    return false;
+  }
+
+  map<pg_shard_t, pg_missing_t>::const_iterator pm =
+    get_parent()->get_shard_missing().find(peer);
+  if (pm == get_parent()->get_shard_missing().end())
+    return false;
+  map<hobject_t, pg_missing_t::item>::const_iterator mi =
+    pm->second.missing.find(head);
+  if (mi == pm->second.missing.end() ||
+      mi->second.have == eversion_t())
+    return false;
+  const eversion_t have = mi->second.have;
+
+  ConnectionRef con = get_parent()->get_con_osd_cluster(
+    peer.osd, get_osdmap()->get_epoch());
+  if (!con || !con->has_feature(CEPH_FEATURE_OSD_PARTIAL_RECOVERY))
+    return false;
+
+  // walk the object's log entries back to the version the peer has
+  interval_set<uint64_t> dirty;
+  if (!get_parent()->get_log().get_log().get_dirty_extents(
+	head, have, oi.version, &dirty)) {
+    dout(20) << __func__ << " " << head << " log does not record the"
+	     << " extents written since " << have << dendl;
+    return false;
+  }
+
+  interval_set<uint64_t> subset;
+  if (oi.size) {
+    subset.insert(0, oi.size);
+    subset.intersection_of(dirty);
+  }
+  if ((uint64_t)subset.size() >= oi.size && oi.size > 0)
+    return false;
+  if ((uint64_t)subset.size() > cct->_conf->osd_recovery_max_chunk)
+    return false;
+
+  dout(10) << __func__ << " " << head << " v" << oi.version
+	   << " peer has " << have << ", pushing " << subset
+	   << " of " << oi.size << dendl;
+  data_subset.swap(subset);
+  *base_version = have;
+  return true;
+}
+
 void ReplicatedBackend::calc_clone_subsets(
   SnapSet& snapset, const hobject_t& soid,
   const pg_missing_t& missing,
@@ -8343,6 +8780,16 @@ void ReplicatedBackend::prep_push_to_replica(
 		       pi->second.last_backfill,
 		       data_subset, clone_subsets);
   } else if (soid.snap == CEPH_NOSNAP) {
+    // does the replica have an older copy we can patch?
+    eversion_t base_version;
+    if (calc_partial_subsets(obc, soid, peer, data_subset, &base_version)) {
+      get_parent()->get_logger()->inc(l_osd_push_partial);
+      get_parent()->get_logger()->inc(l_osd_push_partial_saved_bytes,
+				      size - data_subset.size());
+      return prep_push(obc, soid, peer, oi.version, data_subset,
+		       clone_subsets, pop, base_version);
+    }
+
     // pushing head or unversioned object.
     // base this on partially on replica's clones?
     SnapSetContext *ssc = obc->ssc;
@@ -8378,7 +8825,8 @@ void ReplicatedBackend::prep_push(
   eversion_t version,
   interval_set<uint64_t> &data_subset,
   map<hobject_t, interval_set<uint64_t> >& clone_subsets,
-  PushOp *pop)
+  PushOp *pop,
+  eversion_t base_version)
 {
   get_parent()->begin_peer_recover(peer, soid);
   // take note.
@@ -8387,6 +8835,7 @@ void ReplicatedBackend::prep_push(
   pi.recovery_info.size = obc->obs.oi.size;
   pi.recovery_info.copy_subset = data_subset;
   pi.recovery_info.clone_subset = clone_subsets;
+  pi.recovery_info.base_version = base_version;
   pi.recovery_info.soid = soid;
   pi.recovery_info.oi = obc->obs.oi;
   pi.recovery_info.version = version;
@@ -8440,6 +8889,30 @@ int ReplicatedBackend::send_pull_legacy(int prio, pg_shard_t peer,
   return 0;
 }
 
+/**
+ * check that our copy of the object is the version a partial push
+ * was computed against
+ */
+bool ReplicatedBackend::can_apply_partial_push(
+  const ObjectRecoveryInfo &recovery_info)
+{
+  bufferlist bv;
+  int r = store->getattr(coll, recovery_info.soid, OI_ATTR, bv);
+  if (r < 0) {
+    dout(0) << __func__ << ": " << recovery_info.soid
+	    << " has no object_info: " << cpp_strerror(r) << dendl;
+    return false;
+  }
+  object_info_t oi(bv);
+  if (oi.version != recovery_info.base_version) {
+    dout(0) << __func__ << ": " << recovery_info.soid << " is v"
+	    << oi.version << ", partial push is against v"
+	    << recovery_info.base_version << dendl;
+    return false;
+  }
+  return true;
+}
+
 void ReplicatedBackend::submit_push_data(
   ObjectRecoveryInfo &recovery_info,
   bool first,
@@ -8452,7 +8925,11 @@ void ReplicatedBackend::submit_push_data(
   ObjectStore::Transaction *t)
 {
   coll_t target_coll;
-  if (first && complete) {
+  if (recovery_info.is_partial()) {
+    // patch the copy we already have; see calc_partial_subsets()
+    assert(first && complete);
+    target_coll = coll;
+  } else if (first && complete) {
     target_coll = coll;
   } else {
     dout(10) << __func__ << ": Creating oid "
@@ -8461,7 +8938,16 @@ void ReplicatedBackend::submit_push_data(
     target_coll = get_temp_coll(t);
   }
 
-  if (first) {
+  if (first && recovery_info.is_partial()) {
+    // checked by can_apply_partial_push()
+    dout(10) << __func__ << ": patching " << recovery_info.soid
+	     << " v" << recovery_info.base_version
+	     << " to " << recovery_info.version << dendl;
+    t->truncate(coll, recovery_info.soid, recovery_info.size);
+    t->rmattrs(coll, recovery_info.soid);
+    t->omap_clear(coll, recovery_info.soid);
+    t->omap_setheader(coll, recovery_info.soid, omap_header);
+  } else if (first) {
     get_parent()->on_local_recover_start(recovery_info.soid, t);
     t->remove(get_temp_coll(t), recovery_info.soid);
     t->touch(target_coll, recovery_info.soid);
@@ -8646,6 +9132,12 @@ void ReplicatedBackend::handle_push(
     pop.after_progress.omap_complete;
 
   response->soid = pop.recovery_info.soid;
+  if (first && pop.recovery_info.is_partial() &&
+      !can_apply_partial_push(pop.recovery_info)) {
+    // leave our copy alone; the primary will push all of it
+    response->retry_full = true;
+    return;
+  }
   submit_push_data(pop.recovery_info,
 		   first,
 		   complete,
@@ -8927,6 +9419,14 @@ bool ReplicatedBackend::handle_push_reply(pg_shard_t peer, PushReplyOp &op, Push
   } else {
     PushInfo *pi = &pushing[soid][peer];
 
+    if (op.retry_full) {
+      dout(10) << " osd." << peer << " could not apply partial push of "
+	       << soid << ", pushing all of it" << dendl;
+      ObjectContextRef obc = pi->obc;
+      prep_push(obc, soid, peer, reply);
+      return true;
+    }
+
     if (!pi->recovery_progress.data_complete) {
       dout(10) << " pushing more from, "
 	       << pi->recovery_progress.data_recovered_to
@@ -9585,6 +10085,7 @@ void ReplicatedPG::on_shutdown()
   unreg_next_scrub();
   cancel_copy_ops(false);
   cancel_flush_ops(false);
+  cancel_proxy_ops(false);
   apply_and_flush_repops(false);
 
   pgbackend->on_change();
@@ -9663,6 +10164,9 @@ void ReplicatedPG::on_change(ObjectStore::Transaction *t)
   clear_scrub_reserved();
   scrub_clear_state();
 
+  // ops not yet handed to the log are dropped by the backend
+  projected_last_update = eversion_t();
+
   context_registry_on_change();
 
   for (list<pair<OpRequestRef, OpContext*> >::iterator i =
@@ -9675,6 +10179,7 @@ void ReplicatedPG::on_change(ObjectStore::Transaction *t)
 
   cancel_copy_ops(is_primary());
   cancel_flush_ops(is_primary());
+  cancel_proxy_ops(is_primary());
 
   // requeue object waiters
   if (is_primary()) {
@@ -9720,6 +10225,7 @@ void ReplicatedPG::on_change(ObjectStore::Transaction *t)
 
   debug_op_order.clear();
   unstable_stats.clear();
+  read_repaired.clear();
 }
 
 void ReplicatedPG::on_role_change()
@@ -9852,8 +10358,35 @@ void PG::MissingLoc::check_recovery_sources(const OSDMapRef osdmap)
 }
   
 
+/*
+ * ECBackend reads every object handed to it in one round with a
+ * single sub read per shard, so recovering a handful of small objects
+ * costs about as much as recovering one.  Let each slot granted by
+ * OSD::do_recovery cover several objects when the pg's objects are
+ * small on average.  The average only sizes the batch: the objects
+ * still count against osd_recovery_max_active, and the reads of a
+ * batch are bounded by osd_recovery_max_chunk per slot, at least one
+ * stripe per object (see ECBackend::get_batch_read_size).
+ */
+int ReplicatedPG::get_recovery_batch() const
+{
+  if (!pool.info.ec_pool())
+    return 1;
+  int max_batch = cct->_conf->osd_recovery_ec_max_batch;
+  const object_stat_sum_t &sum = info.stats.stats.sum;
+  if (max_batch <= 1 || sum.num_objects <= 0 || sum.num_bytes < 0)
+    return 1;
+  uint64_t avg = MAX(sum.num_bytes / sum.num_objects, (int64_t)1);
+  uint64_t batch = cct->_conf->osd_recovery_max_chunk / avg;
+  batch = MIN(batch, cct->_conf->osd_recovery_max_chunk /
+	      MAX((uint64_t)pool.info.get_stripe_width(), (uint64_t)1));
+  if (batch <= 1)
+    return 1;
+  return MIN(batch, (uint64_t)max_batch);
+}
+
 bool ReplicatedPG::start_recovery_ops(
-  int max, RecoveryCtx *prctx,
+  int max, int max_objects, RecoveryCtx *prctx,
   ThreadPool::TPHandle &handle,
   int *ops_started)
 {
@@ -9875,6 +10408,14 @@ bool ReplicatedPG::start_recovery_ops(
   int num_missing = missing.num_missing();
   int num_unfound = get_num_unfound();
 
+  // batched objects share the reads of the slots they were granted by
+  uint64_t max_bytes = 0;
+  if (max_objects > max) {
+    dout(10) << " batching " << max_objects << " objects in " << max
+	     << " recovery slots" << dendl;
+    max_bytes = max * cct->_conf->osd_recovery_max_chunk;
+  }
+
   if (num_missing == 0) {
     info.last_complete = info.last_update;
   }
@@ -9882,15 +10423,15 @@ bool ReplicatedPG::start_recovery_ops(
   if (num_missing == num_unfound) {
     // All of the missing objects we have are unfound.
     // Recover the replicas.
-    started = recover_replicas(max, handle);
+    started = recover_replicas(max_objects, max_bytes, handle);
   }
   if (!started) {
     // We still have missing objects that we should grab from replicas.
-    started += recover_primary(max, handle);
+    started += recover_primary(max_objects, max_bytes, handle);
   }
   if (!started && num_unfound != get_num_unfound()) {
     // second chance to recovery replicas
-    started = recover_replicas(max, handle);
+    started = recover_replicas(max_objects, max_bytes, handle);
   }
 
   if (started)
@@ -9996,7 +10537,8 @@ bool ReplicatedPG::start_recovery_ops(
  * do one recovery op.
  * return true if done, false if nothing left to do.
  */
-int ReplicatedPG::recover_primary(int max, ThreadPool::TPHandle &handle)
+int ReplicatedPG::recover_primary(int max, uint64_t max_bytes,
+				  ThreadPool::TPHandle &handle)
 {
   assert(is_primary());
 
@@ -10013,6 +10555,7 @@ int ReplicatedPG::recover_primary(int max, ThreadPool::TPHandle &handle)
   int skipped = 0;
 
   PGBackend::RecoveryHandle *h = pgbackend->open_recovery_op();
+  h->max_bytes = max_bytes;
   map<version_t, hobject_t>::const_iterator p =
     missing.rmissing.lower_bound(pg_log.get_log().last_requested);
   while (p != missing.rmissing.end()) {
@@ -10239,12 +10782,14 @@ int ReplicatedBackend::start_pushes(
   return pushes;
 }
 
-int ReplicatedPG::recover_replicas(int max, ThreadPool::TPHandle &handle)
+int ReplicatedPG::recover_replicas(int max, uint64_t max_bytes,
+				   ThreadPool::TPHandle &handle)
 {
   dout(10) << __func__ << "(" << max << ")" << dendl;
   int started = 0;
 
   PGBackend::RecoveryHandle *h = pgbackend->open_recovery_op();
+  h->max_bytes = max_bytes;
 
   // this is FAR from an optimal recovery order.  pretty lame, really.
   assert(actingbackfill.size() > 0);
@@ -11086,7 +11631,8 @@ void ReplicatedPG::hit_set_persist()
     info.hit_set.current_info.begin = hit_set_start_stamp;
 
   hit_set->seal();
-  ::encode(*hit_set, bl);
+  // any up osd may become primary and load this archive
+  ::encode(*hit_set, bl, get_osdmap()->get_up_osd_features());
   info.hit_set.current_info.end = now;
   dout(20) << __func__ << " archive " << oid << dendl;
 
@@ -11239,14 +11785,21 @@ void ReplicatedPG::hit_set_trim(RepGather *repop, unsigned max)
   }
 }
 
-void ReplicatedPG::hit_set_in_memory_trim()
+unsigned ReplicatedPG::hit_set_in_memory_max() const
 {
-  unsigned max = pool.info.hit_set_count;
-  unsigned max_in_memory = pool.info.min_read_recency_for_promote > 0 ? pool.info.min_read_recency_for_promote - 1 : 0;
+  // promotion needs the last recency - 1 archived HitSets; the agent
+  // grades temperature from as many as we are willing to cache, so
+  // that it does not read them back from the store on every pass.
+  unsigned recency = MAX(pool.info.min_read_recency_for_promote,
+			 pool.info.min_write_recency_for_promote);
+  unsigned max_in_memory = MAX(recency > 0 ? recency - 1 : 0,
+			       (unsigned)g_conf->osd_hit_set_archive_cache_size);
+  return MIN(max_in_memory, pool.info.hit_set_count);
+}
 
-  if (max_in_memory > max) {
-    max_in_memory = max;
-  }
+void ReplicatedPG::hit_set_in_memory_trim()
+{
+  unsigned max_in_memory = hit_set_in_memory_max();
   while (agent_state->hit_set_map.size() > max_in_memory) {
     agent_state->remove_oldest_hit_set();
   }
@@ -11396,12 +11949,36 @@ bool ReplicatedPG::agent_work(int start_max)
       continue;
     }
 
+    // where does this object fall among those we have seen?  without
+    // HitSets we cannot tell, so treat everything as cold.
+    int temp = 0;
+    uint64_t temp_lower = 0, temp_upper = 0;
+    if (hit_set) {
+      temp = agent_estimate_temp(obc->obs.oi.soid);
+      agent_state->temp_hist.add(temp);
+      agent_state->temp_hist.get_position_micro(temp, &temp_lower,
+						&temp_upper);
+      dout(20) << __func__ << " " << obc->obs.oi.soid
+	       << " temp " << temp
+	       << " pos " << temp_lower << "-" << temp_upper
+	       << ", flush_effort " << agent_state->flush_effort
+	       << ", evict_effort " << agent_state->evict_effort
+	       << dendl;
+    }
+
+    const char *action = "skip";
     if (agent_state->flush_mode != TierAgentState::FLUSH_MODE_IDLE &&
-	agent_maybe_flush(obc))
+	agent_maybe_flush(obc, temp_lower)) {
       ++started;
+      action = "flush";
+    }
     if (agent_state->evict_mode != TierAgentState::EVICT_MODE_IDLE &&
-	agent_maybe_evict(obc))
+	agent_maybe_evict(obc, temp_lower)) {
       ++started;
+      action = "evict";
+    }
+    agent_state->note_decision(obc->obs.oi.soid, temp, temp_lower, temp_upper,
+			       action);
     if (started >= start_max) {
       // If finishing early, set "next" to the next object
       if (++p != ls.end())
@@ -11411,9 +11988,8 @@ bool ReplicatedPG::agent_work(int start_max)
   }
 
   if (++agent_state->hist_age > g_conf->osd_agent_hist_halflife) {
-    dout(20) << __func__ << " resetting atime and temp histograms" << dendl;
+    dout(20) << __func__ << " decaying temp histogram" << dendl;
     agent_state->hist_age = 0;
-    agent_state->atime_hist.decay();
     agent_state->temp_hist.decay();
   }
 
@@ -11460,14 +12036,21 @@ bool ReplicatedPG::agent_work(int start_max)
 
 void ReplicatedPG::agent_load_hit_sets()
 {
-  if (agent_state->evict_mode == TierAgentState::EVICT_MODE_IDLE) {
+  if (agent_state->is_idle()) {
     return;
   }
 
-  if (agent_state->hit_set_map.size() < info.hit_set.history.size()) {
+  unsigned max = MIN(hit_set_in_memory_max(),
+		     info.hit_set.history.size());
+  if (agent_state->hit_set_map.size() < max) {
     dout(10) << __func__ << dendl;
-    for (list<pg_hit_set_info_t>::iterator p = info.hit_set.history.begin();
-	 p != info.hit_set.history.end(); ++p) {
+    // newest first; anything older than what we keep in memory would
+    // only be trimmed again at the end of this pass.
+    unsigned n = 0;
+    for (list<pg_hit_set_info_t>::reverse_iterator p =
+	   info.hit_set.history.rbegin();
+	 p != info.hit_set.history.rend() && n < max;
+	 ++p, ++n) {
       if (agent_state->hit_set_map.count(p->begin.sec()) == 0) {
 	dout(10) << __func__ << " loading " << p->begin << "-"
 		 << p->end << dendl;
@@ -11522,7 +12105,8 @@ struct C_AgentFlushStartStop : public Context {
   }
 };
 
-bool ReplicatedPG::agent_maybe_flush(ObjectContextRef& obc)
+bool ReplicatedPG::agent_maybe_flush(ObjectContextRef& obc,
+				     uint64_t temp_lower)
 {
   if (!obc->obs.oi.is_dirty()) {
     dout(20) << __func__ << " skip (clean) " << obc->obs.oi << dendl;
@@ -11549,10 +12133,16 @@ bool ReplicatedPG::agent_maybe_flush(ObjectContextRef& obc)
     return false;
   }
 
-  dout(10) << __func__ << " flushing " << obc->obs.oi << dendl;
+  // flush the coldest flush_effort fraction of what we see, so that
+  // the flush rate follows how far we are over the dirty target.
+  if (temp_lower >= agent_state->flush_effort) {
+    dout(20) << __func__ << " skip (warm) " << obc->obs.oi << dendl;
+    osd->logger->inc(l_osd_agent_skip);
+    ++agent_state->num_skip_warm;
+    return false;
+  }
 
-  // FIXME: flush anything dirty, regardless of what distribution of
-  // ages we expect.
+  dout(10) << __func__ << " flushing " << obc->obs.oi << dendl;
 
   Context *on_flush = new C_AgentFlushStartStop(this, obc->obs.oi.soid);
   int result = start_flush(
@@ -11567,10 +12157,12 @@ bool ReplicatedPG::agent_maybe_flush(ObjectContextRef& obc)
   }
 
   osd->logger->inc(l_osd_agent_flush);
+  ++agent_state->num_flush;
   return true;
 }
 
-bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
+bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc,
+				     uint64_t temp_lower)
 {
   const hobject_t& soid = obc->obs.oi.soid;
   if (obc->obs.oi.is_dirty()) {
@@ -11590,51 +12182,13 @@ bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
     }
   }
 
+  // evict the coldest evict_effort fraction of what we see, unless
+  // we are full and need to evict anything we can.
   if (agent_state->evict_mode != TierAgentState::EVICT_MODE_FULL &&
-      hit_set) {
-    // is this object old and/or cold enough?
-    int atime = -1, temp = 0;
-    agent_estimate_atime_temp(soid, &atime, NULL /*FIXME &temp*/);
-
-    uint64_t atime_upper = 0, atime_lower = 0;
-    if (atime < 0 && obc->obs.oi.mtime != utime_t())
-      atime = ceph_clock_now(NULL).sec() - obc->obs.oi.mtime;
-    if (atime < 0)
-      atime = pool.info.hit_set_period * pool.info.hit_set_count; // "infinite"
-    if (atime >= 0) {
-      agent_state->atime_hist.add(atime);
-      agent_state->atime_hist.get_position_micro(atime, &atime_lower,
-						 &atime_upper);
-    }
-
-    unsigned temp_upper = 0, temp_lower = 0;
-    /*
-    // FIXME: bound atime based on creation time?
-    agent_state->temp_hist.add(atime);
-    agent_state->temp_hist.get_position_micro(temp, &temp_lower, &temp_upper);
-    */
-
-    dout(20) << __func__
-	     << " atime " << atime
-	     << " pos " << atime_lower << "-" << atime_upper
-	     << ", temp " << temp
-	     << " pos " << temp_lower << "-" << temp_upper
-	     << ", evict_effort " << agent_state->evict_effort
-	     << dendl;
-    dout(30) << "agent_state:\n";
-    Formatter *f = new_formatter("");
-    f->open_object_section("agent_state");
-    agent_state->dump(f);
-    f->close_section();
-    f->flush(*_dout);
-    delete f;
-    *_dout << dendl;
-
-    // FIXME: ignore temperature for now.
-
-    // KISS: if [lower,upper] spans our target effort, evict it.
-    if (atime_lower >= agent_state->evict_effort)
-      return false;
+      temp_lower >= agent_state->evict_effort) {
+    dout(20) << __func__ << " skip (warm) " << obc->obs.oi << dendl;
+    ++agent_state->num_skip_warm;
+    return false;
   }
 
   dout(10) << __func__ << " evicting " << obc->obs.oi << dendl;
@@ -11650,6 +12204,7 @@ bool ReplicatedPG::agent_maybe_evict(ObjectContextRef& obc)
   simple_repop_submit(repop);
   osd->logger->inc(l_osd_tier_evict);
   osd->logger->inc(l_osd_agent_evict);
+  ++agent_state->num_evict;
   return true;
 }
 
@@ -11659,7 +12214,7 @@ void ReplicatedPG::agent_stop()
   if (agent_state && !agent_state->is_idle()) {
     agent_state->evict_mode = TierAgentState::EVICT_MODE_IDLE;
     agent_state->flush_mode = TierAgentState::FLUSH_MODE_IDLE;
-    osd->agent_disable_pg(this, agent_state->evict_effort);
+    osd->agent_disable_pg(this, agent_state->get_priority());
   }
 }
 
@@ -11669,7 +12224,7 @@ void ReplicatedPG::agent_delay()
   if (agent_state && !agent_state->is_idle()) {
     assert(agent_state->delaying == false);
     agent_state->delaying = true;
-    osd->agent_disable_pg(this, agent_state->evict_effort);
+    osd->agent_disable_pg(this, agent_state->get_priority());
   }
 }
 
@@ -11684,6 +12239,18 @@ void ReplicatedPG::agent_choose_mode_restart()
   unlock();
 }
 
+// quantize effort to avoid too much reordering in the agent_queue.
+static unsigned agent_quantize_effort(uint64_t effort)
+{
+  uint64_t inc = g_conf->osd_agent_quantize_effort * 1000000;
+  assert(inc > 0);
+  effort -= effort % inc;
+  if (effort < inc)
+    effort = inc;
+  assert(effort >= inc && effort <= 1000000);
+  return effort;
+}
+
 void ReplicatedPG::agent_choose_mode(bool restart)
 {
   // Let delay play out
@@ -11769,6 +12336,7 @@ void ReplicatedPG::agent_choose_mode(bool restart)
 
   // flush mode
   TierAgentState::flush_mode_t flush_mode = TierAgentState::FLUSH_MODE_IDLE;
+  unsigned flush_effort = 0;
   uint64_t flush_target = pool.info.cache_target_dirty_ratio_micro;
   uint64_t flush_slop = (float)flush_target * g_conf->osd_agent_slop;
   if (restart || agent_state->flush_mode == TierAgentState::FLUSH_MODE_IDLE)
@@ -11781,6 +12349,20 @@ void ReplicatedPG::agent_choose_mode(bool restart)
     dout(20) << __func__ << " stats invalid (post-split), idle" << dendl;
   } else if (dirty_micro > flush_target) {
     flush_mode = TierAgentState::FLUSH_MODE_ACTIVE;
+    // scale effort with how far we are between the dirty target and
+    // the full target, so that flushes start slowly and ramp up
+    // instead of coming in bursts.
+    uint64_t over = dirty_micro - flush_target;
+    uint64_t full_target = pool.info.cache_target_full_ratio_micro;
+    uint64_t span;
+    if (full_target > flush_target)
+      span = full_target - flush_target;
+    else
+      span = 1;
+    flush_effort = MIN(over * 1000000 / span, 1000000);
+    flush_effort = MAX(flush_effort,
+		       (unsigned)(1000000.0 * g_conf->osd_agent_min_flush_effort));
+    flush_effort = agent_quantize_effort(flush_effort);
   }
 
   // evict mode
@@ -11796,9 +12378,11 @@ void ReplicatedPG::agent_choose_mode(bool restart)
   if (info.stats.stats_invalid) {
     // idle; stats can't be trusted until we scrub.
   } else if (full_micro > 1000000) {
-    // evict anything clean
+    // evict anything clean, and flush anything dirty so we can evict it
     evict_mode = TierAgentState::EVICT_MODE_FULL;
     evict_effort = 1000000;
+    if (flush_mode != TierAgentState::FLUSH_MODE_IDLE)
+      flush_effort = 1000000;
   } else if (full_micro > evict_target) {
     // set effort in [0..1] range based on where we are between
     evict_mode = TierAgentState::EVICT_MODE_SOME;
@@ -11810,16 +12394,7 @@ void ReplicatedPG::agent_choose_mode(bool restart)
       span = 1000000 - evict_target;
     evict_effort = MAX(over * 1000000 / span,
 		       (unsigned)(1000000.0 * g_conf->osd_agent_min_evict_effort));
-
-    // quantize effort to avoid too much reordering in the agent_queue.
-    uint64_t inc = g_conf->osd_agent_quantize_effort * 1000000;
-    assert(inc > 0);
-    uint64_t was = evict_effort;
-    evict_effort -= evict_effort % inc;
-    if (evict_effort < inc)
-      evict_effort = inc;
-    assert(evict_effort >= inc && evict_effort <= 1000000);
-    dout(30) << __func__ << " evict_effort " << was << " quantized by " << inc << " to " << evict_effort << dendl;
+    evict_effort = agent_quantize_effort(evict_effort);
   }
 
   bool old_idle = agent_state->is_idle();
@@ -11844,7 +12419,15 @@ void ReplicatedPG::agent_choose_mode(bool restart)
     }
     agent_state->evict_mode = evict_mode;
   }
-  uint64_t old_effort = agent_state->evict_effort;
+  uint64_t old_priority = agent_state->get_priority();
+  if (flush_effort != agent_state->flush_effort) {
+    dout(5) << __func__ << " flush_effort "
+	    << ((float)agent_state->flush_effort / 1000000.0)
+	    << " -> "
+	    << ((float)flush_effort / 1000000.0)
+	    << dendl;
+    agent_state->flush_effort = flush_effort;
+  }
   if (evict_effort != agent_state->evict_effort) {
     dout(5) << __func__ << " evict_effort "
 	    << ((float)agent_state->evict_effort / 1000000.0)
@@ -11854,49 +12437,50 @@ void ReplicatedPG::agent_choose_mode(bool restart)
     agent_state->evict_effort = evict_effort;
   }
 
-  // NOTE: we are using evict_effort as a proxy for *all* agent effort
-  // (including flush).  This is probably fine (they should be
-  // correlated) but it is not precisely correct.
+  // queue by whichever of flush and evict needs the most effort
   if (agent_state->is_idle()) {
     if (!restart && !old_idle) {
-      osd->agent_disable_pg(this, old_effort);
+      osd->agent_disable_pg(this, old_priority);
     }
   } else {
     if (restart || old_idle) {
-      osd->agent_enable_pg(this, agent_state->evict_effort);
-    } else if (old_effort != agent_state->evict_effort) {
-      osd->agent_adjust_pg(this, old_effort, agent_state->evict_effort);
+      osd->agent_enable_pg(this, agent_state->get_priority());
+    } else if (old_priority != agent_state->get_priority()) {
+      osd->agent_adjust_pg(this, old_priority, agent_state->get_priority());
     }
   }
 }
 
-void ReplicatedPG::agent_estimate_atime_temp(const hobject_t& oid,
-					     int *atime, int *temp)
+void ReplicatedPG::agent_dump(Formatter *f)
+{
+  if (!agent_state)
+    return;
+  f->open_object_section("pg");
+  f->dump_stream("pgid") << info.pgid;
+  agent_state->dump(f);
+  f->close_section();
+}
+
+int ReplicatedPG::agent_estimate_temp(const hobject_t& oid)
 {
   assert(hit_set);
-  *atime = -1;
-  if (temp)
-    *temp = 0;
-  if (hit_set->contains(oid)) {
-    *atime = 0;
-    if (temp)
-      ++(*temp);
-    else
-      return;
-  }
-  time_t now = ceph_clock_now(NULL).sec();
-  for (map<time_t,HitSetRef>::iterator p = agent_state->hit_set_map.begin();
-       p != agent_state->hit_set_map.end();
+  unsigned decay = MIN(pool.info.hit_set_grade_decay_rate, 100u);
+  int grade = 1000000;
+  int temp = 0;
+  if (hit_set->contains(oid))
+    temp += grade;
+  // newest first
+  for (map<time_t,HitSetRef>::reverse_iterator p =
+	 agent_state->hit_set_map.rbegin();
+       p != agent_state->hit_set_map.rend();
        ++p) {
-    if (p->second->contains(oid)) {
-      if (*atime < 0)
-	*atime = now - p->first;
-      if (temp)
-	++(*temp);
-      else
-	return;
-    }
+    grade = (int64_t)grade * (100 - decay) / 100;
+    if (grade == 0)
+      break;
+    if (p->second->contains(oid))
+      temp += grade;
   }
+  return temp;
 }
 
 
@@ -12285,32 +12869,61 @@ boost::statechart::result ReplicatedPG::TrimmingObjects::react(const SnapTrim&)
 
   dout(10) << "TrimmingObjects: trimming snap " << snap_to_trim << dendl;
 
-  // Get next
-  hobject_t old_pos = pos;
-  int r = pg->snap_mapper.get_next_object_to_trim(snap_to_trim, &pos);
-  if (r != 0 && r != -ENOENT) {
-    derr << __func__ << ": get_next returned " << cpp_strerror(r) << dendl;
-    assert(0);
-  } else if (r == -ENOENT) {
-    // Done!
-    dout(10) << "TrimmingObjects: got ENOENT" << dendl;
-    post_event(SnapTrim());
-    return transit< WaitingOnReplicas >();
+  // forget trims that have already been applied
+  for (set<RepGather *>::iterator i = repops.begin();
+       i != repops.end(); ) {
+    if ((*i)->all_applied) {
+      (*i)->put();
+      repops.erase(i++);
+    } else {
+      ++i;
+    }
   }
 
-  dout(10) << "TrimmingObjects react trimming " << pos << dendl;
-  RepGather *repop = pg->trim_object(pos);
-  if (!repop) {
-    dout(10) << __func__ << " could not get write lock on obj "
-	     << pos << dendl;
-    pos = old_pos;
-    return discard_event();
+  // keep up to osd_pg_max_concurrent_snap_trims trims in flight
+  unsigned max = MAX(pg->cct->_conf->osd_pg_max_concurrent_snap_trims, 1);
+  unsigned trimmed = 0;
+  bool done = false;
+  while (repops.size() < max) {
+    // Get next
+    hobject_t old_pos = pos;
+    int r = pg->snap_mapper.get_next_object_to_trim(snap_to_trim, &pos);
+    if (r != 0 && r != -ENOENT) {
+      derr << __func__ << ": get_next returned " << cpp_strerror(r) << dendl;
+      assert(0);
+    } else if (r == -ENOENT) {
+      // Done!
+      dout(10) << "TrimmingObjects: got ENOENT" << dendl;
+      done = true;
+      break;
+    }
+
+    dout(10) << "TrimmingObjects react trimming " << pos << dendl;
+    RepGather *repop = pg->trim_object(pos);
+    if (!repop) {
+      dout(10) << __func__ << " could not get write lock on obj "
+	       << pos << dendl;
+      pos = old_pos;
+      break;
+    }
+    repop->queue_snap_trimmer = true;
+
+    repops.insert(repop->get());
+    pg->simple_repop_submit(repop);
+    ++trimmed;
   }
-  assert(repop);
-  repop->queue_snap_trimmer = true;
 
-  repops.insert(repop->get());
-  pg->simple_repop_submit(repop);
+  if (trimmed) {
+    pg->osd->take_snap_trim(trimmed);
+    pg->osd->logger->inc(l_osd_snap_trim, trimmed);
+  }
+  if (done) {
+    post_event(SnapTrim());
+    return transit< WaitingOnReplicas >();
+  }
+  // each trim requeues us as it completes, so there is no need to spin
+  // while we are at the limit
+  context<SnapTrimmer>().requeue = repops.size() < max;
   return discard_event();
 }
 /* WaitingOnReplicasObjects */
@@ -12357,6 +12970,7 @@ boost::statechart::result ReplicatedPG::WaitingOnReplicas::react(const SnapTrim&
 
   pg->info.purged_snaps.insert(sn);
   pg->snap_trimq.erase(sn);
+  pg->publish_snap_trimq_len();
   dout(10) << "purged_snaps now " << pg->info.purged_snaps << ", snap_trimq now " 
 	   << pg->snap_trimq << dendl;
   
@@ -197,6 +197,22 @@ public:
   friend class CopyFromCallback;
   friend class PromoteCallback;
 
+  /// a client op sent on to the base tier on a cache miss
+  struct ProxyOp {
+    OpRequestRef op;
+    hobject_t soid;            ///< head object
+    bool write;
+    vector<OSDOp> ops;         ///< receives the base tier results
+    version_t user_version;
+    ceph_tid_t objecter_tid;
+
+    ProxyOp(OpRequestRef _op, const hobject_t& oid, bool w,
+	    const vector<OSDOp>& _ops)
+      : op(_op), soid(oid), write(w), ops(_ops),
+	user_version(0), objecter_tid(0) {}
+  };
+  typedef boost::shared_ptr<ProxyOp> ProxyOpRef;
+
   struct FlushOp {
     ObjectContextRef obc;       ///< obc we are flushing
     OpRequestRef op;            ///< initiating op
@@ -415,6 +431,13 @@ public:
 
   PerfCounters *get_logger();
 
+  void note_peer_read_latency(int peer, utime_t lat) {
+    osd->note_peer_read_latency(peer, lat);
+  }
+  double get_peer_read_latency(int peer) {
+    return osd->get_peer_read_latency(peer);
+  }
+
   ceph_tid_t get_tid() { return osd->get_tid(); }
 
   LogClientTemp clog_error() { return osd->clog.error(); }
@@ -466,6 +489,8 @@ public:
     boost::optional<pg_hit_set_history_t> updated_hset_history;
 
     interval_set<uint64_t> modified_ranges;
+    bool dirty_extents_valid;       ///< dirty_extents covers every data change
+    interval_set<uint64_t> dirty_extents;  ///< recorded in the log entry
     ObjectContextRef obc;
     map<hobject_t,ObjectContextRef> src_obc;
     ObjectContextRef clone_obc;    // if we created a clone
@@ -480,6 +505,7 @@ public:
 
     int num_read;    ///< count read ops
     int num_write;   ///< count update ops
+    bool read_eio;   ///< a data read failed with EIO
 
     CopyFromCallback *copy_cb;
 
@@ -543,9 +569,11 @@ public:
       bytes_written(0), bytes_read(0), user_at_version(0),
       current_osd_subop_num(0),
       op_t(NULL),
+      dirty_extents_valid(false),
       data_off(0), reply(NULL), pg(_pg),
       num_read(0),
       num_write(0),
+      read_eio(false),
       copy_cb(NULL),
       async_read_result(0),
       inflightreads(0),
@@ -801,6 +829,7 @@ protected:
   void hit_set_persist();   ///< persist hit info
   bool hit_set_apply_log(); ///< apply log entries to update in-memory HitSet
   void hit_set_trim(RepGather *repop, unsigned max); ///< discard old HitSets
+  unsigned hit_set_in_memory_max() const;             ///< archived HitSets to keep decoded
   void hit_set_in_memory_trim();                     ///< discard old in memory HitSets
 
   hobject_t get_hit_set_current_object(utime_t stamp);
@@ -814,18 +843,22 @@ protected:
 
   void agent_setup();       ///< initialize agent state
   bool agent_work(int max); ///< entry point to do some agent work
-  bool agent_maybe_flush(ObjectContextRef& obc);  ///< maybe flush
-  bool agent_maybe_evict(ObjectContextRef& obc);  ///< maybe evict
+  /// maybe flush; temp_lower is the object's position in temp_hist
+  bool agent_maybe_flush(ObjectContextRef& obc, uint64_t temp_lower);
+  /// maybe evict; temp_lower is the object's position in temp_hist
+  bool agent_maybe_evict(ObjectContextRef& obc, uint64_t temp_lower);
 
   void agent_load_hit_sets();  ///< load HitSets, if needed
 
-  /// estimate object atime and temperature
+  /// estimate object temperature
+  ///
+  /// Each HitSet the object appears in adds its grade: 1000000 for the
+  /// current HitSet, less hit_set_grade_decay_rate percent for each
+  /// older one.
   ///
   /// @param oid [in] object name
-  /// @param atime [out] seconds since last access (lower bound)
-  /// @param temperature [out] relative temperature (# hitset bins we appear in)
-  void agent_estimate_atime_temp(const hobject_t& oid,
-				 int *atime, int *temperature);
+  /// @return relative temperature, 0 if not seen in any HitSet
+  int agent_estimate_temp(const hobject_t& oid);
 
   /// stop the agent
   void agent_stop();
@@ -836,6 +869,7 @@ protected:
 
   void agent_choose_mode(bool restart = false);  ///< choose (new) agent mode(s)
   void agent_choose_mode_restart();
+  void agent_dump(Formatter *f);
 
   /// true if we can send an ondisk/commit for v
   bool already_complete(eversion_t v) {
@@ -1072,6 +1106,12 @@ protected:
    * Check if the op is such that we can skip promote (e.g., DELETE)
    */
   bool can_skip_promote(OpRequestRef op, ObjectContextRef obc);
+  /**
+   * Check if oid is in the current or one of the last recency - 1
+   * HitSets; always true for a recency of 0
+   */
+  bool is_hit_set_recent(const hobject_t& oid, bool in_hit_set,
+			 unsigned recency);
 
   int prepare_transaction(OpContext *ctx);
   list<pair<OpRequestRef, OpContext*> > in_progress_async_reads;
@@ -1084,11 +1124,14 @@ protected:
 
   void queue_for_recovery();
   bool start_recovery_ops(
-    int max, RecoveryCtx *prctx,
+    int max, int max_objects, RecoveryCtx *prctx,
     ThreadPool::TPHandle &handle, int *started);
+  int get_recovery_batch() const;
 
-  int recover_primary(int max, ThreadPool::TPHandle &handle);
-  int recover_replicas(int max, ThreadPool::TPHandle &handle);
+  int recover_primary(int max, uint64_t max_bytes,
+		      ThreadPool::TPHandle &handle);
+  int recover_replicas(int max, uint64_t max_bytes,
+		       ThreadPool::TPHandle &handle);
   hobject_t earliest_peer_backfill() const;
   bool all_peer_done() const;
   /**
@@ -1247,6 +1290,26 @@ protected:
 
   friend struct C_Flush;
 
+  // -- proxy --
+  map<ceph_tid_t, ProxyOpRef> proxy_ops;
+  /// proxied writes in flight per head object
+  map<hobject_t, unsigned> proxy_writes;
+  /// ops handled locally that must be ordered after the proxied writes
+  map<hobject_t, list<OpRequestRef> > waiting_for_proxy_writes;
+
+  /**
+   * Check that replaying the write ops of op has the same effect as
+   * applying them once.  The base tier cannot tell a proxied write
+   * resent after a cache tier interval change from a new one.
+   */
+  bool can_proxy_write(OpRequestRef op);
+  /// send op to the base tier on behalf of the client
+  void do_proxy_op(OpRequestRef op, bool write);
+  void finish_proxy_op(hobject_t oid, ceph_tid_t tid, int r);
+  void cancel_proxy_ops(bool requeue);
+
+  friend struct C_ProxyOp;
+
   // -- scrub --
   virtual bool _range_available_for_scrub(
     const hobject_t &begin, const hobject_t &end);
@@ -1387,6 +1450,12 @@ public:
   void wait_for_unreadable_object(const hobject_t& oid, OpRequestRef op);
   void wait_for_all_missing(OpRequestRef op);
 
+  /// oid -> version we last recovered because a read returned EIO
+  map<hobject_t, eversion_t> read_repaired;
+  void get_repair_sources(const hobject_t& oid, set<pg_shard_t> *good);
+  bool can_repair_primary_object(const hobject_t& oid, eversion_t v);
+  bool repair_primary_object(const hobject_t& oid, OpRequestRef op);
+
   bool is_degraded_object(const hobject_t& oid);
   void wait_for_degraded_object(const hobject_t& oid, OpRequestRef op);
 
@@ -0,0 +1,159 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "ScrubThrottle.h"
+#include "common/Formatter.h"
+
+ScrubThrottle::ScrubThrottle()
+  : lock("ScrubThrottle::lock"),
+    latency_threshold(0), latency_percentile(95), latency_window(10),
+    total_bytes(0), total_ops(0),
+    num_throttled(0), num_latency_paused(0)
+{
+}
+
+void ScrubThrottle::set_limits(uint64_t bytes_per_sec, uint64_t ops_per_sec)
+{
+  Mutex::Locker l(lock);
+  // never carry a debt incurred at a lower rate
+  bytes.set_rate(bytes_per_sec);
+  ops.set_rate(ops_per_sec);
+}
+
+void ScrubThrottle::set_latency_limit(double threshold, double percentile,
+				      double window)
+{
+  Mutex::Locker l(lock);
+  latency_threshold = threshold;
+  latency_percentile = std::max(0.0, std::min(100.0, percentile));
+  latency_window = window;
+  if (latency_threshold <= 0)
+    latency_samples.clear();
+}
+
+void ScrubThrottle::take(utime_t now, uint64_t b, uint64_t o)
+{
+  Mutex::Locker l(lock);
+  total_bytes += b;
+  total_ops += o;
+  bytes.take(now, b);
+  ops.take(now, o);
+}
+
+void ScrubThrottle::_trim_latency(utime_t now)
+{
+  utime_t cutoff = now;
+  cutoff -= latency_window;
+  while (!latency_samples.empty() &&
+	 (latency_samples.front().first < cutoff ||
+	  latency_samples.size() > MAX_LATENCY_SAMPLES))
+    latency_samples.pop_front();
+}
+
+double ScrubThrottle::_get_client_latency() const
+{
+  if (latency_samples.size() < MIN_LATENCY_SAMPLES)
+    return 0;
+  std::vector<double> v;
+  v.reserve(latency_samples.size());
+  for (std::deque<std::pair<utime_t, double> >::const_iterator p =
+	 latency_samples.begin();
+       p != latency_samples.end();
+       ++p)
+    v.push_back(p->second);
+  size_t n = (size_t)((v.size() - 1) * latency_percentile / 100.0);
+  std::nth_element(v.begin(), v.begin() + n, v.end());
+  return v[n];
+}
+
+utime_t ScrubThrottle::_get_delay(utime_t now, bool *latency_paused)
+{
+  *latency_paused = false;
+
+  if (latency_threshold > 0) {
+    _trim_latency(now);
+    if (_get_client_latency() > latency_threshold) {
+      *latency_paused = true;
+      // the oldest sample is the first that can age out and change our mind
+      utime_t expire = latency_samples.front().first;
+      expire += latency_window;
+      return expire > now ? expire - now : utime_t();
+    }
+  }
+
+  double delay = std::max(bytes.get_delay(now), ops.get_delay(now));
+  if (delay <= 0)
+    return utime_t();
+  utime_t t;
+  t.set_from_double(delay);
+  return t;
+}
+
+utime_t ScrubThrottle::get_delay(utime_t now, bool *latency_paused)
+{
+  Mutex::Locker l(lock);
+  bool paused;
+  utime_t t = _get_delay(now, &paused);
+  if (paused)
+    ++num_latency_paused;
+  else if (t != utime_t())
+    ++num_throttled;
+  if (latency_paused)
+    *latency_paused = paused;
+  return t;
+}
+
+utime_t ScrubThrottle::peek_delay(utime_t now)
+{
+  Mutex::Locker l(lock);
+  bool paused;
+  return _get_delay(now, &paused);
+}
+
+void ScrubThrottle::note_client_latency(utime_t now, utime_t latency)
+{
+  Mutex::Locker l(lock);
+  if (latency_threshold <= 0)
+    return;
+  latency_samples.push_back(std::make_pair(now, (double)latency));
+  _trim_latency(now);
+}
+
+double ScrubThrottle::get_client_latency(utime_t now)
+{
+  Mutex::Locker l(lock);
+  _trim_latency(now);
+  return _get_client_latency();
+}
+
+void ScrubThrottle::dump(Formatter *f, utime_t now)
+{
+  Mutex::Locker l(lock);
+  bytes.refill(now);
+  ops.refill(now);
+  _trim_latency(now);
+  f->dump_float("max_bytes_per_sec", bytes.get_rate());
+  f->dump_float("max_ops_per_sec", ops.get_rate());
+  f->dump_float("bytes_avail", bytes.get_avail());
+  f->dump_float("ops_avail", ops.get_avail());
+  f->dump_unsigned("total_bytes", total_bytes);
+  f->dump_unsigned("total_ops", total_ops);
+  f->dump_unsigned("num_throttled", num_throttled);
+  f->dump_float("client_latency_threshold", latency_threshold);
+  f->dump_float("client_latency_percentile", latency_percentile);
+  f->dump_unsigned("client_latency_samples", latency_samples.size());
+  f->dump_float("client_latency", _get_client_latency());
+  f->dump_unsigned("num_latency_paused", num_latency_paused);
+}
@@ -0,0 +1,91 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_SCRUBTHROTTLE_H
+#define CEPH_OSD_SCRUBTHROTTLE_H
+
+#include <deque>
+
+#include "include/types.h"
+#include "include/utime.h"
+#include "common/Mutex.h"
+#include "common/TokenBucket.h"
+
+/**
+ * per-OSD budget for scrub reads
+ *
+ * Scrub cost is charged after the fact (we do not know how much a
+ * chunk will read until we have read it), so the byte and op buckets
+ * are allowed to go into debt.  Before starting a new chunk the
+ * primary asks for the delay until both buckets are out of debt.
+ * Each bucket holds at most one second worth of tokens, so an idle
+ * OSD may burst up to that much at once.  A rate of 0 disables the
+ * corresponding bucket.
+ *
+ * Independently, recent client op latencies are sampled so that scrub
+ * can back off entirely while a chosen latency percentile is above a
+ * threshold.  Samples older than the window are discarded, so with no
+ * client load scrub resumes once the window has passed.
+ */
+class ScrubThrottle {
+  Mutex lock;
+  TokenBucket bytes, ops;
+
+  double latency_threshold;   ///< seconds, 0 to disable
+  double latency_percentile;  ///< 0-100
+  double latency_window;      ///< seconds of history to consider
+  std::deque<std::pair<utime_t, double> > latency_samples;
+
+  // stats
+  uint64_t total_bytes, total_ops;
+  uint64_t num_throttled, num_latency_paused;
+
+  void _trim_latency(utime_t now);
+  double _get_client_latency() const;
+  utime_t _get_delay(utime_t now, bool *latency_paused);
+
+public:
+  /// do not compute a percentile from fewer samples than this
+  static const unsigned MIN_LATENCY_SAMPLES = 10;
+  /// cap on retained samples regardless of the window
+  static const unsigned MAX_LATENCY_SAMPLES = 1000;
+
+  ScrubThrottle();
+
+  void set_limits(uint64_t bytes_per_sec, uint64_t ops_per_sec);
+  void set_latency_limit(double threshold, double percentile, double window);
+
+  /// charge a completed scrub read (or batch of reads)
+  void take(utime_t now, uint64_t bytes, uint64_t ops);
+
+  /**
+   * how long a new scrub chunk should wait
+   *
+   * @param now current time
+   * @param latency_paused [out] set if the delay is due to client latency
+   * @return zero if scrub may proceed now
+   */
+  utime_t get_delay(utime_t now, bool *latency_paused = 0);
+
+  /// get_delay() without counting a throttled or paused chunk
+  utime_t peek_delay(utime_t now);
+
+  /// record the latency of a completed client op
+  void note_client_latency(utime_t now, utime_t latency);
+
+  /// current client latency at the configured percentile (0 if unknown)
+  double get_client_latency(utime_t now);
+
+  void dump(Formatter *f, utime_t now);
+};
+
+#endif
@@ -22,8 +22,7 @@ struct TierAgentState {
   hobject_t start;
   bool delaying;
 
-  /// histogram of ages we've encountered
-  pow2_hist_t atime_hist;
+  /// histogram of temperatures we've encountered
   pow2_hist_t temp_hist;
   int hist_age;
 
@@ -69,15 +68,52 @@ struct TierAgentState {
   /// distributed) that i should aim to evict.
   unsigned evict_effort;
 
+  /// approximate ratio of dirty objects, coldest first, to flush
+  unsigned flush_effort;
+
+  /// what the agent did with an object it looked at
+  struct decision_t {
+    hobject_t oid;
+    int temp;
+    uint64_t temp_lower, temp_upper;  ///< position in temp_hist (millionths)
+    const char *action;
+    decision_t(const hobject_t& o, int t, uint64_t l, uint64_t u,
+	       const char *a)
+      : oid(o), temp(t), temp_lower(l), temp_upper(u), action(a) {}
+  };
+  /// the last few decisions, newest last
+  list<decision_t> recent_decisions;
+  static const unsigned MAX_RECENT_DECISIONS = 20;
+
+  uint64_t num_flush, num_evict, num_skip_warm;
+
   TierAgentState()
     : started(0),
       delaying(false),
       hist_age(0),
       flush_mode(FLUSH_MODE_IDLE),
       evict_mode(EVICT_MODE_IDLE),
-      evict_effort(0)
+      evict_effort(0),
+      flush_effort(0),
+      num_flush(0),
+      num_evict(0),
+      num_skip_warm(0)
   {}
 
+  /// priority of this pg in the OSD agent queue
+  unsigned get_priority() const {
+    return MAX(evict_effort, flush_effort);
+  }
+
+  void note_decision(const hobject_t& oid, int temp,
+		     uint64_t temp_lower, uint64_t temp_upper,
+		     const char *action) {
+    recent_decisions.push_back(
+      decision_t(oid, temp, temp_lower, temp_upper, action));
+    if (recent_decisions.size() > MAX_RECENT_DECISIONS)
+      recent_decisions.pop_front();
+  }
+
   /// false if we have any work to do
   bool is_idle() const {
     return
@@ -106,13 +142,28 @@ struct TierAgentState {
     f->dump_string("flush_mode", get_flush_mode_name());
     f->dump_string("evict_mode", get_evict_mode_name());
     f->dump_unsigned("evict_effort", evict_effort);
+    f->dump_unsigned("flush_effort", flush_effort);
     f->dump_stream("position") << position;
-    f->open_object_section("atime_hist");
-    atime_hist.dump(f);
-    f->close_section();
+    f->dump_unsigned("num_hit_sets", hit_set_map.size());
+    f->dump_unsigned("num_flush", num_flush);
+    f->dump_unsigned("num_evict", num_evict);
+    f->dump_unsigned("num_skip_warm", num_skip_warm);
     f->open_object_section("temp_hist");
     temp_hist.dump(f);
     f->close_section();
+    f->open_array_section("recent_decisions");
+    for (list<decision_t>::const_iterator p = recent_decisions.begin();
+	 p != recent_decisions.end();
+	 ++p) {
+      f->open_object_section("decision");
+      f->dump_stream("oid") << p->oid;
+      f->dump_int("temp", p->temp);
+      f->dump_unsigned("temp_lower", p->temp_lower);
+      f->dump_unsigned("temp_upper", p->temp_upper);
+      f->dump_string("action", p->action);
+      f->close_section();
+    }
+    f->close_section();
   }
 };
 
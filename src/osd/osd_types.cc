@@ -810,6 +810,8 @@ void pg_pool_t::dump(Formatter *f) const
   f->dump_unsigned("hit_set_period", hit_set_period);
   f->dump_unsigned("hit_set_count", hit_set_count);
   f->dump_unsigned("min_read_recency_for_promote", min_read_recency_for_promote);
+  f->dump_unsigned("min_write_recency_for_promote", min_write_recency_for_promote);
+  f->dump_unsigned("hit_set_grade_decay_rate", hit_set_grade_decay_rate);
   f->dump_unsigned("stripe_width", get_stripe_width());
   f->dump_unsigned("expected_num_objects", expected_num_objects);
 }
@@ -1111,7 +1113,7 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
     return;
   }
 
-  ENCODE_START(17, 5, bl);
+  ENCODE_START(19, 5, bl);
   ::encode(type, bl);
   ::encode(size, bl);
   ::encode(crush_ruleset, bl);
@@ -1153,12 +1155,14 @@ void pg_pool_t::encode(bufferlist& bl, uint64_t features) const
   ::encode(last_force_op_resend, bl);
   ::encode(min_read_recency_for_promote, bl);
   ::encode(expected_num_objects, bl);
+  ::encode(min_write_recency_for_promote, bl);
+  ::encode(hit_set_grade_decay_rate, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_pool_t::decode(bufferlist::iterator& bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(17, 5, 5, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(19, 5, 5, bl);
   ::decode(type, bl);
   ::decode(size, bl);
   ::decode(crush_ruleset, bl);
@@ -1271,6 +1275,16 @@ void pg_pool_t::decode(bufferlist::iterator& bl)
   } else {
     expected_num_objects = 0;
   }
+  if (struct_v >= 18) {
+    ::decode(min_write_recency_for_promote, bl);
+  } else {
+    min_write_recency_for_promote = 0;
+  }
+  if (struct_v >= 19) {
+    ::decode(hit_set_grade_decay_rate, bl);
+  } else {
+    hit_set_grade_decay_rate = 0;
+  }
   DECODE_FINISH(bl);
   calc_pg_masks();
 }
@@ -1317,6 +1331,8 @@ void pg_pool_t::generate_test_instances(list<pg_pool_t*>& o)
   a.hit_set_period = 3600;
   a.hit_set_count = 8;
   a.min_read_recency_for_promote = 1;
+  a.min_write_recency_for_promote = 2;
+  a.hit_set_grade_decay_rate = 50;
   a.set_stripe_width(12345);
   a.target_max_bytes = 1238132132;
   a.target_max_objects = 1232132;
@@ -1372,6 +1388,10 @@ ostream& operator<<(ostream& out, const pg_pool_t& p)
   }
   if (p.min_read_recency_for_promote)
     out << " min_read_recency_for_promote " << p.min_read_recency_for_promote;
+  if (p.min_write_recency_for_promote)
+    out << " min_write_recency_for_promote " << p.min_write_recency_for_promote;
+  if (p.hit_set_grade_decay_rate)
+    out << " hit_set_grade_decay_rate " << p.hit_set_grade_decay_rate;
   out << " stripe_width " << p.get_stripe_width();
   if (p.expected_num_objects)
     out << " expected_num_objects " << p.expected_num_objects;
@@ -2540,6 +2560,14 @@ void ObjectModDesc::visit(Visitor *visitor) const
 	visitor->update_snaps(snaps);
 	break;
       }
+      case ROLLBACK_EXTENTS: {
+	version_t gen;
+	vector<pair<uint64_t, uint64_t> > extents;
+	::decode(gen, bp);
+	::decode(extents, bp);
+	visitor->rollback_extents(gen, extents);
+	break;
+      }
       default:
 	assert(0 == "Invalid rollback code");
       }
@@ -2588,6 +2616,15 @@ struct DumpVisitor : public ObjectModDesc::Visitor {
     f->dump_stream("snaps") << snaps;
     f->close_section();
   }
+  void rollback_extents(
+    version_t gen,
+    const vector<pair<uint64_t, uint64_t> > &extents) {
+    f->open_object_section("op");
+    f->dump_string("code", "ROLLBACK_EXTENTS");
+    f->dump_unsigned("gen", gen);
+    f->dump_stream("extents") << extents;
+    f->close_section();
+  }
 };
 
 void ObjectModDesc::dump(Formatter *f) const
@@ -2616,6 +2653,11 @@ void ObjectModDesc::generate_test_instances(list<ObjectModDesc*>& o)
   o.push_back(new ObjectModDesc());
   o.back()->rmobject(1001);
   o.push_back(new ObjectModDesc());
+  o.back()->setattrs(attrs);
+  o.back()->append(8192);
+  o.back()->rollback_extents(
+    1002, vector<pair<uint64_t, uint64_t> >(1, make_pair(4096, 4096)));
+  o.push_back(new ObjectModDesc());
   o.back()->create();
   o.back()->setattrs(attrs);
   o.push_back(new ObjectModDesc());
@@ -2672,7 +2714,7 @@ void pg_log_entry_t::decode_with_checksum(bufferlist::iterator& p)
 
 void pg_log_entry_t::encode(bufferlist &bl) const
 {
-  ENCODE_START(9, 4, bl);
+  ENCODE_START(10, 4, bl);
   ::encode(op, bl);
   ::encode(soid, bl);
   ::encode(version, bl);
@@ -2696,12 +2738,14 @@ void pg_log_entry_t::encode(bufferlist &bl) const
   ::encode(snaps, bl);
   ::encode(user_version, bl);
   ::encode(mod_desc, bl);
+  ::encode(dirty_extents_valid, bl);
+  ::encode(dirty_extents, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_log_entry_t::decode(bufferlist::iterator &bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(8, 4, 4, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(10, 4, 4, bl);
   ::decode(op, bl);
   if (struct_v < 2) {
     sobject_t old_soid;
@@ -2748,6 +2792,14 @@ void pg_log_entry_t::decode(bufferlist::iterator &bl)
   else
     mod_desc.mark_unrollbackable();
 
+  if (struct_v >= 10) {
+    ::decode(dirty_extents_valid, bl);
+    ::decode(dirty_extents, bl);
+  } else {
+    dirty_extents_valid = false;
+    dirty_extents.clear();
+  }
+
   DECODE_FINISH(bl);
 }
 
@@ -2778,6 +2830,8 @@ void pg_log_entry_t::dump(Formatter *f) const
     mod_desc.dump(f);
     f->close_section();
   }
+  if (dirty_extents_valid)
+    f->dump_stream("dirty_extents") << dirty_extents;
 }
 
 void pg_log_entry_t::generate_test_instances(list<pg_log_entry_t*>& o)
@@ -2787,6 +2841,11 @@ void pg_log_entry_t::generate_test_instances(list<pg_log_entry_t*>& o)
   o.push_back(new pg_log_entry_t(MODIFY, oid, eversion_t(1,2), eversion_t(3,4),
 				 1, osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
 				 utime_t(8,9)));
+  o.push_back(new pg_log_entry_t(MODIFY, oid, eversion_t(1,3), eversion_t(1,2),
+				 2, osd_reqid_t(entity_name_t::CLIENT(777), 9, 999),
+				 utime_t(8,10)));
+  o.back()->dirty_extents_valid = true;
+  o.back()->dirty_extents.insert(4096, 512);
 }
 
 ostream& operator<<(ostream& out, const pg_log_entry_t& e)
@@ -2804,6 +2863,8 @@ ostream& operator<<(ostream& out, const pg_log_entry_t& e)
     }
     out << " snaps " << snaps;
   }
+  if (e.dirty_extents_valid)
+    out << " dirty " << e.dirty_extents;
   return out;
 }
 
@@ -2933,6 +2994,26 @@ void pg_log_t::copy_up_to(const pg_log_t &other, int max)
   }
 }
 
+bool pg_log_t::get_dirty_extents(const hobject_t &soid, eversion_t from,
+				 eversion_t to,
+				 interval_set<uint64_t> *dirty) const
+{
+  eversion_t want = to;
+  for (list<pg_log_entry_t>::const_reverse_iterator p = log.rbegin();
+       p != log.rend() && want > from;
+       ++p) {
+    if (p->soid != soid || p->version > want)
+      continue;
+    if (p->version != want ||
+	!p->is_modify() ||
+	!p->dirty_extents_valid)
+      return false;
+    dirty->union_of(p->dirty_extents);
+    want = p->prior_version;
+  }
+  return want == from;
+}
+
 ostream& pg_log_t::print(ostream& out) const 
 {
   out << *this << std::endl;
@@ -4007,7 +4088,7 @@ void ObjectRecoveryProgress::dump(Formatter *f) const
 
 void ObjectRecoveryInfo::encode(bufferlist &bl) const
 {
-  ENCODE_START(2, 1, bl);
+  ENCODE_START(3, 1, bl);
   ::encode(soid, bl);
   ::encode(version, bl);
   ::encode(size, bl);
@@ -4015,13 +4096,14 @@ void ObjectRecoveryInfo::encode(bufferlist &bl) const
   ::encode(ss, bl);
   ::encode(copy_subset, bl);
   ::encode(clone_subset, bl);
+  ::encode(base_version, bl);
   ENCODE_FINISH(bl);
 }
 
 void ObjectRecoveryInfo::decode(bufferlist::iterator &bl,
 				int64_t pool)
 {
-  DECODE_START(2, bl);
+  DECODE_START(3, bl);
   ::decode(soid, bl);
   ::decode(version, bl);
   ::decode(size, bl);
@@ -4029,6 +4111,8 @@ void ObjectRecoveryInfo::decode(bufferlist::iterator &bl,
   ::decode(ss, bl);
   ::decode(copy_subset, bl);
   ::decode(clone_subset, bl);
+  if (struct_v >= 3)
+    ::decode(base_version, bl);
   DECODE_FINISH(bl);
 
   if (struct_v < 2) {
@@ -4054,6 +4138,12 @@ void ObjectRecoveryInfo::generate_test_instances(
   o.back()->soid = hobject_t(sobject_t("key", CEPH_NOSNAP));
   o.back()->version = eversion_t(0,0);
   o.back()->size = 100;
+  o.push_back(new ObjectRecoveryInfo);
+  o.back()->soid = hobject_t(sobject_t("key", CEPH_NOSNAP));
+  o.back()->version = eversion_t(3,10);
+  o.back()->size = 4194304;
+  o.back()->copy_subset.insert(8192, 4096);
+  o.back()->base_version = eversion_t(3,7);
 }
 
 
@@ -4074,6 +4164,7 @@ void ObjectRecoveryInfo::dump(Formatter *f) const
   }
   f->dump_stream("copy_subset") << copy_subset;
   f->dump_stream("clone_subset") << clone_subset;
+  f->dump_stream("base_version") << base_version;
 }
 
 ostream& operator<<(ostream& out, const ObjectRecoveryInfo &inf)
@@ -4083,11 +4174,13 @@ ostream& operator<<(ostream& out, const ObjectRecoveryInfo &inf)
 
 ostream &ObjectRecoveryInfo::print(ostream &out) const
 {
-  return out << "ObjectRecoveryInfo("
-	     << soid << "@" << version
-	     << ", copy_subset: " << copy_subset
-	     << ", clone_subset: " << clone_subset
-	     << ")";
+  out << "ObjectRecoveryInfo("
+      << soid << "@" << version
+      << ", copy_subset: " << copy_subset
+      << ", clone_subset: " << clone_subset;
+  if (is_partial())
+    out << ", base_version: " << base_version;
+  return out << ")";
 }
 
 // -- PushReplyOp --
@@ -4098,32 +4191,40 @@ void PushReplyOp::generate_test_instances(list<PushReplyOp*> &o)
   o.back()->soid = hobject_t(sobject_t("asdf", 2));
   o.push_back(new PushReplyOp);
   o.back()->soid = hobject_t(sobject_t("asdf", CEPH_NOSNAP));
+  o.back()->retry_full = true;
 }
 
 void PushReplyOp::encode(bufferlist &bl) const
 {
-  ENCODE_START(1, 1, bl);
+  ENCODE_START(2, 1, bl);
   ::encode(soid, bl);
+  ::encode(retry_full, bl);
   ENCODE_FINISH(bl);
 }
 
 void PushReplyOp::decode(bufferlist::iterator &bl)
 {
-  DECODE_START(1, bl);
+  DECODE_START(2, bl);
   ::decode(soid, bl);
+  if (struct_v >= 2)
+    ::decode(retry_full, bl);
+  else
+    retry_full = false;
   DECODE_FINISH(bl);
 }
 
 void PushReplyOp::dump(Formatter *f) const
 {
   f->dump_stream("soid") << soid;
+  f->dump_int("retry_full", retry_full);
 }
 
 ostream &PushReplyOp::print(ostream &out) const
 {
-  return out
-    << "PushReplyOp(" << soid
-    << ")";
+  out << "PushReplyOp(" << soid;
+  if (retry_full)
+    out << " retry_full";
+  return out << ")";
 }
 
 ostream& operator<<(ostream& out, const PushReplyOp &op)
@@ -4632,3 +4733,35 @@ void OSDOp::merge_osd_op_vector_out_data(vector<OSDOp>& ops, bufferlist& out)
     }
   }
 }
+
+bool OSDOp::have_known_extents(const vector<OSDOp>& ops)
+{
+  for (vector<OSDOp>::const_iterator p = ops.begin(); p != ops.end(); ++p) {
+    switch (p->op.op) {
+    case CEPH_OSD_OP_WRITE:
+      if (p->op.extent.truncate_seq)
+	return false;
+      break;
+    case CEPH_OSD_OP_APPEND:
+    case CEPH_OSD_OP_ZERO:
+      break;
+    case CEPH_OSD_OP_SETALLOCHINT:  // these leave the data alone
+    case CEPH_OSD_OP_ASSERT_VER:
+    case CEPH_OSD_OP_CMPXATTR:
+    case CEPH_OSD_OP_WATCH:
+    case CEPH_OSD_OP_SETXATTR:
+    case CEPH_OSD_OP_RMXATTR:
+    case CEPH_OSD_OP_OMAPSETVALS:
+    case CEPH_OSD_OP_OMAPSETHEADER:
+    case CEPH_OSD_OP_OMAPRMKEYS:
+    case CEPH_OSD_OP_OMAPCLEAR:
+      break;
+    case CEPH_OSD_OP_CALL:
+      return false;
+    default:
+      if (ceph_osd_op_mode_modify(p->op.op))
+	return false;
+    }
+  }
+  return true;
+}
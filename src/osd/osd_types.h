@@ -817,6 +817,8 @@ struct pg_pool_t {
     FLAG_FULL       = 1<<1, // pool is full
     FLAG_DEBUG_FAKE_EC_POOL = 1<<2, // require ReplicatedPG to act like an EC pg
     FLAG_INCOMPLETE_CLONES = 1<<3, // may have incomplete clones (bc we are/were an overlay)
+    FLAG_EC_OVERWRITES = 1<<4, // ec pool allows partial stripe overwrites
+    FLAG_FAST_READ = 1<<5, // ec pool reads extra shards and decodes from the first to reply
   };
 
   static const char *get_flag_name(int f) {
@@ -825,6 +827,8 @@ struct pg_pool_t {
     case FLAG_FULL: return "full";
     case FLAG_DEBUG_FAKE_EC_POOL: return "require_local_rollback";
     case FLAG_INCOMPLETE_CLONES: return "incomplete_clones";
+    case FLAG_EC_OVERWRITES: return "ec_overwrites";
+    case FLAG_FAST_READ: return "fast_read";
     default: return "???";
     }
   }
@@ -848,7 +852,8 @@ struct pg_pool_t {
     CACHEMODE_WRITEBACK = 1,             ///< write to cache, flush later
     CACHEMODE_FORWARD = 2,               ///< forward if not in cache
     CACHEMODE_READONLY = 3,              ///< handle reads, forward writes [not strongly consistent]
-    CACHEMODE_READFORWARD = 4            ///< forward reads, write to cache flush later
+    CACHEMODE_READFORWARD = 4,           ///< forward reads, write to cache flush later
+    CACHEMODE_PROXY = 5                  ///< proxy if not in cache, never promote
   } cache_mode_t;
   static const char *get_cache_mode_name(cache_mode_t m) {
     switch (m) {
@@ -857,6 +862,7 @@ struct pg_pool_t {
     case CACHEMODE_FORWARD: return "forward";
     case CACHEMODE_READONLY: return "readonly";
     case CACHEMODE_READFORWARD: return "readforward";
+    case CACHEMODE_PROXY: return "proxy";
     default: return "unknown";
     }
   }
@@ -871,6 +877,8 @@ struct pg_pool_t {
       return CACHEMODE_READONLY;
     if (s == "readforward")
       return CACHEMODE_READFORWARD;
+    if (s == "proxy")
+      return CACHEMODE_PROXY;
     return (cache_mode_t)-1;
   }
   const char *get_cache_mode_name() const {
@@ -881,6 +889,7 @@ struct pg_pool_t {
     case CACHEMODE_NONE:
     case CACHEMODE_FORWARD:
     case CACHEMODE_READONLY:
+    case CACHEMODE_PROXY:
       return false;
     case CACHEMODE_WRITEBACK:
     case CACHEMODE_READFORWARD:
@@ -974,6 +983,8 @@ public:
   uint32_t hit_set_period;      ///< periodicity of HitSet segments (seconds)
   uint32_t hit_set_count;       ///< number of periods to retain
   uint32_t min_read_recency_for_promote;   ///< minimum number of HitSet to check before promote
+  uint32_t min_write_recency_for_promote;  ///< same for writes, which are proxied until then
+  uint32_t hit_set_grade_decay_rate;  ///< % weight lost by each older HitSet when grading temperature
 
   uint32_t stripe_width;        ///< erasure coded stripe size in bytes
 
@@ -1002,6 +1013,8 @@ public:
       hit_set_period(0),
       hit_set_count(0),
       min_read_recency_for_promote(0),
+      min_write_recency_for_promote(0),
+      hit_set_grade_decay_rate(0),
       stripe_width(0),
       expected_num_objects(0)
   { }
@@ -1048,7 +1061,17 @@ public:
   bool is_replicated()   const { return get_type() == TYPE_REPLICATED; }
   bool is_erasure() const { return get_type() == TYPE_ERASURE; }
 
-  bool requires_aligned_append() const { return is_erasure(); }
+  bool requires_aligned_append() const {
+    return is_erasure() && !has_flag(FLAG_EC_OVERWRITES);
+  }
+  /// true if writes to ec objects need not be appends
+  bool allows_ec_overwrites() const {
+    return is_erasure() && has_flag(FLAG_EC_OVERWRITES);
+  }
+  /// true if client reads of ec objects should not wait for every shard
+  bool fast_read() const {
+    return is_erasure() && has_flag(FLAG_FAST_READ);
+  }
   uint64_t required_alignment() const { return stripe_width; }
 
   bool can_shift_osds() const {
@@ -1896,6 +1919,9 @@ public:
     virtual void rmobject(version_t old_version) {}
     virtual void create() {}
     virtual void update_snaps(set<snapid_t> &old_snaps) {}
+    virtual void rollback_extents(
+      version_t gen,
+      const vector<pair<uint64_t, uint64_t> > &extents) {}
     virtual ~Visitor() {}
   };
   void visit(Visitor *visitor) const;
@@ -1905,7 +1931,8 @@ public:
     SETATTRS = 2,
     DELETE = 3,
     CREATE = 4,
-    UPDATE_SNAPS = 5
+    UPDATE_SNAPS = 5,
+    ROLLBACK_EXTENTS = 6
   };
   ObjectModDesc() : can_local_rollback(true), rollback_info_completed(false) {}
   void claim(ObjectModDesc &other) {
@@ -1981,6 +2008,20 @@ public:
     ::encode(old_snaps, bl);
     ENCODE_FINISH(bl);
   }
+  /**
+   * the logical extents were copied into the object generation gen
+   * before being overwritten; extents are stripe aligned
+   */
+  void rollback_extents(
+    version_t gen, const vector<pair<uint64_t, uint64_t> > &extents) {
+    if (!can_local_rollback || rollback_info_completed)
+      return;
+    ENCODE_START(1, 1, bl);
+    append_id(ROLLBACK_EXTENTS);
+    ::encode(gen, bl);
+    ::encode(extents, bl);
+    ENCODE_FINISH(bl);
+  }
 
   // cannot be rolled back
   void mark_unrollbackable() {
@@ -2069,10 +2110,15 @@ struct pg_log_entry_t {
 
   /// describes state for a locally-rollbackable entry
   ObjectModDesc mod_desc;
+
+  /// data extents written by this entry; only meaningful if dirty_extents_valid
+  interval_set<uint64_t> dirty_extents;
+  bool dirty_extents_valid;
       
   pg_log_entry_t()
     : op(0), user_version(0),
-      invalid_hash(false), invalid_pool(false), offset(0) {}
+      invalid_hash(false), invalid_pool(false), offset(0),
+      dirty_extents_valid(false) {}
   pg_log_entry_t(int _op, const hobject_t& _soid, 
 		 const eversion_t& v, const eversion_t& pv,
 		 version_t uv,
@@ -2080,7 +2126,7 @@ struct pg_log_entry_t {
     : op(_op), soid(_soid), version(v),
       prior_version(pv), user_version(uv),
       reqid(rid), mtime(mt), invalid_hash(false), invalid_pool(false),
-      offset(0) {}
+      offset(0), dirty_extents_valid(false) {}
       
   bool is_clone() const { return op == CLONE; }
   bool is_modify() const { return op == MODIFY; }
@@ -2225,6 +2271,19 @@ struct pg_log_t {
    */
   void copy_up_to(const pg_log_t &other, int max);
 
+  /**
+   * union of the extents written to an object between two versions
+   *
+   * @param soid object
+   * @param from version the caller has
+   * @param to version wanted, the newest entry to look at
+   * @param dirty [out] extents written by the entries in (from, to]
+   * @return false unless the entries for soid chain from to back to
+   *         from and each is a modify with dirty_extents_valid
+   */
+  bool get_dirty_extents(const hobject_t &soid, eversion_t from,
+			 eversion_t to, interval_set<uint64_t> *dirty) const;
+
   ostream& print(ostream& out) const;
 
   void encode(bufferlist &bl) const;
@@ -3065,8 +3124,19 @@ struct ObjectRecoveryInfo {
   interval_set<uint64_t> copy_subset;
   map<hobject_t, interval_set<uint64_t> > clone_subset;
 
+  /**
+   * If set, the target already has the object at this version and
+   * copy_subset only covers the extents written since then; the push
+   * is applied on top of the existing copy instead of replacing it.
+   */
+  eversion_t base_version;
+
   ObjectRecoveryInfo() : size(0) { }
 
+  bool is_partial() const {
+    return base_version != eversion_t();
+  }
+
   static void generate_test_instances(list<ObjectRecoveryInfo*>& o);
   void encode(bufferlist &bl) const;
   void decode(bufferlist::iterator &bl, int64_t pool = -1);
@@ -3106,6 +3176,9 @@ ostream& operator<<(ostream& out, const ObjectRecoveryProgress &prog);
 
 struct PushReplyOp {
   hobject_t soid;
+  bool retry_full;  ///< a partial push did not apply; send the whole object
+
+  PushReplyOp() : retry_full(false) {}
 
   static void generate_test_instances(list<PushReplyOp*>& o);
   void encode(bufferlist &bl) const;
@@ -3250,6 +3323,15 @@ struct OSDOp {
    * @param in  [out] combined data buffer
    */
   static void merge_osd_op_vector_out_data(vector<OSDOp>& ops, bufferlist& out);
+
+  /**
+   * can the data written by ops be described by the extents they write?
+   *
+   * Plain writes, appends, zeroes and ops which leave the data alone
+   * qualify; anything that truncates, replaces, clones or rolls back
+   * the data (or runs a class method that might) does not.
+   */
+  static bool have_known_extents(const vector<OSDOp>& ops);
 };
 
 ostream& operator<<(ostream& out, const OSDOp& op);
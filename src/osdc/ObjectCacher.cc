@@ -35,6 +35,8 @@ ObjectCacher::BufferHead *ObjectCacher::Object::split(BufferHead *left, loff_t o
   right->last_read_tid = left->last_read_tid;
   right->set_state(left->get_state());
   right->snapc = left->snapc;
+  right->hot = left->hot;
+  right->referenced = left->referenced;
 
   loff_t newleftlen = off - left->start();
   right->set_start(off);
@@ -126,7 +128,8 @@ void ObjectCacher::Object::try_merge_bh(BufferHead *bh)
   if (p != data.begin()) {
     --p;
     if (p->second->end() == bh->start() &&
-	p->second->get_state() == bh->get_state()) {
+	p->second->get_state() == bh->get_state() &&
+	p->second->hot == bh->hot) {
       merge_left(p->second, bh);
       bh = p->second;
     } else {
@@ -138,7 +141,8 @@ void ObjectCacher::Object::try_merge_bh(BufferHead *bh)
   ++p;
   if (p != data.end() &&
       p->second->start() == bh->end() &&
-      p->second->get_state() == bh->get_state())
+      p->second->get_state() == bh->get_state() &&
+      p->second->hot == bh->hot)
     merge_left(bh, p->second);
 }
 
@@ -506,12 +510,13 @@ ObjectCacher::ObjectCacher(CephContext *cct_, string name, WritebackHandler& wb,
     cct(cct_), writeback_handler(wb), name(name), lock(l),
     max_dirty(max_dirty), target_dirty(target_dirty),
     max_size(max_bytes), max_objects(max_objects),
-    block_writes_upfront(block_writes_upfront),
+    block_writes_upfront(block_writes_upfront), policy(POLICY_LRU),
     flush_set_callback(flush_callback), flush_set_callback_arg(flush_callback_arg),
     last_read_tid(0),
     flusher_stop(false), flusher_thread(this), finisher(cct),
     stat_clean(0), stat_zero(0), stat_dirty(0), stat_rx(0), stat_tx(0), stat_missing(0),
-    stat_error(0), stat_dirty_waiting(0), reads_outstanding(0)
+    stat_error(0), stat_dirty_waiting(0), stat_probation(0),
+    reads_outstanding(0)
 {
   this->max_dirty_age.set_from_double(max_dirty_age);
   perf_start();
@@ -528,6 +533,7 @@ ObjectCacher::~ObjectCacher()
       ++i)
     assert(i->empty());
   assert(bh_lru_rest.lru_get_size() == 0);
+  assert(bh_lru_probation.lru_get_size() == 0);
   assert(bh_lru_dirty.lru_get_size() == 0);
   assert(ob_lru.lru_get_size() == 0);
   assert(dirty_or_tx_bh.empty());
@@ -542,6 +548,13 @@ void ObjectCacher::perf_start()
   plb.add_u64_counter(l_objectcacher_cache_ops_miss, "cache_ops_miss");
   plb.add_u64_counter(l_objectcacher_cache_bytes_hit, "cache_bytes_hit");
   plb.add_u64_counter(l_objectcacher_cache_bytes_miss, "cache_bytes_miss");
+  plb.add_u64_counter(l_objectcacher_cache_bytes_hit_probation,
+		      "cache_bytes_hit_probation");
+  plb.add_u64_counter(l_objectcacher_cache_bh_promoted, "cache_bh_promoted");
+  plb.add_u64_counter(l_objectcacher_cache_bytes_evicted,
+		      "cache_bytes_evicted");
+  plb.add_u64_counter(l_objectcacher_cache_bytes_evicted_probation,
+		      "cache_bytes_evicted_probation");
   plb.add_u64_counter(l_objectcacher_data_read, "data_read");
   plb.add_u64_counter(l_objectcacher_data_written, "data_written");
   plb.add_u64_counter(l_objectcacher_data_flushed, "data_flushed");
@@ -955,12 +968,18 @@ void ObjectCacher::trim()
 		 << dendl;
 
   while (get_stat_clean() > 0 && (uint64_t) get_stat_clean() > max_size) {
-    BufferHead *bh = static_cast<BufferHead*>(bh_lru_rest.lru_expire());
+    BufferHead *bh = bh_lru_expire();
     if (!bh)
       break;
 
     ldout(cct, 10) << "trim trimming " << *bh << dendl;
     assert(bh->is_clean() || bh->is_zero());
+    if (perfcounter) {
+      perfcounter->inc(l_objectcacher_cache_bytes_evicted, bh->length());
+      if (policy == POLICY_2Q && !bh->hot)
+	perfcounter->inc(l_objectcacher_cache_bytes_evicted_probation,
+			 bh->length());
+    }
 
     Object *ob = bh->ob;
     bh_remove(ob, bh);
@@ -1200,11 +1219,22 @@ int ObjectCacher::_readx(OSDRead *rd, ObjectSet *oset, Context *onfinish,
     }
   }
   
-  // bump hits in lru
+  // bump hits in lru.  under 2q a bh is promoted when a new read (not
+  // a retry of the read that brought it in) finds it already used.
   for (list<BufferHead*>::iterator bhit = hit_ls.begin();
        bhit != hit_ls.end();
-       ++bhit) 
-    touch_bh(*bhit);
+       ++bhit) {
+    BufferHead *bh = *bhit;
+    if (policy == POLICY_2Q && rd->bl) {
+      if (perfcounter && external_call && !bh->hot)
+	perfcounter->inc(l_objectcacher_cache_bytes_hit_probation,
+			 bh->length());
+      touch_bh(bh, external_call && bh->referenced);
+      bh->referenced = true;
+    } else {
+      touch_bh(bh);
+    }
+  }
   
   if (!success) {
     if (perfcounter && external_call) {
@@ -1936,6 +1966,8 @@ void ObjectCacher::verify_stats() const
 void ObjectCacher::bh_stat_add(BufferHead *bh)
 {
   assert(lock.is_locked());
+  if (&bh_lru_clean(bh) == &bh_lru_probation && !bh->is_dirty())
+    stat_probation += bh->length();
   switch (bh->get_state()) {
   case BufferHead::STATE_MISSING:
     stat_missing += bh->length();
@@ -1972,6 +2004,8 @@ void ObjectCacher::bh_stat_add(BufferHead *bh)
 void ObjectCacher::bh_stat_sub(BufferHead *bh)
 {
   assert(lock.is_locked());
+  if (&bh_lru_clean(bh) == &bh_lru_probation && !bh->is_dirty())
+    stat_probation -= bh->length();
   switch (bh->get_state()) {
   case BufferHead::STATE_MISSING:
     stat_missing -= bh->length();
@@ -2009,11 +2043,11 @@ void ObjectCacher::bh_set_state(BufferHead *bh, int s)
   int state = bh->get_state();
   // move between lru lists?
   if (s == BufferHead::STATE_DIRTY && state != BufferHead::STATE_DIRTY) {
-    bh_lru_rest.lru_remove(bh);
+    bh_lru_clean(bh).lru_remove(bh);
     bh_lru_dirty.lru_insert_top(bh);
   } else if (s != BufferHead::STATE_DIRTY && state == BufferHead::STATE_DIRTY) {
     bh_lru_dirty.lru_remove(bh);
-    bh_lru_rest.lru_insert_top(bh);
+    bh_lru_clean(bh).lru_insert_top(bh);
   }
 
   if ((s == BufferHead::STATE_TX ||
@@ -2038,6 +2072,57 @@ void ObjectCacher::bh_set_state(BufferHead *bh, int s)
   bh_stat_add(bh);
 }
 
+bool ObjectCacher::set_replacement_policy(const string& name)
+{
+  assert(bh_lru_rest.lru_get_size() == 0);
+  assert(bh_lru_probation.lru_get_size() == 0);
+  if (name == "lru") {
+    policy = POLICY_LRU;
+  } else if (name == "2q") {
+    policy = POLICY_2Q;
+  } else {
+    lderr(cct) << "unknown cache replacement policy '" << name
+	       << "', keeping " << (policy == POLICY_2Q ? "2q" : "lru")
+	       << dendl;
+    return false;
+  }
+  ldout(cct, 10) << "replacement policy " << name << dendl;
+  return true;
+}
+
+void ObjectCacher::bh_promote(BufferHead *bh)
+{
+  assert(lock.is_locked());
+  assert(policy == POLICY_2Q && !bh->hot && !bh->is_dirty());
+  ldout(cct, 20) << "bh_promote " << *bh << dendl;
+  bh_lru_probation.lru_remove(bh);
+  bh_stat_sub(bh);
+  bh->hot = true;
+  bh_stat_add(bh);
+  bh_lru_rest.lru_insert_top(bh);
+  if (perfcounter)
+    perfcounter->inc(l_objectcacher_cache_bh_promoted);
+}
+
+/*
+ * pick a clean bh to trim.  under 2q the probation queue is kept to
+ * about a quarter of the cache so a one-pass scan only churns that
+ * quarter; below that share we evict from the main lru instead.
+ */
+ObjectCacher::BufferHead *ObjectCacher::bh_lru_expire()
+{
+  assert(lock.is_locked());
+  BufferHead *bh = NULL;
+  if (policy == POLICY_2Q &&
+      (uint64_t)stat_probation > max_size / 4)
+    bh = static_cast<BufferHead*>(bh_lru_probation.lru_expire());
+  if (!bh)
+    bh = static_cast<BufferHead*>(bh_lru_rest.lru_expire());
+  if (!bh && policy == POLICY_2Q)
+    bh = static_cast<BufferHead*>(bh_lru_probation.lru_expire());
+  return bh;
+}
+
 void ObjectCacher::bh_add(Object *ob, BufferHead *bh)
 {
   assert(lock.is_locked());
@@ -2047,7 +2132,7 @@ void ObjectCacher::bh_add(Object *ob, BufferHead *bh)
     bh_lru_dirty.lru_insert_top(bh);
     dirty_or_tx_bh.insert(bh);
   } else {
-    bh_lru_rest.lru_insert_top(bh);
+    bh_lru_clean(bh).lru_insert_top(bh);
   }
 
   if (bh->is_tx()) {
@@ -2065,7 +2150,7 @@ void ObjectCacher::bh_remove(Object *ob, BufferHead *bh)
     bh_lru_dirty.lru_remove(bh);
     dirty_or_tx_bh.erase(bh);
   } else {
-    bh_lru_rest.lru_remove(bh);
+    bh_lru_clean(bh).lru_remove(bh);
   }
 
   if (bh->is_tx()) {
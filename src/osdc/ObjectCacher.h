@@ -27,6 +27,10 @@ enum {
 
   l_objectcacher_cache_bytes_hit, // bytes read directly from cache
   l_objectcacher_cache_bytes_miss, // bytes we couldn't read directly from cache
+  l_objectcacher_cache_bytes_hit_probation, // hit bytes from bhs not yet promoted (2q)
+  l_objectcacher_cache_bh_promoted, // bhs moved from probation to the main lru (2q)
+  l_objectcacher_cache_bytes_evicted, // clean bytes trimmed from the cache
+  l_objectcacher_cache_bytes_evicted_probation, // ...of which were never promoted (2q)
 
   l_objectcacher_data_read, // total bytes read out
   l_objectcacher_data_written, // bytes written to cache
@@ -108,6 +112,8 @@ class ObjectCacher {
     utime_t last_write;
     SnapContext snapc;
     int error; // holds return value for failed reads
+    bool hot;         // 2q: re-read since it was cached; lives in bh_lru_rest
+    bool referenced;  // 2q: has satisfied a read
     
     map< loff_t, list<Context*> > waitfor_read;
     
@@ -118,7 +124,9 @@ class ObjectCacher {
       ob(o),
       last_write_tid(0),
       last_read_tid(0),
-      error(0) {
+      error(0),
+      hot(false),
+      referenced(false) {
       ex.start = ex.length = 0;
     }
   
@@ -326,6 +334,10 @@ class ObjectCacher {
 
   // ******* ObjectCacher *********
   // ObjectCacher fields
+  // replacement policies for clean bhs
+  static const int POLICY_LRU = 0;
+  static const int POLICY_2Q = 1;   // simplified 2q: probation fifo + main lru
+
  private:
   WritebackHandler& writeback_handler;
 
@@ -335,6 +347,7 @@ class ObjectCacher {
   uint64_t max_dirty, target_dirty, max_size, max_objects;
   utime_t max_dirty_age;
   bool block_writes_upfront;
+  int policy;
 
   flush_set_callback_t flush_set_callback;
   void *flush_set_callback_arg;
@@ -345,6 +358,7 @@ class ObjectCacher {
 
   set<BufferHead*>    dirty_or_tx_bh;
   LRU   bh_lru_dirty, bh_lru_rest;
+  LRU   bh_lru_probation;  // 2q: clean bhs that have not been re-read yet
   LRU   ob_lru;
 
   Cond flusher_cond;
@@ -386,6 +400,7 @@ class ObjectCacher {
   loff_t stat_missing;
   loff_t stat_error;
   loff_t stat_dirty_waiting;   // bytes that writers are waiting on to write
+  loff_t stat_probation;       // non-dirty bytes in bh_lru_probation
 
   void verify_stats() const;
 
@@ -398,11 +413,22 @@ class ObjectCacher {
   loff_t get_stat_clean() { return stat_clean; }
   loff_t get_stat_zero() { return stat_zero; }
 
-  void touch_bh(BufferHead *bh) {
+  /// the lru holding a non-dirty bh
+  LRU& bh_lru_clean(BufferHead *bh) {
+    if (policy == POLICY_2Q && !bh->hot)
+      return bh_lru_probation;
+    return bh_lru_rest;
+  }
+  void bh_promote(BufferHead *bh);
+  BufferHead *bh_lru_expire();
+
+  void touch_bh(BufferHead *bh, bool promote=false) {
     if (bh->is_dirty())
       bh_lru_dirty.lru_touch(bh);
+    else if (promote && policy == POLICY_2Q && !bh->hot)
+      bh_promote(bh);
     else
-      bh_lru_rest.lru_touch(bh);
+      bh_lru_clean(bh).lru_touch(bh);
     touch_ob(bh->ob);
   }
   void touch_ob(Object *ob) {
@@ -631,6 +657,15 @@ public:
   void set_max_objects(int64_t v) {
     max_objects = v;
   }
+  /**
+   * choose how clean buffers are replaced
+   *
+   * "lru" (the default) or "2q".  Must be called before anything is
+   * cached.
+   *
+   * @return false if the name is not recognized (policy is unchanged)
+   */
+  bool set_replacement_policy(const string& name);
 
 
   // file functions
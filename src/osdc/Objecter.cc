@@ -41,6 +41,7 @@
 #include "messages/MCommandReply.h"
 
 #include <errno.h>
+#include <algorithm>
 
 #include "common/config.h"
 #include "common/perf_counters.h"
@@ -68,6 +69,7 @@ enum {
   l_osdc_op_w,
   l_osdc_op_rmw,
   l_osdc_op_pg,
+  l_osdc_op_r_replica,
 
   l_osdc_osdop_stat,
   l_osdc_osdop_create,
@@ -120,6 +122,7 @@ enum {
   l_osdc_map_epoch,
   l_osdc_map_full,
   l_osdc_map_inc,
+  l_osdc_map_pg_mapping_bytes,
 
   l_osdc_osd_sessions,
   l_osdc_osd_session_open,
@@ -191,6 +194,7 @@ void Objecter::init()
     pcb.add_u64_counter(l_osdc_op_w, "op_w");
     pcb.add_u64_counter(l_osdc_op_rmw, "op_rmw");
     pcb.add_u64_counter(l_osdc_op_pg, "op_pg");
+    pcb.add_u64_counter(l_osdc_op_r_replica, "op_r_replica");
 
     pcb.add_u64_counter(l_osdc_osdop_stat, "osdop_stat");
     pcb.add_u64_counter(l_osdc_osdop_create, "osdop_create");
@@ -243,6 +247,7 @@ void Objecter::init()
     pcb.add_u64(l_osdc_map_epoch, "map_epoch");
     pcb.add_u64_counter(l_osdc_map_full, "map_full");
     pcb.add_u64_counter(l_osdc_map_inc, "map_inc");
+    pcb.add_u64(l_osdc_map_pg_mapping_bytes, "map_pg_mapping_bytes");
 
     pcb.add_u64(l_osdc_osd_sessions, "osd_sessions");  // open sessions
     pcb.add_u64_counter(l_osdc_osd_session_open, "osd_session_open");
@@ -266,6 +271,22 @@ void Objecter::init()
     lderr(cct) << "error registering admin socket command: "
 	       << cpp_strerror(ret) << dendl;
   }
+  ret = admin_socket->register_command("objecter_latency",
+				       "objecter_latency",
+				       m_request_state_hook,
+				       "show histograms of osd request latency by stage");
+  if (ret < 0 && ret != -EEXIST) {
+    lderr(cct) << "error registering admin socket command: "
+	       << cpp_strerror(ret) << dendl;
+  }
+  ret = admin_socket->register_command("objecter_latency_reset",
+				       "objecter_latency_reset",
+				       m_request_state_hook,
+				       "clear the osd request latency histograms");
+  if (ret < 0 && ret != -EEXIST) {
+    lderr(cct) << "error registering admin socket command: "
+	       << cpp_strerror(ret) << dendl;
+  }
 
   timer.init();
 
@@ -376,6 +397,8 @@ void Objecter::shutdown()
   if (m_request_state_hook) {
     AdminSocket* admin_socket = cct->get_admin_socket();
     admin_socket->unregister_command("objecter_requests");
+    admin_socket->unregister_command("objecter_latency");
+    admin_socket->unregister_command("objecter_latency_reset");
     delete m_request_state_hook;
     m_request_state_hook = NULL;
   }
@@ -819,6 +842,16 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	monc->renew_subs();
       }
     }
+
+    if (cct->_conf->objecter_cache_pg_mapping &&
+	osdmap->get_epoch() &&
+	!osdmap->have_pg_mapping()) {
+      osdmap->build_pg_mapping();
+      ldout(cct, 10) << "handle_osd_map built pg mapping for e"
+		     << osdmap->get_epoch() << ", "
+		     << osdmap->get_pg_mapping_bytes() << " bytes" << dendl;
+    }
+    logger->set(l_osdc_map_pg_mapping_bytes, osdmap->get_pg_mapping_bytes());
   }
 
   bool pauserd = osdmap->test_flag(CEPH_OSDMAP_PAUSERD);
@@ -1677,6 +1710,33 @@ ceph_tid_t Objecter::op_submit(Op *op)
   return _op_submit_with_budget(op, lc);
 }
 
+void Objecter::op_submit_batch(const vector<Op*>& ops, vector<ceph_tid_t> *ptids)
+{
+  RWLock::RLocker rl(rwlock);
+  RWLock::Context lc(rwlock, RWLock::Context::TakenForRead);
+
+  // map on a copy of each target; _op_submit maps the op for real
+  vector<pair<int, unsigned> > order;
+  order.reserve(ops.size());
+  for (unsigned i = 0; i < ops.size(); ++i) {
+    op_target_t t = ops[i]->target;
+    _calc_target(&t);
+    order.push_back(make_pair(t.osd, i));
+  }
+  std::sort(order.begin(), order.end());
+
+  ldout(cct, 10) << __func__ << " " << ops.size() << " ops" << dendl;
+  if (ptids)
+    ptids->resize(ops.size());
+  for (vector<pair<int, unsigned> >::iterator p = order.begin();
+       p != order.end();
+       ++p) {
+    ceph_tid_t tid = _op_submit_with_budget(ops[p->second], lc);
+    if (ptids)
+      (*ptids)[p->second] = tid;
+  }
+}
+
 ceph_tid_t Objecter::_op_submit_with_budget(Op *op, RWLock::Context& lc)
 {
   assert(initialized.read());
@@ -1692,53 +1752,15 @@ ceph_tid_t Objecter::_op_submit_with_budget(Op *op, RWLock::Context& lc)
 
   // throttle.  before we look at any state, because
   // take_op_budget() may drop our lock while it blocks.
+  op->submitted = ceph_clock_now(cct);
   _take_op_budget(op);
+  op->throttled = ceph_clock_now(cct);
 
   return _op_submit(op, lc);
 }
 
-ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc)
+void Objecter::_count_op(Op *op)
 {
-  assert(rwlock.is_locked());
-
-  ldout(cct, 10) << __func__ << " op " << op << dendl;
-
-  // pick target
-  assert(op->session == NULL);
-  OSDSession *s = NULL;
-
-  bool const check_for_latest_map = _calc_target(&op->target) == RECALC_OP_TARGET_POOL_DNE;
-
-  // Try to get a session, including a retry if we need to take write lock
-  int r = _get_session(op->target.osd, &s, lc);
-  if (r == -EAGAIN) {
-    assert(s == NULL);
-    lc.promote();
-    r = _get_session(op->target.osd, &s, lc);
-  }
-  assert(r == 0);
-  assert(s);  // may be homeless
-
-  // We may need to take wlock if we will need to _set_op_map_check later.
-  if (check_for_latest_map && !lc.is_wlocked()) {
-    lc.promote();
-  }
-
-  inflight_ops.inc();
-
-  // add to gather set(s)
-  if (op->onack) {
-    num_unacked.inc();
-  } else {
-    ldout(cct, 20) << " note: not requesting ack" << dendl;
-  }
-  if (op->oncommit) {
-    num_uncommitted.inc();
-  } else {
-    ldout(cct, 20) << " note: not requesting commit" << dendl;
-  }
-
-  logger->inc(l_osdc_op_active);
   logger->inc(l_osdc_op);
 
   if ((op->target.flags & (CEPH_OSD_FLAG_READ|CEPH_OSD_FLAG_WRITE)) == (CEPH_OSD_FLAG_READ|CEPH_OSD_FLAG_WRITE))
@@ -1747,6 +1769,8 @@ ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc)
     logger->inc(l_osdc_op_w);
   else if (op->target.flags & CEPH_OSD_FLAG_READ)
     logger->inc(l_osdc_op_r);
+  if (op->target.latency_replica)
+    logger->inc(l_osdc_op_r_replica);
 
   if (op->target.flags & CEPH_OSD_FLAG_PGOP)
     logger->inc(l_osdc_op_pg);
@@ -1782,6 +1806,57 @@ ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc)
     if (code)
       logger->inc(code);
   }
+}
+
+ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc, bool count)
+{
+  assert(rwlock.is_locked());
+
+  ldout(cct, 10) << __func__ << " op " << op << dendl;
+
+  // pick target
+  assert(op->session == NULL);
+  OSDSession *s = NULL;
+
+  op->target.replica_readable = is_replica_readable(op->ops);
+  bool const check_for_latest_map = _calc_target(&op->target) == RECALC_OP_TARGET_POOL_DNE;
+
+  // Try to get a session, including a retry if we need to take write lock
+  int r = _get_session(op->target.osd, &s, lc);
+  if (r == -EAGAIN) {
+    assert(s == NULL);
+    lc.promote();
+    r = _get_session(op->target.osd, &s, lc);
+  }
+  assert(r == 0);
+  assert(s);  // may be homeless
+
+  // We may need to take wlock if we will need to _set_op_map_check later.
+  if (check_for_latest_map && !lc.is_wlocked()) {
+    lc.promote();
+  }
+
+  inflight_ops.inc();
+
+  if ((op->target.flags & CEPH_OSD_FLAG_WRITE) && !op->inflight_write &&
+      cct->_conf->objecter_latency_aware_reads)
+    inflight_write_start(op);
+
+  // add to gather set(s)
+  if (op->onack) {
+    num_unacked.inc();
+  } else {
+    ldout(cct, 20) << " note: not requesting ack" << dendl;
+  }
+  if (op->oncommit) {
+    num_uncommitted.inc();
+  } else {
+    ldout(cct, 20) << " note: not requesting commit" << dendl;
+  }
+
+  logger->inc(l_osdc_op_active);
+  if (count)
+    _count_op(op);
 
   // send?
   ldout(cct, 10) << "_op_submit oid " << op->target.base_oid
@@ -1822,6 +1897,8 @@ ceph_tid_t Objecter::_op_submit(Op *op, RWLock::Context& lc)
   s->lock.get_write();
   if (op->tid == 0)
     op->tid = last_tid.inc();
+  if (op->trace_id == 0 && cct->_conf->objecter_trace_ops)
+    op->trace_id = op->tid;  // the tid changes on resend, this does not
   _session_op_assign(s, op);
 
   if (need_send) {
@@ -1975,6 +2052,130 @@ int64_t Objecter::get_object_pg_hash_position(int64_t pool, const string& key,
   return p->raw_hash_to_pg(p->hash_key(key, ns));
 }
 
+/*
+ * Whether ops may be served by any replica: plain data, xattr and omap
+ * reads only.  Notably not notify/notify_ack or list_watchers, which
+ * only mean anything on the primary, nor class methods, whose side
+ * effects we can't know.
+ */
+bool Objecter::is_replica_readable(const vector<OSDOp>& ops)
+{
+  if (ops.empty())
+    return false;
+  for (vector<OSDOp>::const_iterator p = ops.begin(); p != ops.end(); ++p) {
+    switch (p->op.op) {
+    case CEPH_OSD_OP_READ:
+    case CEPH_OSD_OP_SPARSE_READ:
+    case CEPH_OSD_OP_STAT:
+    case CEPH_OSD_OP_MAPEXT:
+    case CEPH_OSD_OP_GETXATTR:
+    case CEPH_OSD_OP_GETXATTRS:
+    case CEPH_OSD_OP_CMPXATTR:
+    case CEPH_OSD_OP_OMAPGETKEYS:
+    case CEPH_OSD_OP_OMAPGETVALS:
+    case CEPH_OSD_OP_OMAPGETHEADER:
+    case CEPH_OSD_OP_OMAPGETVALSBYKEYS:
+    case CEPH_OSD_OP_OMAP_CMP:
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Pick the acting osd with the lowest recent read latency.  Only
+ * replicated pgs that look clean (up == acting, full size) qualify,
+ * and an object we have writes in flight to is always read from the
+ * primary so that we read our own writes.  An osd with no recent
+ * sample counts as fastest so that it gets probed; ties go to the
+ * primary.
+ */
+int Objecter::_pick_read_replica(op_target_t *t, pg_t pgid,
+				 const vector<int>& acting, int primary)
+{
+  assert(rwlock.is_locked());
+
+  const pg_pool_t *pi = osdmap->get_pg_pool(t->target_oloc.pool);
+  if (!pi || pi->is_erasure() || pi->is_tier() || pi->has_read_tier() ||
+      (int)acting.size() != (int)pi->get_size())
+    return primary;
+  vector<int> up, up_acting;
+  osdmap->pg_to_up_acting_osds(pgid, up, up_acting);
+  if (up != acting)
+    return primary;
+
+  Mutex::Locker l(read_balance_lock);
+  if (inflight_writes.count(make_pair(t->base_oloc.pool, t->base_oid)))
+    return primary;
+
+  // latency of each acting osd, primary first
+  utime_t now = ceph_clock_now(cct);
+  double max_age = cct->_conf->objecter_read_latency_max_age;
+  vector<int> osds(1, primary);
+  for (unsigned i = 0; i < acting.size(); ++i) {
+    if (acting[i] == CRUSH_ITEM_NONE)
+      return primary;
+    if (acting[i] != primary)
+      osds.push_back(acting[i]);
+  }
+  int best = -1;
+  double best_lat = 0;
+  for (unsigned i = 0; i < osds.size(); ++i) {
+    double lat = 0;
+    map<int, read_latency_t>::iterator p = osd_read_latency.find(osds[i]);
+    if (p != osd_read_latency.end() &&
+	(double)(now - p->second.stamp) < max_age)
+      lat = p->second.avg;
+    if (best < 0 || lat < best_lat) {
+      best = osds[i];
+      best_lat = lat;
+    }
+  }
+  if (best != primary) {
+    t->used_replica = true;
+    t->latency_replica = true;
+    ldout(cct, 10) << __func__ << " chose osd." << best << " ("
+		   << best_lat << "s) of " << acting << dendl;
+  }
+  return best;
+}
+
+void Objecter::record_read_latency(int osd, utime_t lat)
+{
+  Mutex::Locker l(read_balance_lock);
+  utime_t now = ceph_clock_now(cct);
+  read_latency_t& r = osd_read_latency[osd];
+  if (r.stamp == utime_t() ||
+      (double)(now - r.stamp) >= cct->_conf->objecter_read_latency_max_age) {
+    r.avg = lat;
+  } else {
+    double w = cct->_conf->objecter_read_latency_weight;
+    r.avg = w * (double)lat + (1.0 - w) * r.avg;
+  }
+  r.stamp = now;
+}
+
+void Objecter::inflight_write_start(Op *op)
+{
+  Mutex::Locker l(read_balance_lock);
+  ++inflight_writes[make_pair(op->target.base_oloc.pool, op->target.base_oid)];
+  op->inflight_write = true;
+}
+
+void Objecter::inflight_write_finish(Op *op)
+{
+  Mutex::Locker l(read_balance_lock);
+  map<pair<int64_t, object_t>, int>::iterator p =
+    inflight_writes.find(make_pair(op->target.base_oloc.pool,
+				   op->target.base_oid));
+  assert(p != inflight_writes.end());
+  if (--p->second == 0)
+    inflight_writes.erase(p);
+  op->inflight_write = false;
+}
+
 int Objecter::_calc_target(op_target_t *t)
 {
   assert(rwlock.is_locked());
@@ -2044,12 +2245,17 @@ int Objecter::_calc_target(op_target_t *t)
     ldout(cct, 10) << __func__ << " "
 		   << " pgid " << pgid << " acting " << acting << dendl;
     t->used_replica = false;
+    t->latency_replica = false;
     if (primary == -1) {
       t->osd = -1;
     } else {
       int osd;
       bool read = is_read && !is_write;
-      if (read && (t->flags & CEPH_OSD_FLAG_BALANCE_READS)) {
+      if (read && cct->_conf->objecter_latency_aware_reads &&
+	  t->replica_readable && !t->read_from_primary && acting.size() > 1 &&
+	  (t->flags & (CEPH_OSD_FLAG_PGOP | CEPH_OSD_FLAG_LOCALIZE_READS)) == 0) {
+	osd = _pick_read_replica(t, pgid, acting, primary);
+      } else if (read && (t->flags & CEPH_OSD_FLAG_BALANCE_READS)) {
 	int p = rand() % acting.size();
 	if (p)
 	  t->used_replica = true;
@@ -2288,6 +2494,9 @@ void Objecter::_finish_op(Op *op)
 
   logger->dec(l_osdc_op_active);
 
+  if (op->inflight_write)
+    inflight_write_finish(op);
+
   assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
 
   if (op->ontimeout) {
@@ -2321,6 +2530,8 @@ MOSDOp *Objecter::_prepare_osd_op(Op *op)
 
   int flags = op->target.flags;
   flags |= CEPH_OSD_FLAG_KNOWN_REDIR;
+  if (op->target.latency_replica)
+    flags |= CEPH_OSD_FLAG_BALANCE_READS;  // so the replica will serve it
   if (op->oncommit)
     flags |= CEPH_OSD_FLAG_ONDISK;
   if (op->onack)
@@ -2384,8 +2595,11 @@ void Objecter::_send_op(Op *op, MOSDOp *m)
   }
 
   op->incarnation = op->session->incarnation;
+  if (op->first_sent == utime_t())
+    op->first_sent = op->stamp;
 
   m->set_tid(op->tid);
+  m->set_trace_id(op->trace_id);
 
   op->session->con->send_message(m);
 }
@@ -2510,6 +2724,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   Context *oncommit = 0;
 
   int rc = m->get_result();
+  utime_t now = ceph_clock_now(cct);
 
   if (m->is_redirect_reply()) {
     ldout(cct, 5) << " got redirect reply; redirecting" << dendl;
@@ -2532,6 +2747,29 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     return;
   }
 
+  if (rc == -EAGAIN && op->target.latency_replica) {
+    // the replica we picked can't serve this (e.g. it is missing the
+    // object); go back to the primary
+    ldout(cct, 7) << " got -EAGAIN from replica, resubmitting to primary"
+		  << dendl;
+    if (op->onack)
+      num_unacked.dec();
+    if (op->oncommit)
+      num_uncommitted.dec();
+    _session_op_remove(s, op);
+    s->lock.unlock();
+    put_session(s);
+
+    op->tid = 0;
+    op->target.read_from_primary = true;
+    op->target.primary = -1;  // force a remap
+    inflight_ops.dec();
+    logger->dec(l_osdc_op_active);
+    _op_submit(op, lc, false);
+    m->put();
+    return;
+  }
+
   if (rc == -EAGAIN) {
     ldout(cct, 7) << " got -EAGAIN, resubmitting" << dendl;
 
@@ -2549,6 +2787,11 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   l.unlock();
   lc.set_state(RWLock::Context::Untaken);
 
+  if ((op->target.flags & (CEPH_OSD_FLAG_READ | CEPH_OSD_FLAG_WRITE |
+			   CEPH_OSD_FLAG_PGOP)) == CEPH_OSD_FLAG_READ &&
+      cct->_conf->objecter_latency_aware_reads)
+    record_read_latency(osd_num, now - op->stamp);
+
   if (op->objver)
     *op->objver = m->get_user_version();
   if (op->reply_epoch)
@@ -2593,6 +2836,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     op->replay_version = m->get_replay_version();
     onack = op->onack;
     op->onack = 0;  // only do callback once
+    op->acked = now;
     num_unacked.dec();
     logger->inc(l_osdc_op_ack);
   }
@@ -2600,6 +2844,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     ldout(cct, 15) << "handle_osd_op_reply safe" << dendl;
     oncommit = op->oncommit;
     op->oncommit = 0;
+    op->committed = now;
     num_uncommitted.dec();
     logger->inc(l_osdc_op_commit);
   }
@@ -2618,6 +2863,8 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   // done with this tid?
   if (!op->onack && !op->oncommit) {
     ldout(cct, 15) << "handle_osd_op_reply completed tid " << tid << dendl;
+    if (cct->_conf->objecter_latency_histograms)
+      record_op_latency(op);
     _finish_op(op);
   }
 
@@ -2660,6 +2907,49 @@ uint32_t Objecter::list_objects_seek(ListContext *list_context,
   return list_context->current_pg;
 }
 
+void Objecter::ListContext::set_pg_range(int pg_num, unsigned pg_num_mask)
+{
+  starting_pg_num = pg_num;
+  if (split_num == 0)
+    return;
+  split_buckets = 1;
+  while (split_buckets < split_num)
+    split_buckets <<= 1;
+  // an object's pg and its hash agree modulo the half of the pg mask
+  // (ceph_stable_mod), so that is how finely pgs can be told apart
+  uint32_t mod = (pg_num_mask + 1) >> 1;
+  split_pg_mod = MAX(1u, MIN(split_buckets, mod));
+  split_pg_residues.clear();
+  for (uint32_t b = 0; b < split_buckets; ++b)
+    if (bucket_in_split(b))
+      split_pg_residues.insert(b % split_pg_mod);
+}
+
+int Objecter::list_objects_split(ListContext *list_context,
+				 uint32_t split_num, uint32_t split_index)
+{
+  if (split_num == 0 || split_index >= split_num)
+    return -EINVAL;
+  RWLock::RLocker rl(rwlock);
+  const pg_pool_t *pool = osdmap->get_pg_pool(list_context->pool_id);
+  if (!pool)
+    return -ENOENT;
+  list_context->split_num = split_num;
+  list_context->split_index = split_index;
+  list_context->set_pg_range(pool->get_pg_num(), pool->get_pg_num_mask());
+  list_context->current_pg = list_context->next_split_pg(0);
+  list_context->cookie = collection_list_handle_t();
+  list_context->at_end_of_pg = false;
+  list_context->at_end_of_pool = false;
+  list_context->current_pg_epoch = 0;
+  ldout(cct, 10) << "list_objects_split " << list_context
+		 << " " << split_index << "/" << split_num
+		 << " buckets " << list_context->split_buckets
+		 << " pg residues " << list_context->split_pg_residues
+		 << " mod " << list_context->split_pg_mod << dendl;
+  return 0;
+}
+
 void Objecter::list_objects(ListContext *list_context, Context *onfinish)
 {
   ldout(cct, 10) << "list_objects" << dendl;
@@ -2673,7 +2963,8 @@ void Objecter::list_objects(ListContext *list_context, Context *onfinish)
 
   if (list_context->at_end_of_pg) {
     list_context->at_end_of_pg = false;
-    ++list_context->current_pg;
+    list_context->current_pg =
+      list_context->next_split_pg(list_context->current_pg + 1);
     list_context->current_pg_epoch = 0;
     list_context->cookie = collection_list_handle_t();
     if (list_context->current_pg >= list_context->starting_pg_num) {
@@ -2683,29 +2974,46 @@ void Objecter::list_objects(ListContext *list_context, Context *onfinish)
       ldout(cct, 20) << " move to next pg " << list_context->current_pg << dendl;
     }
   }
-  if (list_context->at_end_of_pool) {
-    onfinish->complete(0);
-    return;
-  }
 
   rwlock.get_read();
   const pg_pool_t *pool = osdmap->get_pg_pool(list_context->pool_id);
   int pg_num = pool->get_pg_num();
+  unsigned pg_num_mask = pool->get_pg_num_mask();
   rwlock.unlock();
 
+  if (list_context->split_num &&
+      list_context->starting_pg_num != pg_num) {
+    // objects may have moved to pgs we have passed or will not read;
+    // the caller has to list this split again
+    ldout(cct, 10) << " pg_num changed to " << pg_num
+		   << " during split listing" << dendl;
+    onfinish->complete(-ESTALE);
+    return;
+  }
+  if (list_context->at_end_of_pool) {
+    onfinish->complete(0);
+    return;
+  }
+
   if (list_context->starting_pg_num == 0) {     // there can't be zero pgs!
-    list_context->starting_pg_num = pg_num;
+    list_context->set_pg_range(pg_num, pg_num_mask);
     ldout(cct, 20) << pg_num << " placement groups" << dendl;
   }
   if (list_context->starting_pg_num != pg_num) {
     // start reading from the beginning; the pgs have changed
     ldout(cct, 10) << " pg_num changed; restarting with " << pg_num << dendl;
     list_context->current_pg = 0;
+    list_context->set_pg_range(pg_num, pg_num_mask);
     list_context->cookie = collection_list_handle_t();
     list_context->current_pg_epoch = 0;
-    list_context->starting_pg_num = pg_num;
   }
   assert(list_context->current_pg <= pg_num);
+  if (list_context->current_pg >= pg_num) {
+    ldout(cct, 20) << " split is empty; reached end of pool" << dendl;
+    list_context->at_end_of_pool = true;
+    onfinish->complete(0);
+    return;
+  }
 
   ObjectOperation op;
   op.pg_ls(list_context->max_entries, list_context->filter, list_context->cookie,
@@ -2742,7 +3050,22 @@ void Objecter::_list_reply(ListContext *list_context, int r,
   ldout(cct, 20) << " response.entries.size " << response_size
 		 << ", response.entries " << response.entries << dendl;
   list_context->extra_info.append(extra_info);
-  if (response_size) {
+  if (list_context->split_num) {
+    rwlock.get_read();
+    const pg_pool_t *pool = osdmap->get_pg_pool(list_context->pool_id);
+    for (list<pair<object_t, string> >::iterator p =
+	   response.entries.begin();
+	 p != response.entries.end(); ) {
+      const string &key = p->second.empty() ? p->first.name : p->second;
+      if (pool && list_context->hash_in_split(
+	    pool->hash_key(key, list_context->nspace)))
+	++p;
+      else
+	response.entries.erase(p++);
+    }
+    rwlock.unlock();
+  }
+  if (!response.entries.empty()) {
     list_context->list.merge(response.entries);
   }
 
@@ -3453,6 +3776,76 @@ void Objecter::dump_requests(Formatter *fmt)
   fmt->close_section(); // requests object
 }
 
+static void hist_add_usec(pow2_hist_t& h, utime_t from, utime_t to)
+{
+  if (from == utime_t() || to < from)
+    return;
+  utime_t d = to - from;
+  h.add((int32_t)MIN(d.to_nsec() / 1000, (uint64_t)INT_MAX));
+}
+
+void Objecter::op_latency_hist_t::clear()
+{
+  throttle.clear();
+  queue.clear();
+  ack.clear();
+  commit.clear();
+  total.clear();
+}
+
+void Objecter::op_latency_hist_t::dump(Formatter *f) const
+{
+  f->open_object_section("throttle");
+  throttle.dump(f);
+  f->close_section();
+  f->open_object_section("queue");
+  queue.dump(f);
+  f->close_section();
+  f->open_object_section("ack");
+  ack.dump(f);
+  f->close_section();
+  f->open_object_section("commit");
+  commit.dump(f);
+  f->close_section();
+  f->open_object_section("total");
+  total.dump(f);
+  f->close_section();
+}
+
+void Objecter::record_op_latency(Op *op)
+{
+  utime_t now = ceph_clock_now(cct);
+  Mutex::Locker l(op_latency_lock);
+  op_latency_hist_t& h = (op->target.flags & CEPH_OSD_FLAG_WRITE) ?
+    write_op_latency : read_op_latency;
+  hist_add_usec(h.throttle, op->submitted, op->throttled);
+  hist_add_usec(h.queue, op->throttled, op->first_sent);
+  hist_add_usec(h.ack, op->first_sent, op->acked);
+  hist_add_usec(h.commit, op->first_sent, op->committed);
+  hist_add_usec(h.total, op->submitted, now);
+}
+
+void Objecter::dump_op_latency(Formatter *fmt)
+{
+  Mutex::Locker l(op_latency_lock);
+  fmt->open_object_section("op_latency");
+  fmt->dump_string("units", "usec");
+  fmt->open_object_section("read");
+  read_op_latency.dump(fmt);
+  fmt->close_section();
+  fmt->open_object_section("write");
+  write_op_latency.dump(fmt);
+  fmt->close_section();
+  fmt->close_section();
+}
+
+void Objecter::reset_op_latency()
+{
+  Mutex::Locker l(op_latency_lock);
+  read_op_latency.clear();
+  write_op_latency.clear();
+}
+
 void Objecter::_dump_ops(const OSDSession *s, Formatter *fmt)
 {
   for (map<ceph_tid_t,Op*>::const_iterator p = s->ops.begin();
@@ -3462,7 +3855,14 @@ void Objecter::_dump_ops(const OSDSession *s, Formatter *fmt)
     fmt->open_object_section("op");
     fmt->dump_unsigned("tid", op->tid);
     op->target.dump(fmt);
+    if (op->trace_id)
+      fmt->dump_unsigned("trace_id", op->trace_id);
+    fmt->dump_stream("submitted") << op->submitted;
+    fmt->dump_stream("throttled") << op->throttled;
+    fmt->dump_stream("first_sent") << op->first_sent;
     fmt->dump_stream("last_sent") << op->stamp;
+    if (op->acked != utime_t())
+      fmt->dump_stream("acked") << op->acked;
     fmt->dump_int("attempts", op->attempts);
     fmt->dump_stream("snapid") << op->snapid;
     fmt->dump_stream("snap_context") << op->snapc;
@@ -3632,8 +4032,14 @@ bool Objecter::RequestStateHook::call(std::string command, cmdmap_t& cmdmap,
   Formatter *f = new_formatter(format);
   if (!f)
     f = new_formatter("json-pretty");
-  RWLock::RLocker rl(m_objecter->rwlock);
-  m_objecter->dump_requests(f);
+  if (command == "objecter_latency") {
+    m_objecter->dump_op_latency(f);
+  } else if (command == "objecter_latency_reset") {
+    m_objecter->reset_op_latency();
+  } else {
+    RWLock::RLocker rl(m_objecter->rwlock);
+    m_objecter->dump_requests(f);
+  }
   f->flush(out);
   delete f;
   return true;
@@ -22,6 +22,7 @@
 #include "messages/MOSDOp.h"
 
 #include "common/admin_socket.h"
+#include "common/histogram.h"
 #include "common/Timer.h"
 #include "common/RWLock.h"
 #include "include/rados/rados_types.h"
@@ -75,6 +76,19 @@ struct ObjectOperation {
     ops.rbegin()->op.flags = flags;
   }
 
+  /// take over sops, returning the results and out data into them
+  void dup(vector<OSDOp>& sops) {
+    ops = sops;
+    out_bl.resize(sops.size());
+    out_handler.resize(sops.size());
+    out_rval.resize(sops.size());
+    for (unsigned i = 0; i < sops.size(); i++) {
+      out_bl[i] = &sops[i].outdata;
+      out_handler[i] = NULL;
+      out_rval[i] = &sops[i].rval;
+    }
+  }
+
   /**
    * This is a more limited form of C_Contexts, but that requires
    * a ceph_context which we don't have here.
@@ -1049,6 +1063,19 @@ private:
   void schedule_tick();
   void tick();
 
+  /// latency of completed ops, in microseconds, split by stage
+  struct op_latency_hist_t {
+    pow2_hist_t throttle;  ///< submitted -> throttled: waiting for budget
+    pow2_hist_t queue;     ///< throttled -> first sent: waiting for a map or session
+    pow2_hist_t ack;       ///< first sent -> acked: network and osd
+    pow2_hist_t commit;    ///< first sent -> committed (writes)
+    pow2_hist_t total;     ///< submitted -> completed
+    void clear();
+    void dump(Formatter *f) const;
+  };
+  Mutex op_latency_lock;
+  op_latency_hist_t read_op_latency, write_op_latency;
+
   class RequestStateHook : public AdminSocketHook {
     Objecter *m_objecter;
   public:
@@ -1081,6 +1108,9 @@ public:
     int primary;         ///< primary for last pg we mapped to
 
     bool used_replica;
+    bool latency_replica;   ///< used_replica, chosen by read latency
+    bool read_from_primary; ///< a replica turned us away; don't pick one again
+    bool replica_readable;  ///< only plain reads; set by _op_submit for non-linger ops
     bool paused;
 
     int osd;      ///< the final target osd, or -1
@@ -1092,6 +1122,9 @@ public:
 	precalc_pgid(false),
 	primary(-1),
 	used_replica(false),
+	latency_replica(false),
+	read_from_primary(false),
+	replica_readable(false),
 	paused(false),
 	osd(-1)
     {}
@@ -1128,7 +1161,18 @@ public:
     version_t *objver;
     epoch_t *reply_epoch;
 
-    utime_t stamp;
+    utime_t stamp;  ///< when last sent
+
+    // when the op reached each stage, for objecter_requests and the
+    // latency histograms
+    utime_t submitted;   ///< handed to op_submit()
+    utime_t throttled;   ///< got its budget
+    utime_t first_sent;  ///< first sent to an osd
+    utime_t acked;
+    utime_t committed;
+
+    /// sent to the osd in MOSDOp so its TrackedOp can be matched up; 0 if none
+    uint64_t trace_id;
 
     epoch_t map_dne_bound;
 
@@ -1137,6 +1181,9 @@ public:
     /// true if we should resend this message on failure
     bool should_resend;
 
+    /// true while counted in inflight_writes
+    bool inflight_write;
+
     Op(const object_t& o, const object_locator_t& ol, vector<OSDOp>& op,
        int f, Context *ac, Context *co, version_t *ov) :
       session(NULL), incarnation(0),
@@ -1148,9 +1195,11 @@ public:
       ontimeout(NULL),
       tid(0), attempts(0),
       objver(ov), reply_epoch(NULL),
+      trace_id(0),
       map_dne_bound(0),
       budgeted(false),
-      should_resend(true) {
+      should_resend(true),
+      inflight_write(false) {
       ops.swap(op);
       
       /* initialize out_* to match op vector */
@@ -1243,6 +1292,18 @@ public:
     bool at_end_of_pool;
     bool at_end_of_pg;
 
+    // With split_num > 0 only objects whose hash bucket (the low bits
+    // of the object hash, split_buckets of them) belongs to split_index
+    // are listed.  A bucket does not depend on pg_num, so the splits
+    // stay disjoint while pgs split.  Only pgs that can hold our
+    // buckets (pg % split_pg_mod in split_pg_residues) are read.
+    // split_num 0 lists the whole pool.
+    uint32_t split_num;
+    uint32_t split_index;
+    uint32_t split_buckets;
+    uint32_t split_pg_mod;
+    set<uint32_t> split_pg_residues;
+
     int64_t pool_id;
     int pool_snap_seq;
     int max_entries;
@@ -1258,6 +1319,8 @@ public:
     ListContext() : current_pg(0), current_pg_epoch(0), starting_pg_num(0),
 		    at_end_of_pool(false),
 		    at_end_of_pg(false),
+		    split_num(0), split_index(0), split_buckets(1),
+		    split_pg_mod(1),
 		    pool_id(0),
 		    pool_snap_seq(0), max_entries(0) {}
 
@@ -1268,6 +1331,24 @@ public:
     uint32_t get_pg_hash_position() const {
       return current_pg;
     }
+
+    bool bucket_in_split(uint32_t bucket) const {
+      return (uint64_t)bucket * split_num / split_buckets == split_index;
+    }
+    /// true if an object with this hash belongs to our split
+    bool hash_in_split(uint32_t hash) const {
+      return split_num == 0 || bucket_in_split(hash & (split_buckets - 1));
+    }
+    /// first pg >= pg that may hold objects of our split
+    int next_split_pg(int pg) const {
+      if (split_num == 0)
+	return pg;
+      while (pg < starting_pg_num &&
+	     !split_pg_residues.count(pg % split_pg_mod))
+	++pg;
+      return pg;
+    }
+    void set_pg_range(int pg_num, unsigned pg_num_mask);
   };
 
   struct C_List : public Context {
@@ -1514,6 +1595,13 @@ public:
 
   bool target_should_be_paused(op_target_t *op);
   int _calc_target(op_target_t *t);
+  static bool is_replica_readable(const vector<OSDOp>& ops);
+  int _pick_read_replica(op_target_t *t, pg_t pgid, const vector<int>& acting,
+			 int primary);
+  void record_read_latency(int osd, utime_t lat);
+  void record_op_latency(Op *op);
+  void inflight_write_start(Op *op);
+  void inflight_write_finish(Op *op);
   int _map_session(op_target_t *op, OSDSession **s,
 		   RWLock::Context& lc);
 
@@ -1586,6 +1674,17 @@ public:
   }
   Throttle op_throttle_bytes, op_throttle_ops;
 
+  // latency-aware replica reads (objecter_latency_aware_reads)
+  struct read_latency_t {
+    double avg;     ///< moving average of read latency, in seconds
+    utime_t stamp;  ///< when the last sample was taken
+    read_latency_t() : avg(0) {}
+  };
+  Mutex read_balance_lock;
+  map<int, read_latency_t> osd_read_latency;
+  /// (pool, oid) -> number of our writes in flight to it
+  map<pair<int64_t, object_t>, int> inflight_writes;
+
  public:
   Objecter(CephContext *cct_, Messenger *m, MonClient *mc,
 	   double mon_timeout,
@@ -1604,13 +1703,15 @@ public:
     rwlock("Objecter::rwlock"),
     timer(cct, rwlock),
     logger(NULL), tick_event(NULL),
+    op_latency_lock("Objecter::op_latency_lock"),
     m_request_state_hook(NULL),
     num_homeless_ops(0),
     homeless_session(new OSDSession(cct, -1)),
     mon_timeout(mon_timeout),
     osd_timeout(osd_timeout),
     op_throttle_bytes(cct, "objecter_bytes", cct->_conf->objecter_inflight_op_bytes),
-    op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops)
+    op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops),
+    read_balance_lock("Objecter::read_balance_lock")
   { }
   ~Objecter();
 
@@ -1678,13 +1779,25 @@ private:
   bool _promote_lock_check_race(RWLock::Context& lc);
 
   // low-level
-  ceph_tid_t _op_submit(Op *op, RWLock::Context& lc);
+  ceph_tid_t _op_submit(Op *op, RWLock::Context& lc, bool count=true);
+  void _count_op(Op *op);
   ceph_tid_t _op_submit_with_budget(Op *op, RWLock::Context& lc);
   inline void unregister_op(Op *op);
 
   // public interface
 public:
   ceph_tid_t op_submit(Op *op);
+  /**
+   * submit many independent ops at once
+   *
+   * The ops are mapped up front and submitted ordered by target osd,
+   * so each session gets its share of the batch back to back under a
+   * single hold of rwlock.
+   *
+   * @param ops the ops to submit
+   * @param ptids [out] tid of each op, in the order of ops (optional)
+   */
+  void op_submit_batch(const vector<Op*>& ops, vector<ceph_tid_t> *ptids=NULL);
   bool is_active() {
     return !((!inflight_ops.read()) && linger_ops.empty() && poolstat_ops.empty() && statfs_ops.empty());
   }
@@ -1696,6 +1809,8 @@ public:
   void _dump_active();
   void dump_active();
   void dump_requests(Formatter *fmt);
+  void dump_op_latency(Formatter *fmt);
+  void reset_op_latency();
   void _dump_ops(const OSDSession *s, Formatter *fmt);
   void dump_ops(Formatter *fmt);
   void _dump_linger_ops(const OSDSession *s, Formatter *fmt);
@@ -2160,6 +2275,8 @@ public:
 
   void list_objects(ListContext *p, Context *onfinish);
   uint32_t list_objects_seek(ListContext *p, uint32_t pos);
+  int list_objects_split(ListContext *p, uint32_t split_num,
+			 uint32_t split_index);
 
   // -------------------------
   // pool ops
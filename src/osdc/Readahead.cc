@@ -0,0 +1,242 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <algorithm>
+#include <functional>
+
+#include "osdc/Readahead.h"
+
+Readahead::Readahead()
+  : m_lock("Readahead::m_lock"),
+    m_trigger_requests(10),
+    m_min_readahead_size(128 * 1024),
+    m_max_readahead_size(512 * 1024),
+    m_last_offset(0),
+    m_last_end(0),
+    m_stride(0),
+    m_nr_consec(0),
+    m_window(128 * 1024),
+    m_ra_end(0),
+    m_pending_lock("Readahead::m_pending_lock"),
+    m_pending(0)
+{
+}
+
+Readahead::~Readahead()
+{
+}
+
+void Readahead::update(uint64_t offset, uint64_t length, uint64_t limit,
+		       update_t *result)
+{
+  Mutex::Locker l(m_lock);
+  if (length == 0)
+    return;
+
+  uint64_t read_end = offset + length;
+  bool sequential = offset == m_last_end;
+  uint64_t stride = offset > m_last_offset ? offset - m_last_offset : 0;
+  bool match = m_stride ? stride == m_stride : sequential;
+
+  if (match) {
+    ++m_nr_consec;
+    _account(offset, length, result);
+  } else {
+    // new stream; whatever we prefetched for the old one is wasted
+    result->waste_bytes += _discard();
+    m_ra_end = 0;
+    if (sequential) {
+      m_stride = 0;
+      m_nr_consec = 1;
+    } else if (stride > m_last_end - m_last_offset) {
+      m_stride = stride;
+      m_nr_consec = 1;
+    } else {
+      m_stride = 0;
+      m_nr_consec = 0;
+    }
+  }
+  m_last_offset = offset;
+  m_last_end = read_end;
+
+  if (m_nr_consec < m_trigger_requests || m_max_readahead_size == 0)
+    return;
+
+  if (m_stride)
+    _prefetch_strided(offset, length, limit, result);
+  else
+    _prefetch_sequential(read_end, limit, result);
+}
+
+void Readahead::reset()
+{
+  Mutex::Locker l(m_lock);
+  m_unread.clear();
+  m_last_offset = 0;
+  m_last_end = 0;
+  m_stride = 0;
+  m_nr_consec = 0;
+  m_ra_end = 0;
+}
+
+void Readahead::_account(uint64_t offset, uint64_t length, update_t *result)
+{
+  assert(m_lock.is_locked());
+  uint64_t read_end = offset + length;
+  std::list<extent_t>::iterator p = m_unread.begin();
+  while (p != m_unread.end() && p->first < read_end) {
+    if (p->second <= offset) {
+      // skipped over entirely
+      result->waste_bytes += p->second - p->first;
+      m_unread.erase(p++);
+      continue;
+    }
+    uint64_t start = MAX(p->first, offset);
+    uint64_t end = MIN(p->second, read_end);
+    result->hit_bytes += end - start;
+    result->waste_bytes += start - p->first;
+    if (p->second <= read_end) {
+      m_unread.erase(p++);
+    } else {
+      p->first = read_end;
+      break;
+    }
+  }
+}
+
+uint64_t Readahead::_discard()
+{
+  assert(m_lock.is_locked());
+  uint64_t unread = 0;
+  for (std::list<extent_t>::iterator p = m_unread.begin();
+       p != m_unread.end();
+       ++p)
+    unread += p->second - p->first;
+  m_unread.clear();
+  if (unread)
+    _shrink();
+  return unread;
+}
+
+void Readahead::_grow()
+{
+  m_window = MIN(m_window * 2, m_max_readahead_size);
+}
+
+void Readahead::_shrink()
+{
+  m_window = MAX(m_window / 2, m_min_readahead_size);
+}
+
+void Readahead::_prefetch_sequential(uint64_t read_end, uint64_t limit,
+				     update_t *result)
+{
+  assert(m_lock.is_locked());
+  uint64_t ahead = m_ra_end > read_end ? m_ra_end - read_end : 0;
+  if (ahead > m_window / 2)
+    return;  // still plenty in flight
+
+  // the reader caught up with readahead it consumed; widen the window
+  if (m_ra_end)
+    _grow();
+
+  uint64_t start = MAX(read_end, m_ra_end);
+  uint64_t end = MIN(read_end + m_window, limit);
+  for (std::vector<uint64_t>::iterator p = m_alignments.begin();
+       p != m_alignments.end();
+       ++p) {
+    uint64_t aligned = end - end % *p;
+    if (aligned > start) {
+      end = aligned;
+      break;
+    }
+  }
+  if (end <= start)
+    return;
+
+  result->extents.push_back(extent_t(start, end - start));
+  result->bytes += end - start;
+  m_unread.push_back(extent_t(start, end));
+  m_ra_end = end;
+}
+
+void Readahead::_prefetch_strided(uint64_t offset, uint64_t length,
+				  uint64_t limit, update_t *result)
+{
+  assert(m_lock.is_locked());
+  uint64_t blocks = MAX(m_window / length, (uint64_t)1);
+  if (m_unread.size() > blocks / 2)
+    return;
+
+  if (m_ra_end) {
+    _grow();
+    blocks = MAX(m_window / length, (uint64_t)1);
+  }
+
+  uint64_t next = m_unread.empty() ? offset + m_stride :
+    m_unread.back().first + m_stride;
+  uint64_t last = offset + blocks * m_stride;
+  for (; next <= last && next + length <= limit; next += m_stride) {
+    result->extents.push_back(extent_t(next, length));
+    result->bytes += length;
+    m_unread.push_back(extent_t(next, next + length));
+    m_ra_end = next + length;
+  }
+}
+
+void Readahead::inc_pending(int count)
+{
+  assert(count > 0);
+  Mutex::Locker l(m_pending_lock);
+  m_pending += count;
+}
+
+void Readahead::dec_pending(int count)
+{
+  assert(count > 0);
+  Mutex::Locker l(m_pending_lock);
+  assert(m_pending >= count);
+  m_pending -= count;
+  if (m_pending == 0)
+    m_pending_cond.Signal();
+}
+
+void Readahead::wait_for_pending()
+{
+  Mutex::Locker l(m_pending_lock);
+  while (m_pending > 0)
+    m_pending_cond.Wait(m_pending_lock);
+}
+
+void Readahead::set_trigger_requests(int trigger_requests)
+{
+  Mutex::Locker l(m_lock);
+  m_trigger_requests = trigger_requests;
+}
+
+void Readahead::set_min_readahead_size(uint64_t min_readahead_size)
+{
+  Mutex::Locker l(m_lock);
+  m_min_readahead_size = min_readahead_size;
+  m_window = MIN(m_min_readahead_size, m_max_readahead_size);
+}
+
+void Readahead::set_max_readahead_size(uint64_t max_readahead_size)
+{
+  Mutex::Locker l(m_lock);
+  m_max_readahead_size = max_readahead_size;
+  m_window = MIN(m_window, m_max_readahead_size);
+}
+
+void Readahead::set_alignments(const std::vector<uint64_t> &alignments)
+{
+  Mutex::Locker l(m_lock);
+  m_alignments.clear();
+  for (std::vector<uint64_t>::const_iterator p = alignments.begin();
+       p != alignments.end();
+       ++p)
+    if (*p)
+      m_alignments.push_back(*p);
+  std::sort(m_alignments.begin(), m_alignments.end(),
+	    std::greater<uint64_t>());
+}
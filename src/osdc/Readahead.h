@@ -0,0 +1,117 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_OSDC_READAHEAD_H
+#define CEPH_OSDC_READAHEAD_H
+
+#include <list>
+#include <vector>
+
+#include "include/types.h"
+#include "common/Mutex.h"
+#include "common/Cond.h"
+
+/**
+ * Readahead state for one ObjectSet.
+ *
+ * Watches the reads made against an ObjectSet and decides what to
+ * prefetch.  A stream is either sequential (each read starts where the
+ * last one ended) or strided (each read starts a constant distance
+ * past the start of the last one).  Once trigger_requests reads in a
+ * row follow the same pattern we start prefetching ahead of the
+ * reader.
+ *
+ * The window starts at the minimum size and doubles each time the
+ * reader catches up with readahead it consumed in full.  It halves
+ * whenever the stream breaks with prefetched data still unread.
+ * Sequential readahead is trimmed back to the largest alignment
+ * boundary (e.g. stripe period or stripe unit) that still leaves
+ * something to read, and never extends past the limit passed to
+ * update().
+ *
+ * The caller issues the returned extents (typically an
+ * ObjectCacher::readx() with no destination bufferlist), calling
+ * inc_pending() for each and dec_pending() as each completes, and
+ * calls wait_for_pending() before tearing the cache down.
+ */
+class Readahead {
+public:
+  typedef std::pair<uint64_t, uint64_t> extent_t;
+
+  /// outcome of a single update()
+  struct update_t {
+    std::vector<extent_t> extents;  ///< ranges to prefetch, in order
+    uint64_t bytes;                 ///< total length of extents
+    uint64_t hit_bytes;             ///< bytes of this read covered by earlier readahead
+    uint64_t waste_bytes;           ///< earlier readahead given up on unread
+    update_t() : bytes(0), hit_bytes(0), waste_bytes(0) {}
+  };
+
+  Readahead();
+  ~Readahead();
+
+  /**
+   * note a read and compute what to prefetch next
+   *
+   * @param offset start of the read
+   * @param length length of the read
+   * @param limit readahead never extends past this offset
+   * @param result [out] what to prefetch, plus hit/waste accounting
+   */
+  void update(uint64_t offset, uint64_t length, uint64_t limit,
+	      update_t *result);
+
+  /// forget the current stream (e.g. after the ObjectSet is invalidated)
+  void reset();
+
+  void inc_pending(int count = 1);
+  void dec_pending(int count = 1);
+  void wait_for_pending();
+
+  void set_trigger_requests(int trigger_requests);
+  void set_min_readahead_size(uint64_t min_readahead_size);
+  void set_max_readahead_size(uint64_t max_readahead_size);
+
+  /**
+   * set the boundaries sequential readahead should end on
+   *
+   * @param alignments boundaries in bytes, any order; 0 entries are ignored
+   */
+  void set_alignments(const std::vector<uint64_t> &alignments);
+
+private:
+  void _account(uint64_t offset, uint64_t length, update_t *result);
+  uint64_t _discard();
+  void _grow();
+  void _shrink();
+  void _prefetch_sequential(uint64_t read_end, uint64_t limit,
+			    update_t *result);
+  void _prefetch_strided(uint64_t offset, uint64_t length, uint64_t limit,
+			 update_t *result);
+
+  Mutex m_lock;
+
+  // tunables
+  int m_trigger_requests;
+  uint64_t m_min_readahead_size;
+  uint64_t m_max_readahead_size;
+  std::vector<uint64_t> m_alignments;  ///< sorted largest first
+
+  // stream detection
+  uint64_t m_last_offset;
+  uint64_t m_last_end;
+  uint64_t m_stride;    ///< 0 for a sequential stream
+  int m_nr_consec;      ///< reads in a row matching the stream
+
+  // readahead issued for the current stream
+  uint64_t m_window;
+  uint64_t m_ra_end;    ///< end of the furthest extent prefetched
+  std::list<extent_t> m_unread;  ///< prefetched (offset, end) not yet read
+
+  // outstanding prefetches
+  Mutex m_pending_lock;
+  Cond m_pending_cond;
+  int m_pending;
+};
+
+#endif
@@ -181,6 +181,18 @@ public:
 
   static Action::ptr read_from(Action &src, Deser &d);
 
+  imagectx_id_t imagectx_id() const {
+    return m_imagectx_id;
+  }
+
+  uint64_t offset() const {
+    return m_offset;
+  }
+
+  uint64_t length() const {
+    return m_length;
+  }
+
 private:
   std::ostream& dump(std::ostream& o) const;
 
@@ -201,6 +213,18 @@ public:
 
   static Action::ptr read_from(Action &src, Deser &d);
 
+  imagectx_id_t imagectx_id() const {
+    return m_imagectx_id;
+  }
+
+  uint64_t offset() const {
+    return m_offset;
+  }
+
+  uint64_t length() const {
+    return m_length;
+  }
+
 private:
   std::ostream& dump(std::ostream& o) const;
 
@@ -221,6 +245,18 @@ public:
 
   static Action::ptr read_from(Action &src, Deser &d);
 
+  imagectx_id_t imagectx_id() const {
+    return m_imagectx_id;
+  }
+
+  uint64_t offset() const {
+    return m_offset;
+  }
+
+  uint64_t length() const {
+    return m_length;
+  }
+
 private:
   std::ostream& dump(std::ostream& o) const;
 
@@ -241,6 +277,18 @@ public:
 
   static Action::ptr read_from(Action &src, Deser &d);
 
+  imagectx_id_t imagectx_id() const {
+    return m_imagectx_id;
+  }
+
+  uint64_t offset() const {
+    return m_offset;
+  }
+
+  uint64_t length() const {
+    return m_length;
+  }
+
 private:
   std::ostream& dump(std::ostream& o) const;
 
@@ -200,6 +200,41 @@ TEST_F(ThrottleTest, wait) {
   } while(!waited);
 }
 
+TEST_F(ThrottleTest, concurrent_put) {
+  // put() skips the lock when no one is waiting; make sure a waiter
+  // racing with the last put is never left behind.
+  class Thread_churn : public Thread {
+  public:
+    Throttle &throttle;
+    int rounds;
+    Thread_churn(Throttle& _throttle, int _rounds) :
+      throttle(_throttle), rounds(_rounds) {}
+    virtual void *entry() {
+      for (int i = 0; i < rounds; i++) {
+	throttle.get(1);
+	throttle.put(1);
+	throttle.take(1);
+	throttle.put(1);
+      }
+      return NULL;
+    }
+  };
+
+  int64_t throttle_max = 2;
+  Throttle throttle(g_ceph_context, "throttle", throttle_max);
+  const int nthreads = 8;
+  Thread_churn *threads[nthreads];
+  for (int i = 0; i < nthreads; i++) {
+    threads[i] = new Thread_churn(throttle, 10000);
+    threads[i]->create();
+  }
+  for (int i = 0; i < nthreads; i++) {
+    threads[i]->join();
+    delete threads[i];
+  }
+  ASSERT_EQ(0, throttle.get_current());
+}
+
 TEST_F(ThrottleTest, destructor) {
   Thread_get *t;
   {
@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/types.h"
+#include "include/xor_region.h"
+#include "include/utime.h"
+#include "common/Clock.h"
+
+#include "gtest/gtest.h"
+
+static void fill(unsigned char *p, unsigned len, unsigned seed)
+{
+  for (unsigned i = 0; i < len; i++)
+    p[i] = (i * 31 + seed * 17) & 0xff;
+}
+
+static void check(ceph_xor_region_func_t f, unsigned offset,
+		  int src_size, unsigned size)
+{
+  unsigned char *buf[src_size + 1];
+  for (int i = 0; i <= src_size; i++) {
+    ASSERT_EQ(0, posix_memalign((void **)&buf[i], 64, size + offset));
+    fill(buf[i] + offset, size, i);
+  }
+  unsigned char *src[src_size];
+  for (int i = 0; i < src_size; i++)
+    src[i] = buf[i] + offset;
+  unsigned char *parity = buf[src_size] + offset;
+  f(src, parity, src_size, size);
+  for (unsigned b = 0; b < size; b++) {
+    unsigned char expect = 0;
+    for (int i = 0; i < src_size; i++)
+      expect ^= src[i][b];
+    ASSERT_EQ(expect, parity[b]) << " offset " << offset
+				 << " src_size " << src_size
+				 << " byte " << b;
+  }
+  for (int i = 0; i <= src_size; i++)
+    free(buf[i]);
+}
+
+static void check_all(ceph_xor_region_func_t f)
+{
+  unsigned sizes[] = { 1, 7, 64, 100, 4096, 4096 + 33 };
+  unsigned offsets[] = { 0, 1, 8, 16 };
+  for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    for (unsigned o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++)
+      for (int n = 1; n <= 5; n++)
+	check(f, offsets[o], n, sizes[s]);
+}
+
+TEST(XorRegion, Generic) {
+  check_all(ceph_xor_region_generic);
+}
+
+TEST(XorRegion, SSE2) {
+  if (!ceph_xor_region_sse2_exists()) {
+    std::cout << "sse2 kernel not compiled in, skipping" << std::endl;
+    return;
+  }
+  check_all(ceph_xor_region_sse2);
+}
+
+TEST(XorRegion, BestChoice) {
+  check_all(ceph_xor_region);
+}
+
+TEST(XorRegion, InPlace) {
+  unsigned size = 4096;
+  unsigned char *a, *b;
+  ASSERT_EQ(0, posix_memalign((void **)&a, 64, size));
+  ASSERT_EQ(0, posix_memalign((void **)&b, 64, size));
+  fill(a, size, 1);
+  fill(b, size, 2);
+  unsigned char *src[] = { a, b };
+  ceph_xor_region(src, a, 2, size);
+  ceph_xor_region(src, a, 2, size);
+  for (unsigned i = 0; i < size; i++)
+    ASSERT_EQ((unsigned char)((i * 31 + 17) & 0xff), a[i]);
+  free(a);
+  free(b);
+}
+
+static void bench(const char *name, ceph_xor_region_func_t f,
+		  unsigned char **src, unsigned char *parity,
+		  int src_size, unsigned size)
+{
+  int rounds = 16;
+  utime_t start = ceph_clock_now(NULL);
+  for (int i = 0; i < rounds; i++)
+    f(src, parity, src_size, size);
+  utime_t end = ceph_clock_now(NULL);
+  float rate = (float)size * src_size * rounds / (float)(1024*1024) /
+    (float)(end - start);
+  std::cout << name << " = " << rate << " MB/sec" << std::endl;
+}
+
+TEST(XorRegion, Performance) {
+  int src_size = 6;
+  unsigned size = 16 * 1024 * 1024;
+  unsigned char *src[src_size];
+  for (int i = 0; i < src_size; i++) {
+    ASSERT_EQ(0, posix_memalign((void **)&src[i], 64, size));
+    fill(src[i], size, i);
+  }
+  unsigned char *parity;
+  ASSERT_EQ(0, posix_memalign((void **)&parity, 64, size));
+
+  bench("best choice", ceph_xor_region, src, parity, src_size, size);
+  bench("generic", ceph_xor_region_generic, src, parity, src_size, size);
+  if (ceph_xor_region_sse2_exists())
+    bench("sse2", ceph_xor_region_sse2, src, parity, src_size, size);
+
+  for (int i = 0; i < src_size; i++)
+    free(src[i]);
+  free(parity);
+}
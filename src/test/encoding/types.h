@@ -92,10 +92,10 @@ TYPE(ECSubRead)
 TYPE(ECSubReadReply)
 
 #include "osd/HitSet.h"
-TYPE(ExplicitHashHitSet)
-TYPE(ExplicitObjectHitSet)
-TYPE(BloomHitSet)
-TYPE(HitSet)
+TYPE_FEATUREFUL(ExplicitHashHitSet)
+TYPE_FEATUREFUL(ExplicitObjectHitSet)
+TYPE_FEATUREFUL(BloomHitSet)
+TYPE_FEATUREFUL(HitSet)
 TYPE(HitSet::Params)
 
 #include "os/ObjectStore.h"
@@ -0,0 +1,257 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <errno.h>
+
+#include "crush/CrushWrapper.h"
+#include "include/stringify.h"
+#include "global/global_init.h"
+#include "erasure-code/lrc/ErasureCodeLrc.h"
+#include "common/ceph_argparse.h"
+#include "global/global_context.h"
+#include "gtest/gtest.h"
+
+// k=4 m=2 l=3 : positions 0 1 2 (3) 4 5 6 (7) where 3 and 7 are the
+// local parities and 0 1 2 4 are the data chunks
+static void init(ErasureCodeLrc &lrc)
+{
+  map<std::string,std::string> parameters;
+  parameters["directory"] = ".libs";
+  parameters["k"] = "4";
+  parameters["m"] = "2";
+  parameters["l"] = "3";
+  stringstream ss;
+  EXPECT_EQ(0, lrc.init(parameters, &ss));
+}
+
+TEST(ErasureCodeLrc, parse)
+{
+  map<std::string,std::string> parameters;
+  parameters["directory"] = ".libs";
+  parameters["k"] = "4";
+  parameters["m"] = "2";
+  parameters["l"] = "4";
+  {
+    ErasureCodeLrc lrc;
+    stringstream ss;
+    EXPECT_EQ(-EINVAL, lrc.init(parameters, &ss));
+  }
+  parameters["l"] = "3";
+  parameters["layer-plugin"] = "does_not_exist";
+  {
+    ErasureCodeLrc lrc;
+    stringstream ss;
+    EXPECT_NE(0, lrc.init(parameters, &ss));
+  }
+  {
+    ErasureCodeLrc lrc;
+    init(lrc);
+    EXPECT_EQ(8u, lrc.get_chunk_count());
+    EXPECT_EQ(4u, lrc.get_data_chunk_count());
+    int expected[] = { 0, 1, 2, 4, 3, 5, 6, 7 };
+    const vector<int> &mapping = lrc.get_chunk_mapping();
+    ASSERT_EQ(8u, mapping.size());
+    for (unsigned i = 0; i < mapping.size(); i++)
+      EXPECT_EQ(expected[i], mapping[i]);
+    EXPECT_EQ(-1, lrc.position_to_global(3));
+    EXPECT_EQ(3, lrc.position_to_global(4));
+    EXPECT_EQ(7, lrc.get_local_parity(1));
+  }
+}
+
+TEST(ErasureCodeLrc, minimum_to_decode)
+{
+  ErasureCodeLrc lrc;
+  init(lrc);
+  set<int> available;
+  for (int i = 0; i < 8; i++)
+    available.insert(i);
+
+  set<int> want;
+  want.insert(1);
+  set<int> minimum;
+  // nothing missing
+  EXPECT_EQ(0, lrc.minimum_to_decode(want, available, &minimum));
+  EXPECT_EQ(want, minimum);
+
+  // a single missing chunk is read from its group only
+  available.erase(1);
+  minimum.clear();
+  EXPECT_EQ(0, lrc.minimum_to_decode(want, available, &minimum));
+  set<int> group;
+  group.insert(0);
+  group.insert(2);
+  group.insert(3);
+  EXPECT_EQ(group, minimum);
+
+  // two chunks missing from the same group need k global chunks
+  available.erase(2);
+  minimum.clear();
+  EXPECT_EQ(0, lrc.minimum_to_decode(want, available, &minimum));
+  EXPECT_EQ(4u, minimum.size());
+  EXPECT_FALSE(minimum.count(3));
+
+  // the second group repairs one of its own chunks locally
+  available.erase(5);
+  minimum.clear();
+  EXPECT_EQ(0, lrc.minimum_to_decode(want, available, &minimum));
+  set<int> expected;
+  expected.insert(0);
+  expected.insert(4);
+  expected.insert(6);
+  expected.insert(7);
+  EXPECT_EQ(expected, minimum);
+
+  available.erase(6);
+  minimum.clear();
+  EXPECT_EQ(-EIO, lrc.minimum_to_decode(want, available, &minimum));
+}
+
+TEST(ErasureCodeLrc, encode_decode)
+{
+  ErasureCodeLrc lrc;
+  init(lrc);
+
+  bufferlist in;
+  for (unsigned i = 0; i < 4096; i++)
+    in.append((char)(i * 7));
+  set<int> want_to_encode;
+  for (int i = 0; i < 8; i++)
+    want_to_encode.insert(i);
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, lrc.encode(want_to_encode, in, &encoded));
+  EXPECT_EQ(8u, encoded.size());
+  unsigned length = encoded[0].length();
+  EXPECT_EQ(lrc.get_chunk_size(in.length()), length);
+  EXPECT_EQ(0, memcmp(encoded[0].c_str(), in.c_str(), length));
+
+  // any single chunk is repaired from the three others of its group
+  for (int lost = 0; lost < 8; lost++) {
+    set<int> want;
+    want.insert(lost);
+    set<int> available;
+    for (int i = 0; i < 8; i++)
+      if (i != lost)
+	available.insert(i);
+    set<int> minimum;
+    EXPECT_EQ(0, lrc.minimum_to_decode(want, available, &minimum));
+    EXPECT_EQ(3u, minimum.size());
+    map<int, bufferlist> chunks;
+    for (set<int>::iterator i = minimum.begin(); i != minimum.end(); ++i)
+      chunks[*i] = encoded[*i];
+    map<int, bufferlist> decoded;
+    EXPECT_EQ(0, lrc.decode(want, chunks, &decoded));
+    EXPECT_EQ(length, decoded[lost].length());
+    EXPECT_EQ(0, memcmp(decoded[lost].c_str(), encoded[lost].c_str(), length));
+  }
+
+  // two chunks and the local parity lost from the same group
+  {
+    set<int> want;
+    want.insert(4);
+    want.insert(5);
+    want.insert(7);
+    map<int, bufferlist> chunks;
+    for (int i = 0; i < 4; i++)
+      chunks[i] = encoded[i];
+    chunks[6] = encoded[6];
+    map<int, bufferlist> decoded;
+    EXPECT_EQ(0, lrc.decode(want, chunks, &decoded));
+    for (set<int>::iterator i = want.begin(); i != want.end(); ++i)
+      EXPECT_EQ(0, memcmp(decoded[*i].c_str(), encoded[*i].c_str(), length));
+    chunks.erase(6);
+    EXPECT_EQ(-EIO, lrc.decode(want, chunks, &decoded));
+  }
+
+  // the whole object back from the data chunks
+  {
+    map<int, bufferlist> chunks;
+    for (int i = 0; i < 8; i++)
+      if (i != 1 && i != 4)
+	chunks[i] = encoded[i];
+    bufferlist out;
+    EXPECT_EQ(0, lrc.decode_concat(chunks, &out));
+    EXPECT_EQ(length * 4, out.length());
+    EXPECT_EQ(0, memcmp(out.c_str(), in.c_str(), in.length()));
+  }
+}
+
+TEST(ErasureCodeLrc, create_ruleset)
+{
+  CrushWrapper *c = new CrushWrapper;
+  c->create();
+  c->set_type_name(3, "root");
+  c->set_type_name(2, "rack");
+  c->set_type_name(1, "host");
+  c->set_type_name(0, "osd");
+
+  int rootno;
+  c->add_bucket(0, CRUSH_BUCKET_STRAW, CRUSH_HASH_RJENKINS1,
+		3, 0, NULL, NULL, &rootno);
+  c->set_item_name(rootno, "default");
+
+  map<string,string> loc;
+  loc["root"] = "default";
+  int osd = 0;
+  for (int r = 0; r < 2; ++r) {
+    loc["rack"] = string("rack-") + stringify(r);
+    for (int h = 0; h < 4; ++h, ++osd) {
+      loc["host"] = string("host-") + stringify(osd);
+      c->insert_item(g_ceph_context, osd, 1.0,
+		     string("osd.") + stringify(osd), loc);
+    }
+  }
+
+  ErasureCodeLrc lrc;
+  map<std::string,std::string> parameters;
+  parameters["directory"] = ".libs";
+  parameters["k"] = "4";
+  parameters["m"] = "2";
+  parameters["l"] = "3";
+  parameters["ruleset-locality"] = "rack";
+  stringstream ss;
+  ASSERT_EQ(0, lrc.init(parameters, &ss));
+  int ruleset = lrc.create_ruleset("lrcrule", *c, &ss);
+  EXPECT_LE(0, ruleset);
+  EXPECT_EQ(-EEXIST, lrc.create_ruleset("lrcrule", *c, &ss));
+
+  // each group lands in a single rack
+  vector<__u32> weight(c->get_max_devices(), 0x10000);
+  for (int x = 0; x < 10; x++) {
+    vector<int> out;
+    c->do_rule(ruleset, x, out, lrc.get_chunk_count(), weight);
+    ASSERT_EQ(lrc.get_chunk_count(), out.size());
+    for (unsigned g = 0; g < lrc.get_group_count(); g++) {
+      int rack = out[g * 4] / 4;
+      for (unsigned i = 0; i < 4; i++) {
+	ASSERT_NE(CRUSH_ITEM_NONE, out[g * 4 + i]);
+	EXPECT_EQ(rack, out[g * 4 + i] / 4);
+      }
+    }
+  }
+
+  lrc.ruleset_locality = "BAD";
+  EXPECT_EQ(-EINVAL, lrc.create_ruleset("otherrule", *c, &ss));
+  delete c;
+}
+
+int main(int argc, char **argv)
+{
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -23,17 +23,51 @@
 #include <boost/program_options/parsers.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
 #include "ceph_erasure_code_benchmark.h"
 #include "global/global_context.h"
 #include "global/global_init.h"
 #include "common/ceph_argparse.h"
 #include "common/config.h"
 #include "common/Clock.h"
+#include "common/errno.h"
+#include "include/stringify.h"
 #include "include/utime.h"
+#include "arch/probe.h"
+#include "arch/intel.h"
 #include "erasure-code/ErasureCodePlugin.h"
+#include "osd/ECUtil.h"
 
 namespace po = boost::program_options;
 
+static uint64_t get_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t lo, hi;
+  asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t)hi << 32) | lo;
+#else
+  return 0;
+#endif
+}
+
+static bool is_prime(int value)
+{
+  for (int i = 2; i * i <= value; i++)
+    if (value % i == 0)
+      return false;
+  return true;
+}
+
+static void split_list(const string &s, vector<string> *out)
+{
+  boost::split(*out, s, boost::is_any_of(","));
+  out->erase(remove(out->begin(), out->end(), string()), out->end());
+}
+
 int ErasureCodeBench::setup(int argc, char** argv) {
 
   po::options_description desc("Allowed options");
@@ -46,11 +80,29 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run either encode, decode or sweep")
     ("erasures,e", po::value<int>()->default_value(1),
      "number of erasures when decoding")
     ("parameter,P", po::value<vector<string> >(),
      "parameters")
+    ("stripe-width", po::value<int>()->default_value(0),
+     "encode or decode stripes of this width as the OSD does and "
+     "show the bytes copied per byte")
+    ("fragment-size", po::value<int>()->default_value(0),
+     "build the input from buffers of this size")
+    ("sweep-plugins", po::value<string>()->default_value("jerasure,isa"),
+     "comma separated plugins compared by the sweep workload")
+    ("sweep-km", po::value<string>()->default_value("2/1,4/2,6/3,10/4"),
+     "comma separated k/m compared by the sweep workload")
+    ("sweep-packetsizes", po::value<string>()->default_value("2048"),
+     "comma separated packetsize for the techniques using one")
+    ("sweep-stripe-widths",
+     po::value<string>()->default_value("4096,65536,1048576"),
+     "comma separated stripe widths (bytes encoded at once)")
+    ("sweep-rank", po::value<string>()->default_value("encode"),
+     "rank the sweep results by encode or decode rate")
+    ("sweep-profile", po::value<string>()->default_value(""),
+     "write the best erasure code profile for each k/m in this file")
     ;
 
   po::variables_map vm;
@@ -106,6 +158,38 @@ int ErasureCodeBench::setup(int argc, char** argv) {
   plugin = vm["plugin"].as<string>();
   workload = vm["workload"].as<string>();
   erasures = vm["erasures"].as<int>();
+  stripe_width = vm["stripe-width"].as<int>();
+  fragment_size = vm["fragment-size"].as<int>();
+
+  split_list(vm["sweep-plugins"].as<string>(), &sweep_plugins);
+  vector<string> strs;
+  split_list(vm["sweep-km"].as<string>(), &strs);
+  for (vector<string>::iterator i = strs.begin(); i != strs.end(); ++i) {
+    int k, m;
+    if (sscanf(i->c_str(), "%d/%d", &k, &m) != 2 || k <= 0 || m <= 0) {
+      cerr << "--sweep-km " << *i << " is not of the form k/m" << endl;
+      return -EINVAL;
+    }
+    sweep_km.push_back(make_pair(k, m));
+  }
+  split_list(vm["sweep-packetsizes"].as<string>(), &strs);
+  for (vector<string>::iterator i = strs.begin(); i != strs.end(); ++i)
+    sweep_packetsizes.push_back(atoi(i->c_str()));
+  split_list(vm["sweep-stripe-widths"].as<string>(), &strs);
+  for (vector<string>::iterator i = strs.begin(); i != strs.end(); ++i) {
+    int width = atoi(i->c_str());
+    if (width <= 0) {
+      cerr << "--sweep-stripe-widths " << *i << " must be positive" << endl;
+      return -EINVAL;
+    }
+    sweep_stripe_widths.push_back(width);
+  }
+  sweep_rank = vm["sweep-rank"].as<string>();
+  if (sweep_rank != "encode" && sweep_rank != "decode") {
+    cerr << "--sweep-rank must be encode or decode" << endl;
+    return -EINVAL;
+  }
+  sweep_profile = vm["sweep-profile"].as<string>();
 
   return 0;
 }
@@ -116,6 +200,8 @@ int ErasureCodeBench::run() {
 
   if (workload == "encode")
     return encode();
+  else if (workload == "sweep")
+    return sweep();
   else
     return decode();
 }
@@ -127,6 +213,8 @@ int ErasureCodeBench::encode()
   int code = instance.factory(plugin, parameters, &erasure_code, cerr);
   if (code)
     return code;
+  if (stripe_width)
+    return stripes(erasure_code, false);
   int k = atoi(parameters["k"].c_str());
   int m = atoi(parameters["m"].c_str());
 
@@ -155,6 +243,8 @@ int ErasureCodeBench::decode()
   int code = instance.factory(plugin, parameters, &erasure_code, cerr);
   if (code)
     return code;
+  if (stripe_width)
+    return stripes(erasure_code, true);
   int k = atoi(parameters["k"].c_str());
   int m = atoi(parameters["m"].c_str());
 
@@ -193,6 +283,343 @@ int ErasureCodeBench::decode()
   return 0;
 }
 
+int ErasureCodeBench::stripes(ErasureCodeInterfaceRef &erasure_code,
+			      bool decode)
+{
+  unsigned k = erasure_code->get_data_chunk_count();
+  unsigned n = erasure_code->get_chunk_count();
+  ECUtil::stripe_info_t sinfo(k,
+			      k * erasure_code->get_chunk_size(stripe_width));
+  unsigned length = max(1, in_size / (int)sinfo.get_stripe_width()) *
+    sinfo.get_stripe_width();
+
+  bufferlist in;
+  unsigned fragment = fragment_size > 0 ? fragment_size : length;
+  for (unsigned off = 0; off < length; off += fragment) {
+    bufferptr p(min(fragment, length - off));
+    memset(p.c_str(), 'X', p.length());
+    in.append(p);
+  }
+
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < n; i++)
+    want_to_encode.insert(i);
+  map<int,bufferlist> encoded;
+  int code = ECUtil::encode(sinfo, erasure_code, in, want_to_encode, &encoded);
+  if (code)
+    return code;
+
+  uint64_t copied = ECUtil::get_copied_bytes();
+  utime_t begin_time = ceph_clock_now(g_ceph_context);
+  for (int i = 0; i < max_iterations; i++) {
+    if (decode) {
+      map<int,bufferlist> chunks = encoded;
+      map<int,bufferlist> decoded;
+      map<int,bufferlist*> out;
+      for (int j = 0; j < erasures; j++) {
+	int erasure;
+	do {
+	  erasure = rand() % n;
+	} while(chunks.count(erasure) == 0);
+	chunks.erase(erasure);
+	out[erasure] = &decoded[erasure];
+      }
+      code = ECUtil::decode(sinfo, erasure_code, chunks, out);
+    } else {
+      map<int,bufferlist> out;
+      code = ECUtil::encode(sinfo, erasure_code, in, want_to_encode, &out);
+    }
+    if (code)
+      return code;
+  }
+  utime_t end_time = ceph_clock_now(g_ceph_context);
+  copied = ECUtil::get_copied_bytes() - copied;
+  cout << (end_time - begin_time) << "\t"
+       << (max_iterations * (length / 1024)) << "\t"
+       << (double)copied / ((double)length * max_iterations) << endl;
+  return 0;
+}
+
+void ErasureCodeBench::get_sweep_candidates(
+  list<pair<string, map<string,string> > > *candidates)
+{
+  // the jerasure variants ErasureCodePluginSelectJerasure could pick
+  // on this cpu
+  ceph_arch_probe();
+  vector<string> variants;
+  variants.push_back("generic");
+  if (ceph_arch_intel_ssse3 &&
+      ceph_arch_intel_sse3 &&
+      ceph_arch_intel_sse2)
+    variants.push_back("sse3");
+  if (ceph_arch_intel_pclmul &&
+      ceph_arch_intel_sse42 &&
+      ceph_arch_intel_sse41 &&
+      ceph_arch_intel_ssse3 &&
+      ceph_arch_intel_sse3 &&
+      ceph_arch_intel_sse2)
+    variants.push_back("sse4");
+
+  for (vector<string>::iterator p = sweep_plugins.begin();
+       p != sweep_plugins.end();
+       ++p) {
+    for (vector<pair<int, int> >::iterator km = sweep_km.begin();
+	 km != sweep_km.end();
+	 ++km) {
+      int k = km->first;
+      int m = km->second;
+      map<string,string> base = parameters;
+      base["k"] = stringify(k);
+      base["m"] = stringify(m);
+      list<map<string,string> > techniques;
+      if (*p == "jerasure") {
+	map<string,string> t = base;
+	t["w"] = "8";
+	t["technique"] = "reed_sol_van";
+	techniques.push_back(t);
+	if (m == 2) {
+	  t["technique"] = "reed_sol_r6_op";
+	  techniques.push_back(t);
+	}
+	for (vector<int>::iterator ps = sweep_packetsizes.begin();
+	     ps != sweep_packetsizes.end();
+	     ++ps) {
+	  t = base;
+	  t["w"] = "8";
+	  t["packetsize"] = stringify(*ps);
+	  t["technique"] = "cauchy_orig";
+	  techniques.push_back(t);
+	  t["technique"] = "cauchy_good";
+	  techniques.push_back(t);
+	  if (m != 2)
+	    continue;
+	  // blaum_roth is left out: it accepts a w for which it
+	  // cannot build a coding matrix
+	  if (k <= 8) {
+	    t["technique"] = "liber8tion";
+	    techniques.push_back(t);
+	  }
+	  int w = max(k, 3);
+	  while (!is_prime(w))
+	    w++;
+	  t["w"] = stringify(w);
+	  t["technique"] = "liberation";
+	  techniques.push_back(t);
+	}
+	for (list<map<string,string> >::iterator t = techniques.begin();
+	     t != techniques.end();
+	     ++t) {
+	  for (vector<string>::iterator v = variants.begin();
+	       v != variants.end();
+	       ++v) {
+	    map<string,string> c = *t;
+	    c["jerasure-variant"] = *v;
+	    candidates->push_back(make_pair(*p, c));
+	  }
+	}
+      } else if (*p == "isa") {
+	map<string,string> t = base;
+	t["technique"] = "reed_sol_van";
+	candidates->push_back(make_pair(*p, t));
+	t["technique"] = "cauchy";
+	candidates->push_back(make_pair(*p, t));
+      } else {
+	candidates->push_back(make_pair(*p, base));
+      }
+    }
+  }
+}
+
+int ErasureCodeBench::bench(const string &plugin,
+			    const map<string,string> &parameters,
+			    int stripe_width,
+			    Result *result)
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin, parameters, &erasure_code, messages);
+  if (code)
+    return code;
+  // some plugins fall back to their defaults on invalid parameters
+  unsigned k = erasure_code->get_data_chunk_count();
+  unsigned n = erasure_code->get_chunk_count();
+  if (parameters.count("k") &&
+      (k != (unsigned)atoi(parameters.find("k")->second.c_str()) ||
+       n - k != (unsigned)atoi(parameters.find("m")->second.c_str())))
+    return -EINVAL;
+
+  result->plugin = plugin;
+  result->parameters = parameters;
+  result->stripe_width = stripe_width;
+
+  bufferptr content(stripe_width);
+  for (int i = 0; i < stripe_width; i++)
+    content[i] = rand();
+  bufferlist stripe;
+  stripe.append(content);
+  int stripes = max(1, in_size / stripe_width) * max_iterations;
+  double bytes = (double)stripe_width * stripes;
+
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < n; i++)
+    want_to_encode.insert(i);
+  map<int,bufferlist> encoded;
+  utime_t begin_time = ceph_clock_now(g_ceph_context);
+  uint64_t begin_cycles = get_cycles();
+  for (int i = 0; i < stripes; i++) {
+    encoded.clear();
+    code = erasure_code->encode(want_to_encode, stripe, &encoded);
+    if (code)
+      return code;
+  }
+  uint64_t cycles = get_cycles() - begin_cycles;
+  double seconds = ceph_clock_now(g_ceph_context) - begin_time;
+  result->encode_rate = seconds > 0 ? bytes / seconds : 0;
+  result->encode_cpb = cycles / bytes;
+
+  int lost = min(erasures, (int)(n - k));
+  begin_time = ceph_clock_now(g_ceph_context);
+  begin_cycles = get_cycles();
+  for (int i = 0; i < stripes; i++) {
+    map<int,bufferlist> chunks = encoded;
+    for (int j = 0; j < lost; j++) {
+      int erasure;
+      do {
+	erasure = rand() % n;
+      } while (chunks.count(erasure) == 0);
+      chunks.erase(erasure);
+    }
+    map<int,bufferlist> decoded;
+    code = erasure_code->decode(want_to_encode, chunks, &decoded);
+    if (code)
+      return code;
+  }
+  cycles = get_cycles() - begin_cycles;
+  seconds = ceph_clock_now(g_ceph_context) - begin_time;
+  result->decode_rate = seconds > 0 ? bytes / seconds : 0;
+  result->decode_cpb = cycles / bytes;
+  return 0;
+}
+
+/// the parameters that tell candidates apart, as for erasure-code-profile set
+static string describe(const string &plugin,
+		       const map<string,string> &parameters,
+		       bool for_profile)
+{
+  string s = "plugin=" + plugin;
+  for (map<string,string>::const_iterator i = parameters.begin();
+       i != parameters.end();
+       ++i) {
+    if (i->first == "directory")
+      continue;
+    // the osd selects the jerasure variant for its own cpu
+    if (for_profile && i->first == "jerasure-variant")
+      continue;
+    s += " " + i->first + "=" + i->second;
+  }
+  return s;
+}
+
+struct RankResult {
+  bool by_decode;
+  RankResult(bool by_decode) : by_decode(by_decode) {}
+  bool operator()(const ErasureCodeBench::Result &a,
+		  const ErasureCodeBench::Result &b) const {
+    int ka = atoi(a.parameters.find("k")->second.c_str());
+    int kb = atoi(b.parameters.find("k")->second.c_str());
+    if (ka != kb)
+      return ka < kb;
+    int ma = atoi(a.parameters.find("m")->second.c_str());
+    int mb = atoi(b.parameters.find("m")->second.c_str());
+    if (ma != mb)
+      return ma < mb;
+    if (by_decode)
+      return a.decode_rate > b.decode_rate;
+    return a.encode_rate > b.encode_rate;
+  }
+};
+
+int ErasureCodeBench::sweep()
+{
+  list<pair<string, map<string,string> > > candidates;
+  get_sweep_candidates(&candidates);
+
+  vector<Result> results;
+  for (list<pair<string, map<string,string> > >::iterator c =
+	 candidates.begin();
+       c != candidates.end();
+       ++c) {
+    for (vector<int>::iterator w = sweep_stripe_widths.begin();
+	 w != sweep_stripe_widths.end();
+	 ++w) {
+      Result result;
+      int code = bench(c->first, c->second, *w, &result);
+      if (code) {
+	cerr << "skipping " << describe(c->first, c->second, false)
+	     << ": " << cpp_strerror(code) << endl;
+	break;
+      }
+      results.push_back(result);
+    }
+  }
+  sort(results.begin(), results.end(), RankResult(sweep_rank == "decode"));
+
+  cout << "rank	k	m	encode GB/s	decode GB/s	encode cycles/B	"
+       << "decode cycles/B	stripe width	parameters" << endl;
+  int rank = 0;
+  for (vector<Result>::iterator i = results.begin(); i != results.end(); ++i) {
+    if (i == results.begin() ||
+	(i - 1)->parameters["k"] != i->parameters["k"] ||
+	(i - 1)->parameters["m"] != i->parameters["m"])
+      rank = 0;
+    cout << ++rank << "	"
+	 << i->parameters["k"] << "	"
+	 << i->parameters["m"] << "	"
+	 << fixed << setprecision(3)
+	 << i->encode_rate / (1024 * 1024 * 1024) << "	"
+	 << i->decode_rate / (1024 * 1024 * 1024) << "	"
+	 << setprecision(2)
+	 << i->encode_cpb << "	"
+	 << i->decode_cpb << "	"
+	 << i->stripe_width << "	"
+	 << describe(i->plugin, i->parameters, false) << endl;
+  }
+
+  if (!sweep_profile.empty())
+    return write_profile(results);
+  return 0;
+}
+
+int ErasureCodeBench::write_profile(const vector<Result> &ranked)
+{
+  ofstream out(sweep_profile.c_str());
+  if (!out) {
+    cerr << "cannot write " << sweep_profile << endl;
+    return -EIO;
+  }
+  out << "# recommended erasure code profiles, one per k/m, for\n"
+      << "#   ceph osd erasure-code-profile set <name> <line>\n"
+      << "# with osd_pool_erasure_code_stripe_width set as noted" << endl;
+  const Result *best = NULL;
+  for (vector<Result>::const_iterator i = ranked.begin();
+       i != ranked.end();
+       ++i) {
+    if (best &&
+	best->parameters.find("k")->second == i->parameters.find("k")->second &&
+	best->parameters.find("m")->second == i->parameters.find("m")->second)
+      continue;
+    best = &*i;
+    out << fixed << setprecision(3)
+	<< "# encode " << best->encode_rate / (1024 * 1024 * 1024)
+	<< " GB/s, decode " << best->decode_rate / (1024 * 1024 * 1024)
+	<< " GB/s, osd_pool_erasure_code_stripe_width = "
+	<< best->stripe_width << "\n"
+	<< describe(best->plugin, best->parameters, true) << endl;
+  }
+  return 0;
+}
+
 int main(int argc, char** argv) {
   ErasureCodeBench ecbench;
   int err = ecbench.setup(argc, argv);
@@ -18,6 +18,11 @@
 #define CEPH_ERASURE_CODE_BENCHMARK_H
 
 #include <string>
+#include <map>
+#include <vector>
+#include <list>
+
+#include "erasure-code/ErasureCodeInterface.h"
 
 using namespace std;
 
@@ -28,11 +33,48 @@ class ErasureCodeBench {
   int erasures;
   string workload;
   map<string,string> parameters;
+  int stripe_width;
+  int fragment_size;
+
+  // --workload sweep
+  vector<string> sweep_plugins;
+  vector<pair<int, int> > sweep_km;
+  vector<int> sweep_packetsizes;
+  vector<int> sweep_stripe_widths;
+  string sweep_rank;
+  string sweep_profile;
+
 public:
+  struct Result {
+    string plugin;
+    map<string,string> parameters;
+    int stripe_width;
+    double encode_rate;  ///< bytes per second
+    double decode_rate;
+    double encode_cpb;   ///< cpu cycles per byte, 0 if unknown
+    double decode_cpb;
+    Result() : stripe_width(0), encode_rate(0), decode_rate(0),
+	       encode_cpb(0), decode_cpb(0) {}
+  };
+
   int setup(int argc, char** argv);
   int run();
   int decode();
   int encode();
+  int sweep();
+
+private:
+  /// encode or decode through ECUtil, as the OSD does
+  int stripes(ErasureCodeInterfaceRef &erasure_code, bool decode);
+  /// plugin and parameters for every combination worth measuring
+  void get_sweep_candidates(
+    list<pair<string, map<string,string> > > *candidates);
+  /// encode and decode stripes of stripe_width bytes
+  int bench(const string &plugin,
+	    const map<string,string> &parameters,
+	    int stripe_width,
+	    Result *result);
+  int write_profile(const vector<Result> &ranked);
 };
 
 #endif
@@ -132,6 +132,82 @@ function TEST_alignment_constraints() {
     rm $dir/ORIGINAL
 }
 
+function set_rmw_read_errors() {
+    local errors=$1
+
+    for id in $(seq 0 4) ; do
+        ./ceph tell osd.$id injectargs -- \
+            --osd-debug-inject-ec-rmw-read-errors $errors || return 1
+    done
+}
+
+function overwrite_and_check() {
+    local dir=$1
+    local poolname=$2
+    local objname=$3
+
+    cp $dir/ORIGINAL $dir/EXPECTED
+    dd if=$dir/PATCH of=$dir/EXPECTED bs=1 seek=10 conv=notrunc 2>/dev/null
+    ./rados --pool $poolname put $objname $dir/PATCH --offset 10 || return 1
+    ./rados --pool $poolname get $objname $dir/COPY || return 1
+    cmp $dir/EXPECTED $dir/COPY || return 1
+    rm $dir/EXPECTED $dir/COPY
+}
+
+function TEST_overwrite_read_error() {
+    local dir=$1
+    local poolname=pool-overwrite
+    local stripe_width=$(./ceph-conf --show-config-value osd_pool_erasure_code_stripe_width)
+
+    ./ceph osd pool create $poolname 12 12 erasure || return 1
+    ./ceph osd pool set $poolname allow_ec_overwrites true || return 1
+    dd if=/dev/urandom of=$dir/ORIGINAL bs=$stripe_width count=4 2>/dev/null
+    echo -n PATCH > $dir/PATCH
+    for objname in RETRIED FAILED OTHER ; do
+        ./rados --pool $poolname put $objname $dir/ORIGINAL || return 1
+    done
+
+    #
+    # one failed shard (k=2, m=1): the old stripe is read again from
+    # the remaining shards
+    #
+    set_rmw_read_errors 1 || return 1
+    overwrite_and_check $dir $poolname RETRIED || return 1
+
+    #
+    # two failed shards: the stripe cannot be decoded, the overwrite
+    # waits for a new interval but writes to other objects go on
+    #
+    set_rmw_read_errors 2 || return 1
+    ./rados --pool $poolname put FAILED $dir/PATCH --offset 10 &
+    local pid=$!
+    for i in $(seq 60) ; do
+        grep --quiet 'cannot read the old stripes of .*FAILED' \
+            $dir/osd-*.log && break
+        sleep 1
+    done
+    grep --quiet 'cannot read the old stripes of .*FAILED' \
+        $dir/osd-*.log || return 1
+    set_rmw_read_errors 0 || return 1
+    timeout 60 ./rados --pool $poolname put OTHER $dir/PATCH --offset 10 \
+        || return 1
+    kill -0 $pid || return 1
+
+    #
+    # a new interval drops the failed overwrite and the client resends it
+    #
+    local -a osds=($(get_osds $poolname FAILED))
+    ./ceph osd down ${osds[0]} || return 1
+    wait $pid || return 1
+    ./rados --pool $poolname get FAILED $dir/COPY || return 1
+    cp $dir/ORIGINAL $dir/EXPECTED
+    dd if=$dir/PATCH of=$dir/EXPECTED bs=1 seek=10 conv=notrunc 2>/dev/null
+    cmp $dir/EXPECTED $dir/COPY || return 1
+
+    rm $dir/ORIGINAL $dir/PATCH $dir/EXPECTED $dir/COPY
+    delete_pool $poolname
+}
+
 function get_osds() {
     local poolname=$1
     local objectname=$2
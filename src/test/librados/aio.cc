@@ -502,6 +502,90 @@ TEST(LibRadosAio, RoundTripAppendPP) {
   delete my_completion3;
 }
 
+TEST(LibRadosAio, CoalesceAppendWritePP) {
+  AioTestDataPP test_data;
+  ASSERT_EQ("", test_data.init());
+  // long enough that the ops below are queued before the window ends
+  test_data.m_ioctx.set_aio_coalesce(1000000, 1 << 20);
+
+  const int num = 8;
+  char buf[num][16];
+  AioCompletion *c[num];
+  for (int i = 0; i < num; ++i) {
+    memset(buf[i], 'a' + i, sizeof(buf[i]));
+    bufferlist bl;
+    bl.append(buf[i], sizeof(buf[i]));
+    c[i] = test_data.m_cluster.aio_create_completion(NULL, NULL, NULL);
+    ASSERT_EQ(0, test_data.m_ioctx.aio_append("foo", c[i], bl, bl.length()));
+  }
+  // a write into the range above goes out after the appends
+  char over[4];
+  memset(over, 'z', sizeof(over));
+  bufferlist obl;
+  obl.append(over, sizeof(over));
+  AioCompletion *wc = test_data.m_cluster.aio_create_completion(NULL, NULL,
+								 NULL);
+  ASSERT_EQ(0, test_data.m_ioctx.aio_write("foo", wc, obl, obl.length(), 16));
+  ASSERT_EQ(0, test_data.m_ioctx.aio_flush());
+  for (int i = 0; i < num; ++i) {
+    ASSERT_TRUE(c[i]->is_safe());
+    ASSERT_EQ(0, c[i]->get_return_value());
+    c[i]->release();
+  }
+  ASSERT_TRUE(wc->is_safe());
+  ASSERT_EQ(0, wc->get_return_value());
+  wc->release();
+
+  uint64_t writes, ops;
+  test_data.m_ioctx.get_aio_coalesce_stats(&writes, &ops);
+  ASSERT_EQ((uint64_t)num + 1, writes);
+  ASSERT_EQ(2u, ops);
+
+  bufferlist bl;
+  ASSERT_EQ(num * 16, test_data.m_ioctx.read("foo", bl, num * 16, 0));
+  for (int i = 0; i < num; ++i) {
+    if (i == 1)
+      ASSERT_EQ(0, memcmp(bl.c_str() + 16, over, sizeof(over)));
+    else
+      ASSERT_EQ(0, memcmp(bl.c_str() + i * 16, buf[i], sizeof(buf[i])));
+  }
+}
+
+TEST(LibRadosAio, CoalesceCancelPP) {
+  AioTestDataPP test_data;
+  ASSERT_EQ("", test_data.init());
+  test_data.m_ioctx.set_aio_coalesce(1000000, 1 << 20);
+
+  char buf[16];
+  memset(buf, 'a', sizeof(buf));
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+  AioCompletion *c[4];
+  for (int i = 0; i < 4; ++i)
+    c[i] = test_data.m_cluster.aio_create_completion(NULL, NULL, NULL);
+
+  // while held
+  ASSERT_EQ(0, test_data.m_ioctx.aio_append("foo", c[0], bl, bl.length()));
+  ASSERT_EQ(0, test_data.m_ioctx.aio_append("foo", c[1], bl, bl.length()));
+  ASSERT_EQ(-EBUSY, test_data.m_ioctx.aio_cancel(c[0]));
+
+  // after the merged append went out
+  ASSERT_EQ(0, test_data.m_ioctx.aio_append("foo", c[2], bl, bl.length()));
+  ASSERT_EQ(0, test_data.m_ioctx.aio_append("foo", c[3], bl, bl.length()));
+  ASSERT_EQ(0, test_data.m_ioctx.aio_flush());
+  ASSERT_EQ(-EBUSY, test_data.m_ioctx.aio_cancel(c[3]));
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(c[i]->is_safe());
+    ASSERT_EQ(0, c[i]->get_return_value());
+    c[i]->release();
+  }
+  uint64_t size;
+  time_t mtime;
+  ASSERT_EQ(0, test_data.m_ioctx.stat("foo", &size, &mtime));
+  ASSERT_EQ(4 * sizeof(buf), size);
+}
+
 TEST(LibRadosAio, IsComplete) {
   AioTestData test_data;
   rados_completion_t my_completion;
@@ -3,6 +3,8 @@
 
 #include "include/rados/librados.h"
 #include "include/rados/librados.hpp"
+#include "include/stringify.h"
+#include "include/utime.h"
 #include "test/librados/test.h"
 #include "test/librados/TestCase.h"
 
@@ -451,6 +453,55 @@ TEST_F(LibRadosIoPP, XattrListPP) {
   }
 }
 
+TEST_F(LibRadosIoPP, OperateManyPP) {
+  std::vector<std::string> oids;
+  for (int i = 0; i < 20; ++i) {
+    std::string oid = "many" + stringify(i);
+    bufferlist bl;
+    bl.append(std::string(i + 1, 'a' + i));
+    ASSERT_EQ(0, ioctx.write_full(oid, bl));
+    oids.push_back(oid);
+  }
+  oids.push_back("missing");
+
+  ObjectReadOperation op;
+  op.stat(NULL, NULL, NULL);
+  op.read(0, 64, NULL, NULL);
+  std::vector<bulk_op_result_t> results;
+  AioCompletion *completion = cluster.aio_create_completion();
+  ASSERT_EQ(0, ioctx.aio_operate_many(oids, completion, &op, 0, &results));
+  ASSERT_EQ(0, completion->wait_for_complete());
+  ASSERT_EQ(0, completion->get_return_value());
+  completion->release();
+
+  ASSERT_EQ(oids.size(), results.size());
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_EQ(0, results[i].rval);
+    ASSERT_EQ(2u, results[i].op_outs.size());
+    uint64_t size;
+    utime_t mtime;
+    bufferlist::iterator p = results[i].op_outs[0].begin();
+    ::decode(size, p);
+    ::decode(mtime, p);
+    ASSERT_EQ((uint64_t)i + 1, size);
+    ASSERT_EQ(std::string(i + 1, 'a' + i),
+	      std::string(results[i].op_outs[1].c_str(),
+			  results[i].op_outs[1].length()));
+  }
+  ASSERT_EQ(-ENOENT, results[20].rval);
+
+  // the synchronous flavour
+  results.clear();
+  ASSERT_EQ(0, ioctx.operate_many(oids, &op, 0, &results));
+  ASSERT_EQ(oids.size(), results.size());
+  ASSERT_EQ(0, results[0].rval);
+  ASSERT_EQ(-ENOENT, results[20].rval);
+
+  std::vector<std::string> none;
+  ASSERT_EQ(0, ioctx.operate_many(none, &op, 0, &results));
+  ASSERT_TRUE(results.empty());
+}
+
 TEST_F(LibRadosIoEC, SimpleWrite) {
   char buf[128];
   memset(buf, 0xcc, sizeof(buf));
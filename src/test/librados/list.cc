@@ -342,6 +342,103 @@ TEST_F(LibRadosListPP, ListObjectsStartPP) {
   }
 }
 
+TEST_F(LibRadosList, ListObjectsSplit) {
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+
+  std::set<std::string> written;
+  for (int i=0; i<64; ++i) {
+    string n = stringify(i);
+    ASSERT_EQ(0, rados_write(ioctx, n.c_str(), buf, sizeof(buf), 0));
+    written.insert(n);
+  }
+
+  rados_list_ctx_t ctx;
+  ASSERT_EQ(-EINVAL, rados_objects_list_open_split(ioctx, 0, 0, &ctx));
+  ASSERT_EQ(-EINVAL, rados_objects_list_open_split(ioctx, 4, 4, &ctx));
+
+  // more splits than pgs: pgs are shared and filtered by object hash
+  const uint32_t splits[] = { 1, 3, 4, 1000 };
+  for (unsigned s = 0; s < sizeof(splits) / sizeof(splits[0]); ++s) {
+    std::set<std::string> saw;
+    for (uint32_t i = 0; i < splits[s]; ++i) {
+      ASSERT_EQ(0, rados_objects_list_open_split(ioctx, splits[s], i, &ctx));
+      const char *entry;
+      int r;
+      while ((r = rados_objects_list_next(ctx, &entry, NULL)) == 0)
+	ASSERT_TRUE(saw.insert(entry).second);
+      ASSERT_EQ(-ENOENT, r);
+      rados_objects_list_close(ctx);
+    }
+    ASSERT_TRUE(written == saw);
+  }
+}
+
+TEST_F(LibRadosListPP, ListObjectsSplitPP) {
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+
+  std::set<std::string> written;
+  for (int i=0; i<64; ++i) {
+    ASSERT_EQ(0, ioctx.write(stringify(i), bl, bl.length(), 0));
+    written.insert(stringify(i));
+  }
+
+  ASSERT_THROW(ioctx.objects_begin_split(2, 2), std::invalid_argument);
+
+  std::set<std::string> saw;
+  for (uint32_t i = 0; i < 5; ++i) {
+    librados::ObjectIterator it = ioctx.objects_begin_split(5, i);
+    for (; it != ioctx.objects_end(); ++it)
+      ASSERT_TRUE(saw.insert(it->first).second);
+  }
+  ASSERT_TRUE(written == saw);
+}
+
+TEST_F(LibRadosListPP, ListObjectsSplitPgNumChangePP) {
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+
+  std::set<std::string> written;
+  for (int i=0; i<64; ++i) {
+    ASSERT_EQ(0, ioctx.write(stringify(i), bl, bl.length(), 0));
+    written.insert(stringify(i));
+  }
+
+  bufferlist inbl, outbl;
+  ASSERT_EQ(0, cluster.mon_command(
+    "{\"prefix\": \"osd pool get\", \"pool\": \"" + pool_name +
+    "\", \"var\": \"pg_num\", \"format\": \"json\"}",
+    inbl, &outbl, NULL));
+  std::string out(outbl.c_str(), outbl.length());
+  size_t pos = out.find("\"pg_num\":");
+  ASSERT_NE(std::string::npos, pos);
+  int pg_num = atoi(out.c_str() + pos + 9);
+  ASSERT_LT(0, pg_num);
+
+  // a split that sees pg_num change fails rather than skip or repeat
+  librados::ObjectIterator it = ioctx.objects_begin_split(2, 0);
+  ASSERT_EQ(0, cluster.mon_command(
+    "{\"prefix\": \"osd pool set\", \"pool\": \"" + pool_name +
+    "\", \"var\": \"pg_num\", \"val\": \"" + stringify(pg_num * 2) +
+    "\"}",
+    inbl, NULL, NULL));
+  ASSERT_EQ(0, cluster.wait_for_latest_osdmap());
+  ASSERT_THROW(while (it != ioctx.objects_end()) ++it, std::runtime_error);
+
+  // listed again, the splits still cover the pool exactly once
+  std::set<std::string> saw;
+  for (uint32_t i = 0; i < 2; ++i) {
+    for (it = ioctx.objects_begin_split(2, i); it != ioctx.objects_end(); ++it)
+      ASSERT_TRUE(saw.insert(it->first).second);
+  }
+  ASSERT_TRUE(written == saw);
+}
+
 TEST_F(LibRadosListEC, ListObjects) {
   char buf[128];
   memset(buf, 0xcc, sizeof(buf));
@@ -68,6 +68,39 @@ TEST_P(LibRadosWatchNotifyPP, WatchNotifyTestPP) {
   ioctx.unwatch("foo", handle);
   sem_destroy(&sem);
 }
+// notify and notify_ack are reads, but only the primary knows the
+// watchers; they must not be steered to a replica
+TEST_P(LibRadosWatchNotifyPP, WatchNotifyLatencyAwareReadsPP) {
+  ASSERT_EQ(0, cluster.conf_set("objecter_latency_aware_reads", "true"));
+  ASSERT_EQ(0, sem_init(&sem, 0, 0));
+  ioctx.set_notify_timeout(5);
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl1;
+  bl1.append(buf, sizeof(buf));
+  ASSERT_EQ(0, ioctx.write("foo", bl1, sizeof(buf), 0));
+  // plain reads give every osd a latency sample, so replicas get picked
+  for (int i = 0; i < 20; ++i) {
+    bufferlist bl;
+    ASSERT_EQ((int)sizeof(buf), ioctx.read("foo", bl, sizeof(buf), 0));
+  }
+  uint64_t handle;
+  WatchNotifyTestCtx ctx;
+  ASSERT_EQ(0, ioctx.watch("foo", 0, &handle, &ctx));
+  std::list<obj_watch_t> watches;
+  ASSERT_EQ(0, ioctx.list_watchers("foo", &watches));
+  ASSERT_EQ(1u, watches.size());
+  TestAlarm alarm;
+  for (int i = 0; i < 10; ++i) {
+    bufferlist bl2;
+    ASSERT_EQ(0, ioctx.notify("foo", 0, bl2));
+    sem_wait(&sem);
+  }
+  ioctx.unwatch("foo", handle);
+  sem_destroy(&sem);
+  ASSERT_EQ(0, cluster.conf_set("objecter_latency_aware_reads", "false"));
+}
+
 TEST_P(LibRadosWatchNotifyPP, WatchNotifyTimeoutTestPP) {
   ASSERT_EQ(0, sem_init(&sem, 0, 0));
   ioctx.set_notify_timeout(1);
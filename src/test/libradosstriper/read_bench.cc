@@ -0,0 +1,58 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Read a striped object back with various rados_striper_read_window
+ * settings and report the throughput of each.  The content is checked
+ * on every read, so this doubles as a test of the windowed read path
+ * when the window is much smaller than the number of objects.
+ */
+
+#include "include/rados/librados.hpp"
+#include "include/radosstriper/libradosstriper.hpp"
+#include "include/stringify.h"
+#include "include/utime.h"
+#include "common/Clock.h"
+#include "test/librados/test.h"
+#include "test/libradosstriper/TestCase.h"
+
+#include <iostream>
+#include <string>
+
+using namespace librados;
+using namespace libradosstriper;
+
+TEST_F(StriperTestPP, ReadWindowBench) {
+  // 32 objects of 1MB, striped 8 wide in 64KB units
+  const unsigned stripe_unit = 65536;
+  const size_t size = 32 << 20;
+  ASSERT_EQ(0, striper.set_object_layout_stripe_unit(stripe_unit));
+  ASSERT_EQ(0, striper.set_object_layout_stripe_count(8));
+  ASSERT_EQ(0, striper.set_object_layout_object_size(1 << 20));
+
+  bufferlist bl;
+  bufferptr bp(size);
+  for (size_t i = 0; i < size; i++)
+    bp[i] = (char)(i / stripe_unit + i);
+  bl.append(bp);
+  ASSERT_EQ(0, striper.write("ReadWindowBench", bl, size, 0));
+
+  const int windows[] = { 1, 2, 4, 16, 64, 0 };
+  const int reps = 4;
+  for (unsigned w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+    ASSERT_EQ(0, cluster.conf_set("rados_striper_read_window",
+				  stringify(windows[w]).c_str()));
+    utime_t start = ceph_clock_now(NULL);
+    for (int r = 0; r < reps; r++) {
+      bufferlist out;
+      ASSERT_EQ((int)size, striper.read("ReadWindowBench", &out, size, 0));
+      ASSERT_TRUE(out.contents_equal(bl));
+    }
+    double elapsed = ceph_clock_now(NULL) - start;
+    std::cout << "window " << windows[w] << ": "
+	      << (double)(size * reps) / elapsed / (1 << 20) << " MB/s"
+	      << std::endl;
+  }
+  ASSERT_EQ(0, cluster.conf_set("rados_striper_read_window", "16"));
+  ASSERT_EQ(0, striper.remove("ReadWindowBench"));
+}
@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <signal.h>
 #include "osd/ECBackend.h"
+#include "erasure-code/ErasureCode.h"
 #include "gtest/gtest.h"
 
 TEST(ECUtil, stripe_info_t)
@@ -58,3 +59,181 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECUtil, partial_stripes)
+{
+  const uint64_t swidth = 4096;
+  ECUtil::stripe_info_t s(4, swidth);
+
+  ASSERT_TRUE(s.partial_stripes(make_pair((uint64_t)0, swidth)).empty());
+  ASSERT_TRUE(s.partial_stripes(make_pair(swidth, (uint64_t)0)).empty());
+
+  set<uint64_t> p = s.partial_stripes(make_pair((uint64_t)10, (uint64_t)20));
+  ASSERT_EQ(1u, p.size());
+  ASSERT_EQ(1u, p.count(0));
+
+  // whole stripes in the middle need not be read
+  p = s.partial_stripes(make_pair(swidth - 10, 2*swidth + 20));
+  ASSERT_EQ(2u, p.size());
+  ASSERT_EQ(1u, p.count(0));
+  ASSERT_EQ(1u, p.count(2*swidth));
+}
+
+TEST(ECBackend, batch_read_size)
+{
+  const uint64_t swidth = 4096;
+  const uint64_t chunk = 8 << 20;
+  ECUtil::stripe_info_t s(4, swidth);
+
+  // a single object reads at most a recovery chunk
+  ASSERT_EQ(chunk, ECBackend::get_batch_read_size(s, chunk, 4 * chunk, 1));
+  // the batch shares the byte limit, in whole stripes
+  ASSERT_EQ(chunk / 4, ECBackend::get_batch_read_size(s, chunk, chunk, 4));
+  ASSERT_EQ(swidth, ECBackend::get_batch_read_size(s, chunk,
+						   3 * swidth - 1, 2));
+  // but every object reads at least a stripe
+  ASSERT_EQ(swidth, ECBackend::get_batch_read_size(s, chunk, swidth, 16));
+}
+
+TEST(ECUtil, merge_overwrite)
+{
+  const uint64_t swidth = 16;
+  ECUtil::stripe_info_t s(4, swidth);
+
+  map<uint64_t, bufferlist> old;
+  old[0].append(string(swidth, 'a'));
+  old[2*swidth].append(string(swidth, 'c'));
+
+  bufferlist bl;
+  bl.append(string(2*swidth, 'x'));
+  bufferlist out;
+  ECUtil::merge_overwrite(s, 4, bl, old, &out);
+  ASSERT_EQ(3*swidth, out.length());
+  ASSERT_EQ(string(4, 'a') + string(2*swidth, 'x') + string(12, 'c'),
+	    string(out.c_str(), out.length()));
+
+  // stripes we have nothing for are zeros
+  out.clear();
+  bl.clear();
+  bl.append("xy");
+  ECUtil::merge_overwrite(s, swidth + 1, bl, old, &out);
+  ASSERT_EQ(swidth, out.length());
+  ASSERT_EQ(string(1, '\0') + "xy" + string(swidth - 3, '\0'),
+	    string(out.c_str(), out.length()));
+}
+
+TEST(ECUtil, HashInfo_overwrite)
+{
+  ECUtil::HashInfo h(2);
+  map<int, bufferlist> chunks;
+  chunks[0].append_zero(8);
+  chunks[1].append_zero(8);
+  h.append(0, chunks);
+  ASSERT_TRUE(h.has_chunk_hash());
+
+  h.set_total_chunk_size_clear_hash(32);
+  ASSERT_FALSE(h.has_chunk_hash());
+  ASSERT_EQ(32u, h.get_total_chunk_size());
+  // appends still track the size
+  h.append(32, chunks);
+  ASSERT_EQ(40u, h.get_total_chunk_size());
+
+  bufferlist bl;
+  ::encode(h, bl);
+  ECUtil::HashInfo d;
+  bufferlist::iterator p = bl.begin();
+  ::decode(d, p);
+  ASSERT_FALSE(d.has_chunk_hash());
+  ASSERT_EQ(40u, d.get_total_chunk_size());
+}
+
+/// k=2 m=1 parity, with the chunk level methods ECUtil calls directly
+class ErasureCodeXor : public ErasureCode {
+public:
+  bool direct;
+  ErasureCodeXor(bool direct) : direct(direct) {}
+  virtual int create_ruleset(const string &name,
+			     CrushWrapper &crush,
+			     ostream *ss) const {
+    return 0;
+  }
+  virtual unsigned int get_chunk_count() const { return 3; }
+  virtual unsigned int get_data_chunk_count() const { return 2; }
+  virtual unsigned int get_chunk_size(unsigned int object_size) const {
+    return object_size / 2;
+  }
+  virtual bool supports_encode_chunks() const { return direct; }
+  virtual int encode_chunks(const set<int> &want_to_encode,
+			    map<int, bufferlist> *encoded) {
+    const char *a = (*encoded)[0].c_str();
+    const char *b = (*encoded)[1].c_str();
+    char *p = (*encoded)[2].c_str();
+    for (unsigned i = 0; i < (*encoded)[2].length(); i++)
+      p[i] = a[i] ^ b[i];
+    return 0;
+  }
+  virtual int decode_chunks(const set<int> &want_to_read,
+			    const map<int, bufferlist> &chunks,
+			    map<int, bufferlist> *decoded) {
+    int lost = 0;
+    while (chunks.count(lost))
+      lost++;
+    const char *a = (*decoded)[(lost + 1) % 3].c_str();
+    const char *b = (*decoded)[(lost + 2) % 3].c_str();
+    char *p = (*decoded)[lost].c_str();
+    for (unsigned i = 0; i < (*decoded)[lost].length(); i++)
+      p[i] = a[i] ^ b[i];
+    return 0;
+  }
+};
+
+TEST(ECUtil, encode_decode_chunks)
+{
+  const uint64_t swidth = 2 * 4096;
+  ECUtil::stripe_info_t s(2, swidth);
+  ErasureCodeInterfaceRef direct(new ErasureCodeXor(true));
+  ErasureCodeInterfaceRef copy(new ErasureCodeXor(false));
+  set<int> want;
+  for (int i = 0; i < 3; i++)
+    want.insert(i);
+
+  // three stripes in unaligned fragments
+  bufferlist in;
+  for (unsigned off = 0; off < 3 * swidth; off += 1000) {
+    bufferptr p(MIN(1000, 3 * swidth - off));
+    for (unsigned i = 0; i < p.length(); i++)
+      p[i] = (off + i) * 7;
+    in.append(p);
+  }
+  map<int, bufferlist> expected, encoded;
+  ASSERT_EQ(0, ECUtil::encode(s, copy, in, want, &expected));
+  uint64_t copied = ECUtil::get_copied_bytes();
+  ASSERT_EQ(0, ECUtil::encode(s, direct, in, want, &encoded));
+  ASSERT_EQ(3u, encoded.size());
+  for (int i = 0; i < 3; i++)
+    ASSERT_TRUE(expected[i].contents_equal(encoded[i]));
+  ASSERT_EQ(in.length(), ECUtil::get_copied_bytes() - copied);
+  // the parity of all stripes is in one buffer
+  ASSERT_EQ(1u, encoded[2].buffers().size());
+
+  // page aligned input is used in place
+  in.rebuild_page_aligned();
+  encoded.clear();
+  copied = ECUtil::get_copied_bytes();
+  ASSERT_EQ(0, ECUtil::encode(s, direct, in, want, &encoded));
+  ASSERT_EQ(0u, ECUtil::get_copied_bytes() - copied);
+  ASSERT_TRUE(expected[0].contents_equal(encoded[0]));
+
+  // rebuild a lost data chunk
+  map<int, bufferlist> chunks;
+  chunks[1] = encoded[1];
+  chunks[2] = encoded[2];
+  bufferlist out;
+  ASSERT_EQ(0, ECUtil::decode(s, direct, chunks, &out));
+  ASSERT_TRUE(in.contents_equal(out));
+  bufferlist recovered;
+  map<int, bufferlist*> to_recover;
+  to_recover[0] = &recovered;
+  ASSERT_EQ(0, ECUtil::decode(s, direct, chunks, to_recover));
+  ASSERT_TRUE(expected[0].contents_equal(recovered));
+}
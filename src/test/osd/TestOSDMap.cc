@@ -400,3 +400,57 @@ TEST_F(OSDMapTest, PrimaryAffinity) {
     osdmap.set_primary_affinity(1, 0x10000);
   }
 }
+
+TEST_F(OSDMapTest, PGMappingMatches) {
+  set_up_map();
+
+  // give the replicated pool some temp mappings so we cover those too
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, 0, -1));
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+                              &acting_osds, &acting_primary);
+  {
+    OSDMap::Incremental pgtemp_map(osdmap.get_epoch() + 1);
+    vector<int> new_acting_osds(acting_osds.rbegin(), acting_osds.rend());
+    pgtemp_map.new_pg_temp[pgid] = new_acting_osds;
+    pgtemp_map.new_primary_affinity[2] = 0x4000;
+    osdmap.apply_incremental(pgtemp_map);
+  }
+
+  // remember the CRUSH results for every pg, raw and folded
+  map<pg_t, vector<int> > ups, actings;
+  map<pg_t, int> up_primaries, acting_primaries;
+  const map<int64_t,pg_pool_t>& pools = osdmap.get_pools();
+  for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin();
+       p != pools.end(); ++p) {
+    for (unsigned ps = 0; ps < p->second.get_pg_num() * 4; ++ps) {
+      pg_t pg(ps, p->first, -1);
+      osdmap.pg_to_up_acting_osds(pg, &ups[pg], &up_primaries[pg],
+                                  &actings[pg], &acting_primaries[pg]);
+    }
+  }
+
+  ASSERT_FALSE(osdmap.have_pg_mapping());
+  osdmap.build_pg_mapping();
+  ASSERT_TRUE(osdmap.have_pg_mapping());
+  ASSERT_LT(0u, osdmap.get_pg_mapping_bytes());
+
+  for (map<pg_t, vector<int> >::iterator p = ups.begin();
+       p != ups.end(); ++p) {
+    osdmap.pg_to_up_acting_osds(p->first, &up_osds, &up_primary,
+                                &acting_osds, &acting_primary);
+    ASSERT_EQ(ups[p->first], up_osds);
+    ASSERT_EQ(up_primaries[p->first], up_primary);
+    ASSERT_EQ(actings[p->first], acting_osds);
+    ASSERT_EQ(acting_primaries[p->first], acting_primary);
+  }
+
+  // any change to the map drops the table
+  osdmap.set_primary_affinity(2, 0x10000);
+  ASSERT_FALSE(osdmap.have_pg_mapping());
+  osdmap.build_pg_mapping();
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  osdmap.apply_incremental(inc);
+  ASSERT_FALSE(osdmap.have_pg_mapping());
+}
@@ -0,0 +1,116 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "common/Formatter.h"
+#include "osd/ScrubThrottle.h"
+
+static utime_t at(double t)
+{
+  utime_t u;
+  u.set_from_double(1000 + t);
+  return u;
+}
+
+TEST(ScrubThrottle, Unlimited)
+{
+  ScrubThrottle t;
+  t.take(at(0), 1ull << 40, 1000000);
+  EXPECT_EQ(utime_t(), t.get_delay(at(0)));
+}
+
+TEST(ScrubThrottle, Bytes)
+{
+  ScrubThrottle t;
+  t.set_limits(1000, 0);
+  t.take(at(0), 500, 10);
+  // within the one second burst
+  EXPECT_EQ(utime_t(), t.get_delay(at(0)));
+  t.take(at(0), 2500, 10);
+  // 2000 bytes of debt at 1000/s
+  EXPECT_DOUBLE_EQ(2.0, (double)t.get_delay(at(0)));
+  EXPECT_DOUBLE_EQ(1.0, (double)t.get_delay(at(1)));
+  EXPECT_EQ(utime_t(), t.get_delay(at(2)));
+  // the bucket never holds more than one second worth
+  t.take(at(100), 2000, 0);
+  EXPECT_DOUBLE_EQ(1.0, (double)t.get_delay(at(100)));
+}
+
+TEST(ScrubThrottle, Ops)
+{
+  ScrubThrottle t;
+  t.set_limits(0, 10);
+  t.take(at(0), 1ull << 30, 30);
+  EXPECT_DOUBLE_EQ(2.0, (double)t.get_delay(at(0)));
+  // raising the limit forgives the debt
+  t.set_limits(0, 100);
+  EXPECT_EQ(utime_t(), t.get_delay(at(0)));
+}
+
+TEST(ScrubThrottle, Peek)
+{
+  ScrubThrottle t;
+  t.set_limits(1000, 0);
+  t.take(at(0), 3000, 10);
+  EXPECT_DOUBLE_EQ(2.0, (double)t.get_delay(at(0)));
+  // rechecking after the sleep must not count the chunk twice
+  EXPECT_DOUBLE_EQ(1.0, (double)t.peek_delay(at(1)));
+  EXPECT_EQ(utime_t(), t.peek_delay(at(2)));
+
+  JSONFormatter f;
+  f.open_object_section("throttle");
+  t.dump(&f, at(2));
+  f.close_section();
+  ostringstream ss;
+  f.flush(ss);
+  EXPECT_NE(string::npos, ss.str().find("\"num_throttled\":1,"));
+}
+
+TEST(ScrubThrottle, ClientLatency)
+{
+  ScrubThrottle t;
+  utime_t fast, slow;
+  fast.set_from_double(.001);
+  slow.set_from_double(.5);
+
+  // disabled: samples are ignored
+  for (unsigned i = 0; i < 100; ++i)
+    t.note_client_latency(at(0), slow);
+  EXPECT_EQ(0.0, t.get_client_latency(at(0)));
+
+  t.set_latency_limit(.1, 90, 10);
+
+  // too few samples to judge
+  for (unsigned i = 0; i < ScrubThrottle::MIN_LATENCY_SAMPLES - 1; ++i)
+    t.note_client_latency(at(0), slow);
+  EXPECT_EQ(utime_t(), t.get_delay(at(0)));
+
+  // 5% slow is under the 90th percentile
+  for (unsigned i = 0; i < 200; ++i)
+    t.note_client_latency(at(1), fast);
+  EXPECT_EQ(utime_t(), t.get_delay(at(1)));
+
+  // 50% slow is not
+  for (unsigned i = 0; i < 200; ++i)
+    t.note_client_latency(at(2), slow);
+  bool paused = false;
+  utime_t d = t.get_delay(at(2), &paused);
+  EXPECT_TRUE(paused);
+  // until the oldest sample ages out
+  EXPECT_DOUBLE_EQ(8.0, (double)d);
+
+  // once the slow samples age out we run again
+  EXPECT_EQ(utime_t(), t.get_delay(at(13), &paused));
+  EXPECT_FALSE(paused);
+}
@@ -159,6 +159,75 @@ TEST_F(ExplicitHashHitSetTest, RejectsNoMatch) {
   EXPECT_EQ(matches, 0);
 }
 
+TEST_F(ExplicitHashHitSetTest, EncodeDecode) {
+  fill(1000);
+  bufferlist bl;
+  ::encode(*hitset, bl, CEPH_FEATURES_ALL);
+  // consecutive hashes take a byte each
+  EXPECT_GT(2000u, bl.length());
+
+  HitSet decoded;
+  bufferlist::iterator p = bl.begin();
+  ::decode(decoded, p);
+  ASSERT_EQ(HitSet::TYPE_EXPLICIT_HASH, decoded.impl->get_type());
+  EXPECT_EQ(1000u, decoded.insert_count());
+  EXPECT_EQ(1000u, decoded.approx_unique_insert_count());
+  HitSet *orig = hitset;
+  hitset = &decoded;
+  verify_fill(1000);
+  hitset = orig;
+  EXPECT_FALSE(decoded.contains(hobject_t(object_t("x"), "", 0, 1000, 0, "")));
+}
+
+TEST_F(ExplicitHashHitSetTest, DecodeV1) {
+  ceph::unordered_set<uint32_t> hits;
+  hits.insert(1);
+  hits.insert(0xffffffff);
+  bufferlist bl;
+  ENCODE_START(1, 1, bl);
+  ::encode((uint64_t)3, bl);
+  ::encode(hits, bl);
+  ENCODE_FINISH(bl);
+
+  ExplicitHashHitSet decoded;
+  bufferlist::iterator p = bl.begin();
+  decoded.decode(p);
+  EXPECT_EQ(3u, decoded.insert_count());
+  EXPECT_TRUE(decoded.contains(hobject_t(object_t("a"), "", 0, 1, 0, "")));
+  EXPECT_TRUE(decoded.contains(hobject_t(object_t("b"), "", 0, 0xffffffff,
+					 0, "")));
+}
+
+// what a decoder that only knows v1 does
+static void decode_v1(bufferlist& bl, uint64_t *count,
+		      ceph::unordered_set<uint32_t> *hits)
+{
+  bufferlist::iterator p = bl.begin();
+  DECODE_START(1, p);
+  ::decode(*count, p);
+  ::decode(*hits, p);
+  DECODE_FINISH(p);
+}
+
+TEST_F(ExplicitHashHitSetTest, EncodeForOldPeers) {
+  fill(50);
+  uint64_t count = 0;
+  ceph::unordered_set<uint32_t> hits;
+
+  // a v1 decoder must refuse v2 rather than see an empty set
+  bufferlist v2;
+  get_hitset()->encode(v2, CEPH_FEATURES_ALL);
+  EXPECT_THROW(decode_v1(v2, &count, &hits), buffer::error);
+
+  // and gets every hash when the peers lack the feature
+  bufferlist v1;
+  get_hitset()->encode(v1,
+		       CEPH_FEATURES_ALL & ~CEPH_FEATURE_OSD_HITSET_COMPACT);
+  decode_v1(v1, &count, &hits);
+  EXPECT_EQ(50u, count);
+  EXPECT_EQ(50u, hits.size());
+}
+
 class ExplicitObjectHitSetTest : public testing::Test, public HitSetTestStrap {
 public:
 
@@ -0,0 +1,139 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * Compare the cost of mapping pgs with CRUSH against lookups in the
+ * precomputed table built by OSDMap::build_pg_mapping().
+ *
+ * Prints one line per mode: mode, total seconds, lookups, ns/lookup.
+ */
+
+#include <boost/program_options/option.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <iostream>
+
+#include "osd/OSDMap.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include "common/common_init.h"
+#include "common/ceph_argparse.h"
+#include "common/config.h"
+#include "common/Clock.h"
+#include "include/utime.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+static void build_map(OSDMap& osdmap, int num_osds, int pg_bits)
+{
+  uuid_d fsid;
+  osdmap.build_simple(g_ceph_context, 0, fsid, num_osds, pg_bits, pg_bits);
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.fsid = osdmap.get_fsid();
+  entity_addr_t addr;
+  for (int i = 0; i < num_osds; ++i) {
+    addr.nonce = i;
+    inc.new_state[i] = CEPH_OSD_EXISTS | CEPH_OSD_NEW;
+    inc.new_up_client[i] = addr;
+    inc.new_up_cluster[i] = addr;
+    inc.new_hb_back_up[i] = addr;
+    inc.new_hb_front_up[i] = addr;
+    inc.new_weight[i] = CEPH_OSD_IN;
+  }
+  osdmap.apply_incremental(inc);
+}
+
+static double run(const OSDMap& osdmap, uint64_t lookups)
+{
+  const map<int64_t,pg_pool_t>& pools = osdmap.get_pools();
+  vector<int> up, acting;
+  int up_primary, acting_primary;
+  utime_t start = ceph_clock_now(g_ceph_context);
+  uint64_t n = 0;
+  while (n < lookups) {
+    for (map<int64_t,pg_pool_t>::const_iterator p = pools.begin();
+	 p != pools.end() && n < lookups;
+	 ++p, ++n) {
+      // raw pg, as Objecter::_calc_target would see it
+      pg_t pgid(rand(), p->first, -1);
+      osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				  &acting, &acting_primary);
+    }
+  }
+  return ceph_clock_now(g_ceph_context) - start;
+}
+
+int main(int argc, char **argv)
+{
+  po::options_description desc("Allowed options");
+  desc.add_options()
+    ("help,h", "produce help message")
+    ("osds", po::value<int>()->default_value(100),
+     "number of osds in the map")
+    ("pg-bits", po::value<int>()->default_value(6),
+     "pg bits per osd for each default pool")
+    ("lookups", po::value<uint64_t>()->default_value(1000000),
+     "number of pg lookups per mode")
+    ;
+
+  po::variables_map vm;
+  po::parsed_options parsed =
+    po::command_line_parser(argc, argv).options(desc).allow_unregistered().run();
+  po::store(parsed, vm);
+  po::notify(vm);
+
+  vector<const char *> ceph_options, def_args;
+  vector<string> ceph_option_strings = po::collect_unrecognized(
+    parsed.options, po::include_positional);
+  for (vector<string>::iterator i = ceph_option_strings.begin();
+       i != ceph_option_strings.end();
+       ++i) {
+    ceph_options.push_back(i->c_str());
+  }
+
+  global_init(&def_args, ceph_options, CEPH_ENTITY_TYPE_CLIENT,
+	      CODE_ENVIRONMENT_UTILITY,
+	      CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+  g_ceph_context->_conf->set_val("osd_crush_chooseleaf_type", "0", false);
+  g_ceph_context->_conf->apply_changes(NULL);
+
+  if (vm.count("help")) {
+    cout << desc << std::endl;
+    return 1;
+  }
+
+  int num_osds = vm["osds"].as<int>();
+  uint64_t lookups = vm["lookups"].as<uint64_t>();
+
+  OSDMap osdmap;
+  build_map(osdmap, num_osds, vm["pg-bits"].as<int>());
+
+  double crush = run(osdmap, lookups);
+
+  utime_t start = ceph_clock_now(g_ceph_context);
+  osdmap.build_pg_mapping();
+  double build = ceph_clock_now(g_ceph_context) - start;
+
+  double table = run(osdmap, lookups);
+
+  cout << "build\t" << build << "\t" << osdmap.get_pg_mapping_bytes()
+       << " bytes" << std::endl;
+  cout << "crush\t" << crush << "\t" << lookups << "\t"
+       << (crush * 1000000000.0 / lookups) << std::endl;
+  cout << "table\t" << table << "\t" << lookups << "\t"
+       << (table * 1000000000.0 / lookups) << std::endl;
+  return 0;
+}
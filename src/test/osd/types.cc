@@ -1241,6 +1241,98 @@ TEST_F(ObjectContextTest, read_write_lock)
 
 }
 
+static OSDOp make_osd_op(int op)
+{
+  OSDOp o;
+  o.op.op = op;
+  return o;
+}
+
+TEST(OSDOp, have_known_extents) {
+  vector<OSDOp> ops;
+  EXPECT_TRUE(OSDOp::have_known_extents(ops));
+
+  // what librbd sends for an object write
+  ops.push_back(make_osd_op(CEPH_OSD_OP_SETALLOCHINT));
+  ops.push_back(make_osd_op(CEPH_OSD_OP_WRITE));
+  EXPECT_TRUE(OSDOp::have_known_extents(ops));
+
+  ops.push_back(make_osd_op(CEPH_OSD_OP_ASSERT_VER));
+  ops.push_back(make_osd_op(CEPH_OSD_OP_CMPXATTR));
+  ops.push_back(make_osd_op(CEPH_OSD_OP_ZERO));
+  ops.push_back(make_osd_op(CEPH_OSD_OP_SETXATTR));
+  ops.push_back(make_osd_op(CEPH_OSD_OP_READ));
+  EXPECT_TRUE(OSDOp::have_known_extents(ops));
+
+  ops.back().op.op = CEPH_OSD_OP_TRUNCATE;
+  EXPECT_FALSE(OSDOp::have_known_extents(ops));
+  ops.back().op.op = CEPH_OSD_OP_WRITEFULL;
+  EXPECT_FALSE(OSDOp::have_known_extents(ops));
+  ops.back().op.op = CEPH_OSD_OP_CALL;
+  EXPECT_FALSE(OSDOp::have_known_extents(ops));
+  ops.back().op.op = CEPH_OSD_OP_ROLLBACK;
+  EXPECT_FALSE(OSDOp::have_known_extents(ops));
+
+  // a write carrying a truncate
+  ops.pop_back();
+  ops[1].op.extent.truncate_seq = 1;
+  EXPECT_FALSE(OSDOp::have_known_extents(ops));
+}
+
+static pg_log_entry_t make_modify(const hobject_t &soid, eversion_t prior,
+				  eversion_t v, uint64_t off, uint64_t len)
+{
+  pg_log_entry_t e(pg_log_entry_t::MODIFY, soid, v, prior, 0,
+		   osd_reqid_t(), utime_t());
+  if (len) {
+    e.dirty_extents_valid = true;
+    e.dirty_extents.insert(off, len);
+  }
+  return e;
+}
+
+TEST(pg_log_t, get_dirty_extents) {
+  hobject_t a(object_t("a"), "", CEPH_NOSNAP, 1, 0, "");
+  hobject_t b(object_t("b"), "", CEPH_NOSNAP, 2, 0, "");
+  pg_log_t log;
+  log.log.push_back(make_modify(a, eversion_t(1, 1), eversion_t(1, 2), 0, 10));
+  log.log.push_back(make_modify(b, eversion_t(1, 1), eversion_t(1, 3), 0, 99));
+  log.log.push_back(make_modify(a, eversion_t(1, 2), eversion_t(1, 4), 5, 10));
+  log.log.push_back(make_modify(a, eversion_t(1, 4), eversion_t(1, 5), 100, 1));
+
+  interval_set<uint64_t> dirty;
+  ASSERT_TRUE(log.get_dirty_extents(a, eversion_t(1, 4), eversion_t(1, 5),
+				    &dirty));
+  EXPECT_EQ(1, dirty.size());
+  EXPECT_TRUE(dirty.contains(100, 1));
+
+  // other objects' entries are skipped, overlapping extents merge
+  dirty.clear();
+  ASSERT_TRUE(log.get_dirty_extents(a, eversion_t(1, 1), eversion_t(1, 5),
+				    &dirty));
+  EXPECT_EQ(16, dirty.size());
+  EXPECT_TRUE(dirty.contains(0, 15));
+  EXPECT_FALSE(dirty.contains(99, 1));
+
+  // newer entries than the wanted version are ignored
+  dirty.clear();
+  ASSERT_TRUE(log.get_dirty_extents(a, eversion_t(1, 2), eversion_t(1, 4),
+				    &dirty));
+  EXPECT_TRUE(dirty.contains(5, 10));
+  EXPECT_EQ(10, dirty.size());
+
+  // the log does not go back far enough
+  dirty.clear();
+  EXPECT_FALSE(log.get_dirty_extents(a, eversion_t(1, 0), eversion_t(1, 5),
+				     &dirty));
+
+  // an entry without extents, e.g. a truncate, spoils the chain
+  log.log.push_back(make_modify(a, eversion_t(1, 5), eversion_t(1, 6), 0, 0));
+  dirty.clear();
+  EXPECT_FALSE(log.get_dirty_extents(a, eversion_t(1, 4), eversion_t(1, 6),
+				     &dirty));
+}
+
 TEST(pg_pool_t_test, get_pg_num_divisor) {
   pg_pool_t p;
   p.set_pg_num(16);
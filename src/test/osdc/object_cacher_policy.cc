@@ -0,0 +1,279 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Replay a block trace against an ObjectCacher backed by FakeWriteback
+ * and report the read hit ratio under each replacement policy.
+ *
+ * With --trace the ops come from an rbd-replay-prep capture; otherwise
+ * a synthetic trace is used in which a small working set is re-read
+ * while a large sequential scan (think backup job) streams past it.
+ * In the synthetic case 2q is expected to beat lru and we exit non-zero
+ * if it does not.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/common_init.h"
+#include "common/config.h"
+#include "common/Cond.h"
+#include "common/Mutex.h"
+#include "common/snap_types.h"
+#include "global/global_init.h"
+#include "include/buffer.h"
+#include "include/Context.h"
+#include "osdc/ObjectCacher.h"
+#include "osdc/Striper.h"
+#include "rbd_replay/actions.hpp"
+#include "rbd_replay/Deser.hpp"
+
+#include "FakeWriteback.h"
+
+using namespace rbd_replay;
+
+struct trace_op {
+  uint64_t image;
+  uint64_t offset;
+  uint64_t length;
+  bool is_read;
+
+  trace_op(uint64_t i, uint64_t o, uint64_t l, bool r)
+    : image(i), offset(o), length(l), is_read(r) {}
+};
+
+struct replay_result {
+  uint64_t reads;
+  uint64_t read_hits;
+  uint64_t read_bytes;
+  uint64_t read_hit_bytes;
+
+  replay_result() : reads(0), read_hits(0), read_bytes(0), read_hit_bytes(0) {}
+
+  double op_ratio() const {
+    return reads ? (double)read_hits / (double)reads : 0;
+  }
+  double byte_ratio() const {
+    return read_bytes ? (double)read_hit_bytes / (double)read_bytes : 0;
+  }
+};
+
+static int load_trace(const std::string& path, std::vector<trace_op> *ops)
+{
+  std::ifstream input(path.c_str(), std::ios::in | std::ios::binary);
+  if (!input.is_open()) {
+    std::cerr << "unable to open " << path << std::endl;
+    return -ENOENT;
+  }
+  Deser deser(input);
+  while (true) {
+    Action::ptr action = Action::read_from(deser);
+    if (!action)
+      break;
+    if (AioReadAction *a = dynamic_cast<AioReadAction*>(action.get())) {
+      ops->push_back(trace_op(a->imagectx_id(), a->offset(), a->length(), true));
+    } else if (ReadAction *a = dynamic_cast<ReadAction*>(action.get())) {
+      ops->push_back(trace_op(a->imagectx_id(), a->offset(), a->length(), true));
+    } else if (AioWriteAction *a = dynamic_cast<AioWriteAction*>(action.get())) {
+      ops->push_back(trace_op(a->imagectx_id(), a->offset(), a->length(), false));
+    } else if (WriteAction *a = dynamic_cast<WriteAction*>(action.get())) {
+      ops->push_back(trace_op(a->imagectx_id(), a->offset(), a->length(), false));
+    }
+  }
+  return 0;
+}
+
+/*
+ * warm a working_set of hot blocks, then scan scan_size bytes
+ * sequentially, re-reading a random hot block after every
+ * scan_per_hot scan blocks.
+ */
+static void synthetic_trace(uint64_t block, uint64_t working_set,
+			    uint64_t scan_size, int scan_per_hot,
+			    std::vector<trace_op> *ops)
+{
+  uint64_t hot_blocks = working_set / block;
+  uint64_t scan_start = working_set;
+  for (int pass = 0; pass < 2; ++pass)
+    for (uint64_t i = 0; i < hot_blocks; ++i)
+      ops->push_back(trace_op(0, i * block, block, true));
+  for (uint64_t i = 0; i < scan_size / block; ++i) {
+    ops->push_back(trace_op(0, scan_start + i * block, block, true));
+    if (i % scan_per_hot == 0)
+      ops->push_back(trace_op(0, (random() % hot_blocks) * block, block, true));
+  }
+}
+
+static int replay(const std::vector<trace_op>& ops, const std::string& policy,
+		  uint64_t cache_size, replay_result *result)
+{
+  Mutex lock("object_cacher_policy::object_cacher");
+  FakeWriteback writeback(g_ceph_context, &lock, 0);
+  ObjectCacher obc(g_ceph_context, "policy-" + policy, writeback, lock,
+		   NULL, NULL,
+		   cache_size,
+		   1 << 20,          // objects are bounded by cache_size instead
+		   cache_size / 2,   // max dirty
+		   cache_size / 4,   // target dirty
+		   1.0,
+		   true);
+  if (!obc.set_replacement_policy(policy))
+    return -EINVAL;
+  obc.start();
+
+  ceph_file_layout layout;
+  memset(&layout, 0, sizeof(layout));
+  layout.fl_object_size = 4 << 20;
+  layout.fl_stripe_unit = 4 << 20;
+  layout.fl_stripe_count = 1;
+
+  ObjectCacher::ObjectSet object_set(NULL, 0, 0);
+  SnapContext snapc;
+
+  for (std::vector<trace_op>::const_iterator p = ops.begin();
+       p != ops.end();
+       ++p) {
+    if (p->length == 0)
+      continue;
+    std::vector<ObjectExtent> extents;
+    Striper::file_to_extents(g_ceph_context, p->image + 1, &layout,
+			     p->offset, p->length, 0, extents);
+    for (std::vector<ObjectExtent>::iterator q = extents.begin();
+	 q != extents.end();
+	 ++q)
+      q->oloc.pool = 0;
+
+    if (p->is_read) {
+      bufferlist bl;
+      ObjectCacher::OSDRead *rd = obc.prepare_read(CEPH_NOSNAP, &bl, 0);
+      rd->extents = extents;
+
+      Mutex mylock("object_cacher_policy::read");
+      Cond cond;
+      bool done = false;
+      int r = 0;
+      Context *onfinish = new C_SafeCond(&mylock, &cond, &done, &r);
+      lock.Lock();
+      int ret = obc.readx(rd, &object_set, onfinish);
+      lock.Unlock();
+
+      ++result->reads;
+      result->read_bytes += p->length;
+      if (ret != 0) {
+	delete onfinish;
+	if (ret < 0) {
+	  std::cerr << "read " << p->offset << "~" << p->length
+		    << " failed: " << ret << std::endl;
+	  obc.stop();
+	  return ret;
+	}
+	++result->read_hits;
+	result->read_hit_bytes += p->length;
+      } else {
+	mylock.Lock();
+	while (!done)
+	  cond.Wait(mylock);
+	mylock.Unlock();
+      }
+    } else {
+      bufferptr bp(p->length);
+      bp.zero();
+      bufferlist bl;
+      bl.append(bp);
+      ObjectCacher::OSDWrite *wr = obc.prepare_write(snapc, bl, utime_t(), 0);
+      wr->extents = extents;
+      lock.Lock();
+      obc.writex(wr, &object_set, lock, NULL);
+      lock.Unlock();
+    }
+  }
+
+  Mutex mylock("object_cacher_policy::flush");
+  Cond cond;
+  bool done = false;
+  int r = 0;
+  Context *onfinish = new C_SafeCond(&mylock, &cond, &done, &r);
+  lock.Lock();
+  bool already_flushed = obc.flush_set(&object_set, onfinish);
+  lock.Unlock();
+  if (already_flushed) {
+    delete onfinish;
+  } else {
+    mylock.Lock();
+    while (!done)
+      cond.Wait(mylock);
+    mylock.Unlock();
+  }
+
+  lock.Lock();
+  obc.release_set(&object_set);
+  lock.Unlock();
+  obc.stop();
+  return 0;
+}
+
+int main(int argc, const char **argv)
+{
+  std::vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  env_to_vec(args);
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  std::string trace;
+  long long cache_size = 16 << 20;
+  int seed = 0;
+  std::ostringstream err;
+  std::vector<const char*>::iterator i;
+  for (i = args.begin(); i != args.end();) {
+    if (ceph_argparse_witharg(args, i, &trace, "--trace", (char*)NULL)) {
+    } else if (ceph_argparse_withlonglong(args, i, &cache_size, &err, "--cache-size", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << argv[0] << ": " << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+    } else if (ceph_argparse_withint(args, i, &seed, &err, "--seed", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << argv[0] << ": " << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+    } else {
+      cerr << "unknown option " << *i << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  srandom(seed);
+
+  std::vector<trace_op> ops;
+  if (trace.empty()) {
+    // working set of half the cache, scan eight times the cache
+    synthetic_trace(64 << 10, cache_size / 2, cache_size * 8, 4, &ops);
+  } else if (load_trace(trace, &ops) < 0) {
+    return EXIT_FAILURE;
+  }
+  std::cout << ops.size() << " ops, cache size " << cache_size << std::endl;
+
+  const char *policies[] = { "lru", "2q" };
+  replay_result results[2];
+  for (int p = 0; p < 2; ++p) {
+    if (replay(ops, policies[p], cache_size, &results[p]) < 0)
+      return EXIT_FAILURE;
+    std::cout << policies[p] << ": "
+	      << results[p].read_hits << "/" << results[p].reads
+	      << " reads hit (" << results[p].op_ratio() << "), "
+	      << results[p].read_hit_bytes << "/" << results[p].read_bytes
+	      << " bytes (" << results[p].byte_ratio() << ")" << std::endl;
+  }
+
+  if (trace.empty() && results[1].op_ratio() <= results[0].op_ratio()) {
+    std::cerr << "2q did not improve on lru for a scan over a working set"
+	      << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
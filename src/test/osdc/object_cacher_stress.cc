@@ -52,7 +52,7 @@ public:
 
 int stress_test(uint64_t num_ops, uint64_t num_objs,
 		uint64_t max_obj_size, uint64_t delay_ns,
-		uint64_t max_op_len, float percent_reads)
+		uint64_t max_op_len, float percent_reads, bool quiet)
 {
   Mutex lock("object_cacher_stress::object_cacher");
   FakeWriteback writeback(g_ceph_context, &lock, delay_ns);
@@ -84,6 +84,8 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
 	    << setw(10) << "max op len: " << max_op_len << "\n"
 	    << setw(10) << "percent reads: " << percent_reads << "\n\n";
 
+  utime_t start = ceph_clock_now(g_ceph_context);
+
   for (uint64_t i = 0; i < num_ops; ++i) {
     uint64_t offset = random() % max_obj_size;
     uint64_t max_len = MIN(max_obj_size - offset, max_op_len);
@@ -93,8 +95,9 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
     bool is_read = random() < percent_reads * RAND_MAX;
     ceph::shared_ptr<op_data> op(new op_data(oid, offset, length, is_read));
     ops.push_back(op);
-    std::cout << "op " << i << " " << (is_read ? "read" : "write")
-	      << " " << op->extent << "\n";
+    if (!quiet)
+      std::cout << "op " << i << " " << (is_read ? "read" : "write")
+		<< " " << op->extent << "\n";
     if (op->is_read) {
       ObjectCacher::OSDRead *rd = obc.prepare_read(CEPH_NOSNAP, &op->result, 0);
       rd->extents.push_back(op->extent);
@@ -121,7 +124,8 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
   for (uint64_t i = 0; i < num_ops; ++i) {
     if (!ops[i]->is_read)
       continue;
-    std::cout << "waiting for read " << i << ops[i]->extent << std::endl;
+    if (!quiet)
+      std::cout << "waiting for read " << i << ops[i]->extent << std::endl;
     uint64_t done = 0;
     while (done == 0) {
       done = ops[i]->done.read();
@@ -165,6 +169,11 @@ int stress_test(uint64_t num_ops, uint64_t num_objs,
 
   obc.stop();
 
+  utime_t elapsed = ceph_clock_now(g_ceph_context) - start;
+  std::cout << "Completed " << num_ops << " ops in " << elapsed
+	    << " seconds (" << (double)num_ops / (double)elapsed
+	    << " ops/sec)" << std::endl;
+
   std::cout << "Test completed successfully." << std::endl;
 
   return EXIT_SUCCESS;
@@ -184,6 +193,7 @@ int main(int argc, const char **argv)
   long long num_objs = 10;
   float percent_reads = 0.90;
   int seed = time(0) % 100000;
+  bool quiet = false;
   std::ostringstream err;
   std::vector<const char*>::iterator i;
   for (i = args.begin(); i != args.end();) {
@@ -222,6 +232,8 @@ int main(int argc, const char **argv)
 	cerr << argv[0] << ": " << err.str() << std::endl;
 	return EXIT_FAILURE;
       }
+    } else if (ceph_argparse_flag(args, i, "--quiet", (char*)NULL)) {
+      quiet = true;
     } else {
       cerr << "unknown option " << *i << std::endl;
       return EXIT_FAILURE;
@@ -229,5 +241,6 @@ int main(int argc, const char **argv)
   }
 
   srandom(seed);
-  return stress_test(num_ops, num_objs, obj_bytes, delay_ns, max_len, percent_reads);
+  return stress_test(num_ops, num_objs, obj_bytes, delay_ns, max_len,
+		     percent_reads, quiet);
 }
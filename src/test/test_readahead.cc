@@ -0,0 +1,151 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "gtest/gtest.h"
+
+#include "osdc/Readahead.h"
+
+static const uint64_t LIMIT = 1ull << 30;
+
+static void setup(Readahead *ra)
+{
+  ra->set_trigger_requests(3);
+  ra->set_min_readahead_size(4096);
+  ra->set_max_readahead_size(16384);
+}
+
+TEST(Readahead, SequentialTrigger)
+{
+  Readahead ra;
+  setup(&ra);
+
+  Readahead::update_t r1, r2, r3;
+  ra.update(0, 1024, LIMIT, &r1);
+  ra.update(1024, 1024, LIMIT, &r2);
+  ASSERT_TRUE(r1.extents.empty());
+  ASSERT_TRUE(r2.extents.empty());
+
+  ra.update(2048, 1024, LIMIT, &r3);
+  ASSERT_EQ(1u, r3.extents.size());
+  ASSERT_EQ(3072u, r3.extents[0].first);
+  ASSERT_EQ(4096u, r3.extents[0].second);
+  ASSERT_EQ(4096u, r3.bytes);
+}
+
+TEST(Readahead, RandomNoTrigger)
+{
+  Readahead ra;
+  setup(&ra);
+
+  uint64_t offsets[] = { 81920, 4096, 65536, 0, 32768, 12288 };
+  for (unsigned i = 0; i < sizeof(offsets) / sizeof(offsets[0]); ++i) {
+    Readahead::update_t r;
+    ra.update(offsets[i], 1024, LIMIT, &r);
+    ASSERT_TRUE(r.extents.empty());
+  }
+}
+
+TEST(Readahead, WindowGrowsWithHits)
+{
+  Readahead ra;
+  setup(&ra);
+
+  uint64_t issued = 0, hit = 0, last_len = 0;
+  for (uint64_t off = 0; off < 256 * 1024; off += 1024) {
+    Readahead::update_t r;
+    ra.update(off, 1024, LIMIT, &r);
+    ASSERT_EQ(0u, r.waste_bytes);
+    issued += r.bytes;
+    hit += r.hit_bytes;
+    if (!r.extents.empty())
+      last_len = r.extents.back().second;
+  }
+  ASSERT_GT(issued, 0u);
+  ASSERT_GT(hit, 0u);
+  ASSERT_LE(hit, issued);
+  // grew from the minimum window towards the maximum
+  ASSERT_GT(last_len, 4096u);
+  ASSERT_LE(last_len, 16384u);
+}
+
+TEST(Readahead, BreakCountsWaste)
+{
+  Readahead ra;
+  setup(&ra);
+
+  Readahead::update_t r;
+  for (uint64_t off = 0; off < 3 * 1024; off += 1024)
+    ra.update(off, 1024, LIMIT, &r);
+  ASSERT_EQ(4096u, r.bytes);
+
+  // jump elsewhere before reading any of it
+  Readahead::update_t w;
+  ra.update(1 << 20, 1024, LIMIT, &w);
+  ASSERT_EQ(4096u, w.waste_bytes);
+  ASSERT_EQ(0u, w.hit_bytes);
+  ASSERT_TRUE(w.extents.empty());
+}
+
+TEST(Readahead, Limit)
+{
+  Readahead ra;
+  setup(&ra);
+
+  Readahead::update_t r;
+  for (uint64_t off = 0; off < 3 * 1024; off += 1024)
+    ra.update(off, 1024, 5000, &r);
+  ASSERT_EQ(1u, r.extents.size());
+  ASSERT_EQ(3072u, r.extents[0].first);
+  ASSERT_EQ(5000u - 3072u, r.extents[0].second);
+}
+
+TEST(Readahead, Alignment)
+{
+  Readahead ra;
+  setup(&ra);
+  std::vector<uint64_t> alignments;
+  alignments.push_back(512);
+  alignments.push_back(4096);
+  ra.set_alignments(alignments);
+
+  Readahead::update_t r;
+  for (uint64_t off = 0; off < 3 * 1024; off += 1024)
+    ra.update(off, 1024, LIMIT, &r);
+  // 3072 + 4096 = 7168 is trimmed back to the 4096 boundary
+  ASSERT_EQ(1u, r.extents.size());
+  ASSERT_EQ(3072u, r.extents[0].first);
+  ASSERT_EQ(1024u, r.extents[0].second);
+}
+
+TEST(Readahead, Strided)
+{
+  Readahead ra;
+  setup(&ra);
+
+  const uint64_t stride = 65536, len = 1024;
+  Readahead::update_t r;
+  ra.update(0, len, LIMIT, &r);
+  ra.update(stride, len, LIMIT, &r);
+  ASSERT_TRUE(r.extents.empty());
+  ra.update(2 * stride, len, LIMIT, &r);
+  ra.update(3 * stride, len, LIMIT, &r);
+  ASSERT_FALSE(r.extents.empty());
+  for (unsigned i = 0; i < r.extents.size(); ++i) {
+    ASSERT_EQ((4 + i) * stride, r.extents[i].first);
+    ASSERT_EQ(len, r.extents[i].second);
+  }
+
+  Readahead::update_t n;
+  ra.update(4 * stride, len, LIMIT, &n);
+  ASSERT_EQ(len, n.hit_bytes);
+  ASSERT_EQ(0u, n.waste_bytes);
+}
+
+TEST(Readahead, Pending)
+{
+  Readahead ra;
+  ra.inc_pending(2);
+  ra.dec_pending();
+  ra.dec_pending();
+  ra.wait_for_pending();
+}
@@ -23,6 +23,8 @@ using namespace librados;
 #include "common/ceph_argparse.h"
 #include "global/global_init.h"
 #include "common/Cond.h"
+#include "common/Mutex.h"
+#include "common/Thread.h"
 #include "common/debug.h"
 #include "common/errno.h"
 #include "common/Formatter.h"
@@ -63,12 +65,16 @@ void usage(ostream& out)
 "   rmpool <pool-name> [<pool-name> --yes-i-really-really-mean-it]\n"
 "                                    remove pool <pool-name>'\n"
 "   df                               show per-pool and total usage\n"
-"   ls                               list objects in pool\n\n"
+"   ls                               list objects in pool\n"
+"                                    (with --workers N, list N parts of\n"
+"                                    the pool in parallel; order is lost)\n\n"
 "   chown 123                        change the pool owner to auid 123\n"
 "\n"
 "OBJECT COMMANDS\n"
 "   get <obj-name> [outfile]         fetch object\n"
-"   put <obj-name> [infile]          write object\n"
+"   put <obj-name> [infile] [--offset offset]\n"
+"                                    write object, starting at offset\n"
+"                                    (default 0: replace the whole object)\n"
 "   truncate <obj-name> length       truncate object\n"
 "   create <obj-name> [category]     create object\n"
 "   rm <obj-name> ...                remove object(s)\n"
@@ -404,7 +410,60 @@ static int do_copy_pool(Rados& rados, const char *src_pool, const char *target_p
   return 0;
 }
 
-static int do_put(IoCtx& io_ctx, const char *objname, const char *infile, int op_size)
+class ListWorker : public Thread {
+  IoCtx& io_ctx;
+  uint32_t num, index;
+  Mutex& out_lock;
+  ostream *out;
+public:
+  int r;
+  ListWorker(IoCtx& io_ctx, uint32_t num, uint32_t index,
+	     Mutex& out_lock, ostream *out)
+    : io_ctx(io_ctx), num(num), index(index),
+      out_lock(out_lock), out(out), r(0) {}
+
+  void *entry() {
+    try {
+      librados::ObjectIterator i = io_ctx.objects_begin_split(num, index);
+      librados::ObjectIterator i_end = io_ctx.objects_end();
+      for (; i != i_end; ++i) {
+	Mutex::Locker l(out_lock);
+	if (i->second.size())
+	  *out << i->first << "\t" << i->second << std::endl;
+	else
+	  *out << i->first << std::endl;
+      }
+    }
+    catch (const std::exception& e) {
+      Mutex::Locker l(out_lock);
+      cerr << e.what() << std::endl;
+      r = -1;
+    }
+    return NULL;
+  }
+};
+
+static int do_ls_parallel(IoCtx& io_ctx, ostream *out, int workers)
+{
+  Mutex out_lock("do_ls_parallel::out_lock");
+  vector<ListWorker*> threads;
+  for (int i = 0; i < workers; i++) {
+    threads.push_back(new ListWorker(io_ctx, workers, i, out_lock, out));
+    threads.back()->create();
+  }
+  int ret = 0;
+  for (vector<ListWorker*>::iterator p = threads.begin();
+       p != threads.end(); ++p) {
+    (*p)->join();
+    if ((*p)->r < 0)
+      ret = (*p)->r;
+    delete *p;
+  }
+  return ret;
+}
+
+static int do_put(IoCtx& io_ctx, const char *objname, const char *infile, int op_size,
+		  uint64_t obj_offset)
 {
   string oid(objname);
   bufferlist indata;
@@ -422,7 +481,7 @@ static int do_put(IoCtx& io_ctx, const char *objname, const char *infile, int op
   }
   char *buf = new char[op_size];
   int count = op_size;
-  uint64_t offset = 0;
+  uint64_t offset = obj_offset;
   while (count != 0) {
     count = read(fd, buf, op_size);
     if (count < 0) {
@@ -1177,6 +1236,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   const char *target_pool_name = NULL;
   string oloc, target_oloc, nspace;
   int concurrent_ios = 16;
+  int workers = 1;
   unsigned op_size = default_op_size;
   bool cleanup = true;
   const char *snapname = NULL;
@@ -1184,6 +1244,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   std::map<std::string, std::string>::const_iterator i;
   std::string category;
 
+  uint64_t obj_offset = 0;
   uint64_t min_obj_len = 0;
   uint64_t max_obj_len = 0;
   uint64_t min_op_len = 0;
@@ -1234,6 +1295,14 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   if (i != opts.end()) {
     concurrent_ios = strtol(i->second.c_str(), NULL, 10);
   }
+  i = opts.find("workers");
+  if (i != opts.end()) {
+    workers = strtol(i->second.c_str(), NULL, 10);
+    if (workers < 1) {
+      cerr << "--workers must be at least 1" << std::endl;
+      return -EINVAL;
+    }
+  }
   i = opts.find("run-name");
   if (i != opts.end()) {
     run_name = i->second.c_str();
@@ -1254,6 +1323,10 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   if (i != opts.end()) {
     snapid = strtoll(i->second.c_str(), NULL, 10);
   }
+  i = opts.find("offset");
+  if (i != opts.end()) {
+    obj_offset = strtoull(i->second.c_str(), NULL, 10);
+  }
   i = opts.find("min-object-size");
   if (i != opts.end()) {
     min_obj_len = strtoll(i->second.c_str(), NULL, 10);
@@ -1543,7 +1616,11 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
     else
       outstream = new ofstream(nargs[1]);
 
-    {
+    if (workers > 1) {
+      ret = do_ls_parallel(io_ctx, outstream, workers);
+      if (ret < 0)
+	goto out;
+    } else {
       try {
 	librados::ObjectIterator i = io_ctx.objects_begin();
 	librados::ObjectIterator i_end = io_ctx.objects_end();
@@ -1618,7 +1695,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   else if (strcmp(nargs[0], "put") == 0) {
     if (!pool_name || nargs.size() < 3)
       usage_exit();
-    ret = do_put(io_ctx, nargs[1], nargs[2], op_size);
+    ret = do_put(io_ctx, nargs[1], nargs[2], op_size, obj_offset);
     if (ret < 0) {
       cerr << "error putting " << pool_name << "/" << nargs[1] << ": " << cpp_strerror(ret) << std::endl;
       goto out;
@@ -2605,6 +2682,8 @@ int main(int argc, const char **argv)
       opts["category"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-t", "--concurrent-ios", (char*)NULL)) {
       opts["concurrent-ios"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--workers", (char*)NULL)) {
+      opts["workers"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--block-size", (char*)NULL)) {
       opts["block-size"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-b", (char*)NULL)) {
@@ -2613,6 +2692,8 @@ int main(int argc, const char **argv)
       opts["snap"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-S", "--snapid", (char*)NULL)) {
       opts["snapid"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--offset", (char*)NULL)) {
+      opts["offset"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--min-object-size", (char*)NULL)) {
       opts["min-object-size"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--max-object-size", (char*)NULL)) {